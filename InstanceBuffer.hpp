@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "assets.hpp"
+
+// Per-instance attributes for Mesh::drawInstanced (locations 4 and 5)
+struct mesh_instance {
+    glm::vec3 offset;   // object -> world translation
+    float layer;        // texture layer of the instance
+    glm::vec3 scale;    // per-axis scale, applied before the offset
+    float padding;
+};
+
+// GPU buffer of mesh_instance records, one glDrawElementsInstanced per buffer
+class InstanceBuffer {
+public:
+    GLuint buffer{ 0 };
+    GLsizei count{ 0 };
+
+    void upload(const std::vector<mesh_instance>& instances) {
+        if (!buffer) glCreateBuffers(1, &buffer);
+        count = static_cast<GLsizei>(instances.size());
+        glNamedBufferData(buffer, instances.size() * sizeof(mesh_instance), instances.data(), GL_STATIC_DRAW);
+    }
+
+    void clear() {
+        if (buffer) glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        count = 0;
+    }
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <iostream>
@@ -9,7 +11,14 @@
 
 #include "assets.hpp"
 #include "ShaderProgram.hpp"
+#include "InstanceBuffer.hpp"
+#include "gpu_geometry.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplify.hpp"
+#include "vertex_packing.hpp"
 
+// Shader, material and placement around shared GPU geometry. Copies of a
+// Mesh share the same buffers; no CPU copy of the vertices is kept.
 class Mesh {
 public:
     glm::vec3 origin{};
@@ -24,68 +33,247 @@ public:
     glm::vec4 specular_material{ 1.0f };
     float reflectivity{ 1.0f };
 
+    // object-space bounding box
+    glm::vec3 bounds_min{ 0.0f };
+    glm::vec3 bounds_max{ 0.0f };
+
+    // Reorder triangles/vertices for the post-transform cache, overdraw and fetch
+    // locality when meshes are built (app_settings.json: "optimize_meshes")
+    static inline bool optimize_on_load = false;
+
+    // GPU vertex layout (app_settings.json: "vertex_format" = "float" | "packed");
+    // the .meshbin cache always keeps the float vertex
+    static inline VertexFormat vertex_format = VertexFormat::Float;
+    // upload vertex colors to attribute location 3 (no shader reads them yet)
+    static inline bool upload_colors = false;
+
+    // 16-bit indices halve the index buffer whenever the vertex count allows it
+    static bool fitsShortIndices(size_t vertex_count) { return vertex_count <= 0x10000; }
+
+    // Optimizes and simplifies a temporary copy of the data, uploads it and
+    // frees it again; a non-empty geometry_key registers the upload for sharing
     Mesh(GLenum primitive_type,
         ShaderProgram shader,
         const std::vector<vertex>& vertices,
         const std::vector<GLuint>& indices,
         const glm::vec3& origin,
         const glm::vec3& orientation,
-        GLuint texture_id = 0)
+        GLuint texture_id = 0,
+        const std::vector<float>& lod_ratios = {},
+        const std::string& geometry_key = "")
         : primitive_type(primitive_type),
         shader(shader),
-        vertices(vertices),
-        indices(indices),
         origin(origin),
         orientation(orientation),
         texture_id(texture_id)
     {
-        glCreateVertexArrays(1, &VAO);
-        glCreateBuffers(1, &VBO);
-        glCreateBuffers(1, &EBO);
-
-        glNamedBufferData(VBO, vertices.size() * sizeof(vertex), vertices.data(), GL_STATIC_DRAW);
-        glNamedBufferData(EBO, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        std::vector<vertex> vtx(vertices);
+        std::vector<GLuint> idx(indices);
+        std::vector<MeshLod> lods = prepare(primitive_type, vtx, idx, lod_ratios);
+        computeBounds(vtx, bounds_min, bounds_max);
+        geometry = uploadGeometry(geometry_key, vtx, idx, lods, bounds_min, bounds_max);
+        resolveUniforms();
+    }
 
-        glVertexArrayVertexBuffer(VAO, 0, VBO, 0, sizeof(vertex));
-        glVertexArrayElementBuffer(VAO, EBO);
+    // Uploads ready-made GPU streams (e.g. straight from a memory-mapped cache);
+    // empty lods means a single level
+    Mesh(GLenum primitive_type,
+        ShaderProgram shader,
+        const vertex* vertex_data, size_t vertex_count,
+        const void* index_data, size_t index_count, GLenum index_type,
+        const glm::vec3& bounds_min, const glm::vec3& bounds_max,
+        const glm::vec3& origin,
+        const glm::vec3& orientation,
+        GLuint texture_id = 0,
+        const std::vector<MeshLod>& lods = {},
+        const std::string& geometry_key = "")
+        : primitive_type(primitive_type),
+        shader(shader),
+        origin(origin),
+        orientation(orientation),
+        texture_id(texture_id),
+        bounds_min(bounds_min),
+        bounds_max(bounds_max)
+    {
+        geometry = std::make_shared<GpuGeometry>(geometry_key, vertex_data, vertex_count, index_data, index_count,
+            index_type, lods, bounds_min, bounds_max, vertex_format, upload_colors);
+        if (!geometry_key.empty()) GeometryRegistry::add(geometry_key, geometry);
+        resolveUniforms();
+    }
 
-        // Position -> location 0
-        glEnableVertexArrayAttrib(VAO, 0);
-        glVertexArrayAttribFormat(VAO, 0, 3, GL_FLOAT, GL_FALSE, offsetof(vertex, position));
-        glVertexArrayAttribBinding(VAO, 0, 0);
+    // Another drawable on already uploaded geometry (see GeometryRegistry)
+    Mesh(GLenum primitive_type,
+        ShaderProgram shader,
+        GeometryHandle geometry,
+        const glm::vec3& origin,
+        const glm::vec3& orientation,
+        GLuint texture_id = 0)
+        : primitive_type(primitive_type),
+        shader(shader),
+        origin(origin),
+        orientation(orientation),
+        texture_id(texture_id),
+        bounds_min(geometry->boundsMin()),
+        bounds_max(geometry->boundsMax()),
+        geometry(std::move(geometry))
+    {
+        resolveUniforms();
+    }
 
-        // Color -> location 1
-        glEnableVertexArrayAttrib(VAO, 1);
-        glVertexArrayAttribFormat(VAO, 1, 3, GL_FLOAT, GL_FALSE, offsetof(vertex, color));
-        glVertexArrayAttribBinding(VAO, 1, 0);
+    // CPU preprocessing done by the vector constructor, for callers that also
+    // need the final streams (e.g. to cache them): optional reordering, then
+    // the LOD chain appended to indices. Returns the level ranges.
+    static std::vector<MeshLod> prepare(GLenum primitive_type, std::vector<vertex>& vertices,
+        std::vector<GLuint>& indices, const std::vector<float>& lod_ratios)
+    {
+        if (optimize_on_load && primitive_type == GL_TRIANGLES && indices.size() >= 3)
+            optimize(vertices, indices);
 
-        // Texcoords -> location 2 (optional for now)
-        glEnableVertexArrayAttrib(VAO, 2);
-        glVertexArrayAttribFormat(VAO, 2, 2, GL_FLOAT, GL_FALSE, offsetof(vertex, texcoords));
-        glVertexArrayAttribBinding(VAO, 2, 0);
+        std::vector<MeshLod> lods{ { 0, static_cast<GLsizei>(indices.size()), 0.0f } };
+        if (primitive_type == GL_TRIANGLES && !lod_ratios.empty())
+            buildLods(vertices, indices, lods, lod_ratios);
+        return lods;
+    }
 
+    static void computeBounds(const std::vector<vertex>& vertices, glm::vec3& bounds_min, glm::vec3& bounds_max) {
+        bounds_min = bounds_max = vertices.empty() ? glm::vec3(0.0f) : vertices[0].position;
+        for (const vertex& v : vertices) {
+            bounds_min = glm::min(bounds_min, v.position);
+            bounds_max = glm::max(bounds_max, v.position);
+        }
+    }
 
+    // Uploads with 16-bit indices when they fit; registers non-empty keys
+    static GeometryHandle uploadGeometry(const std::string& key,
+        const std::vector<vertex>& vertices, const std::vector<GLuint>& indices,
+        const std::vector<MeshLod>& lods, const glm::vec3& bounds_min, const glm::vec3& bounds_max)
+    {
+        GeometryHandle geometry;
+        if (fitsShortIndices(vertices.size())) {
+            std::vector<GLushort> short_indices(indices.begin(), indices.end());
+            geometry = std::make_shared<GpuGeometry>(key, vertices.data(), vertices.size(),
+                short_indices.data(), short_indices.size(), GL_UNSIGNED_SHORT,
+                lods, bounds_min, bounds_max, vertex_format, upload_colors);
+        }
+        else {
+            geometry = std::make_shared<GpuGeometry>(key, vertices.data(), vertices.size(),
+                indices.data(), indices.size(), GL_UNSIGNED_INT,
+                lods, bounds_min, bounds_max, vertex_format, upload_colors);
+        }
+        if (!key.empty()) GeometryRegistry::add(key, geometry);
+        return geometry;
     }
 
     // In Mesh.hpp
-    void draw() {
-        shader.activate();
-        glBindVertexArray(VAO);
-        glDrawElements(primitive_type, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, nullptr);
+    void draw(size_t lod = 0) {
+        if (!geometry) return;
+        const MeshLod& level = geometry->lod(lod);
+
+        activateShader(false);
+        glBindVertexArray(geometry->vao());
+        glDrawElements(primitive_type, level.index_count, geometry->indexType(),
+            reinterpret_cast<const void*>(size_t(level.first_index) * geometry->indexSize()));
+        glBindVertexArray(0);
+    }
+
+    // One draw for every record in instances; uM_m still applies on top
+    void drawInstanced(const InstanceBuffer& instances, size_t lod = 0) {
+        if (!geometry || instances.count == 0) return;
+        const MeshLod& level = geometry->lod(lod);
+        geometry->bindInstances(instances.buffer);
+
+        activateShader(true);
+        glBindVertexArray(geometry->vao());
+        glDrawElementsInstanced(primitive_type, level.index_count, geometry->indexType(),
+            reinterpret_cast<const void*>(size_t(level.first_index) * geometry->indexSize()), instances.count);
         glBindVertexArray(0);
     }
 
+    void setModelMatrix(const glm::mat4& model_matrix) const { u.model.set(model_matrix); }
+    void setTextureLayer(int layer) const { u.texture_layer.set(layer); } // non-instanced draws
 
+    const GeometryHandle& getGeometry() const { return geometry; }
+
+    // lods[0] is the full mesh, further levels are progressively coarser
+    const std::vector<MeshLod>& getLods() const {
+        static const std::vector<MeshLod> none;
+        return geometry ? geometry->lods() : none;
+    }
+
+    GLenum indexType() const { return geometry ? geometry->indexType() : GL_UNSIGNED_INT; }
+    size_t vertexBufferBytes() const { return geometry ? geometry->vertexBytes() : 0; }
+
+    // Drops this mesh's reference; the buffers go with the last one
     void clear() {
-        if (VBO) glDeleteBuffers(1, &VBO);
-        if (EBO) glDeleteBuffers(1, &EBO);
-        if (VAO) glDeleteVertexArrays(1, &VAO);
-        VBO = EBO = VAO = 0;
+        geometry.reset();
     }
 
 private:
-    std::vector<vertex> vertices;
-    std::vector<GLuint> indices;
+    GeometryHandle geometry;
+
+    // per-draw uniforms, resolved once per mesh
+    struct {
+        Uniform<glm::mat4> model;
+        Uniform<glm::vec3> pos_offset, pos_scale;
+        Uniform<int> oct_normals, instanced, texture_layer;
+    } u;
 
-    GLuint VAO{ 0 }, VBO{ 0 }, EBO{ 0 };
+    void resolveUniforms() {
+        u.model = shader.uniform<glm::mat4>("uM_m");
+        u.pos_offset = shader.uniform<glm::vec3>("uPosOffset");
+        u.pos_scale = shader.uniform<glm::vec3>("uPosScale");
+        u.oct_normals = shader.uniform<int>("uOctNormals");
+        u.instanced = shader.uniform<int>("uInstanced");
+        u.texture_layer = shader.uniform<int>("uTextureLayer");
+    }
+
+    static void optimize(std::vector<vertex>& vertices, std::vector<GLuint>& indices) {
+        auto start = std::chrono::steady_clock::now();
+        size_t vertex_count = vertices.size();
+
+        VertexCacheStats before, after;
+        optimizeMesh(vertices, indices, &before, &after);
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "[MeshOpt] " << indices.size() / 3 << " triangles, " << vertex_count << " -> " << vertices.size()
+            << " vertices | ACMR " << before.acmr << " -> " << after.acmr
+            << " | ATVR " << before.atvr << " -> " << after.atvr << " | " << ms << " ms\n";
+    }
+
+    void activateShader(bool instanced) {
+        shader.activate();
+        u.pos_offset.set(geometry->positionOffset());
+        u.pos_scale.set(geometry->positionScale());
+        u.oct_normals.set(geometry->packed() ? 1 : 0);
+        u.instanced.set(instanced ? 1 : 0);
+    }
+
+    // Appends a simplified level per ratio (of the full triangle count) to the
+    // index buffer. Each level is simplified from the previous one, which is
+    // cheaper than starting from the full mesh every time.
+    static void buildLods(const std::vector<vertex>& vertices, std::vector<GLuint>& indices,
+        std::vector<MeshLod>& lods, const std::vector<float>& lod_ratios)
+    {
+        auto start = std::chrono::steady_clock::now();
+        const size_t full_count = indices.size();
+        std::vector<GLuint> level(indices);
+
+        for (float ratio : lod_ratios) {
+            if (ratio <= 0.0f || ratio >= 1.0f) continue;
+            size_t target = static_cast<size_t>(full_count * ratio) / 3 * 3;
+            float error = 0.0f;
+            level = simplifyMesh(vertices, level, target, &error);
+            if (level.empty() || level.size() >= static_cast<size_t>(lods.back().index_count))
+                break; // locked borders/seams, no further reduction possible
+
+            optimizeVertexCache(level, vertices.size());
+            lods.push_back({ static_cast<GLuint>(indices.size()), static_cast<GLsizei>(level.size()), error });
+            indices.insert(indices.end(), level.begin(), level.end());
+        }
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "[MeshLod] " << lods.size() << " levels:";
+        for (const MeshLod& lod : lods) std::cout << " " << lod.index_count / 3;
+        std::cout << " triangles | " << ms << " ms\n";
+    }
 };
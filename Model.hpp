@@ -1,7 +1,10 @@
 ﻿#pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
 #include <string>
+#include <sstream>
 #include <vector>
 #include <iostream>
 #include <glm/glm.hpp>
@@ -11,6 +14,7 @@
 #include "Mesh.hpp"
 #include "ShaderProgram.hpp"
 #include "OBJloader.h"
+#include "mesh_cache.hpp"
 
 class Model {
 public:
@@ -23,11 +27,38 @@ public:
     glm::vec3 scale{ 1.0f, 1.0f, 1.0f }; // default scale 1
     glm::mat4 local_model_matrix{ 1.0f }; // optional custom transform
     GLuint texture_ID{ 0 }; // each model can have its own texture
+    int texture_layer{ 0 }; // layer of texture_ID (a GL_TEXTURE_2D_ARRAY) for this model
 
 
     ShaderProgram shader;
     bool transparent{ false }; // ✅ transparency flag
 
+    // LOD chain built for loaded models, as fractions of the full triangle count
+    static inline std::vector<float> lod_ratios{ 0.5f, 0.25f, 0.1f };
+    // projected bounding sphere diameter (pixels) below which the next coarser
+    // level is used; lod_hysteresis widens each threshold to avoid popping
+    static inline std::vector<float> lod_screen_sizes{ 300.0f, 120.0f, 50.0f };
+    static inline float lod_hysteresis = 0.15f;
+
+    // Call when the projection or viewport changes / every frame for the eye
+    static void setLodProjection(const glm::mat4& projection, int viewport_height) {
+        lod_pixel_scale = projection[1][1] * 0.5f * static_cast<float>(viewport_height);
+    }
+    static void setLodEye(const glm::vec3& eye) { lod_eye = eye; }
+
+    // GeometryRegistry key of a loaded file: its path plus every load setting
+    // that changes what gets uploaded, so different settings never share
+    static std::string geometryKey(const std::filesystem::path& filename) {
+        std::ostringstream key;
+        key << filename.string() << (Mesh::optimize_on_load ? " [optimized" : " [raw")
+            << (Mesh::vertex_format == VertexFormat::Packed ? ", packed" : ", float") << ", lods";
+        for (float ratio : lod_ratios) key << ' ' << ratio;
+        key << ']';
+        return key.str();
+    }
+
+    size_t currentLod() const { return current_lod; }
+
     Model(const std::filesystem::path& filename, ShaderProgram shader)
         : shader(shader)
     {
@@ -38,31 +69,73 @@ public:
             return; // ✅ manually-added mesh will be used
         }
 
-        std::vector<glm::vec3> positions;
-        std::vector<glm::vec2> texcoords;
-        std::vector<glm::vec3> normals;
-
-        if (!loadOBJ(filename.string().c_str(), positions, texcoords, normals)) {
-            std::cerr << "[Model ERROR] Failed to load OBJ: " << filename << "\n";
+        using Clock = std::chrono::steady_clock;
+        auto ms_since = [](Clock::time_point t) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - t).count();
+        };
+        auto load_start = Clock::now();
+        name = filename.filename().string();
+        const std::string geometry_key = geometryKey(filename);
+        uint32_t cache_flags = Mesh::optimize_on_load ? MESHBIN_FLAG_OPTIMIZED : 0;
+
+        // Already uploaded by another model: share the buffers
+        if (GeometryHandle geometry = GeometryRegistry::find(geometry_key)) {
+            meshes.emplace_back(GL_TRIANGLES, shader, geometry, origin, orientation);
+            std::cout << "[Model] " << name << ": sharing uploaded geometry (" << geometry.use_count() - 1
+                << " users), " << ms_since(load_start) << " ms\n";
             return;
         }
 
+        // Warm start: upload straight from the memory-mapped .meshbin
+        {
+            MeshBinView cached;
+            if (loadMeshCache(filename, cache_flags, lod_ratios, cached)) {
+                const MeshBinHeader& h = *cached.header;
+                std::vector<MeshLod> lods;
+                for (uint32_t i = 0; i < h.lod_count; ++i)
+                    lods.push_back({ h.lods[i].first_index, static_cast<GLsizei>(h.lods[i].index_count), h.lods[i].error });
+
+                meshes.emplace_back(GL_TRIANGLES, shader,
+                    cached.vertices, h.vertex_count, cached.indices, h.index_count, h.index_type,
+                    glm::vec3(h.bounds_min[0], h.bounds_min[1], h.bounds_min[2]),
+                    glm::vec3(h.bounds_max[0], h.bounds_max[1], h.bounds_max[2]),
+                    origin, orientation, 0, lods, geometry_key);
+
+                std::cout << "[Model] " << name << ": warm start from " << meshCachePath(filename).filename().string()
+                    << " (" << h.vertex_count << " vertices, " << h.lod_count << " LODs, "
+                    << meshes.back().vertexBufferBytes() / 1024 << " KB VBO), " << ms_since(load_start) << " ms incl. upload\n";
+                return;
+            }
+        }
+
+        // Shared vertices for identical (v, vt, vn) corners + real index buffer
         std::vector<vertex> combined_vertices;
         std::vector<GLuint> indices;
-
-        for (size_t i = 0; i < positions.size(); ++i) {
-            vertex v{};
-            v.position = positions[i];
-            v.normal = (i < normals.size()) ? normals[i] : glm::vec3(0.0f);
-            v.texcoords = (i < texcoords.size()) ? texcoords[i] : glm::vec2(0.0f);
-            v.color = glm::vec3(1.0f, 0.0f, 0.0f); // fallback color
-            combined_vertices.push_back(v);
-            indices.push_back(static_cast<GLuint>(i));
+        if (!loadOBJIndexed(filename.string().c_str(), combined_vertices, indices)) {
+            std::cerr << "[Model ERROR] Failed to load OBJ: " << filename << "\n";
+            return;
         }
 
-        std::cout << "[Model] Loaded " << combined_vertices.size() << " vertices\n";
-        meshes.emplace_back(GL_TRIANGLES, shader, combined_vertices, indices, origin, orientation);
-        name = filename.filename().string();
+        double load_ms = ms_since(load_start);
+        size_t corner_count = indices.size(), unique_count = combined_vertices.size();
+        double dedup_ratio = unique_count == 0 ? 0.0 : double(corner_count) / unique_count;
+
+        // Preprocess here rather than in the Mesh so the final streams can be
+        // cached without the mesh keeping a CPU copy
+        std::vector<MeshLod> lods = Mesh::prepare(GL_TRIANGLES, combined_vertices, indices, lod_ratios);
+        glm::vec3 bounds_min, bounds_max;
+        Mesh::computeBounds(combined_vertices, bounds_min, bounds_max);
+        GeometryHandle geometry = Mesh::uploadGeometry(geometry_key, combined_vertices, indices, lods, bounds_min, bounds_max);
+        meshes.emplace_back(GL_TRIANGLES, shader, geometry, origin, orientation);
+
+        std::cout << "[Model] " << name << ": " << corner_count << " corners -> "
+            << unique_count << " unique vertices (dedup " << dedup_ratio << "x, "
+            << (geometry->indexType() == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices, "
+            << geometry->vertexBytes() / 1024 << " KB VBO), load " << load_ms << " ms, cold start "
+            << ms_since(load_start) << " ms incl. upload\n";
+
+        if (!saveMeshCache(filename, cache_flags, lod_ratios, combined_vertices, indices, lods, bounds_min, bounds_max))
+            std::cerr << "[Model] Could not write mesh cache for " << name << "\n";
     }
 
     void setTransparent(bool value) {
@@ -82,29 +155,88 @@ public:
         model_matrix = glm::rotate(model_matrix, rotation.z, glm::vec3(0, 0, 1));
         model_matrix = glm::scale(model_matrix, scale);
 
-        glBindTextureUnit(0, tex_ID); // bind texture
+        bindTexture(tex_ID);
 
+        selectLod(model_matrix);
         for (auto& mesh : meshes) {
-            mesh.shader.setUniform("uM_m", model_matrix);
-            mesh.draw();
+            mesh.setModelMatrix(model_matrix);
+            mesh.setTextureLayer(texture_layer);
+            mesh.draw(current_lod);
         }
 
         // Save matrix for transparency sorting
         local_model_matrix = model_matrix;
     }
 
+    // Draws every record of instances with a single instanced call per mesh;
+    // the instance offset/scale replace origin and scale
+    void drawInstanced(GLuint tex_ID, const InstanceBuffer& instances) {
+        bindTexture(tex_ID);
+        for (auto& mesh : meshes) {
+            mesh.setModelMatrix(glm::mat4(1.0f));
+            mesh.drawInstanced(instances);
+        }
+    }
+
     void draw(glm::mat4 const& model_matrix) {
         for (auto& mesh : meshes) {
             glm::mat4 final_model = model_matrix * local_model_matrix;
-            mesh.shader.setUniform("uM_m", final_model);
-            mesh.draw();
+            mesh.setModelMatrix(final_model);
+            mesh.setTextureLayer(texture_layer);
+            mesh.draw(current_lod);
         }
     }
 
+    // Texture unit 0 is only bound through here (the terrain too), so draws
+    // sharing a texture array skip the rebind
+    static void bindTexture(GLuint tex_ID) {
+        if (tex_ID == bound_texture) return;
+        glBindTextureUnit(0, tex_ID);
+        bound_texture = tex_ID;
+    }
+
     void clear() {
         for (auto& mesh : meshes) {
             mesh.clear();
         }
         meshes.clear();
     }
+
+private:
+    static inline glm::vec3 lod_eye{ 0.0f };
+    static inline float lod_pixel_scale{ 0.0f }; // 0 = LOD selection disabled
+
+    static inline GLuint bound_texture{ 0 };
+
+    size_t current_lod{ 0 };
+
+    // Picks the level from the projected size of the bounding sphere. A level
+    // changes only once the size is lod_hysteresis past the threshold, so a
+    // model hovering around a boundary does not flicker between levels.
+    void selectLod(const glm::mat4& model_matrix) {
+        size_t level_count = 1;
+        for (const auto& mesh : meshes) level_count = std::max(level_count, mesh.getLods().size());
+        if (level_count == 1 || lod_pixel_scale <= 0.0f) {
+            current_lod = 0;
+            return;
+        }
+
+        glm::vec3 bmin = meshes.front().bounds_min, bmax = meshes.front().bounds_max;
+        for (const auto& mesh : meshes) {
+            bmin = glm::min(bmin, mesh.bounds_min);
+            bmax = glm::max(bmax, mesh.bounds_max);
+        }
+        glm::vec3 center = glm::vec3(model_matrix * glm::vec4((bmin + bmax) * 0.5f, 1.0f));
+        float max_scale = std::max({ glm::length(glm::vec3(model_matrix[0])), glm::length(glm::vec3(model_matrix[1])),
+            glm::length(glm::vec3(model_matrix[2])) });
+        float radius = 0.5f * glm::length(bmax - bmin) * max_scale;
+        float distance = std::max(glm::length(center - lod_eye), 1e-3f);
+        float size_px = 2.0f * radius / distance * lod_pixel_scale;
+
+        size_t max_lod = std::min(level_count - 1, lod_screen_sizes.size());
+        size_t lod = std::min(current_lod, max_lod);
+        while (lod < max_lod && size_px < lod_screen_sizes[lod] * (1.0f - lod_hysteresis)) ++lod;
+        while (lod > 0 && size_px > lod_screen_sizes[lod - 1] * (1.0f + lod_hysteresis)) --lod;
+        current_lod = lod;
+    }
 };
@@ -1,105 +1,357 @@
-#include <string>
-#include <GL/glew.h> 
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <GL/glew.h>
 #include <glm/glm.hpp>
 
 #include "OBJloader.h"
+#include "mapped_file.hpp"
 
-#define MAX_LINE_SIZE 255
+// Chunks smaller than this are not worth a thread of their own
+#define MIN_CHUNK_SIZE (1u << 20)
 
-bool loadOBJ(const char* path, std::vector < glm::vec3 >& out_vertices,
-    std::vector < glm::vec2 >& out_uvs, std::vector < glm::vec3 >& out_normals)
+namespace {
+
+constexpr int MISSING = INT_MIN;
+
+// Corner as seen inside one chunk; negative OBJ indices are stored relative
+// to the chunk start and get rebased once all chunk sizes are known
+struct RawCorner {
+    int v, vt, vn;
+    uint8_t relative; // bit 0 = v, bit 1 = vt, bit 2 = vn
+};
+
+struct Chunk {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+    std::vector<RawCorner> corners;
+    bool ok{ true };
+};
+
+inline const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) ++p;
+    return p;
+}
+
+inline bool parseFloat(const char*& p, const char* end, float& out) {
+    p = skipSpaces(p, end);
+    if (p < end && *p == '+') ++p;
+    auto res = std::from_chars(p, end, out);
+    if (res.ec != std::errc()) return false;
+    p = res.ptr;
+    return true;
+}
+
+inline bool parseIndex(const char*& p, const char* end, int& out) {
+    auto res = std::from_chars(p, end, out);
+    if (res.ec != std::errc() || out == 0) return false;
+    p = res.ptr;
+    return true;
+}
+
+// OBJ index (1-based, or negative = relative to the current element count)
+// -> 0-based index local to the chunk
+inline int resolveLocal(int idx, size_t local_count, uint8_t bit, uint8_t& relative) {
+    if (idx > 0) return idx - 1;
+    relative |= bit;
+    return static_cast<int>(local_count) + idx;
+}
+
+// Parses one face corner: v, v/vt, v//vn or v/vt/vn
+bool parseCorner(const char*& p, const char* end, const Chunk& c, RawCorner& out) {
+    int v = 0, vt = 0, vn = 0;
+    out = { MISSING, MISSING, MISSING, 0 };
+
+    if (!parseIndex(p, end, v)) return false;
+    out.v = resolveLocal(v, c.positions.size(), 1, out.relative);
+
+    if (p < end && *p == '/') {
+        ++p;
+        if (p < end && *p != '/') {
+            if (!parseIndex(p, end, vt)) return false;
+            out.vt = resolveLocal(vt, c.uvs.size(), 2, out.relative);
+        }
+        if (p < end && *p == '/') {
+            ++p;
+            if (!parseIndex(p, end, vn)) return false;
+            out.vn = resolveLocal(vn, c.normals.size(), 4, out.relative);
+        }
+    }
+    return true;
+}
+
+void parseChunk(const char* p, const char* end, Chunk& c) {
+    std::vector<RawCorner> polygon;
+
+    while (p < end) {
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol) eol = end;
+        const char* line_end = (eol > p && eol[-1] == '\r') ? eol - 1 : eol;
+
+        const char* s = skipSpaces(p, line_end);
+        if (line_end - s >= 2 && s[0] == 'v') {
+            if (s[1] == ' ' || s[1] == '\t') {
+                glm::vec3 pos(0.0f);
+                s += 1;
+                parseFloat(s, line_end, pos.x) && parseFloat(s, line_end, pos.y) && parseFloat(s, line_end, pos.z);
+                c.positions.push_back(pos);
+            }
+            else if (s[1] == 't') {
+                glm::vec2 uv(0.0f);
+                s += 2;
+                parseFloat(s, line_end, uv.x) && parseFloat(s, line_end, uv.y);
+                c.uvs.push_back(uv);
+            }
+            else if (s[1] == 'n') {
+                glm::vec3 n(0.0f);
+                s += 2;
+                parseFloat(s, line_end, n.x) && parseFloat(s, line_end, n.y) && parseFloat(s, line_end, n.z);
+                c.normals.push_back(n);
+            }
+        }
+        else if (line_end - s >= 2 && s[0] == 'f' && (s[1] == ' ' || s[1] == '\t')) {
+            polygon.clear();
+            s = skipSpaces(s + 1, line_end);
+            while (s < line_end && *s != '#') { // a trailing comment ends the corners
+                RawCorner corner;
+                if (!parseCorner(s, line_end, c, corner)) {
+                    c.ok = false;
+                    return;
+                }
+                polygon.push_back(corner);
+                // skip anything up to the next corner or comment
+                while (s < line_end && *s != ' ' && *s != '\t' && *s != '#') ++s;
+                s = skipSpaces(s, line_end);
+            }
+
+            // fan triangulation handles triangles, quads and general n-gons
+            for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+                c.corners.push_back(polygon[0]);
+                c.corners.push_back(polygon[i]);
+                c.corners.push_back(polygon[i + 1]);
+            }
+        }
+        // anything else (comments, o/g/s/usemtl/mtllib...) is skipped
+
+        p = eol + 1;
+    }
+}
+
+inline int rebase(int local, size_t base, bool relative, size_t count) {
+    if (local == MISSING) return -1;
+    int64_t idx = relative ? static_cast<int64_t>(base) + local : local;
+    if (idx < 0 || idx >= static_cast<int64_t>(count)) return INT_MIN;
+    return static_cast<int>(idx);
+}
+
+template <typename Fn>
+void runParallel(size_t count, Fn fn) {
+    if (count == 1) {
+        fn(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        workers.emplace_back(fn, i);
+    for (auto& w : workers)
+        w.join();
+}
+
+} // namespace
+
+bool parseOBJ(const char* data, size_t size, ObjData& out, unsigned thread_count)
 {
-    std::vector<glm::vec3> temp_vertices;
-    std::vector<glm::vec2> temp_uvs;
-    std::vector<glm::vec3> temp_normals;
+    out = ObjData{};
+    if (size == 0) return true;
+
+    if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunk_count = std::min<size_t>(thread_count, size / MIN_CHUNK_SIZE + 1);
+
+    // Split into line-aligned ranges
+    std::vector<const char*> bounds{ data };
+    const char* end = data + size;
+    for (size_t i = 1; i < chunk_count; ++i) {
+        const char* p = std::max(bounds.back(), data + size * i / chunk_count);
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!eol) break;
+        bounds.push_back(eol + 1);
+    }
+    bounds.push_back(end);
+    chunk_count = bounds.size() - 1;
 
-    std::vector<unsigned int> vertexIndices, uvIndices, normalIndices;
+    std::vector<Chunk> chunks(chunk_count);
+    runParallel(chunk_count, [&](size_t i) {
+        parseChunk(bounds[i], bounds[i + 1], chunks[i]);
+    });
 
+    // Prefix sums give every chunk its place in the merged arrays
+    std::vector<size_t> v_base(chunk_count + 1, 0), vt_base(chunk_count + 1, 0),
+        vn_base(chunk_count + 1, 0), c_base(chunk_count + 1, 0);
+    for (size_t i = 0; i < chunk_count; ++i) {
+        if (!chunks[i].ok) {
+            std::cerr << "[OBJ ERROR] Malformed face index\n";
+            return false;
+        }
+        v_base[i + 1] = v_base[i] + chunks[i].positions.size();
+        vt_base[i + 1] = vt_base[i] + chunks[i].uvs.size();
+        vn_base[i + 1] = vn_base[i] + chunks[i].normals.size();
+        c_base[i + 1] = c_base[i] + chunks[i].corners.size();
+    }
+
+    out.positions.resize(v_base[chunk_count]);
+    out.uvs.resize(vt_base[chunk_count]);
+    out.normals.resize(vn_base[chunk_count]);
+    out.corners.resize(c_base[chunk_count]);
+
+    std::vector<char> valid(chunk_count, 1);
+    runParallel(chunk_count, [&](size_t i) {
+        const Chunk& c = chunks[i];
+        std::copy(c.positions.begin(), c.positions.end(), out.positions.begin() + v_base[i]);
+        std::copy(c.uvs.begin(), c.uvs.end(), out.uvs.begin() + vt_base[i]);
+        std::copy(c.normals.begin(), c.normals.end(), out.normals.begin() + vn_base[i]);
+
+        ObjCorner* dst = out.corners.data() + c_base[i];
+        for (const RawCorner& rc : c.corners) {
+            ObjCorner oc{
+                rebase(rc.v, v_base[i], rc.relative & 1, out.positions.size()),
+                rebase(rc.vt, vt_base[i], rc.relative & 2, out.uvs.size()),
+                rebase(rc.vn, vn_base[i], rc.relative & 4, out.normals.size())
+            };
+            if (oc.v < 0 || oc.vt == INT_MIN || oc.vn == INT_MIN) valid[i] = 0;
+            *dst++ = oc;
+        }
+    });
+
+    if (std::find(valid.begin(), valid.end(), 0) != valid.end()) {
+        std::cerr << "[OBJ ERROR] Face index out of range\n";
+        return false;
+    }
+    return true;
+}
+
+bool parseOBJ(const char* path, ObjData& out, unsigned thread_count)
+{
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "[OBJ ERROR] Impossible to open the file: " << path << "\n";
+        return false;
+    }
+    return parseOBJ(file.data(), file.size(), out, thread_count);
+}
+
+bool loadOBJ(const char* path, std::vector < glm::vec3 >& out_vertices,
+    std::vector < glm::vec2 >& out_uvs, std::vector < glm::vec3 >& out_normals)
+{
     out_vertices.clear();
     out_uvs.clear();
     out_normals.clear();
 
-    FILE* file;
-    fopen_s(&file, path, "r");
-    if (file == NULL) {
-        printf("Impossible to open the file !\n");
+    ObjData obj;
+    if (!parseOBJ(path, obj))
         return false;
+
+    out_vertices.reserve(obj.corners.size());
+    out_uvs.reserve(obj.corners.size());
+    out_normals.reserve(obj.corners.size());
+
+    for (const ObjCorner& c : obj.corners) {
+        out_vertices.push_back(obj.positions[c.v]);
+        if (c.vt >= 0) out_uvs.push_back(obj.uvs[c.vt]);
+        else           out_uvs.push_back(glm::vec2(0.0f));
+        if (c.vn >= 0) out_normals.push_back(obj.normals[c.vn]);
+        else           out_normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f)); // fallback normal
     }
 
-    while (true) {
-        char lineHeader[128];
-        int res = fscanf_s(file, "%s", lineHeader, sizeof(lineHeader));
-        if (res == EOF) break;
+    return true;
+}
 
-        if (strcmp(lineHeader, "v") == 0) {
-            glm::vec3 vertex;
-            fscanf_s(file, "%f %f %f\n", &vertex.x, &vertex.y, &vertex.z);
-            temp_vertices.push_back(vertex);
-        }
-        else if (strcmp(lineHeader, "vt") == 0) {
-            glm::vec2 uv;
-            fscanf_s(file, "%f %f\n", &uv.x, &uv.y);
-            temp_uvs.push_back(uv);
-        }
-        else if (strcmp(lineHeader, "vn") == 0) {
-            glm::vec3 normal;
-            fscanf_s(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-            temp_normals.push_back(normal);
+namespace {
+
+// Open-addressing (linear probing) map from a (v, vt, vn) triplet to its
+// output vertex index. Capacity is fixed up front from the corner count,
+// so it never rehashes.
+class CornerMap {
+public:
+    explicit CornerMap(size_t max_entries) {
+        size_t capacity = 16;
+        while (capacity < max_entries * 2) capacity <<= 1;
+        mask = capacity - 1;
+        slots.assign(capacity, Slot{ { -1, -1, -1 }, EMPTY });
+    }
+
+    // Returns the existing index, or stores next_index and returns it
+    GLuint findOrInsert(const ObjCorner& key, GLuint next_index) {
+        size_t i = hash(key) & mask;
+        while (true) {
+            Slot& slot = slots[i];
+            if (slot.index == EMPTY) {
+                slot.key = key;
+                slot.index = next_index;
+                return next_index;
+            }
+            if (slot.key.v == key.v && slot.key.vt == key.vt && slot.key.vn == key.vn)
+                return slot.index;
+            i = (i + 1) & mask;
         }
-        else if (strcmp(lineHeader, "f") == 0) {
-            char vertexStr[128];
+    }
 
-            unsigned int vIndex[3], vtIndex[3], vnIndex[3];
-            bool hasUV = false, hasNormal = false;
+private:
+    static constexpr GLuint EMPTY = 0xFFFFFFFFu;
 
-            for (int i = 0; i < 3; i++) {
-                fscanf_s(file, "%s", vertexStr, (unsigned)_countof(vertexStr));
-                std::string vert(vertexStr);
+    struct Slot {
+        ObjCorner key;
+        GLuint index;
+    };
 
-                size_t firstSlash = vert.find('/');
-                size_t secondSlash = vert.find('/', firstSlash + 1);
+    static size_t hash(const ObjCorner& c) {
+        uint64_t h = static_cast<uint32_t>(c.v) * 0x9E3779B97F4A7C15ull;
+        h ^= static_cast<uint32_t>(c.vt) * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+        h ^= static_cast<uint32_t>(c.vn) * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
 
-                if (firstSlash == std::string::npos) {
-                    // Format: v
-                    vIndex[i] = std::stoi(vert);
-                }
-                else if (secondSlash == std::string::npos) {
-                    // Format: v/vt
-                    vIndex[i] = std::stoi(vert.substr(0, firstSlash));
-                    vtIndex[i] = std::stoi(vert.substr(firstSlash + 1));
-                    hasUV = true;
-                }
-                else if (secondSlash == firstSlash + 1) {
-                    // Format: v//vn
-                    vIndex[i] = std::stoi(vert.substr(0, firstSlash));
-                    vnIndex[i] = std::stoi(vert.substr(secondSlash + 1));
-                    hasNormal = true;
-                }
-                else {
-                    // Format: v/vt/vn
-                    vIndex[i] = std::stoi(vert.substr(0, firstSlash));
-                    vtIndex[i] = std::stoi(vert.substr(firstSlash + 1, secondSlash - firstSlash - 1));
-                    vnIndex[i] = std::stoi(vert.substr(secondSlash + 1));
-                    hasUV = true;
-                    hasNormal = true;
-                }
-            }
+    std::vector<Slot> slots;
+    size_t mask{ 0 };
+};
 
-            for (int i = 0; i < 3; i++) {
-                out_vertices.push_back(temp_vertices[vIndex[i] - 1]);
-                if (hasUV) out_uvs.push_back(temp_uvs[vtIndex[i] - 1]);
-                else       out_uvs.push_back(glm::vec2(0.0f));
-                if (hasNormal) out_normals.push_back(temp_normals[vnIndex[i] - 1]);
-                else           out_normals.push_back(glm::vec3(0.0f, 1.0f, 0.0f)); // fallback normal
-            }
-        }
-        else {
-            // Skip unknown lines
-            char skip[1000];
-            fgets(skip, 1000, file);
+} // namespace
+
+void buildIndexedMesh(const ObjData& obj, std::vector<vertex>& out_vertices, std::vector<GLuint>& out_indices)
+{
+    out_vertices.clear();
+    out_indices.clear();
+    out_indices.reserve(obj.corners.size());
+
+    CornerMap map(obj.corners.size());
+    for (const ObjCorner& c : obj.corners) {
+        GLuint next = static_cast<GLuint>(out_vertices.size());
+        GLuint idx = map.findOrInsert(c, next);
+        if (idx == next) {
+            vertex v{};
+            v.position = obj.positions[c.v];
+            v.normal = (c.vn >= 0) ? obj.normals[c.vn] : glm::vec3(0.0f, 1.0f, 0.0f); // fallback normal
+            v.texcoords = (c.vt >= 0) ? obj.uvs[c.vt] : glm::vec2(0.0f);
+            v.color = glm::vec3(1.0f, 0.0f, 0.0f); // fallback color
+            out_vertices.push_back(v);
         }
+        out_indices.push_back(idx);
     }
+}
 
-    fclose(file);
+bool loadOBJIndexed(const char* path, std::vector < vertex >& out_vertices, std::vector < GLuint >& out_indices)
+{
+    ObjData obj;
+    if (!parseOBJ(path, obj)) {
+        out_vertices.clear();
+        out_indices.clear();
+        return false;
+    }
+    buildIndexedMesh(obj, out_vertices, out_indices);
     return true;
 }
@@ -3,8 +3,33 @@
 #define OBJloader_H
 
 #include <vector>
-#include <glm/fwd.hpp>
+#include <glm/glm.hpp>
 
+#include "assets.hpp"
+
+// One triangle corner, 0-based indices into ObjData arrays (-1 = not present)
+struct ObjCorner {
+	int v;
+	int vt;
+	int vn;
+};
+
+// Raw OBJ contents; n-gon faces are fan-triangulated into corners
+struct ObjData {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<ObjCorner> corners; // 3 per triangle
+};
+
+// Memory-maps the file and parses line-aligned chunks in parallel.
+// thread_count = 0 picks std::thread::hardware_concurrency().
+bool parseOBJ(const char* path, ObjData& out, unsigned thread_count = 0);
+
+// Same as parseOBJ, but for a text buffer that is already in memory
+bool parseOBJ(const char* data, size_t size, ObjData& out, unsigned thread_count = 0);
+
+// Expanded output: one entry per triangle corner (3 per face)
 bool loadOBJ(
 	const char * path,
 	std::vector < glm::vec3 > & out_vertices,
@@ -12,4 +37,14 @@ bool loadOBJ(
 	std::vector < glm::vec3 > & out_normals
 );
 
+// Indexed output: unique (v, vt, vn) triplets become shared vertices
+bool loadOBJIndexed(
+	const char * path,
+	std::vector < vertex > & out_vertices,
+	std::vector < GLuint > & out_indices
+);
+
+// Deduplicates the corners of already parsed OBJ data
+void buildIndexedMesh(const ObjData& obj, std::vector<vertex>& out_vertices, std::vector<GLuint>& out_indices);
+
 #endif
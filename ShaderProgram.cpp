@@ -1,79 +1,160 @@
 ﻿#include "ShaderProgram.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
-ShaderProgram::ShaderProgram(const std::filesystem::path& VS_file, const std::filesystem::path& FS_file) {
-    std::cout << "[DEBUG] Reading and compiling vertex shader: " << VS_file << "\n";
-    std::cout << textFileRead(VS_file) << "\n"; // ✅ <- Add this here
+#include "shader_cache.hpp"
 
-    std::vector<GLuint> shader_ids;
-    shader_ids.push_back(compile_shader(VS_file, GL_VERTEX_SHADER));
-    shader_ids.push_back(compile_shader(FS_file, GL_FRAGMENT_SHADER));
+ShaderProgram::ShaderProgram(const std::filesystem::path& VS_file, const std::filesystem::path& FS_file,
+    const std::string& defines) {
+    build({ { GL_VERTEX_SHADER, VS_file }, { GL_FRAGMENT_SHADER, FS_file } }, defines);
+}
 
-    ID = link_shader(shader_ids);
-    std::cout << "[ShaderProgram] Program created with ID = " << ID << "\n";
+ShaderProgram::ShaderProgram(const std::filesystem::path& CS_file) {
+    build({ { GL_COMPUTE_SHADER, CS_file } }, "");
 }
 
-void ShaderProgram::setUniform(const std::string& name, float val) {
-    if (ID == 0) {
-        std::cerr << "[Uniform ERROR] Attempted to set uniform '" << name << "' on null program ID.\n";
-        return;
+void ShaderProgram::build(const std::vector<std::pair<GLenum, std::filesystem::path>>& stage_files, const std::string& defines) {
+    PendingBuild pending = submit(stage_files, defines);
+    build_stats.ms += complete(pending);
+}
+
+ShaderProgram::PendingBuild ShaderProgram::submit(const std::vector<std::pair<GLenum, std::filesystem::path>>& stage_files,
+    const std::string& defines) {
+    PendingBuild pending;
+    pending.start = std::chrono::steady_clock::now();
+    pending.stage_files = stage_files;
+    pending.defines = defines;
+
+    // cache entries are named after the stage files: "tex", "cluster_cull", ...
+    std::vector<ShaderStageSource> stages;
+    for (const auto& [type, file] : stage_files) {
+        stages.push_back({ type, textFileRead(file) });
+        injectDefines(stages.back().text, defines);
+        std::string stem = file.stem().string();
+        if (pending.name.empty()) pending.name = stem;
+        else if (pending.name.compare(0, stem.size(), stem) != 0) pending.name += "_" + stem;
+    }
+    // ... and variants by their defines: "tex@1f3a09c2"
+    if (!defines.empty()) {
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), "@%08x", static_cast<unsigned>(std::hash<std::string>{}(defines)));
+        pending.name += suffix;
+    }
+
+    pending.use_cache = !binary_cache_dir.empty() && programBinariesSupported();
+    pending.key = pending.use_cache ? programCacheKey(stages, defines) : 0;
+    ID = pending.use_cache ? loadProgramBinary(binary_cache_dir, pending.name, pending.key) : 0;
+    pending.from_cache = ID != 0;
+
+    if (!pending.from_cache) {
+        for (size_t i = 0; i < stages.size(); ++i)
+            pending.shader_ids.push_back(compile_shader(stages[i].text, stage_files[i].second, stages[i].type));
+        ID = link_shader(pending.shader_ids, pending.use_cache);
     }
+    uniforms.reset();
+    return pending;
+}
 
-    GLint loc = glGetUniformLocation(ID, name.c_str());
-    if (loc == -1) {
-        std::cerr << "[Uniform WARNING] '" << name << "' not found or unused in shader.\n";
-        return;
+double ShaderProgram::complete(PendingBuild& pending) {
+    if (!pending.from_cache) {
+        for (size_t i = 0; i < pending.shader_ids.size(); ++i) {
+            try {
+                check_shader(pending.shader_ids[i], pending.stage_files[i].second);
+            } catch (...) {
+                for (GLuint id : pending.shader_ids) glDeleteShader(id);
+                glDeleteProgram(ID);
+                ID = 0;
+                throw;
+            }
+        }
+        check_program(ID, pending.shader_ids);
+        if (pending.use_cache && !saveProgramBinary(binary_cache_dir, pending.name, pending.key, ID))
+            std::cerr << "[ShaderCache] Could not save the binary of '" << pending.name << "'\n";
     }
+    introspectUniforms();
 
-    glUniform1f(loc, val);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.start).count();
+    ++build_stats.programs;
+    if (pending.from_cache) ++build_stats.cache_hits;
+    std::cout << "[ShaderProgram] '" << pending.name << "' ID = " << ID
+        << (pending.from_cache ? " restored from binary cache" : " compiled from source") << " | " << ms << " ms\n";
+    return ms;
 }
 
+void ShaderProgram::introspectUniforms() {
+    uniforms = std::make_shared<UniformTable>();
 
-void ShaderProgram::setUniform(const std::string& name, int val) {
-    GLint loc = glGetUniformLocation(ID, name.c_str());
-    if (loc == -1) {
-        std::cerr << "Uniform not found: " << name << "\n";
-        return;
+    GLint count = 0, max_length = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    std::vector<char> buffer(std::max(max_length, 1));
+
+    for (GLint i = 0; i < count; ++i) {
+        GLint size = 0;
+        GLenum type = 0;
+        GLsizei length = 0;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+        GLint loc = glGetUniformLocation(ID, name.c_str());
+        if (loc < 0) continue; // block members have no location
+
+        uniforms->locations[name] = loc;
+
+        // arrays report "name[0]"; register "name" and every element too
+        size_t bracket = name.rfind("[0]");
+        if (bracket != std::string::npos && bracket + 3 == name.size()) {
+            std::string base = name.substr(0, bracket);
+            uniforms->locations[base] = loc;
+            for (GLint e = 1; e < size; ++e) {
+                std::string element = base + "[" + std::to_string(e) + "]";
+                uniforms->locations[element] = glGetUniformLocation(ID, element.c_str());
+            }
+        }
     }
-    glUniform1i(loc, val);
+    std::cout << "[ShaderProgram] " << uniforms->locations.size() << " uniform locations cached for program " << ID << "\n";
 }
 
-void ShaderProgram::setUniform(const std::string& name, const glm::vec3 val) {
-    GLint loc = glGetUniformLocation(ID, name.c_str());
-    if (loc == -1) {
-        std::cerr << "Uniform not found: " << name << "\n";
-        return;
+GLint ShaderProgram::uniformLocation(const std::string& name) const {
+    if (ID == 0 || !uniforms) {
+        std::cerr << "[Uniform ERROR] Attempted to look up uniform '" << name << "' on null program ID.\n";
+        return -1;
     }
-    glUniform3fv(loc, 1, glm::value_ptr(val));
+
+    auto it = uniforms->locations.find(name);
+    if (it != uniforms->locations.end()) return it->second;
+
+    if (uniforms->reported_missing.insert(name).second)
+        std::cerr << "[Uniform WARNING] '" << name << "' not found or unused in program " << ID << " (reported once).\n";
+    return -1;
+}
+
+void ShaderProgram::setUniform(const std::string& name, float val) {
+    uniform<float>(name).set(val);
+}
+
+void ShaderProgram::setUniform(const std::string& name, int val) {
+    uniform<int>(name).set(val);
+}
+
+void ShaderProgram::setUniform(const std::string& name, const glm::vec3 val) {
+    uniform<glm::vec3>(name).set(val);
 }
 
 void ShaderProgram::setUniform(const std::string& name, const glm::vec4 val) {
-    GLint loc = glGetUniformLocation(ID, name.c_str());
-    if (loc == -1) {
-        std::cerr << "Uniform not found: " << name << "\n";
-        return;
-    }
-    glUniform4fv(loc, 1, glm::value_ptr(val));
+    uniform<glm::vec4>(name).set(val);
 }
 
 void ShaderProgram::setUniform(const std::string& name, const glm::mat3 val) {
-    GLint loc = glGetUniformLocation(ID, name.c_str());
-    if (loc == -1) {
-        std::cerr << "Uniform not found: " << name << "\n";
-        return;
-    }
-    glUniformMatrix3fv(loc, 1, GL_FALSE, glm::value_ptr(val));
+    uniform<glm::mat3>(name).set(val);
 }
 
 void ShaderProgram::setUniform(const std::string& name, const glm::mat4 val) {
-    GLint loc = glGetUniformLocation(ID, name.c_str());
-    if (loc == -1) {
-        std::cerr << "Uniform not found: " << name << "\n";
-        return;
-    }
-    glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(val));
+    uniform<glm::mat4>(name).set(val);
 }
 
 std::string ShaderProgram::getShaderInfoLog(GLuint obj) {
@@ -98,51 +179,61 @@ std::string ShaderProgram::getProgramInfoLog(GLuint obj) {
     return "";
 }
 
-GLuint ShaderProgram::compile_shader(const std::filesystem::path& source_file, GLenum type) {
+GLuint ShaderProgram::compile_shader(const std::string& source, const std::filesystem::path& source_file, GLenum type) {
     std::cout << "[Shader] Compiling: " << source_file << "\n";
 
     GLuint shader = glCreateShader(type);
     if (shader == 0) throw std::runtime_error("glCreateShader failed");
 
-    std::string src = textFileRead(source_file);
-    const char* src_ptr = src.c_str();
+    const char* src_ptr = source.c_str();
     glShaderSource(shader, 1, &src_ptr, nullptr);
     glCompileShader(shader);
+    return shader;
+}
 
+void ShaderProgram::check_shader(GLuint shader, const std::filesystem::path& source_file) {
     GLint success = 0;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
 
     if (!success) {
         std::string log = getShaderInfoLog(shader);
         std::cerr << "[Shader ERROR] Failed to compile " << source_file << ":\n" << log << "\n";
-        glDeleteShader(shader);
         throw std::runtime_error("Shader compilation failed");
     }
     else {
         std::string log = getShaderInfoLog(shader);
         if (!log.empty()) std::cout << "[Shader LOG] " << log << "\n";
     }
-
-    return shader;
 }
 
 
-GLuint ShaderProgram::link_shader(const std::vector<GLuint> shader_ids) {
+GLuint ShaderProgram::link_shader(const std::vector<GLuint> shader_ids, bool retrievable) {
     GLuint program = glCreateProgram();
     if (program == 0) throw std::runtime_error("glCreateProgram failed");
 
+    // must be set before linking for glGetProgramBinary to work
+    if (retrievable) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
     for (GLuint id : shader_ids)
         glAttachShader(program, id);
 
     glLinkProgram(program);
+    return program;
+}
 
+void ShaderProgram::check_program(GLuint program, const std::vector<GLuint>& shader_ids) {
     GLint success = 0;
     glGetProgramiv(program, GL_LINK_STATUS, &success);
 
+    // Detach and delete shaders after linking
+    for (GLuint id : shader_ids)
+        glDeleteShader(id);
+
     if (!success) {
         std::string log = getProgramInfoLog(program);
         std::cerr << "[Shader ERROR] Program linking failed:\n" << log << "\n";
         glDeleteProgram(program);
+        ID = 0;
         throw std::runtime_error("Shader program linking failed");
     }
     else {
@@ -150,12 +241,7 @@ GLuint ShaderProgram::link_shader(const std::vector<GLuint> shader_ids) {
         if (!log.empty()) std::cout << "[Linker LOG] " << log << "\n";
     }
 
-    // Detach and delete shaders after linking
-    for (GLuint id : shader_ids)
-        glDeleteShader(id);
-
     std::cout << "[Shader] Link successful. Program ID: " << program << "\n";
-    return program;
 }
 
 std::string ShaderProgram::textFileRead(const std::filesystem::path& filename) {
@@ -164,5 +250,83 @@ std::string ShaderProgram::textFileRead(const std::filesystem::path& filename) {
         throw std::runtime_error("Could not open file: " + filename.string());
     std::stringstream ss;
     ss << file.rdbuf();
-    return ss.str();
+    std::string text = ss.str();
+    // a UTF-8 BOM before #version is rejected by some compilers (Mesa)
+    if (text.compare(0, 3, "\xEF\xBB\xBF") == 0) text.erase(0, 3);
+    return text;
+}
+
+void ShaderProgram::injectDefines(std::string& source, const std::string& defines) {
+    if (defines.empty()) return;
+    // #version has to stay the first statement
+    size_t at = 0;
+    size_t version = source.find("#version");
+    if (version != std::string::npos) {
+        at = source.find('\n', version);
+        at = (at == std::string::npos) ? source.size() : at + 1;
+    }
+    // keep compiler messages on the file's own line numbers
+    size_t next_line = std::count(source.begin(), source.begin() + at, '\n') + 1;
+    source.insert(at, defines + "#line " + std::to_string(next_line) + "\n");
+}
+
+ShaderBatch::ShaderBatch() {
+    parallel_compile = GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+    // let the driver pick its thread count (the default may be a single thread)
+    if (GLEW_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+    else if (GLEW_ARB_parallel_shader_compile) glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+}
+
+void ShaderBatch::add(ShaderProgram& target, const std::filesystem::path& VS_file, const std::filesystem::path& FS_file,
+    const std::string& defines) {
+    submit(target, { { GL_VERTEX_SHADER, VS_file }, { GL_FRAGMENT_SHADER, FS_file } }, defines);
+}
+
+void ShaderBatch::add(ShaderProgram& target, const std::filesystem::path& CS_file) {
+    submit(target, { { GL_COMPUTE_SHADER, CS_file } }, "");
+}
+
+void ShaderBatch::submit(ShaderProgram& target, const std::vector<std::pair<GLenum, std::filesystem::path>>& stage_files,
+    const std::string& defines) {
+    auto start = std::chrono::steady_clock::now();
+    if (entries.empty()) first_submit = start;
+    entries.push_back({ &target, target.submit(stage_files, defines), false });
+    entries.back().done = entries.back().pending.from_cache;
+    submit_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ShaderBatch::poll() {
+    if (finished) return true;
+    if (!parallel_compile) return false;
+
+    bool all_done = true;
+    for (Entry& e : entries) {
+        if (!e.done) {
+            GLint complete = GL_FALSE;
+            glGetProgramiv(e.target->ID, GL_COMPLETION_STATUS_KHR, &complete);
+            e.done = complete == GL_TRUE;
+        }
+        all_done = all_done && e.done;
+    }
+    if (all_done && ready_ms < 0.0)
+        ready_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - first_submit).count();
+    return all_done;
+}
+
+void ShaderBatch::finish() {
+    if (finished) return;
+    auto start = std::chrono::steady_clock::now();
+    const bool ready_before = poll();
+    for (Entry& e : entries) e.target->complete(e.pending);
+    finished = true;
+
+    double wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - first_submit).count();
+    ShaderProgram::build_stats.ms += submit_ms + wait_ms;
+
+    std::cout << "[ShaderBatch] " << entries.size() << " programs, "
+        << (parallel_compile ? "parallel compile" : "no parallel compile extension") << " | submit "
+        << submit_ms << " ms, finish " << wait_ms << " ms";
+    if (ready_before) std::cout << " (ready " << ready_ms << " ms after submit)";
+    std::cout << ", " << total_ms - submit_ms - wait_ms << " ms of other work overlapped\n";
 }
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <filesystem>
 
@@ -8,21 +14,96 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// Pre-resolved uniform location. set() goes through glProgramUniform*, so the
+// program does not have to be bound; a missing uniform (location -1) is a no-op.
+template <typename T>
+struct Uniform {
+    GLuint program{ 0 };
+    GLint location{ -1 };
+
+    explicit operator bool() const { return location >= 0; }
+    void set(const T& val) const;
+};
+
+template <> inline void Uniform<float>::set(const float& val) const {
+    if (location >= 0) glProgramUniform1f(program, location, val);
+}
+template <> inline void Uniform<int>::set(const int& val) const {
+    if (location >= 0) glProgramUniform1i(program, location, val);
+}
+template <> inline void Uniform<glm::ivec3>::set(const glm::ivec3& val) const {
+    if (location >= 0) glProgramUniform3i(program, location, val.x, val.y, val.z);
+}
+template <> inline void Uniform<glm::vec2>::set(const glm::vec2& val) const {
+    if (location >= 0) glProgramUniform2fv(program, location, 1, glm::value_ptr(val));
+}
+template <> inline void Uniform<glm::vec3>::set(const glm::vec3& val) const {
+    if (location >= 0) glProgramUniform3fv(program, location, 1, glm::value_ptr(val));
+}
+template <> inline void Uniform<glm::vec4>::set(const glm::vec4& val) const {
+    if (location >= 0) glProgramUniform4fv(program, location, 1, glm::value_ptr(val));
+}
+template <> inline void Uniform<glm::mat3>::set(const glm::mat3& val) const {
+    if (location >= 0) glProgramUniformMatrix3fv(program, location, 1, GL_FALSE, glm::value_ptr(val));
+}
+template <> inline void Uniform<glm::mat4>::set(const glm::mat4& val) const {
+    if (location >= 0) glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, glm::value_ptr(val));
+}
+
+class ShaderBatch;
+
+struct ShaderBuildStats {
+    unsigned programs{ 0 };
+    unsigned cache_hits{ 0 };
+    double ms{ 0.0 };
+};
+
 class ShaderProgram {
 public:
     ShaderProgram() = default;
-    ShaderProgram(const std::filesystem::path& VS_file, const std::filesystem::path& FS_file);
+    // defines ("#define NAME 1\n"...) are inserted after each stage's #version line
+    ShaderProgram(const std::filesystem::path& VS_file, const std::filesystem::path& FS_file,
+        const std::string& defines = "");
+    // compute-only program
+    explicit ShaderProgram(const std::filesystem::path& CS_file);
+
+    // Linked programs are cached here as driver binaries and restored on the
+    // next start; empty compiles from source every time
+    // (app_settings.json: "shader_cache_dir")
+    static inline std::filesystem::path binary_cache_dir;
 
-    void activate() { glUseProgram(ID); }
-    void deactivate() { glUseProgram(0); }
+    // Totals over every program built so far (startup report); ms is time
+    // the calling thread spent on them, not counting work overlapped in a batch
+    static inline ShaderBuildStats build_stats;
+
+    // glUseProgram only when a different program is bound
+    void activate() {
+        if (bound_program != ID) {
+            glUseProgram(ID);
+            bound_program = ID;
+        }
+    }
+    void deactivate() {
+        glUseProgram(0);
+        bound_program = 0;
+    }
 
     void clear() {
         deactivate();
         glDeleteProgram(ID);
         ID = 0;
+        uniforms.reset();
     }
 
-    // Uniforms
+    // Location from the table built at link time (no GL call); warns once per
+    // missing name and returns -1
+    GLint uniformLocation(const std::string& name) const;
+
+    // Resolve once, set every frame
+    template <typename T>
+    Uniform<T> uniform(const std::string& name) const { return { ID, uniformLocation(name) }; }
+
+    // Convenience by name: a hash lookup per call, fine outside hot loops
     void setUniform(const std::string& name, float val);
     void setUniform(const std::string& name, int val);
     void setUniform(const std::string& name, const glm::vec3 val);
@@ -33,11 +114,93 @@ public:
     GLuint ID{ 0 };
 
 private:
+    friend class ShaderBatch;
+
+    // Compile/link issued, results not queried yet
+    struct PendingBuild {
+        std::string name;
+        std::vector<std::pair<GLenum, std::filesystem::path>> stage_files;
+        std::string defines;
+        std::vector<GLuint> shader_ids;
+        uint64_t key{ 0 };
+        bool use_cache{ false };
+        bool from_cache{ false };
+        std::chrono::steady_clock::time_point start;
+    };
+
+    // Shared by copies of the program (Meshes hold theirs by value)
+    struct UniformTable {
+        std::unordered_map<std::string, GLint> locations;
+        std::unordered_set<std::string> reported_missing;
+    };
+    std::shared_ptr<UniformTable> uniforms;
+
+    static inline GLuint bound_program{ 0 };
+
+    // Restores the program from the binary cache or compiles and links the
+    // stages (and caches the result)
+    void build(const std::vector<std::pair<GLenum, std::filesystem::path>>& stage_files, const std::string& defines);
+    // The two halves of build(): submit() sets ID but queries no status, so
+    // the driver may still be compiling; complete() waits for it, throws on
+    // errors, saves the binary and fills the uniform table. Returns ms since submit.
+    PendingBuild submit(const std::vector<std::pair<GLenum, std::filesystem::path>>& stage_files, const std::string& defines);
+    double complete(PendingBuild& pending);
+    void introspectUniforms();
+
     std::string getShaderInfoLog(GLuint obj);
     std::string getProgramInfoLog(GLuint obj);
 
-    GLuint compile_shader(const std::filesystem::path& source_file, GLenum type);
-    GLuint link_shader(const std::vector<GLuint> shader_ids);
+    GLuint compile_shader(const std::string& source, const std::filesystem::path& source_file, GLenum type);
+    GLuint link_shader(const std::vector<GLuint> shader_ids, bool retrievable);
+    // status checks, separate from the calls above so they can be deferred
+    void check_shader(GLuint shader, const std::filesystem::path& source_file);
+    void check_program(GLuint program, const std::vector<GLuint>& shader_ids);
 
     std::string textFileRead(const std::filesystem::path& filename);
+    static void injectDefines(std::string& source, const std::string& defines);
+};
+
+// Builds several programs together. Every compile and link is issued before
+// any status is queried, so the driver works on them in the background (on
+// its compiler threads with GL_KHR/ARB_parallel_shader_compile) while the
+// caller does other startup work.
+class ShaderBatch {
+public:
+    ShaderBatch();
+    ShaderBatch(const ShaderBatch&) = delete;
+    ShaderBatch& operator=(const ShaderBatch&) = delete;
+
+    // target gets its ID right away; its uniforms are usable after finish()
+    void add(ShaderProgram& target, const std::filesystem::path& VS_file, const std::filesystem::path& FS_file,
+        const std::string& defines = "");
+    void add(ShaderProgram& target, const std::filesystem::path& CS_file);
+
+    // Non-blocking: true once the driver reports every program done.
+    // Without the extension the driver cannot be asked without waiting,
+    // so this stays false until finish().
+    bool poll();
+
+    // Waits for the remaining programs and completes every target; throws
+    // on compile/link errors like the ShaderProgram constructors
+    void finish();
+
+    bool parallel() const { return parallel_compile; }
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry {
+        ShaderProgram* target;
+        ShaderProgram::PendingBuild pending;
+        bool done;
+    };
+    std::vector<Entry> entries;
+    bool parallel_compile{ false };
+    bool finished{ false };
+
+    std::chrono::steady_clock::time_point first_submit;
+    double submit_ms{ 0.0 };
+    double ready_ms{ -1.0 }; // first add -> poll() saw everything done
+
+    void submit(ShaderProgram& target, const std::vector<std::pair<GLenum, std::filesystem::path>>& stage_files,
+        const std::string& defines);
 };
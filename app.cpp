@@ -1,5 +1,6 @@
 ﻿// === app.cpp ===
 #include "app.hpp"
+#include "maze_mesher.hpp"
 #include "ShaderProgram.hpp"
 #include "gl_info.hpp"
 #include "gl_err_callback.h"
@@ -7,6 +8,7 @@
 #include <iostream>
 #include <sstream>
 #include <random>
+#include <chrono>
 #include <nlohmann/json.hpp>
 #include <fstream>
 
@@ -29,7 +31,16 @@ void App::updateFPS() {
     frame_count++;
     if (current_time - last_time >= 1.0) {
         std::ostringstream title;
-        title << "OpenGL Context | FPS: " << frame_count;
+        TextureStreamer::Stats s = textures.stats();
+        title << "OpenGL Context | FPS: " << frame_count << " | textures " << (s.resident_bytes >> 20) << " MB ("
+            << s.evictions << " evicted, " << s.reloads << " reloaded)";
+        if (!terrain.empty())
+            title << " | terrain " << terrain.stats().chunks << " chunks, " << terrain.stats().triangles / 1000 << "k tris";
+        if (!paged_terrain.empty()) {
+            PagedTerrainStats t = paged_terrain.stats();
+            title << " | terrain " << t.tiles << "/" << t.resident << " tiles, " << t.triangles / 1000 << "k tris, "
+                << t.pending << " pending";
+        }
         glfwSetWindowTitle(window, title.str().c_str());
         frame_count = 0;
         last_time = current_time;
@@ -85,21 +96,26 @@ void App::updateCameraHeight() {
         float targetY = maze_floor_y + eye_height;
         camera.Position.y = glm::mix(camera.Position.y, targetY, 0.1f);
     }
-    else if (!heightmap_img.empty()) {
-        float x_world = camera.Position.x;
-        float z_world = camera.Position.z;
-
-        float x_local = (x_world + (heightmap_img.cols / 2.0f) * 0.5f) / 0.5f;
-        float z_local = (z_world + (heightmap_img.rows / 2.0f) * 0.5f) / 0.5f;
-
-        int x_px = static_cast<int>(std::clamp(x_local, 0.0f, float(heightmap_img.cols - 1)));
-        int z_px = static_cast<int>(std::clamp(z_local, 0.0f, float(heightmap_img.rows - 1)));
-
-        uchar pixel = heightmap_img.at<uchar>(z_px, x_px);
-        float h = -pixel * 0.25f;
-        float targetY = h + (-10.0f) + 1.0f;
+    else if (!paged_terrain.empty()) {
+        // nothing to stand on until the tile is paged in; never waits for it
+        float y;
+        if (paged_terrain.heightAt(camera.Position.x, camera.Position.z, y))
+            camera.Position.y = glm::mix(camera.Position.y, y + 1.0f, 0.1f);
+    }
+    else if (!terrain_rays.empty()) {
+        // on the surface the terrain triangles make, not the nearest pixel
+        float y;
+        terrain_rays.heightAt(camera.Position.x, camera.Position.z, y);
+        camera.Position.y = glm::mix(camera.Position.y, y + 1.0f, 0.1f);
+    }
+}
 
-        camera.Position.y = glm::mix(camera.Position.y, targetY, 0.1f);
+void App::pickTerrain() {
+    TerrainHit hit;
+    if (terrain_rays.raycast(camera.Position, glm::normalize(camera.Front), 1000.0f, hit)) {
+        spawnParticles(hit.position + 0.1f * hit.normal, 50);
+        std::cout << "[Raycast] Terrain hit at (" << hit.position.x << ", " << hit.position.y << ", " << hit.position.z
+            << "), " << hit.t << " away\n";
     }
 }
 
@@ -111,8 +127,8 @@ void App::drawParticles() {
 
     if (!positions.empty()) {
         particleShader.activate();
-        particleShader.setUniform("uV_m", camera.GetViewMatrix());
-        particleShader.setUniform("uP_m", glm::perspective(glm::radians(60.0f), 1024.0f / 768.0f, 0.1f, 1000.0f));
+        particle_view.set(camera.GetViewMatrix());
+        particle_projection.set(glm::perspective(glm::radians(60.0f), 1024.0f / 768.0f, 0.1f, 1000.0f));
 
         glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
         glBufferSubData(GL_ARRAY_BUFFER, 0, positions.size() * sizeof(glm::vec3), positions.data());
@@ -142,8 +158,7 @@ void App::toggleFullscreen() {
         glViewport(0, 0, fb_width, fb_height);
 
         aspect = static_cast<float>(fb_width) / static_cast<float>(fb_height);
-        glm::mat4 projection = glm::perspective(glm::radians(fov), aspect, 0.1f, 1000.0f);
-        shader_program.setUniform("uP_m", projection);
+        setProjection(glm::perspective(glm::radians(fov), aspect, 0.1f, 1000.0f), fb_width, fb_height);
     }
     else {
         // Zpět do windowed režimu
@@ -155,45 +170,162 @@ void App::toggleFullscreen() {
         glViewport(0, 0, fb_width, fb_height);
 
         aspect = static_cast<float>(fb_width) / static_cast<float>(fb_height);
-        glm::mat4 projection = glm::perspective(glm::radians(fov), aspect, 0.1f, 1000.0f);
-        shader_program.setUniform("uP_m", projection);
+        setProjection(glm::perspective(glm::radians(fov), aspect, 0.1f, 1000.0f), fb_width, fb_height);
     }
 }
 
+void App::setProjection(const glm::mat4& projection, int fb_width, int fb_height) {
+    for (const FrameUniforms& u : frame_uniforms) u.projection.set(projection);
+    Model::setLodProjection(projection, fb_height);
+    terrain.setProjection(projection);
+    paged_terrain.setProjection(projection);
+    clusters.setProjection(projection, 0.1f, 1000.0f, fb_width, fb_height);
+}
+
+void App::toggleClusterDebug() {
+    clusters.setDebugView(!clusters.debugView());
+    std::cout << "[Clusters] Occupancy view " << (clusters.debugView() ? "ON" : "OFF") << "\n";
+}
+
+void App::toggleClusteredLighting() {
+    clusters.setEnabled(!clusters.enabled());
+    std::cout << "[Clusters] " << (clusters.enabled() ? "Clustered" : "Brute-force") << " point lights, "
+        << pointLights.size() << " lights\n";
+}
+
 void App::generateMazeModels(const cv::Mat& mapa) {
     if (!wall_cube) return;
 
     float offsetX = mapa.cols / 2.0f;
     float offsetZ = mapa.rows / 2.0f;
-    float maze_base_y = -67.0f;
-    float maze_floor_base_y = -68.0f;
+
+    if (maze_greedy_mesh) {
+        auto start = std::chrono::steady_clock::now();
+        MazeMeshParams params;
+        params.origin = glm::vec2(-offsetX, -offsetZ);
+        params.wall_bottom = maze_wall_y - maze_wall_scale.y * 0.5f;
+        params.wall_top = maze_wall_y + maze_wall_scale.y * 0.5f;
+        params.floor_bottom = maze_floor_y - maze_floor_scale.y * 0.5f;
+        params.floor_top = maze_floor_y + maze_floor_scale.y * 0.5f;
+
+        const unsigned char* cells = mapa.ptr<uchar>(0);
+        glm::vec3 bounds_min, bounds_max;
+        mazeMeshBounds(mapa.cols, mapa.rows, params, bounds_min, bounds_max);
+
+        // raw upload: no CPU copy, and the quads are already in spatial order
+        if (maze_mesh) maze_mesh->clear();
+        else maze_mesh = new Model("manual", shader_program);
+
+        MazeMeshStats stats;
+        size_t index_count = 0;
+        double mesh_ms = 0.0;
+        auto upload = [&](const auto& vertices, const auto& indices, auto makeGeometry) {
+            mesh_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            index_count = indices.size();
+            if (Mesh::fitsShortIndices(vertices.size())) {
+                std::vector<GLushort> short_indices(indices.begin(), indices.end());
+                makeGeometry(short_indices.data(), GL_UNSIGNED_SHORT);
+            }
+            else {
+                makeGeometry(indices.data(), GL_UNSIGNED_INT);
+            }
+        };
+
+        if (Mesh::vertex_format == VertexFormat::Packed && !Mesh::upload_colors) {
+            // written in the packed layout by the mesher itself, nothing to convert
+            MeshBuffer<packed_vertex> vertices;
+            MeshBuffer<GLuint> indices;
+            stats = buildMazeMesh(cells, mapa.cols, mapa.rows, mapa.step, params, vertices, indices);
+            upload(vertices, indices, [&](const void* index_data, GLenum index_type) {
+                auto geometry = std::make_shared<GpuGeometry>("maze", vertices.data(), vertices.size(), index_data,
+                    indices.size(), index_type, std::vector<MeshLod>{}, bounds_min, bounds_max);
+                maze_mesh->meshes.emplace_back(GL_TRIANGLES, shader_program, geometry, glm::vec3(0.0f), glm::vec3(0.0f));
+            });
+        }
+        else {
+            std::vector<vertex> vertices;
+            std::vector<GLuint> indices;
+            stats = buildMazeMesh(cells, mapa.cols, mapa.rows, mapa.step, params, vertices, indices);
+            upload(vertices, indices, [&](const void* index_data, GLenum index_type) {
+                maze_mesh->meshes.emplace_back(GL_TRIANGLES, shader_program, vertices.data(), vertices.size(),
+                    index_data, indices.size(), index_type, bounds_min, bounds_max, glm::vec3(0.0f), glm::vec3(0.0f),
+                    0, std::vector<MeshLod>{}, "maze");
+            });
+        }
+
+        size_t cube_triangles = size_t(mapa.rows) * mapa.cols * 12;
+        for (int j = 0; j < mapa.rows; ++j)
+            cube_triangles += std::count(mapa.ptr<uchar>(j), mapa.ptr<uchar>(j) + mapa.cols, '#') * 12;
+        std::cout << "[Maze] " << mapa.cols << "x" << mapa.rows << ": greedy mesh " << stats.wall_quads << " wall + "
+            << stats.floor_quads << " floor quads, " << index_count / 3 << " triangles (cubes: " << cube_triangles
+            << "), " << mesh_ms << " ms mesh, "
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms incl. upload\n";
+        return;
+    }
+
+    std::vector<mesh_instance> walls, floors;
+    floors.reserve(size_t(mapa.rows) * mapa.cols);
 
     for (int j = 0; j < mapa.rows; ++j) {
         for (int i = 0; i < mapa.cols; ++i) {
             char cell = mapa.at<uchar>(j, i);
+            float x = i - offsetX + 0.5f;
+            float z = j - offsetZ + 0.5f;
 
             // === Podlaha pro všechny typy buněk ===
-            Model* floor = new Model(*wall_cube);
-            floor->origin = glm::vec3(i - offsetX + 0.5f, maze_floor_base_y, j - offsetZ + 0.5f);
-            floor->scale = glm::vec3(1.0f, 0.05f, 1.0f);
-            floor->texture_ID = heightmap_texture_ID;
-            maze_models.push_back(floor);
+            floors.push_back({ glm::vec3(x, maze_floor_y, z), float(MAZE_LAYER), maze_floor_scale, 0.0f });
 
             // === Zdi ===
-            if (cell == '#') {
-                Model* cube = new Model(*wall_cube);
-                cube->origin = glm::vec3(i - offsetX + 0.5f, maze_base_y, j - offsetZ + 0.5f);// výš posunuté
-                cube->scale = glm::vec3(1.0f, 2.0f, 1.0f);                // dvojnásobná výška
-                maze_models.push_back(cube);
-                std::cout << "Wall at: " << cube->origin.x << ", " << cube->origin.y << ", " << cube->origin.z << "\n";
+            if (cell == '#')
+                walls.push_back({ glm::vec3(x, maze_wall_y, z), float(MAZE_LAYER), maze_wall_scale, 0.0f }); // dvojnásobná výška
+        }
+    }
 
-            }
+    maze_wall_instances.upload(walls);
+    maze_floor_instances.upload(floors);
+    std::cout << "[Maze] " << mapa.cols << "x" << mapa.rows << ": " << walls.size() << " walls, "
+        << floors.size() << " floor tiles, 2 instanced draws\n";
+}
 
-        }
+void FrameUniforms::resolve(const ShaderProgram& program) {
+    view = program.uniform<glm::mat4>("uV_m");
+    projection = program.uniform<glm::mat4>("uP_m");
+    shininess = program.uniform<float>("shininess");
+}
+
+void App::placeMazeLights(const cv::Mat& mapa, int count) {
+    std::vector<cv::Point> open_cells;
+    for (int j = 0; j < mapa.rows; ++j)
+        for (int i = 0; i < mapa.cols; ++i)
+            if (mapa.at<uchar>(j, i) != '#') open_cells.emplace_back(i, j);
+    if (open_cells.empty() || count <= 0) return;
+
+    std::mt19937 rng(12345);
+    std::shuffle(open_cells.begin(), open_cells.end(), rng);
+    std::uniform_real_distribution<float> hue(0.0f, 6.0f);
+
+    const float offsetX = mapa.cols / 2.0f, offsetZ = mapa.rows / 2.0f;
+    const float light_y = maze_floor_y + 1.5f;
+    for (int n = 0; n < count; ++n) {
+        const cv::Point& cell = open_cells[n % open_cells.size()];
+        float h = hue(rng);
+        glm::vec3 color = glm::clamp(glm::vec3(std::abs(h - 3.0f) - 1.0f, 2.0f - std::abs(h - 2.0f),
+            2.0f - std::abs(h - 4.0f)), 0.0f, 1.0f);
+        // short range: fades below 1/256 within about 5 cells
+        pointLights.push_back({ glm::vec3(cell.x - offsetX + 0.5f, light_y, cell.y - offsetZ + 0.5f),
+            glm::vec3(0.0f), color * 1.5f, glm::vec3(0.0f), 1.0f, 1.0f, 16.0f });
     }
+    std::cout << "[Lights] " << count << " maze lights, " << pointLights.size() << " point lights total\n";
 }
 
 Model* makeCubeModel(ShaderProgram& shader) {
+    // every cube shares one upload
+    Model* m = new Model("manual", shader);
+    if (GeometryHandle cube = GeometryRegistry::find("cube")) {
+        m->meshes.emplace_back(GL_TRIANGLES, shader, cube, glm::vec3(0), glm::vec3(0));
+        return m;
+    }
+
     std::vector<vertex> vertices;
     std::vector<GLuint> indices;
 
@@ -242,8 +374,8 @@ Model* makeCubeModel(ShaderProgram& shader) {
         indices.push_back(start + 0);
     }
 
-    Model* m = new Model("manual", shader);
-    m->meshes.emplace_back(GL_TRIANGLES, shader, vertices, indices, glm::vec3(0), glm::vec3(0));
+    m->meshes.emplace_back(GL_TRIANGLES, shader, vertices, indices, glm::vec3(0), glm::vec3(0), 0,
+        std::vector<float>{}, "cube");
     return m;
 }
 
@@ -330,14 +462,46 @@ void App::init_assets() {
     std::string texture_dir = base + settings.value("texture_dir", "textures/");
     std::string object_dir  = base + settings.value("object_dir", "objects/");
 
+    Mesh::optimize_on_load = settings.value("optimize_meshes", false);
+    std::cout << "[Settings] Mesh optimization " << (Mesh::optimize_on_load ? "ON" : "OFF") << "\n";
+    std::string vertex_format = settings.value("vertex_format", "float");
+    Mesh::vertex_format = (vertex_format == "packed") ? VertexFormat::Packed : VertexFormat::Float;
+    Mesh::upload_colors = settings.value("vertex_colors", false);
+    std::cout << "[Settings] Vertex format " << vertex_format << (Mesh::upload_colors ? " + colors" : "") << "\n";
+    Model::lod_ratios = settings.value("lod_ratios", Model::lod_ratios);
+    Model::lod_screen_sizes = settings.value("lod_screen_sizes", Model::lod_screen_sizes);
+    ShaderProgram::binary_cache_dir = settings.value("shader_cache_dir", "");
+
+    // === Shaders: every compile is issued now and overlaps the work below ===
+    ShaderBatch shader_batch;
+    startup_time = std::chrono::steady_clock::now();
+    auto step_start = std::chrono::steady_clock::now();
+    auto startupStep = [&](const char* what) {
+        auto now = std::chrono::steady_clock::now();
+        std::cout << "[Startup] " << what << " | " << std::chrono::duration<double, std::milli>(now - step_start).count()
+            << " ms | shaders " << (shader_batch.poll() ? "ready" : "still compiling") << "\n";
+        step_start = now;
+    };
+    // "chunked" (default), "gpu" (chunks displaced in tex.vert), "paged" or "mesh"
+    const std::string terrain_mode = settings.value("terrain_mode", "chunked");
+    terrain_paged = terrain_mode == "paged";
+    terrain_chunked = terrain_mode != "mesh" && !terrain_paged;
+    terrain_params.gpu_displacement = terrain_mode == "gpu";
+    terrain_features = terrain_shader_features | (terrain_params.gpu_displacement ? SHADER_TERRAIN : 0u);
+
     try {
-        shader_program = ShaderProgram(shader_dir + "tex.vert", shader_dir + "tex.frag");
-        particleShader = ShaderProgram(shader_dir + "particle.vert", shader_dir + "particle.frag");
-        shader_program.activate();
+        // every variant the scene uses, so none compiles on demand later
+        shader_variants = ShaderVariants(shader_dir + "tex.vert", shader_dir + "tex.frag");
+        shader_variants.request(shader_batch, SHADER_LIT);
+        shader_variants.request(shader_batch, glass_shader_features);
+        shader_variants.request(shader_batch, terrain_features);
+        shader_batch.add(particleShader, shader_dir + "particle.vert", shader_dir + "particle.frag");
+        clusters.init(shader_batch, shader_dir + "cluster_cull.comp");
     } catch (const std::exception& e) {
         std::cerr << "[Shader Load Error] " << e.what() << std::endl;
         return;
     }
+    startupStep("shaders submitted");
 
     // === Setup VAO/VBO for particles ===
     glGenVertexArrays(1, &particleVAO);
@@ -370,33 +534,95 @@ void App::init_assets() {
     spotLight.cutoff = glm::cos(glm::radians(15.0f));
     spotLight.outerCutoff = glm::cos(glm::radians(25.0f));
 
-    // === Load textures ===
-    maze_texture_ID     = textureInit(texture_dir + "box_rgb888.png");
-    heightmap_texture_ID = textureInit(texture_dir + "TextureDouble_A.png");
-    object1             = textureInit(texture_dir + "wire2.png");
-    object2             = textureInit(texture_dir + "wg_lily_00.png");
-    object3             = textureInit(texture_dir + "wg_lily_01.png");
+    // === Textures: decoded by workers, uploaded by run() as they finish ===
+    textures.setPreferCompressed(settings.value("compressed_textures", true));
+    textures.init(settings.value("texture_threads", 0u), size_t(settings.value("texture_ring_mb", 64)) << 20);
+    texture_upload_budget = size_t(settings.value("texture_upload_mb_per_frame", 32)) << 20;
+    textures.setBudget(size_t(settings.value("texture_budget_mb", 0)) << 20);
+    // same-sized materials share a GL_TEXTURE_2D_ARRAY: one binding for the maze and terrain
+    maze_texture_ID     = textures.requestArray({ texture_dir + "box_rgb888.png", texture_dir + "TextureDouble_A.png" });
+    heightmap_texture_ID = maze_texture_ID; // MAZE_LAYER, TERRAIN_LAYER
+    object1             = textures.requestArray({ texture_dir + "wire2.png" });
+    object2             = textures.requestArray({ texture_dir + "wg_lily_00.png", texture_dir + "wg_lily_01.png" });
+    object3             = object2;          // layers 0 and 1
+    startupStep("textures requested");
+
+    // === Generate maze (layout and lights; the meshes need the shader) ===
+    maze_greedy_mesh = settings.value("maze_mesh", "greedy") != "instanced";
+    int maze_cols = settings.contains("maze_size") ? settings["maze_size"].value("x", 25) : 25;
+    int maze_rows = settings.contains("maze_size") ? settings["maze_size"].value("y", 10) : 10;
+    mapa = cv::Mat(maze_rows, maze_cols, CV_8U);
+    cv::Point start = genLabyrinth(mapa);
+    placeMazeLights(mapa, settings.value("maze_lights", 100));
+    clusters.setEnabled(settings.value("clustered_lighting", true));
+    camera.Position = glm::vec3(start.x + 0.5f, -59.0f, start.y + 0.5f);
+    startupStep("maze generation");
+
+    std::vector<vertex> heightmap_vertices;
+    std::vector<GLuint> heightmap_indices;
+    terrain_step = std::max(1, settings.value("terrain_step", terrain_step));
+    terrain_params.chunk_cells = settings.value("terrain_chunk_cells", terrain_params.chunk_cells);
+    terrain_params.lod_distance = settings.value("terrain_lod_distance", terrain_params.lod_distance);
+    terrain_params.pool_chunks = settings.value("terrain_chunk_pool", terrain_params.pool_chunks);
+    terrain_tile_cells = settings.value("terrain_tile_cells", terrain_tile_cells);
+    paged_params.radius = settings.value("terrain_page_radius", paged_params.radius);
+    heightmap_file = texture_dir + settings.value("heightmap", "heights.png");
+    terrain_procedural = settings.value("heightmap", "heights.png") == "procedural";
+    {
+        const json noise = settings.value("terrain_noise", json::object());
+        terrain_noise_size = std::max(2, noise.value("size", terrain_noise_size));
+        terrain_noise.seed = noise.value("seed", terrain_noise.seed);
+        terrain_noise.frequency = 1.0f / noise.value("wavelength", 1.0f / terrain_noise.frequency);
+        terrain_noise.octaves = noise.value("octaves", terrain_noise.octaves);
+        terrain_noise.lacunarity = noise.value("lacunarity", terrain_noise.lacunarity);
+        terrain_noise.gain = noise.value("gain", terrain_noise.gain);
+        terrain_noise.warp = noise.value("warp", terrain_noise.warp);
+        terrain_noise.warp_frequency = 1.0f / noise.value("warp_wavelength", 1.0f / terrain_noise.warp_frequency);
+        terrain_noise.warp_octaves = noise.value("warp_octaves", terrain_noise.warp_octaves);
+        terrain_noise.contrast = noise.value("contrast", terrain_noise.contrast);
+    }
+    loadHeightmap(heightmap_vertices, heightmap_indices);
+    startupStep("heightmap meshing");
+
+    // === Wait for the shaders ===
+    try {
+        shader_batch.finish();
+        for (const auto& [features, program] : shader_variants.programs()) {
+            frame_uniforms.emplace_back();
+            frame_uniforms.back().resolve(program);
+            if (features & SHADER_POINT_LIGHTS) clusters.attach(program);
+        }
+        shader_program = shader_variants.get(SHADER_LIT);
+        shader_program.activate();
+        particle_view = particleShader.uniform<glm::mat4>("uV_m");
+        particle_projection = particleShader.uniform<glm::mat4>("uP_m");
+
+        const ShaderBuildStats& stats = ShaderProgram::build_stats;
+        std::cout << "[Shaders] " << stats.programs << " programs ready, " << stats.ms << " ms on this thread ("
+            << stats.cache_hits << " from the binary cache"
+            << (ShaderProgram::binary_cache_dir.empty() ? ", cache disabled" : "") << ")\n";
+    } catch (const std::exception& e) {
+        std::cerr << "[Shader Load Error] " << e.what() << std::endl;
+        return;
+    }
 
-    // === Generate maze ===
     wall_cube = makeCubeModel(shader_program);
-    mapa = cv::Mat(10, 25, CV_8U);
-    cv::Point start = genLabyrinth(mapa);
     generateMazeModels(mapa);
-    camera.Position = glm::vec3(start.x + 0.5f, -59.0f, start.y + 0.5f);
 
     // === Transparent cubes ===
     float maze_floor_y = -60.0f;
-    auto addGlassCube = [&](glm::vec3 pos, GLuint tex) {
-        Model* cube = makeCubeModel(shader_program);
+    auto addGlassCube = [&](glm::vec3 pos, GLuint tex, int layer) {
+        Model* cube = makeCubeModel(shader_variants.get(glass_shader_features));
         cube->origin = pos;
         cube->scale = glm::vec3(1.0f);
         cube->transparent = true;
         cube->texture_ID = tex;
+        cube->texture_layer = layer;
         maze_models.push_back(cube);
     };
-    addGlassCube(glm::vec3(5.0f, maze_floor_y, 5.0f), object1);
-    addGlassCube(glm::vec3(7.0f, maze_floor_y, 5.0f), object2);
-    addGlassCube(glm::vec3(6.0f, maze_floor_y, 7.0f), object3);
+    addGlassCube(glm::vec3(5.0f, maze_floor_y, 5.0f), object1, 0);
+    addGlassCube(glm::vec3(7.0f, maze_floor_y, 5.0f), object2, 0);
+    addGlassCube(glm::vec3(6.0f, maze_floor_y, 7.0f), object3, 1);
 
     // === Load OBJ models ===
     auto loadModel = [&](const std::string& filename, glm::vec3 pos, glm::vec3 scale) {
@@ -410,8 +636,11 @@ void App::init_assets() {
     loadModel("bunny10k.obj", glm::vec3(3.0f, maze_floor_y, 10.0f), glm::vec3(50.0f));
 
     // === Camera and projection ===
-    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1024.0f / 768.0f, 0.1f, 1000.0f);
-    shader_program.setUniform("uP_m", projection);
+    {
+        int fb_width, fb_height;
+        glfwGetFramebufferSize(window, &fb_width, &fb_height);
+        setProjection(glm::perspective(glm::radians(60.0f), 1024.0f / 768.0f, 0.1f, 1000.0f), fb_width, fb_height);
+    }
     camera = Camera(glm::vec3(start.x + 0.5f, -59.0f, start.y + 0.5f));
 
     glEnable(GL_DEPTH_TEST);
@@ -419,56 +648,27 @@ void App::init_assets() {
     glFrontFace(GL_CCW);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-    initHeightmap();
+    initHeightmap(heightmap_vertices, heightmap_indices);
+    startupStep("GPU uploads");
+    GeometryRegistry::report(std::cout);
 }
 
-GLuint App::textureInit(const std::string& filename) {
-    std::cout << "[Texture] Loading texture: " << filename << "\n";
-
-    // Načtení obrázku včetně alfa kanálu, pokud existuje
-    cv::Mat img = cv::imread(filename, cv::IMREAD_UNCHANGED);
-    if (img.empty()) {
-        std::cerr << "[Texture ERROR] Failed to load image: " << filename << "\n";
-        return 0;
-    }
-
-    int channels = img.channels();
-    int width = img.cols;
-    int height = img.rows;
-    GLenum internal_format = GL_RGB8;
-    GLenum format = GL_RGB;
-
-    if (channels == 4) {
-        cv::cvtColor(img, img, cv::COLOR_BGRA2RGBA);
-        internal_format = GL_RGBA8;
-        format = GL_RGBA;
+void App::reportTextureStreaming() {
+    if (textures_reported) return;
+    auto ms = [&] { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startup_time).count(); };
+    if (!first_frame_reported) {
+        TextureStreamer::Stats s = textures.stats();
+        std::cout << "[Startup] First frame after " << ms() << " ms | textures " << s.loaded << "/" << s.requested << " loaded\n";
+        first_frame_reported = true;
     }
-    else if (channels == 3) {
-        cv::cvtColor(img, img, cv::COLOR_BGR2RGB);
-        internal_format = GL_RGB8;
-        format = GL_RGB;
+    if (textures.idle()) {
+        TextureStreamer::Stats s = textures.stats();
+        std::cout << "[Texture] All " << s.requested << " textures done after " << ms() << " ms | "
+            << s.loaded << " loaded, " << s.failed << " failed, " << (s.bytes >> 20) << " MB | decode "
+            << s.decode_ms << " ms (workers), upload " << s.upload_ms << " ms (render thread) | "
+            << s.compressed << " block-compressed, " << (s.saved_bytes >> 10) << " KB VRAM saved\n";
+        textures_reported = true;
     }
-    else {
-        std::cerr << "[Texture ERROR] Unsupported number of channels: " << channels << "\n";
-        return 0;
-    }
-
-    // Vytvoření a nahrání textury do GPU
-    GLuint tex_ID;
-    glCreateTextures(GL_TEXTURE_2D, 1, &tex_ID);
-    glTextureStorage2D(tex_ID, 1, internal_format, width, height);
-    glTextureSubImage2D(tex_ID, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, img.data);
-
-    // Parametry textury
-    glTextureParameteri(tex_ID, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTextureParameteri(tex_ID, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTextureParameteri(tex_ID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTextureParameteri(tex_ID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glGenerateTextureMipmap(tex_ID);
-
-    std::cout << "[Texture] Loaded " << filename << " | " << width << "x" << height << " | channels=" << channels << "\n";
-    return tex_ID;
 }
 
 int App::run() {
@@ -555,33 +755,32 @@ int App::run() {
         float wall_top_y = 1.0f;
         float eps = 0.01f;
 
-        for (const Model* m : maze_models) {
-            if (!m || m->transparent) continue;
-
+        // Walls and floor tiles sit on the maze grid, so only the tile under
+        // the player needs testing (floor first, as it was generated first)
+        {
             glm::vec3 player = camera.Position;
-            glm::vec3 half = m->scale * 0.5f;
-
-            float topY = m->origin.y + half.y;
-            float minX = m->origin.x - half.x;
-            float maxX = m->origin.x + half.x;
-            float minZ = m->origin.z - half.z;
-            float maxZ = m->origin.z + half.z;
-
-            bool insideXZ = player.x >= minX && player.x <= maxX &&
-                player.z >= minZ && player.z <= maxZ;
-            float yDiff = player.y - topY;
-            float targetY = topY + wall_top_y;
-
-            if (!noclip_enabled && insideXZ && std::abs(yDiff) < 1.0f) {
-                if (player.y < targetY - 0.01f || !was_on_wall_top) {
-                    camera.Position.y = targetY;
+            int x_tile = static_cast<int>(floor(player.x + mapa.cols / 2.0f));
+            int z_tile = static_cast<int>(floor(player.z + mapa.rows / 2.0f));
+
+            if (x_tile >= 0 && x_tile < mapa.cols && z_tile >= 0 && z_tile < mapa.rows) {
+                float tops[2] = { maze_floor_y + maze_floor_scale.y * 0.5f, maze_wall_y + maze_wall_scale.y * 0.5f };
+                int top_count = (getmap(mapa, x_tile, z_tile) == '#') ? 2 : 1;
+
+                for (int t = 0; t < top_count; ++t) {
+                    float yDiff = player.y - tops[t];
+                    float targetY = tops[t] + wall_top_y;
+
+                    if (!noclip_enabled && std::abs(yDiff) < 1.0f) {
+                        if (player.y < targetY - 0.01f || !was_on_wall_top) {
+                            camera.Position.y = targetY;
+                        }
+                        on_wall_top = true;
+                        break;
+                    }
                 }
-                on_wall_top = true;
-                break;
             }
         }
 
-
         was_on_wall_top = on_wall_top;
 
         if (!noclip_enabled && !on_wall_top)
@@ -593,35 +792,19 @@ int App::run() {
 
         // === Upload matrices ===
         glm::mat4 view = camera.GetViewMatrix();
-        shader_program.setUniform("uV_m", view);
-
-        // === Light uniforms ===
-        shader_program.setUniform("directionalLight_direction", sun.direction);
-        shader_program.setUniform("directionalLight_ambient", sun.ambient);
-        shader_program.setUniform("directionalLight_diffuse", sun.diffuse);
-        shader_program.setUniform("directionalLight_specular", sun.specular);
+        for (const FrameUniforms& u : frame_uniforms) {
+            u.view.set(view);
+            u.shininess.set(32.0f);
+        }
+        Model::setLodEye(camera.Position);
+        terrain.update(camera.Position, view);
+        paged_terrain.update(camera.Position, view);
 
+        // === Lights: one buffer write, then binning into clusters ===
         spotLight.position = camera.Position;
         spotLight.direction = glm::normalize(camera.Front);
-
-        shader_program.setUniform("spotLight_position", spotLight.position);
-        shader_program.setUniform("spotLight_direction", spotLight.direction);
-        shader_program.setUniform("spotLight_constant", spotLight.constant);
-        shader_program.setUniform("spotLight_linear", spotLight.linear);
-        shader_program.setUniform("spotLight_quadratic", spotLight.quadratic);
-        shader_program.setUniform("spotLight_cutoff", spotLight.cutoff);
-        shader_program.setUniform("spotLight_outerCutoff", spotLight.outerCutoff);
-
-        for (int i = 0; i < 3; ++i) {
-            std::string idx = std::to_string(i);
-            shader_program.setUniform("pointLightPositions[" + idx + "]", pointLights[i].position);
-            shader_program.setUniform("pointLights[" + idx + "].diffuse", pointLights[i].diffuse);
-            shader_program.setUniform("pointLights[" + idx + "].constant", pointLights[i].constant);
-            shader_program.setUniform("pointLights[" + idx + "].linear", pointLights[i].linear);
-            shader_program.setUniform("pointLights[" + idx + "].quadratic", pointLights[i].quadratic);
-        }
-
-        shader_program.setUniform("shininess", 32.0f);
+        light_buffer.update(sun, spotLight, pointLights);
+        clusters.cull(view, light_buffer);
 
         // === Update animated models ===
         float t = static_cast<float>(now);
@@ -630,12 +813,34 @@ int App::run() {
             m->orientation.y = t * 1.5f;
         }
 
+        // === Textures drawn this frame stay resident (evicted ones reload) ===
+        textures.touch(maze_texture_ID);
+        textures.touch(heightmap_texture_ID);
+        for (Model* m : maze_models) textures.touch(m->texture_ID);
+        for (Model* m : moving_models) textures.touch(m->texture_ID);
+
         // === Draw opaque ===
+        if (maze_mesh) {
+            maze_mesh->draw(maze_texture_ID);
+        }
+        else {
+            wall_cube->drawInstanced(maze_texture_ID, maze_floor_instances);
+            wall_cube->drawInstanced(maze_texture_ID, maze_wall_instances);
+        }
+
         for (Model* m : maze_models)
             if (!m->transparent) m->draw(maze_texture_ID);
 
         if (heightmap_model && !heightmap_model->transparent)
             heightmap_model->draw(heightmap_texture_ID);
+        if (!terrain.empty()) {
+            Model::bindTexture(heightmap_texture_ID);
+            terrain.draw(TERRAIN_LAYER);
+        }
+        if (!paged_terrain.empty()) {
+            Model::bindTexture(heightmap_texture_ID);
+            paged_terrain.draw(TERRAIN_LAYER);
+        }
 
         for (Model* m : moving_models)
             if (!m->transparent) m->draw(m->texture_ID, glm::vec3(0.0f), m->orientation);
@@ -668,20 +873,34 @@ int App::run() {
         updateFPS();
         glfwPollEvents();
         glfwSwapBuffers(window);
+
+        reportTextureStreaming();
+        textures.update(texture_upload_budget);
     }
 
     return EXIT_SUCCESS;
 }
 
 App::~App() {
-    if (window) glfwDestroyWindow(window);
-    glfwTerminate();
-
+    // GL objects (including shared geometry) go before the context does
     for (auto* m : maze_models) delete m;
     maze_models.clear();
+    for (auto* m : moving_models) delete m;
+    moving_models.clear();
+    maze_wall_instances.clear();
+    maze_floor_instances.clear();
+    if (maze_mesh) { maze_mesh->clear(); delete maze_mesh; }
     if (wall_cube) delete wall_cube;
     if (model) { model->clear(); delete model; }
+    terrain.clear();
+    paged_terrain.clear();
+
+    clusters.clear();
+    light_buffer.clear();
+    shader_variants.clear();
+    textures.shutdown();
 
-    shader_program.clear();
+    if (window) glfwDestroyWindow(window);
+    glfwTerminate();
     std::cout << "Bye...\n";
 }
\ No newline at end of file
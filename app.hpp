@@ -2,12 +2,21 @@
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <chrono>
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include "assets.hpp"
 #include "ShaderProgram.hpp"
 #include "Model.hpp"
 #include "camera.hpp"
+#include "light_buffer.hpp"
+#include "clustered_lighting.hpp"
+#include "shader_variants.hpp"
+#include "texture_streamer.hpp"
+#include "chunked_terrain.hpp"
+#include "paged_terrain.hpp"
+#include "terrain_noise.hpp"
+#include "terrain_raycast.hpp"
 
 struct SpotLight {
     glm::vec3 position;
@@ -50,6 +59,15 @@ struct DirectionalLight {
     glm::vec3 specular;
 };
 
+// Per-frame uniforms of one main program variant, resolved once after
+// linking; the lights themselves live in LightBuffer
+struct FrameUniforms {
+    Uniform<glm::mat4> view, projection;
+    Uniform<float> shininess;
+
+    void resolve(const ShaderProgram& program);
+};
+
 class App {
 public:
     bool init();
@@ -76,12 +94,15 @@ public:
     void updateCameraHeight();
     void drawParticles();
     void spawnParticles(glm::vec3 origin, int count);
+    void pickTerrain();             // particles where the view ray meets the terrain
 
     // Maze logic from maze_gen.cpp
     uchar getmap(cv::Mat& map, int x, int y);
     cv::Point genLabyrinth(cv::Mat& map);
     bool noclip_enabled = false;  // default off
     void toggleFullscreen();
+    void toggleClusterDebug();
+    void toggleClusteredLighting();
 
 private:
     GLFWwindow* window;
@@ -101,7 +122,16 @@ private:
     ShaderProgram particleShader;
     GLuint particleVAO = 0;
     GLuint particleVBO = 0;
-    ShaderProgram shader_program;
+    ShaderVariants shader_variants;         // tex.vert/tex.frag per feature set
+    ShaderProgram shader_program;           // the SHADER_LIT variant most models use
+    // glass cubes drop fully transparent texels; the terrain fades into the distance
+    static constexpr unsigned glass_shader_features = SHADER_LIT | SHADER_ALPHA_TEST;
+    static constexpr unsigned terrain_shader_features = SHADER_LIT | SHADER_FOG | SHADER_TERRAIN_TEXTURE;
+    std::vector<FrameUniforms> frame_uniforms; // one per variant
+    void setProjection(const glm::mat4& projection, int fb_width, int fb_height);
+    LightBuffer light_buffer;
+    ClusteredLighting clusters;
+    Uniform<glm::mat4> particle_view, particle_projection;
     Model* model = nullptr;
     GLuint VAO_ID{ 0 };
     GLuint VBO_ID{ 0 };
@@ -109,9 +139,14 @@ private:
     GLuint object1 = 0;
     GLuint object2 = 0;
     GLuint object3 = 0;
-    GLuint heightmap_texture_ID = 0;            // heightmap texture
+    GLuint heightmap_texture_ID = 0;            // heightmap texture (the maze's array)
+    static constexpr int MAZE_LAYER = 0, TERRAIN_LAYER = 1; // layers of the material array
     Model* glassCube = nullptr;
-    GLuint textureInit(const std::string& filename);
+    TextureStreamer textures;
+    size_t texture_upload_budget = size_t(32) << 20; // bytes per frame
+    std::chrono::steady_clock::time_point startup_time;
+    bool first_frame_reported = false, textures_reported = false;
+    void reportTextureStreaming();
 
     bool fullscreen_enabled = false;
     int windowed_x = 100, windowed_y = 100;
@@ -119,17 +154,55 @@ private:
 
     // Maze-related
     cv::Mat mapa;
-    cv::Mat heightmap_img; // grayscale heightmap image
+    cv::Mat heightmap_img; // grayscale heightmap image (not kept in paged mode)
+    std::filesystem::path heightmap_file;       // app_settings.json: "heightmap", under "texture_dir"
+    // "heightmap": "procedural" generates the heights instead (app_settings.json: "terrain_noise")
+    bool terrain_procedural = false;
+    NoiseTerrainParams terrain_noise;
+    int terrain_noise_size = 4096;
     std::vector<Model*> moving_models;
 
-    std::vector<Model*> maze_models;
+    std::vector<Model*> maze_models;            // loose models in the maze (glass cubes)
     Model* wall_cube = nullptr;
     void generateMazeModels(const cv::Mat& mapa);
-
+    // adds count point lights over random open cells (app_settings.json: "maze_lights")
+    void placeMazeLights(const cv::Mat& mapa, int count);
+
+    // Maze walls and floor tiles: by default one greedy-meshed static model of
+    // the exposed faces; "maze_mesh": "instanced" draws one cube per cell
+    // with one instanced draw each for walls and floors
+    bool maze_greedy_mesh = true;
+    Model* maze_mesh = nullptr;
+    InstanceBuffer maze_wall_instances;
+    InstanceBuffer maze_floor_instances;
+    const float maze_wall_y = -67.0f;           // tile centers
+    const float maze_floor_y = -68.0f;
+    const glm::vec3 maze_wall_scale{ 1.0f, 2.0f, 1.0f };
+    const glm::vec3 maze_floor_scale{ 1.0f, 0.05f, 1.0f };
+
+    // Terrain: by default a quadtree of LOD chunks built around the camera;
+    // "terrain_mode": "gpu" displaces the chunks in tex.vert from a height
+    // texture instead, "mesh" draws one static grid of the whole heightmap,
+    // "paged" streams tiles of a .tiles file around the camera
+    bool terrain_chunked = true;
+    bool terrain_paged = false;
+    unsigned terrain_features = terrain_shader_features; // + SHADER_TERRAIN in gpu mode
+    ChunkedTerrain terrain;
+    ChunkedTerrainParams terrain_params;        // app_settings.json: "terrain_chunk_cells", "terrain_lod_distance", "terrain_chunk_pool"
+    PagedTerrain paged_terrain;
+    PagedTerrainParams paged_params;            // app_settings.json: "terrain_tile_cells", "terrain_page_radius"
+    int terrain_tile_cells = 128;
+    TerrainRaycaster terrain_rays;              // ray queries and camera height on heightmap_img (not in paged mode)
     Model* heightmap_model = nullptr;
-    void initHeightmap(); // initialization
+    int terrain_step = 7;                       // mesh mode: heightmap pixels per grid cell (app_settings.json: "terrain_step")
+    // CPU meshing or chunk bounds (no GL calls, overlaps shader compilation) and GPU upload
+    void loadHeightmap(std::vector<vertex>& vertices, std::vector<GLuint>& indices);
+    void initHeightmap(const std::vector<vertex>& vertices, const std::vector<GLuint>& indices);
 };
 
+// unit cube with per-face normals, used for the maze and glass cubes
+Model* makeCubeModel(ShaderProgram& shader);
+
 struct AppSettings {
     std::string appname = "default";
     int width = 800;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <GL/glew.h> 
 #include <GL/wglew.h> 
@@ -21,3 +22,10 @@ struct vertex {
     vertex() = default;
 };
 
+// compact GPU vertex (16 bytes instead of 44), see vertex_packing.hpp
+struct packed_vertex {
+    uint16_t position[4];   // unorm16 relative to the mesh bounds, [3] is padding
+    int16_t normal[2];      // snorm16 octahedral encoding
+    uint16_t texcoords[2];  // half float
+};
+
@@ -0,0 +1,1832 @@
+// bench.cpp
+// Command-line benchmarks: my_app.exe --bench <name> [args...]
+
+#include "bench.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "InstanceBuffer.hpp"
+#include "Mesh.hpp"
+#include "Model.hpp"
+#include "app.hpp"
+#include "OBJloader.h"
+#include "maze_mesher.hpp"
+#include "clustered_lighting.hpp"
+#include "light_buffer.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplify.hpp"
+#include "shader_cache.hpp"
+#include "shader_variants.hpp"
+#include "block_compression.hpp"
+#include "chunked_terrain.hpp"
+#include "paged_terrain.hpp"
+#include "terrain_mesher.hpp"
+#include "terrain_noise.hpp"
+#include "terrain_raycast.hpp"
+#include "texture_streamer.hpp"
+#include "vertex_packing.hpp"
+
+// Heap allocations counted while an AllocationCounter is alive (--bench
+// uniforms). The app's allocator is left alone: MSVC debug builds count
+// through a CRT allocation hook installed only for the counter's lifetime;
+// elsewhere only a build with BENCH_COUNT_ALLOCATIONS counts, by replacing
+// operator new in that build.
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#define BENCH_ALLOC_HOOK
+#endif
+
+static std::atomic<size_t> g_allocations{ 0 };
+static std::atomic<bool> g_count_allocations{ false };
+
+#if defined(BENCH_ALLOC_HOOK)
+static int countingAllocHook(int type, void*, size_t, int, long, const unsigned char*, int) {
+    if (type == _HOOK_ALLOC || type == _HOOK_REALLOC) g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return TRUE;
+}
+#elif defined(BENCH_COUNT_ALLOCATIONS)
+void* operator new(std::size_t size) {
+    if (g_count_allocations.load(std::memory_order_relaxed)) g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#endif
+
+class AllocationCounter {
+public:
+    AllocationCounter() : start_(g_allocations.load()) {
+#if defined(BENCH_ALLOC_HOOK)
+        previous_ = _CrtSetAllocHook(countingAllocHook);
+#endif
+        g_count_allocations = true;
+    }
+    ~AllocationCounter() {
+        g_count_allocations = false;
+#if defined(BENCH_ALLOC_HOOK)
+        _CrtSetAllocHook(previous_);
+#endif
+    }
+    AllocationCounter(const AllocationCounter&) = delete;
+    AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+    static constexpr bool available() {
+#if defined(BENCH_ALLOC_HOOK) || defined(BENCH_COUNT_ALLOCATIONS)
+        return true;
+#else
+        return false;
+#endif
+    }
+    size_t count() const { return g_allocations.load() - start_; }
+
+private:
+    size_t start_;
+#if defined(BENCH_ALLOC_HOOK)
+    _CRT_ALLOC_HOOK previous_{ nullptr };
+#endif
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::vector<unsigned> threadCounts() {
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    if (hw == 1)
+        std::cout << "  (one hardware thread: only the 1-thread row is measured; multi-core times are unknown here)\n";
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < hw; t *= 2) counts.push_back(t);
+    counts.push_back(hw);
+    return counts;
+}
+
+// Writes a quad grid with v/vt/vn and mixed quad/triangle faces until the
+// file reaches approximately target_bytes
+void writeSyntheticOBJ(const std::filesystem::path& path, size_t target_bytes) {
+    std::ofstream out(path, std::ios::binary);
+    std::vector<char> buf(1 << 20);
+    out.rdbuf()->pubsetbuf(buf.data(), buf.size());
+
+    // each grid cell costs roughly 180 bytes of text
+    const size_t cells = std::max<size_t>(1, target_bytes / 180);
+    const size_t side = static_cast<size_t>(std::sqrt(static_cast<double>(cells))) + 1;
+
+    char line[128];
+    for (size_t z = 0; z <= side; ++z)
+        for (size_t x = 0; x <= side; ++x) {
+            float fx = x * 0.01f, fz = z * 0.01f;
+            float y = std::sin(fx * 3.0f) * std::cos(fz * 2.0f);
+            out.write(line, snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", fx, y, fz));
+            out.write(line, snprintf(line, sizeof(line), "vt %.6f %.6f\n", fx / side, fz / side));
+            out.write(line, snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", 0.0f, 1.0f, 0.0f));
+        }
+
+    const size_t row = side + 1;
+    for (size_t z = 0; z < side; ++z)
+        for (size_t x = 0; x < side; ++x) {
+            size_t a = z * row + x + 1, b = a + 1, c = a + row + 1, d = a + row;
+            if ((x + z) & 1)
+                out.write(line, snprintf(line, sizeof(line), "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n",
+                    a, a, a, d, d, d, c, c, c, b, b, b));
+            else
+                out.write(line, snprintf(line, sizeof(line), "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\nf %zu//%zu %zu//%zu %zu//%zu\n",
+                    a, a, a, d, d, d, c, c, c, a, a, c, c, b, b));
+        }
+}
+
+// --bench obj [size_mb=256 | file.obj]
+int benchObjParse(const std::vector<std::string>& args) {
+    std::filesystem::path path;
+    bool temporary = false;
+
+    if (!args.empty() && std::filesystem::exists(args[0])) {
+        path = args[0];
+    }
+    else {
+        size_t size_mb = args.empty() ? 256 : std::stoul(args[0]);
+        path = std::filesystem::temp_directory_path() / "bench_synthetic.obj";
+        temporary = true;
+
+        std::cout << "[Bench] Generating synthetic OBJ (" << size_mb << " MB): " << path << "\n";
+        auto start = Clock::now();
+        writeSyntheticOBJ(path, size_mb << 20);
+        std::cout << "[Bench] Generated in " << secondsSince(start) << " s\n";
+    }
+
+    const double mb = std::filesystem::file_size(path) / (1024.0 * 1024.0);
+    std::cout << "[Bench] OBJ parse throughput, file " << mb << " MB\n";
+
+    for (unsigned threads : threadCounts()) {
+        ObjData obj;
+        auto start = Clock::now();
+        bool ok = parseOBJ(path.string().c_str(), obj, threads);
+        double t = secondsSince(start);
+        if (!ok) {
+            std::cerr << "[Bench] Parse failed\n";
+            return EXIT_FAILURE;
+        }
+        std::cout << "  threads=" << threads
+            << "  time=" << t * 1000.0 << " ms"
+            << "  " << mb / t << " MB/s"
+            << "  (v=" << obj.positions.size() << " vt=" << obj.uvs.size()
+            << " vn=" << obj.normals.size() << " tris=" << obj.corners.size() / 3 << ")\n";
+    }
+
+    {
+        std::vector<glm::vec3> v, n;
+        std::vector<glm::vec2> uv;
+        auto start = Clock::now();
+        loadOBJ(path.string().c_str(), v, uv, n);
+        double t = secondsSince(start);
+        std::cout << "  loadOBJ (parse + expand)  time=" << t * 1000.0 << " ms  " << mb / t << " MB/s\n";
+    }
+
+    if (temporary) std::filesystem::remove(path);
+    return EXIT_SUCCESS;
+}
+
+// --bench meshcache [size_mb=64 | file.obj]
+// CPU side of model startup: text OBJ (parse + dedup) vs mapped .meshbin
+int benchMeshCache(const std::vector<std::string>& args) {
+    std::filesystem::path path;
+    bool temporary = false;
+
+    if (!args.empty() && std::filesystem::exists(args[0])) {
+        path = args[0];
+    }
+    else {
+        size_t size_mb = args.empty() ? 64 : std::stoul(args[0]);
+        path = std::filesystem::temp_directory_path() / "bench_meshcache.obj";
+        temporary = true;
+        writeSyntheticOBJ(path, size_mb << 20);
+    }
+    std::filesystem::remove(meshCachePath(path));
+
+    const int runs = 5;
+    double cold = 0.0, warm = 0.0;
+    size_t vertex_count = 0;
+
+    for (int run = 0; run < runs; ++run) {
+        std::filesystem::remove(meshCachePath(path));
+
+        auto start = Clock::now();
+        std::vector<vertex> vertices;
+        std::vector<GLuint> indices;
+        if (!loadOBJIndexed(path.string().c_str(), vertices, indices)) return EXIT_FAILURE;
+        glm::vec3 lo = vertices.empty() ? glm::vec3(0.0f) : vertices[0].position, hi = lo;
+        for (const vertex& v : vertices) {
+            lo = glm::min(lo, v.position);
+            hi = glm::max(hi, v.position);
+        }
+        saveMeshCache(path, 0, {}, vertices, indices, { MeshLod{ 0, static_cast<GLsizei>(indices.size()), 0.0f } }, lo, hi);
+        cold += secondsSince(start);
+        vertex_count = vertices.size();
+
+        start = Clock::now();
+        MeshBinView view;
+        if (!loadMeshCache(path, 0, {}, view)) {
+            std::cerr << "[Bench] Cache did not validate\n";
+            return EXIT_FAILURE;
+        }
+        warm += secondsSince(start);
+    }
+
+    std::cout << "[Bench] Mesh startup (" << vertex_count << " vertices, avg of " << runs << " runs)\n"
+        << "  cold (OBJ parse + dedup + write cache): " << cold / runs * 1000.0 << " ms\n"
+        << "  warm (map + validate .meshbin):         " << warm / runs * 1000.0 << " ms\n"
+        << "  speedup: " << cold / warm << "x\n";
+
+    std::filesystem::remove(meshCachePath(path));
+    if (temporary) std::filesystem::remove(path);
+    return EXIT_SUCCESS;
+}
+
+// --bench meshopt [size_mb=64 | file.obj]
+// Vertex cache / overdraw / fetch optimization cost relative to OBJ parsing
+int benchMeshOptimizer(const std::vector<std::string>& args) {
+    std::filesystem::path path;
+    bool temporary = false;
+
+    if (!args.empty() && std::filesystem::exists(args[0])) {
+        path = args[0];
+    }
+    else {
+        size_t size_mb = args.empty() ? 64 : std::stoul(args[0]);
+        path = std::filesystem::temp_directory_path() / "bench_meshopt.obj";
+        temporary = true;
+        writeSyntheticOBJ(path, size_mb << 20);
+    }
+
+    auto start = Clock::now();
+    std::vector<vertex> vertices;
+    std::vector<GLuint> indices;
+    if (!loadOBJIndexed(path.string().c_str(), vertices, indices)) return EXIT_FAILURE;
+    double parse = secondsSince(start);
+
+    VertexCacheStats before, after;
+    start = Clock::now();
+    optimizeMesh(vertices, indices, &before, &after);
+    double optimize = secondsSince(start);
+
+    std::cout << "[Bench] Mesh optimizer (" << indices.size() / 3 << " triangles)\n"
+        << "  OBJ parse + dedup: " << parse * 1000.0 << " ms\n"
+        << "  optimizeMesh:      " << optimize * 1000.0 << " ms (" << optimize / parse * 100.0 << "% of parse)\n"
+        << "  ACMR " << before.acmr << " -> " << after.acmr << "  ATVR " << before.atvr << " -> " << after.atvr << "\n";
+
+    if (temporary) std::filesystem::remove(path);
+    return EXIT_SUCCESS;
+}
+
+// Closed UV sphere; unlike the synthetic OBJ grid it has no per-face
+// attribute splits, so the simplifier is not held back by locked seams
+void makeSphere(unsigned segments, std::vector<vertex>& vertices, std::vector<GLuint>& indices) {
+    const unsigned rings = segments / 2;
+    const float pi = 3.14159265f;
+    for (unsigned r = 0; r <= rings; ++r)
+        for (unsigned s = 0; s <= segments; ++s) {
+            float theta = pi * r / rings, phi = 2.0f * pi * s / segments;
+            glm::vec3 n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            vertices.push_back({ n, n, glm::vec2(float(s) / segments, float(r) / rings) });
+        }
+    for (unsigned r = 0; r < rings; ++r)
+        for (unsigned s = 0; s < segments; ++s) {
+            GLuint a = r * (segments + 1) + s, b = a + 1, c = a + segments + 1, d = c + 1;
+            indices.insert(indices.end(), { a, c, b, b, c, d });
+        }
+}
+
+// --bench lod [segments=256 | file.obj]
+// QEM LOD chain build time per level, chained the way Mesh builds it
+int benchLodChain(const std::vector<std::string>& args) {
+    std::vector<vertex> vertices;
+    std::vector<GLuint> indices;
+    if (!args.empty() && std::filesystem::exists(args[0])) {
+        if (!loadOBJIndexed(args[0].c_str(), vertices, indices)) return EXIT_FAILURE;
+    }
+    else {
+        makeSphere(args.empty() ? 256 : std::stoul(args[0]), vertices, indices);
+    }
+
+    std::cout << "[Bench] LOD chain (" << indices.size() / 3 << " triangles)\n";
+    std::vector<GLuint> level(indices);
+    double total = 0.0;
+    for (float ratio : { 0.5f, 0.25f, 0.1f }) {
+        float error = 0.0f;
+        auto start = Clock::now();
+        level = simplifyMesh(vertices, level, static_cast<size_t>(indices.size() * ratio) / 3 * 3, &error);
+        double seconds = secondsSince(start);
+        total += seconds;
+        std::cout << "  " << ratio * 100.0f << "%: " << level.size() / 3 << " triangles, error " << error
+            << ", " << seconds * 1000.0 << " ms\n";
+    }
+    std::cout << "  total: " << total * 1000.0 << " ms\n";
+    return EXIT_SUCCESS;
+}
+
+// --bench vertexformat [segments=256 | file.obj]
+// Packed vs float vertex: memory and a visual diff of the decoded attributes.
+// Shades each vertex like tex.frag's directional light from both paths and
+// reports the difference in 8-bit color levels; the position error is given
+// in pixels for the mesh filling a 1080p screen.
+int benchVertexFormat(const std::vector<std::string>& args) {
+    std::vector<vertex> vertices;
+    std::vector<GLuint> indices;
+    if (!args.empty() && std::filesystem::exists(args[0])) {
+        if (!loadOBJIndexed(args[0].c_str(), vertices, indices)) return EXIT_FAILURE;
+    }
+    else {
+        makeSphere(args.empty() ? 256 : std::stoul(args[0]), vertices, indices);
+    }
+    if (vertices.empty()) return EXIT_FAILURE;
+
+    glm::vec3 lo = vertices[0].position, hi = lo;
+    for (const vertex& v : vertices) {
+        lo = glm::min(lo, v.position);
+        hi = glm::max(hi, v.position);
+    }
+
+    auto start = Clock::now();
+    std::vector<packed_vertex> packed;
+    packVertices(vertices.data(), vertices.size(), lo, hi, packed);
+    double pack_ms = secondsSince(start) * 1000.0;
+
+    const glm::vec3 scale = packedPositionScale(lo, hi);
+    const float extent = std::max(glm::length(hi - lo), 1e-12f);
+    const glm::vec3 light_dirs[] = { glm::normalize(glm::vec3(-0.2f, -1.0f, -0.3f)), glm::normalize(glm::vec3(1.0f, 0.5f, 0.0f)),
+        glm::normalize(glm::vec3(0.0f, 0.3f, -1.0f)) };
+    const glm::vec3 view_dir = glm::normalize(glm::vec3(0.3f, 0.2f, 1.0f));
+    auto shade = [&](const glm::vec3& n, const glm::vec3& l) {
+        glm::vec3 L = -l;
+        float diffuse = std::max(glm::dot(n, L), 0.0f);
+        float specular = std::pow(std::max(glm::dot(glm::reflect(-L, n), view_dir), 0.0f), 32.0f);
+        return std::min(0.2f + 0.6f * diffuse + 0.4f * specular, 1.0f) * 255.0f;
+    };
+
+    double max_pos = 0.0, max_angle = 0.0, max_uv = 0.0, max_levels = 0.0, sum_levels = 0.0;
+    size_t over_one_level = 0;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const vertex& ref = vertices[i];
+        vertex dec = unpackVertex(packed[i], lo, scale);
+        glm::vec3 ref_n = glm::normalize(ref.normal);
+
+        max_pos = std::max(max_pos, double(glm::length(dec.position - ref.position)));
+        max_angle = std::max(max_angle, double(std::acos(std::clamp(glm::dot(ref_n, dec.normal), -1.0f, 1.0f))));
+        max_uv = std::max(max_uv, double(glm::length(dec.texcoords - ref.texcoords)));
+        for (const glm::vec3& l : light_dirs) {
+            double d = std::abs(shade(ref_n, l) - shade(dec.normal, l));
+            max_levels = std::max(max_levels, d);
+            sum_levels += d;
+            if (d > 1.0) ++over_one_level;
+        }
+    }
+    const size_t samples = vertices.size() * std::size(light_dirs);
+
+    std::cout << "[Bench] Vertex format (" << vertices.size() << " vertices)\n"
+        << "  float:  " << sizeof(vertex) << " B/vertex, " << vertices.size() * sizeof(vertex) / 1024 << " KB\n"
+        << "  packed: " << sizeof(packed_vertex) << " B/vertex, " << packed.size() * sizeof(packed_vertex) / 1024 << " KB ("
+        << double(sizeof(vertex)) / sizeof(packed_vertex) << "x smaller), pack " << pack_ms << " ms\n"
+        << "  position error: " << max_pos / extent * 1080.0 << " px at 1080p (max " << max_pos << ")\n"
+        << "  normal error:   " << glm::degrees(max_angle) << " deg max\n"
+        << "  uv error:       " << max_uv << " max\n"
+        << "  shading diff:   " << max_levels << " levels max, " << sum_levels / samples << " mean, "
+        << over_one_level << " of " << samples << " samples > 1 level\n";
+    return max_levels <= 2.0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Same carving as App::genLabyrinth (randomized DFS over odd cells), without
+// OpenCV and the console dump
+std::vector<unsigned char> generateMazeCells(int cols, int rows, unsigned seed) {
+    std::vector<unsigned char> cells(size_t(cols) * rows, '#');
+    auto at = [&](int x, int y) -> unsigned char& { return cells[size_t(y) * cols + x]; };
+    std::mt19937 rng(seed);
+    std::vector<std::pair<int, int>> stack{ { 1, 1 } };
+    at(1, 1) = '.';
+
+    while (!stack.empty()) {
+        auto [x, y] = stack.back();
+        int options[4][2];
+        int n = 0;
+        if (x > 2 && at(x - 2, y) == '#') { options[n][0] = -1; options[n++][1] = 0; }
+        if (y > 2 && at(x, y - 2) == '#') { options[n][0] = 0; options[n++][1] = -1; }
+        if (x < cols - 3 && at(x + 2, y) == '#') { options[n][0] = 1; options[n++][1] = 0; }
+        if (y < rows - 3 && at(x, y + 2) == '#') { options[n][0] = 0; options[n++][1] = 1; }
+        if (n == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int k = rng() % n;
+        at(x + options[k][0], y + options[k][1]) = '.';
+        at(x + 2 * options[k][0], y + 2 * options[k][1]) = '.';
+        stack.emplace_back(x + 2 * options[k][0], y + 2 * options[k][1]);
+    }
+    return cells;
+}
+
+// --bench mazemesh [size=4096]
+// Greedy maze mesher rebuild time and output size vs. one cube per cell, in
+// the float and the packed vertex layout (the app's default), then the
+// packed rebuild of the largest maze per thread count
+int benchMazeMesher(const std::vector<std::string>& args) {
+    std::cout << "[Bench] Greedy maze mesher\n";
+    std::vector<int> sizes{ 25, 256, 1024 };
+    sizes.push_back(args.empty() ? 4096 : std::stoi(args[0]));
+
+    std::vector<vertex> vertices;
+    std::vector<GLuint> indices;
+    MeshBuffer<packed_vertex> packed;
+    MeshBuffer<GLuint> packed_indices;
+    std::vector<unsigned char> cells;
+    MazeMeshParams params;
+    for (int n : sizes) {
+        cells = generateMazeCells(n, n, 1);
+        size_t wall_cells = std::count(cells.begin(), cells.end(), '#');
+        params.origin = glm::vec2(-n / 2.0f);
+
+        auto start = Clock::now();
+        buildMazeMesh(cells.data(), n, n, n, params, vertices, indices);
+        double float_ms = secondsSince(start) * 1000.0;
+        const double float_mb = double(vertices.size() * sizeof(vertex)) / (1 << 20);
+        std::vector<vertex>().swap(vertices);
+        std::vector<GLuint>().swap(indices);
+
+        start = Clock::now();
+        MazeMeshStats stats = buildMazeMesh(cells.data(), n, n, n, params, packed, packed_indices);
+        double packed_ms = secondsSince(start) * 1000.0;
+
+        size_t cube_tris = (wall_cells + cells.size()) * 12; // one wall cube + one floor cube per cell
+        std::cout << "  " << n << "x" << n << ": " << stats.wall_quads << " wall + " << stats.floor_quads << " floor quads, "
+            << packed_indices.size() / 3 << " triangles (cubes: " << cube_tris << ", " << double(cube_tris) / (packed_indices.size() / 3)
+            << "x) | float " << float_ms << " ms, " << float_mb << " MB vertices | packed " << packed_ms << " ms, "
+            << double(packed.size() * sizeof(packed_vertex)) / (1 << 20) << " MB vertices + "
+            << double(packed_indices.size() * sizeof(GLuint)) / (1 << 20) << " MB indices\n";
+    }
+
+    // fresh output every run, as a maze rebuild in the app
+    const int n = sizes.back();
+    for (unsigned threads : threadCounts()) {
+        MeshBuffer<packed_vertex>().swap(packed);
+        MeshBuffer<GLuint>().swap(packed_indices);
+        auto start = Clock::now();
+        buildMazeMesh(cells.data(), n, n, n, params, packed, packed_indices, threads);
+        std::cout << "  " << n << "x" << n << " packed, " << threads << " threads: " << secondsSince(start) * 1000.0 << " ms\n";
+    }
+    return EXIT_SUCCESS;
+}
+
+// Hidden window with a 4.6 context, or 4.5 (DSA + compute; e.g. Mesa llvmpipe)
+GLFWwindow* createBenchContext() {
+    if (!glfwInit()) return nullptr;
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = nullptr;
+    for (int minor : { 6, 5 }) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+        if ((window = glfwCreateWindow(640, 480, "bench", nullptr, nullptr))) break;
+    }
+    if (!window) return nullptr;
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (glewInit() != GLEW_OK) return nullptr;
+    return window;
+}
+
+// --bench maze [shader_dir=resources/shaders/]
+// CPU frame time of drawing an n x n maze: one Model per tile (the old path,
+// up to 250x250) vs. two instanced draws
+int benchMazeInstancing(const std::vector<std::string>& args) {
+    std::filesystem::path shader_dir = args.empty() ? "resources/shaders/" : args[0];
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+
+    {
+        ShaderProgram shader(shader_dir / "tex.vert", shader_dir / "tex.frag");
+        Model* cube_model = makeCubeModel(shader);
+        Model& cube = *cube_model;
+
+        const int frames = 20;
+        auto frameTime = [&](const std::function<void()>& draw) {
+            draw(); // warm-up
+            glFinish();
+            auto start = Clock::now();
+            for (int f = 0; f < frames; ++f) draw();
+            double cpu = secondsSince(start) / frames;
+            glFinish();
+            return cpu * 1000.0;
+        };
+
+        std::cout << "[Bench] Maze draw CPU time per frame (" << frames << " frames)\n";
+        std::mt19937 rng(1);
+        for (int n : { 25, 100, 250, 500, 1000 }) {
+            std::vector<mesh_instance> walls, floors;
+            for (int z = 0; z < n; ++z)
+                for (int x = 0; x < n; ++x) {
+                    floors.push_back({ glm::vec3(x, -68.0f, z), 0.0f, glm::vec3(1.0f, 0.05f, 1.0f), 0.0f });
+                    if (rng() % 2) walls.push_back({ glm::vec3(x, -67.0f, z), 0.0f, glm::vec3(1.0f, 2.0f, 1.0f), 0.0f });
+                }
+
+            InstanceBuffer wall_buffer, floor_buffer;
+            wall_buffer.upload(walls);
+            floor_buffer.upload(floors);
+            double instanced = frameTime([&] {
+                cube.drawInstanced(0, floor_buffer);
+                cube.drawInstanced(0, wall_buffer);
+            });
+
+            std::cout << "  " << n << "x" << n << " (" << walls.size() + floors.size() << " cubes): instanced "
+                << instanced << " ms";
+            if (n <= 250) {
+                std::vector<Model> models;
+                models.reserve(walls.size() + floors.size());
+                for (const auto* list : { &floors, &walls })
+                    for (const mesh_instance& inst : *list) {
+                        models.push_back(cube);
+                        models.back().origin = inst.offset;
+                        models.back().scale = inst.scale;
+                    }
+                double per_model = frameTime([&] {
+                    for (Model& m : models) m.draw(0);
+                });
+                std::cout << ", per-model " << per_model << " ms (" << per_model / instanced << "x)";
+            }
+            std::cout << "\n";
+
+            wall_buffer.clear();
+            floor_buffer.clear();
+        }
+        cube.clear();
+        delete cube_model;
+        shader.clear();
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// --bench uniforms [shader_dir=resources/shaders/] [draws=200]
+// Per-frame uniform traffic of the main shader: the three-light uniform block
+// App::run used to set plus the per-mesh uniforms of `draws` draws, by name
+// with a location query per call (the old path) vs. handles resolved at link
+// time and the light buffer. Heap allocations per frame are reported by MSVC
+// debug builds and builds with BENCH_COUNT_ALLOCATIONS defined.
+int benchUniforms(const std::vector<std::string>& args) {
+    std::filesystem::path shader_dir = args.empty() ? "resources/shaders/" : args[0];
+    const int draws = args.size() > 1 ? std::stoi(args[1]) : 200;
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+
+    {
+        ShaderProgram shader(shader_dir / "tex.vert", shader_dir / "tex.frag");
+        const GLuint program = shader.ID;
+        size_t gl_calls = 0;
+
+        // old path: string names, glUseProgram + glGetUniformLocation + glUniform*
+        auto byName = [&](const std::string& name, const glm::vec3& v) {
+            GLint loc = glGetUniformLocation(program, name.c_str());
+            glUniform3fv(loc, 1, glm::value_ptr(v));
+            gl_calls += 2;
+        };
+        auto byNameF = [&](const std::string& name, float v) {
+            GLint loc = glGetUniformLocation(program, name.c_str());
+            glUniform1f(loc, v);
+            gl_calls += 2;
+        };
+        auto byNameI = [&](const std::string& name, int v) {
+            GLint loc = glGetUniformLocation(program, name.c_str());
+            glUniform1i(loc, v);
+            gl_calls += 2;
+        };
+        auto byNameM = [&](const std::string& name, const glm::mat4& m) {
+            GLint loc = glGetUniformLocation(program, name.c_str());
+            glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(m));
+            gl_calls += 2;
+        };
+        const glm::vec3 v(0.5f);
+        const glm::mat4 m(1.0f);
+        auto oldFrame = [&] {
+            glUseProgram(program);
+            ++gl_calls;
+            byNameM("uV_m", m);
+            for (const char* name : { "directionalLight_direction", "directionalLight_ambient",
+                "directionalLight_diffuse", "directionalLight_specular", "spotLight_position", "spotLight_direction" })
+                byName(name, v);
+            for (const char* name : { "spotLight_constant", "spotLight_linear", "spotLight_quadratic",
+                "spotLight_cutoff", "spotLight_outerCutoff" })
+                byNameF(name, 1.0f);
+            for (int i = 0; i < 3; ++i) {
+                std::string idx = std::to_string(i);
+                byName("pointLightPositions[" + idx + "]", v);
+                byName("pointLights[" + idx + "].diffuse", v);
+                byNameF("pointLights[" + idx + "].constant", 1.0f);
+                byNameF("pointLights[" + idx + "].linear", 1.0f);
+                byNameF("pointLights[" + idx + "].quadratic", 1.0f);
+            }
+            byNameF("shininess", 32.0f);
+            for (int d = 0; d < draws; ++d) {
+                byNameM("uM_m", m);
+                glUseProgram(program);
+                ++gl_calls;
+                byName("uPosOffset", v);
+                byName("uPosScale", v);
+                byNameI("uOctNormals", 0);
+                byNameI("uInstanced", 0);
+            }
+        };
+
+        FrameUniforms frame;
+        frame.resolve(shader);
+        const auto model = shader.uniform<glm::mat4>("uM_m");
+        const auto pos_offset = shader.uniform<glm::vec3>("uPosOffset");
+        const auto pos_scale = shader.uniform<glm::vec3>("uPosScale");
+        const auto oct_normals = shader.uniform<int>("uOctNormals");
+        const auto instanced = shader.uniform<int>("uInstanced");
+
+        LightBuffer lights;
+        DirectionalLight sun{ v, v, v, v };
+        SpotLight spot{ v, v, v, v, v, 1.0f, 0.09f, 0.032f, 0.9f, 0.8f };
+        std::vector<PointLight> points(3, PointLight{ v, v, v, v, 1.0f, 0.045f, 0.0075f });
+        auto newFrame = [&] {
+            frame.view.set(m);
+            lights.update(sun, spot, points);
+            lights.bind();
+            frame.shininess.set(32.0f);
+            gl_calls += 4;
+            shader.activate(); // binds once, skipped while bound
+            for (int d = 0; d < draws; ++d) {
+                model.set(m);
+                pos_offset.set(v);
+                pos_scale.set(v);
+                oct_normals.set(0);
+                instanced.set(0);
+                gl_calls += 5;
+            }
+        };
+
+        const int frames = 100;
+        auto measure = [&](const char* label, const std::function<void()>& fn) {
+            fn(); // warm-up
+            glFinish();
+            gl_calls = 0;
+            size_t allocations = 0;
+            auto start = Clock::now();
+            {
+                AllocationCounter counter;
+                for (int f = 0; f < frames; ++f) fn();
+                allocations = counter.count();
+            }
+            double ms = secondsSince(start) * 1000.0 / frames;
+            glFinish();
+            std::cout << "  " << label << ": " << gl_calls / frames << " GL calls, ";
+            if (AllocationCounter::available()) std::cout << allocations / frames << " allocations, ";
+            std::cout << ms << " ms CPU per frame\n";
+        };
+
+        std::cout << "[Bench] Uniform updates per frame (light block + " << draws << " draws, "
+            << frames << " frames)\n";
+        measure("by name  ", oldFrame);
+        measure("handles  ", newFrame);
+        shader.clear();
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// --bench clusters [shader_dir=resources/shaders/] [maze=96] [width=1280] [height=720]
+// GPU frame time of the greedy-meshed maze lit by an increasing number of
+// short-range point lights: every light per fragment vs. clustered lists.
+// Renders off-screen, so it also runs on Mesa's software rasterizer.
+int benchClusteredLighting(const std::vector<std::string>& args) {
+    std::filesystem::path shader_dir = args.empty() ? "resources/shaders/" : args[0];
+    const int n = args.size() > 1 ? std::stoi(args[1]) : 96;
+    const int width = args.size() > 2 ? std::stoi(args[2]) : 1280;
+    const int height = args.size() > 3 ? std::stoi(args[3]) : 720;
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "[Bench] Clustered lighting, " << glGetString(GL_RENDERER) << ", " << width << "x" << height
+        << ", " << n << "x" << n << " maze\n";
+
+    {
+        ShaderProgram shader(shader_dir / "tex.vert", shader_dir / "tex.frag");
+        ClusteredLighting clusters;
+        clusters.init(shader_dir / "cluster_cull.comp");
+        clusters.attach(shader);
+
+        // target
+        GLuint fbo, color, depth;
+        glCreateFramebuffers(1, &fbo);
+        glCreateRenderbuffers(1, &color);
+        glCreateRenderbuffers(1, &depth);
+        glNamedRenderbufferStorage(color, GL_RGBA8, width, height);
+        glNamedRenderbufferStorage(depth, GL_DEPTH_COMPONENT24, width, height);
+        glNamedFramebufferRenderbuffer(fbo, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+
+        GLuint white;
+        const unsigned char texel[4] = { 255, 255, 255, 255 };
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &white); // tex.frag samples a layer of an array
+        glTextureStorage3D(white, 1, GL_RGBA8, 1, 1, 1);
+        glTextureSubImage3D(white, 0, 0, 0, 0, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+        glBindTextureUnit(0, white);
+
+        // scene: the app's maze heights, the same light falloff as placeMazeLights,
+        // camera above one corner looking across
+        std::vector<unsigned char> cells = generateMazeCells(n, n, 1);
+        MazeMeshParams params;
+        params.origin = glm::vec2(-n / 2.0f);
+        params.wall_bottom = -68.0f;
+        params.wall_top = -66.0f;
+        params.floor_bottom = -68.025f;
+        params.floor_top = -67.975f;
+        std::vector<vertex> vertices;
+        std::vector<GLuint> indices;
+        buildMazeMesh(cells.data(), n, n, n, params, vertices, indices);
+        glm::vec3 bmin(params.origin.x, params.floor_bottom, params.origin.y);
+        glm::vec3 bmax(params.origin.x + n, params.wall_top, params.origin.y + n);
+        Mesh maze(GL_TRIANGLES, shader, vertices.data(), vertices.size(), indices.data(), indices.size(),
+            GL_UNSIGNED_INT, bmin, bmax, glm::vec3(0.0f), glm::vec3(0.0f));
+
+        const glm::mat4 projection = glm::perspective(glm::radians(60.0f), float(width) / height, 0.1f, 1000.0f);
+        const glm::vec3 eye(-n * 0.5f, -60.0f, -n * 0.5f);
+        const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, -68.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        shader.uniform<glm::mat4>("uP_m").set(projection);
+        shader.uniform<glm::mat4>("uV_m").set(view);
+        shader.uniform<float>("shininess").set(32.0f);
+        maze.setModelMatrix(glm::mat4(1.0f));
+        clusters.setProjection(projection, 0.1f, 1000.0f, width, height);
+
+        std::vector<std::pair<int, int>> open_cells;
+        for (int j = 0; j < n; ++j)
+            for (int i = 0; i < n; ++i)
+                if (cells[size_t(j) * n + i] != '#') open_cells.emplace_back(i, j);
+
+        DirectionalLight sun{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.05f), glm::vec3(0.1f), glm::vec3(0.1f) };
+        SpotLight spot{ eye, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(0.0f),
+            1.0f, 0.09f, 0.032f, std::cos(glm::radians(15.0f)), std::cos(glm::radians(25.0f)) };
+        LightBuffer lights;
+
+        const int frames = 5;
+        auto frameTime = [&] {
+            auto frame = [&] {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                clusters.cull(view, lights);
+                maze.draw();
+            };
+            frame(); // warm-up
+            glFinish();
+            auto start = Clock::now();
+            for (int f = 0; f < frames; ++f) frame();
+            glFinish();
+            return secondsSince(start) * 1000.0 / frames;
+        };
+
+        std::mt19937 rng(7);
+        std::cout << "  lights | brute force ms | clustered ms | speedup | lights/cluster avg, max\n";
+        for (int count : { 16, 128, 512, 1024, 2048, 4096 }) {
+            std::shuffle(open_cells.begin(), open_cells.end(), rng);
+            std::vector<PointLight> points;
+            for (int k = 0; k < count; ++k) {
+                auto [i, j] = open_cells[k % open_cells.size()];
+                glm::vec3 pos(params.origin.x + i + 0.5f, -66.5f, params.origin.y + j + 0.5f);
+                points.push_back({ pos, glm::vec3(0.0f), glm::vec3(1.5f, 1.2f, 0.9f), glm::vec3(0.0f), 1.0f, 1.0f, 16.0f });
+            }
+            lights.update(sun, spot, points);
+
+            clusters.setEnabled(false);
+            double brute = frameTime();
+            clusters.setEnabled(true);
+            double clustered = frameTime();
+
+            unsigned max_count, overflow;
+            double average;
+            clusters.occupancy(max_count, average, overflow);
+            std::cout << "  " << count << " | " << brute << " | " << clustered << " | " << brute / clustered << "x | "
+                << average << ", " << max_count << (overflow ? " (overflow)" : "") << "\n";
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &color);
+        glDeleteRenderbuffers(1, &depth);
+        glDeleteTextures(1, &white);
+        maze.clear();
+        lights.clear();
+        clusters.clear();
+        shader.clear();
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// --bench shadercache [shader_dir=resources/shaders/]
+// Startup cost of the app's programs (tex, particle, cluster_cull): compiled
+// from source without a cache, cold (compile + save binaries), warm (restored
+// with glProgramBinary) and with binaries the driver rejects (fallback)
+int benchShaderCache(const std::vector<std::string>& args) {
+    std::filesystem::path shader_dir = args.empty() ? "resources/shaders/" : args[0];
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+    if (!programBinariesSupported()) {
+        std::cerr << "[Bench] The driver offers no program binary formats\n";
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path cache_dir = std::filesystem::temp_directory_path() / "my_app_progbin_bench";
+    std::error_code ec;
+    std::filesystem::remove_all(cache_dir, ec);
+
+    auto startup = [&](const std::filesystem::path& dir) {
+        ShaderProgram::binary_cache_dir = dir;
+        ShaderProgram::build_stats = {};
+        ShaderProgram tex(shader_dir / "tex.vert", shader_dir / "tex.frag");
+        ShaderProgram particle(shader_dir / "particle.vert", shader_dir / "particle.frag");
+        ShaderProgram cull(shader_dir / "cluster_cull.comp");
+        glFinish();
+        tex.clear();
+        particle.clear();
+        cull.clear();
+        return ShaderProgram::build_stats;
+    };
+
+    std::vector<std::pair<std::string, ShaderBuildStats>> rows;
+    // cold first: later source compiles may be served by the driver's own
+    // shader cache (Mesa: point MESA_SHADER_CACHE_DIR at an empty directory)
+    rows.emplace_back("cold", startup(cache_dir));
+    for (int i = 0; i < 3; ++i) rows.emplace_back("warm", startup(cache_dir));
+    rows.emplace_back("no cache", startup({}));
+
+    // same payloads, bogus format: glProgramBinary fails and the programs are rebuilt
+    for (const auto& entry : std::filesystem::directory_iterator(cache_dir, ec)) {
+        std::fstream f(entry.path(), std::ios::binary | std::ios::in | std::ios::out);
+        ProgramBinHeader h{};
+        f.read(reinterpret_cast<char*>(&h), sizeof(h));
+        h.binary_format = 0xDEADu;
+        f.seekp(0);
+        f.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    }
+    rows.emplace_back("rejected", startup(cache_dir));
+    rows.emplace_back("warm again", startup(cache_dir));
+
+    std::cout << "\n  run | programs | from cache | startup ms\n";
+    for (const auto& [label, stats] : rows)
+        std::cout << "  " << label << " | " << stats.programs << " | " << stats.cache_hits << " | " << stats.ms << "\n";
+
+    ShaderProgram::binary_cache_dir.clear();
+    std::filesystem::remove_all(cache_dir, ec);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// --bench shaderbatch [shader_dir=resources/shaders/] [maze=1024]
+// Startup with the app's three programs plus CPU work (greedy-meshing a
+// maze of the given size): programs built one by one, then the work, vs. a
+// ShaderBatch submitted first and finished after the work. Every run compiles
+// a uniquified copy of the sources so driver-side shader caches cannot help.
+int benchShaderBatch(const std::vector<std::string>& args) {
+    std::filesystem::path shader_dir = args.empty() ? "resources/shaders/" : args[0];
+    const int maze = args.size() > 1 ? std::stoi(args[1]) : 1024;
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path tmp_dir = std::filesystem::temp_directory_path() / "my_app_shaderbatch_bench";
+    std::filesystem::create_directories(tmp_dir);
+    const std::vector<std::string> files{ "tex.vert", "tex.frag", "particle.vert", "particle.frag", "cluster_cull.comp" };
+    int run = 0;
+    auto uniqueSources = [&] {
+        ++run;
+        for (const std::string& f : files) {
+            std::ifstream in(shader_dir / f, std::ios::binary);
+            std::ofstream out(tmp_dir / f, std::ios::binary | std::ios::trunc);
+            out << in.rdbuf() << "\n// bench run " << run << "\n";
+        }
+    };
+
+    std::vector<unsigned char> cells = generateMazeCells(maze, maze, 1);
+    auto work = [&] {
+        std::vector<vertex> vertices;
+        std::vector<GLuint> indices;
+        MazeMeshParams params;
+        buildMazeMesh(cells.data(), maze, maze, maze, params, vertices, indices);
+        return indices.size();
+    };
+    auto start = Clock::now();
+    work();
+    const double work_ms = secondsSince(start) * 1000.0;
+
+    ShaderProgram::binary_cache_dir.clear();
+    std::cout << "\n  path | startup ms (work alone " << work_ms << " ms)\n";
+    for (int rep = 0; rep < 3; ++rep) {
+        {
+            uniqueSources();
+            auto t0 = Clock::now();
+            ShaderProgram tex(tmp_dir / "tex.vert", tmp_dir / "tex.frag");
+            ShaderProgram particle(tmp_dir / "particle.vert", tmp_dir / "particle.frag");
+            ShaderProgram cull(tmp_dir / "cluster_cull.comp");
+            work();
+            std::cout << "  sequential | " << secondsSince(t0) * 1000.0 << "\n";
+            tex.clear(); particle.clear(); cull.clear();
+        }
+        {
+            uniqueSources();
+            auto t0 = Clock::now();
+            ShaderProgram tex, particle, cull;
+            ShaderBatch batch;
+            batch.add(tex, tmp_dir / "tex.vert", tmp_dir / "tex.frag");
+            batch.add(particle, tmp_dir / "particle.vert", tmp_dir / "particle.frag");
+            batch.add(cull, tmp_dir / "cluster_cull.comp");
+            work();
+            batch.finish();
+            std::cout << "  batch (" << (batch.parallel() ? "parallel" : "serial") << " driver) | "
+                << secondsSince(t0) * 1000.0 << "\n";
+            tex.clear(); particle.clear(); cull.clear();
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(tmp_dir, ec);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// --bench variants [shader_dir=resources/shaders/] [maze=96] [width=1280] [height=720]
+// GPU frame time of the clusters scene (128 maze lights) per tex.frag
+// variant, against the plain build that carries every feature
+int benchShaderVariants(const std::vector<std::string>& args) {
+    std::filesystem::path shader_dir = args.empty() ? "resources/shaders/" : args[0];
+    const int n = args.size() > 1 ? std::stoi(args[1]) : 96;
+    const int width = args.size() > 2 ? std::stoi(args[2]) : 1280;
+    const int height = args.size() > 3 ? std::stoi(args[3]) : 720;
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "[Bench] Shader variants, " << glGetString(GL_RENDERER) << ", " << width << "x" << height
+        << ", " << n << "x" << n << " maze\n";
+
+    {
+        ShaderProgram plain(shader_dir / "tex.vert", shader_dir / "tex.frag");
+        ShaderVariants variants(shader_dir / "tex.vert", shader_dir / "tex.frag");
+        const std::vector<unsigned> masks{ SHADER_LIT, SHADER_LIT | SHADER_FOG, SHADER_LIT | SHADER_ALPHA_TEST,
+            SHADER_SUN | SHADER_SPOT_LIGHT, SHADER_SUN };
+        for (unsigned mask : masks) variants.get(mask);
+
+        ClusteredLighting clusters;
+        clusters.init(shader_dir / "cluster_cull.comp");
+        clusters.attach(plain);
+        for (const auto& [mask, program] : variants.programs())
+            if (mask & SHADER_POINT_LIGHTS) clusters.attach(program);
+
+        GLuint fbo, color, depth;
+        glCreateFramebuffers(1, &fbo);
+        glCreateRenderbuffers(1, &color);
+        glCreateRenderbuffers(1, &depth);
+        glNamedRenderbufferStorage(color, GL_RGBA8, width, height);
+        glNamedRenderbufferStorage(depth, GL_DEPTH_COMPONENT24, width, height);
+        glNamedFramebufferRenderbuffer(fbo, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+
+        GLuint white;
+        const unsigned char texel[4] = { 255, 255, 255, 255 };
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &white); // tex.frag samples a layer of an array
+        glTextureStorage3D(white, 1, GL_RGBA8, 1, 1, 1);
+        glTextureSubImage3D(white, 0, 0, 0, 0, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+        glBindTextureUnit(0, white);
+
+        std::vector<unsigned char> cells = generateMazeCells(n, n, 1);
+        MazeMeshParams params;
+        params.origin = glm::vec2(-n / 2.0f);
+        params.wall_bottom = -68.0f;
+        params.wall_top = -66.0f;
+        params.floor_bottom = -68.025f;
+        params.floor_top = -67.975f;
+        std::vector<vertex> vertices;
+        std::vector<GLuint> indices;
+        buildMazeMesh(cells.data(), n, n, n, params, vertices, indices);
+        glm::vec3 bmin(params.origin.x, params.floor_bottom, params.origin.y);
+        glm::vec3 bmax(params.origin.x + n, params.wall_top, params.origin.y + n);
+        Mesh maze(GL_TRIANGLES, plain, vertices.data(), vertices.size(), indices.data(), indices.size(),
+            GL_UNSIGNED_INT, bmin, bmax, glm::vec3(0.0f), glm::vec3(0.0f));
+
+        const glm::mat4 projection = glm::perspective(glm::radians(60.0f), float(width) / height, 0.1f, 1000.0f);
+        const glm::vec3 eye(-n * 0.5f, -60.0f, -n * 0.5f);
+        const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, -68.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        clusters.setProjection(projection, 0.1f, 1000.0f, width, height);
+
+        std::vector<std::pair<int, int>> open_cells;
+        for (int j = 0; j < n; ++j)
+            for (int i = 0; i < n; ++i)
+                if (cells[size_t(j) * n + i] != '#') open_cells.emplace_back(i, j);
+        std::mt19937 rng(7);
+        std::shuffle(open_cells.begin(), open_cells.end(), rng);
+        std::vector<PointLight> points;
+        for (int k = 0; k < 128; ++k) {
+            auto [i, j] = open_cells[k % open_cells.size()];
+            glm::vec3 pos(params.origin.x + i + 0.5f, -66.5f, params.origin.y + j + 0.5f);
+            points.push_back({ pos, glm::vec3(0.0f), glm::vec3(1.5f, 1.2f, 0.9f), glm::vec3(0.0f), 1.0f, 1.0f, 16.0f });
+        }
+        DirectionalLight sun{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.05f), glm::vec3(0.1f), glm::vec3(0.1f) };
+        SpotLight spot{ eye, glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f), glm::vec3(1.0f), glm::vec3(0.0f),
+            1.0f, 0.09f, 0.032f, std::cos(glm::radians(15.0f)), std::cos(glm::radians(25.0f)) };
+        LightBuffer lights;
+        lights.update(sun, spot, points);
+
+        // the same geometry drawn through each program
+        auto frameTime = [&](const ShaderProgram& program) {
+            Mesh drawable(GL_TRIANGLES, program, maze.getGeometry(), glm::vec3(0.0f), glm::vec3(0.0f));
+            program.uniform<glm::mat4>("uP_m").set(projection);
+            program.uniform<glm::mat4>("uV_m").set(view);
+            program.uniform<float>("shininess").set(32.0f);
+            drawable.setModelMatrix(glm::mat4(1.0f));
+            auto frame = [&] {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                clusters.cull(view, lights);
+                drawable.draw();
+            };
+            frame(); // warm-up
+            glFinish();
+            const int frames = 5;
+            auto start = Clock::now();
+            for (int f = 0; f < frames; ++f) frame();
+            glFinish();
+            return secondsSince(start) * 1000.0 / frames;
+        };
+
+        std::cout << "  program | brute force ms | clustered ms\n";
+        auto row = [&](const std::string& label, const ShaderProgram& program) {
+            clusters.setEnabled(false);
+            double brute = frameTime(program);
+            clusters.setEnabled(true);
+            double clustered = frameTime(program);
+            std::cout << "  " << label << " | " << brute << " | " << clustered << "\n";
+        };
+        row("plain (all features)", plain);
+        for (unsigned mask : masks) row(ShaderVariants::describe(mask), variants.get(mask));
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &color);
+        glDeleteRenderbuffers(1, &depth);
+        glDeleteTextures(1, &white);
+        maze.clear();
+        lights.clear();
+        clusters.clear();
+        variants.clear();
+        plain.clear();
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// count size x size RGB PNGs, noisy so decoding is not trivial
+std::vector<std::filesystem::path> writeBenchTextures(const std::filesystem::path& dir, int count, int size) {
+    std::filesystem::create_directories(dir);
+    std::vector<std::filesystem::path> files;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> noise(0, 31);
+    for (int i = 0; i < count; ++i) {
+        cv::Mat image(size, size, CV_8UC3);
+        for (int y = 0; y < size; ++y) {
+            uchar* row = image.ptr(y);
+            for (int x = 0; x < size; ++x) {
+                row[3 * x + 0] = uchar((x + i * 16) & 0xFF) ^ uchar(noise(rng));
+                row[3 * x + 1] = uchar(y & 0xFF) ^ uchar(noise(rng));
+                row[3 * x + 2] = uchar(((x ^ y) + i) & 0xFF);
+            }
+        }
+        files.push_back(dir / ("tex" + std::to_string(i) + ".png"));
+        cv::imwrite(files.back().string(), image);
+    }
+    return files;
+}
+
+// --bench textures [count=16] [size=2048]
+// Startup with count size x size PNGs (RGB, noisy so decoding is not
+// trivial): the synchronous path the app used before (imread, cvtColor,
+// upload, mipmaps, one texture after another before the first frame) vs.
+// TextureStreamer (placeholders, worker decode, PBO ring uploads spread over
+// frames). Reports time to first frame, time until every texture is loaded
+// and the longest frame spent in update().
+int benchTextures(const std::vector<std::string>& args) {
+    const int count = args.size() > 0 ? std::stoi(args[0]) : 16;
+    const int size = args.size() > 1 ? std::stoi(args[1]) : 2048;
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path tmp_dir = std::filesystem::temp_directory_path() / "my_app_texture_bench";
+    std::vector<std::filesystem::path> files = writeBenchTextures(tmp_dir, count, size);
+    std::cout << "[Bench] Texture streaming, " << glGetString(GL_RENDERER) << ", " << count << " x "
+        << size << "x" << size << " RGB PNG, " << std::thread::hardware_concurrency() << " hardware threads\n";
+
+    auto deleteTextures = [](std::vector<GLuint>& textures) {
+        glDeleteTextures(GLsizei(textures.size()), textures.data());
+        textures.clear();
+    };
+    std::vector<GLuint> textures;
+
+    std::cout << "\n  path | first frame ms | all loaded ms | longest frame ms\n";
+    for (int rep = 0; rep < 2; ++rep) {
+        {
+            auto t0 = Clock::now();
+            for (const auto& file : files) {
+                cv::Mat img = cv::imread(file.string(), cv::IMREAD_UNCHANGED);
+                cv::cvtColor(img, img, cv::COLOR_BGR2RGB);
+                GLuint tex;
+                glCreateTextures(GL_TEXTURE_2D, 1, &tex);
+                GLsizei levels = 1;
+                while ((std::max(img.cols, img.rows) >> levels) > 0) ++levels;
+                glTextureStorage2D(tex, levels, GL_RGB8, img.cols, img.rows);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTextureSubImage2D(tex, 0, 0, 0, img.cols, img.rows, GL_RGB, GL_UNSIGNED_BYTE, img.data);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                glGenerateTextureMipmap(tex);
+                textures.push_back(tex);
+            }
+            glFinish();
+            const double ms = secondsSince(t0) * 1000.0;
+            std::cout << "  synchronous | " << ms << " | " << ms << " | " << ms << "\n";
+            deleteTextures(textures);
+        }
+        {
+            auto t0 = Clock::now();
+            TextureStreamer streamer;
+            streamer.init();
+            for (const auto& file : files) textures.push_back(streamer.request(file));
+            double first_frame = 0.0, longest = 0.0;
+            size_t frames = 0;
+            do {
+                auto frame = Clock::now();
+                streamer.update();
+                glFinish(); // stands in for the frame's rendering and swap
+                longest = std::max(longest, secondsSince(frame) * 1000.0);
+                if (frames++ == 0) first_frame = secondsSince(t0) * 1000.0;
+                else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            } while (!streamer.idle());
+            const double all = secondsSince(t0) * 1000.0;
+            TextureStreamer::Stats s = streamer.stats();
+            std::cout << "  streamed (" << frames << " frames, " << s.loaded << " loaded, decode " << s.decode_ms
+                << " ms on workers) | " << first_frame << " | " << all << " | " << longest << "\n";
+            streamer.shutdown();
+            deleteTextures(textures);
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(tmp_dir, ec);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// --bench texcompress [count=8] [size=2048] [format=bc1|bc3|bc7]
+// The same PNGs loaded through TextureStreamer as RGB8 (decode, upload,
+// glGenerateMipmap) and as .dds files written by the texconv encoder
+// (read, upload every level). Reports encode cost, load time and the GPU
+// memory per texture; RGB8 is counted as RGBA8, which is how drivers store it.
+int benchTextureCompression(const std::vector<std::string>& args) {
+    const int count = args.size() > 0 ? std::stoi(args[0]) : 8;
+    const int size = args.size() > 1 ? std::stoi(args[1]) : 2048;
+    const std::string format_name = args.size() > 2 ? args[2] : "bc1";
+    const BlockFormat format = format_name == "bc7" ? BlockFormat::BC7 : format_name == "bc3" ? BlockFormat::BC3 : BlockFormat::BC1;
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path tmp_dir = std::filesystem::temp_directory_path() / "my_app_texcompress_bench";
+    std::vector<std::filesystem::path> files = writeBenchTextures(tmp_dir, count, size);
+    std::cout << "[Bench] Texture compression, " << glGetString(GL_RENDERER) << ", " << count << " x "
+        << size << "x" << size << " RGB PNG -> " << blockFormatName(format) << "\n";
+
+    double encode_ms = 0.0;
+    for (const auto& file : files) {
+        cv::Mat image = cv::imread(file.string(), cv::IMREAD_UNCHANGED);
+        std::vector<uint8_t> rgba(size_t(image.cols) * image.rows * 4);
+        for (int y = 0; y < image.rows; ++y) {
+            const uchar* row = image.ptr(y);
+            for (int x = 0; x < image.cols; ++x) {
+                uint8_t* texel = &rgba[4 * (size_t(y) * image.cols + x)];
+                texel[0] = row[3 * x + 2];
+                texel[1] = row[3 * x + 1];
+                texel[2] = row[3 * x + 0];
+                texel[3] = 255;
+            }
+        }
+        auto t0 = Clock::now();
+        CompressedTexture tex;
+        compressImage(rgba.data(), image.cols, image.rows, format, tex);
+        encode_ms += secondsSince(t0) * 1000.0;
+        saveDDS(std::filesystem::path(file).replace_extension(".dds"), tex);
+    }
+    std::cout << "  offline encode: " << encode_ms / count << " ms per texture\n";
+
+    std::cout << "\n  source | first frame ms | all loaded ms | upload ms (render thread) | GPU KB per texture\n";
+    for (int rep = 0; rep < 2; ++rep) {
+        for (bool compressed : { false, true }) {
+            auto t0 = Clock::now();
+            TextureStreamer streamer;
+            streamer.setPreferCompressed(compressed);
+            streamer.init();
+            std::vector<GLuint> textures;
+            for (const auto& file : files) textures.push_back(streamer.request(file));
+            double first_frame = 0.0;
+            size_t frames = 0;
+            do {
+                streamer.update();
+                glFinish();
+                if (frames++ == 0) first_frame = secondsSince(t0) * 1000.0;
+                else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            } while (!streamer.idle());
+            glFinish();
+            const double all = secondsSince(t0) * 1000.0;
+
+            // what the driver allocated, all levels
+            size_t gpu_bytes = 0;
+            GLint levels = 0;
+            glGetTextureParameteriv(textures[0], GL_TEXTURE_MAX_LEVEL, &levels);
+            for (GLint level = 0; level <= std::min(levels, 15); ++level) {
+                GLint w = 0, h = 0, is_compressed = 0, compressed_size = 0;
+                glGetTextureLevelParameteriv(textures[0], level, GL_TEXTURE_WIDTH, &w);
+                glGetTextureLevelParameteriv(textures[0], level, GL_TEXTURE_HEIGHT, &h);
+                if (w == 0) break;
+                glGetTextureLevelParameteriv(textures[0], level, GL_TEXTURE_COMPRESSED, &is_compressed);
+                if (is_compressed) {
+                    glGetTextureLevelParameteriv(textures[0], level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &compressed_size);
+                    gpu_bytes += size_t(compressed_size);
+                }
+                else gpu_bytes += size_t(w) * h * 4;
+            }
+
+            TextureStreamer::Stats s = streamer.stats();
+            std::cout << "  " << (compressed ? blockFormatName(format) : "png/RGB8") << " (" << s.compressed << " from dds) | "
+                << first_frame << " | " << all << " | " << s.upload_ms << " | " << (gpu_bytes >> 10) << "\n";
+            streamer.shutdown();
+            glDeleteTextures(GLsizei(textures.size()), textures.data());
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(tmp_dir, ec);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// --bench residency [count=24] [size=1024] [budget_mb=24]
+// A working set of count/4 textures slides over count PNGs, one texture
+// further every 20 frames, twice around: TextureStreamer without a budget
+// vs. with budget_mb. Reports peak and final estimated GPU bytes, what the
+// driver reports for the levels actually specified, evictions, dropped
+// mips, reloads and frames spent with loads outstanding.
+int benchTextureResidency(const std::vector<std::string>& args) {
+    const int count = args.size() > 0 ? std::stoi(args[0]) : 24;
+    const int size = args.size() > 1 ? std::stoi(args[1]) : 1024;
+    const size_t budget = size_t(args.size() > 2 ? std::stoi(args[2]) : 24) << 20;
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+
+    const std::filesystem::path tmp_dir = std::filesystem::temp_directory_path() / "my_app_residency_bench";
+    std::vector<std::filesystem::path> files = writeBenchTextures(tmp_dir, count, size);
+    const int window_size = std::max(1, count / 4), frames_per_step = 20;
+    std::cout << "[Bench] Texture residency, " << glGetString(GL_RENDERER) << ", " << count << " x " << size << "x" << size
+        << " RGB PNG, working set of " << window_size << "\n";
+
+    // bytes of the levels the driver has specified (RGB8 counted as RGBA8)
+    auto driverBytes = [](const std::vector<GLuint>& textures) {
+        size_t total = 0;
+        for (GLuint texture : textures) {
+            for (GLint level = 0; level < 16; ++level) {
+                GLint w = 0, h = 0, format = 0;
+                glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_WIDTH, &w);
+                glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_HEIGHT, &h);
+                glGetTextureLevelParameteriv(texture, level, GL_TEXTURE_INTERNAL_FORMAT, &format);
+                total += size_t(w) * h * (format == GL_R8 ? 1 : 4);
+            }
+        }
+        return total;
+    };
+
+    std::cout << "\n  budget | peak MB (estimate) | final MB (estimate / driver) | evicted | mips dropped | reloads | loading frames | longest frame ms\n";
+    for (size_t limit : { size_t(0), budget }) {
+        TextureStreamer streamer;
+        streamer.setBudget(limit);
+        streamer.init();
+        std::vector<GLuint> textures;
+        for (const auto& file : files) textures.push_back(streamer.request(file));
+
+        size_t peak = 0, loading_frames = 0;
+        double longest = 0.0;
+        for (int frame = 0; frame < 2 * count * frames_per_step; ++frame) {
+            auto start = Clock::now();
+            const int first = frame / frames_per_step;
+            for (int i = 0; i < window_size; ++i) streamer.touch(textures[(first + i) % count]);
+            streamer.update();
+            glFinish(); // stands in for the frame's rendering and swap
+            longest = std::max(longest, secondsSince(start) * 1000.0);
+            if (!streamer.idle()) ++loading_frames;
+            peak = std::max(peak, streamer.stats().resident_bytes);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        streamer.finish();
+
+        TextureStreamer::Stats s = streamer.stats();
+        std::cout << "  " << (limit ? std::to_string(limit >> 20) + " MB" : std::string("none")) << " | " << (peak >> 20)
+            << " | " << (s.resident_bytes >> 20) << " / " << (driverBytes(textures) >> 20) << " | " << s.evictions << " | "
+            << s.trimmed_levels << " | " << s.reloads << " | " << loading_frames << " | " << longest << "\n";
+        streamer.shutdown();
+        glDeleteTextures(GLsizei(textures.size()), textures.data());
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(tmp_dir, ec);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// Rolling hills plus per-pixel noise, 8-bit like heights.png
+std::vector<unsigned char> generateHeights(int size, unsigned seed) {
+    std::vector<float> wave_x(size), wave_z(size);
+    for (int i = 0; i < size; ++i) {
+        wave_x[i] = std::sin(i * 0.013f) + 0.5f * std::sin(i * 0.071f + 1.0f);
+        wave_z[i] = std::cos(i * 0.011f) + 0.5f * std::sin(i * 0.053f + 2.0f);
+    }
+    std::vector<unsigned char> heights(size_t(size) * size);
+    std::mt19937 rng(seed);
+    for (int z = 0; z < size; ++z) {
+        unsigned char* row = heights.data() + size_t(z) * size;
+        for (int x = 0; x < size; ++x) {
+            float h = 128.0f + 40.0f * (wave_x[x] + wave_z[z]) + 20.0f * wave_x[x] * wave_z[z] + float(rng() & 7);
+            row[x] = (unsigned char)std::clamp(h, 0.0f, 255.0f);
+        }
+    }
+    return heights;
+}
+
+// --bench terrain [shader_dir=resources/shaders/] [max_size=8192]
+// Terrain over procedural heightmaps from 1k to max_size. The static grid
+// ("terrain_mode": "mesh", step 7) is only meshed; the chunked modes (CPU
+// meshes and GPU displacement) fly a camera across the map a unit per
+// frame and report triangles drawn, CPU time of the per-frame update
+// (selection and chunk builds), the draw until finished and GPU memory.
+// Their setup reads the chunk bounds from the raycaster's min/max pyramid,
+// which the app builds in every mode, as the app does.
+int benchTerrain(const std::vector<std::string>& args) {
+    std::filesystem::path shader_dir = args.empty() ? "resources/shaders/" : args[0];
+    const int max_size = args.size() > 1 ? std::stoi(args[1]) : 8192;
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "[Bench] Terrain, " << glGetString(GL_RENDERER) << "\n";
+
+    {
+        const int width = 640, height = 360;
+        ShaderVariants variants(shader_dir / "tex.vert", shader_dir / "tex.frag");
+        ShaderProgram& mesh_program = variants.get(SHADER_SUN | SHADER_FOG | SHADER_TERRAIN_TEXTURE);
+        ShaderProgram& gpu_program = variants.get(SHADER_SUN | SHADER_FOG | SHADER_TERRAIN_TEXTURE | SHADER_TERRAIN);
+
+        GLuint fbo, color, depth;
+        glCreateFramebuffers(1, &fbo);
+        glCreateRenderbuffers(1, &color);
+        glCreateRenderbuffers(1, &depth);
+        glNamedRenderbufferStorage(color, GL_RGBA8, width, height);
+        glNamedRenderbufferStorage(depth, GL_DEPTH_COMPONENT24, width, height);
+        glNamedFramebufferRenderbuffer(fbo, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glNamedFramebufferRenderbuffer(fbo, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+        glEnable(GL_DEPTH_TEST);
+
+        GLuint white;
+        const unsigned char texel[4] = { 255, 255, 255, 255 };
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &white);
+        glTextureStorage3D(white, 1, GL_RGBA8, 1, 1, 1);
+        glTextureSubImage3D(white, 0, 0, 0, 0, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+        Model::bindTexture(white);
+
+        const glm::mat4 projection = glm::perspective(glm::radians(60.0f), float(width) / height, 0.1f, 1000.0f);
+        mesh_program.uniform<glm::mat4>("uP_m").set(projection);
+        gpu_program.uniform<glm::mat4>("uP_m").set(projection);
+
+        std::cout << "  size | mode | triangles avg/max | meshing ms (bounds + upload + first frame) | "
+            "update ms avg/max (select + build) | builds/frame | draw ms | GPU MB\n";
+        for (int size = 1024; size <= max_size; size *= 2) {
+            std::vector<unsigned char> heights = generateHeights(size, 1);
+            TerrainRaycaster raycaster;
+            auto pyramid_start = Clock::now();
+            raycaster.build(heights.data(), size, size, size_t(size));
+            std::cout << "  " << size << "x" << size << " | min/max pyramid (all modes) | " << secondsSince(pyramid_start) * 1000.0
+                << " ms\n";
+
+            // the static grid at the app's default step, CPU side only
+            {
+                std::vector<vertex> vertices;
+                std::vector<GLuint> indices;
+                TerrainMeshParams params;
+                params.step = 7;
+                params.height_scale = -0.25f;
+                auto start = Clock::now();
+                TerrainMeshStats stats = buildTerrainMesh(heights.data(), size, size, size, params, vertices, indices);
+                double ms = secondsSince(start) * 1000.0;
+                size_t bytes = vertices.size() * sizeof(packed_vertex) + indices.size() * sizeof(GLuint);
+                std::cout << "  " << size << "x" << size << " | mesh step 7 | " << stats.triangles << " (all) | " << ms
+                    << " | - | - | - | " << double(bytes) / (1 << 20) << "\n";
+            }
+
+            for (bool gpu : { false, true }) {
+                ShaderProgram& program = gpu ? gpu_program : mesh_program;
+                ChunkedTerrainParams params;
+                params.height_scale = -0.25f;
+                params.gpu_displacement = gpu;
+                ChunkedTerrain terrain;
+                auto start = Clock::now();
+                terrain.setHeights(heights.data(), size, size, size, params, &raycaster.pyramid());
+                terrain.init(program);
+                double setup_ms = secondsSince(start) * 1000.0;
+                const double bounds_ms = terrain.stats().bounds_ms, upload_ms = terrain.stats().upload_ms;
+                const glm::vec3 origin(-size * 0.25f, -10.0f, -size * 0.25f), scale(0.5f, 1.0f, 0.5f);
+                terrain.setTransform(origin, scale);
+                terrain.setProjection(projection);
+
+                // diagonal flight two units above the ground, looking ahead and down
+                auto eyeAt = [&](int frame) {
+                    glm::vec2 p = glm::vec2(-size * 0.2f) + glm::vec2(float(frame)) * 0.7071f;
+                    int px = std::clamp(int((p.x - origin.x) / scale.x), 0, size - 1);
+                    int pz = std::clamp(int((p.y - origin.z) / scale.z), 0, size - 1);
+                    return glm::vec3(p.x, origin.y + heights[size_t(pz) * size + px] * params.height_scale + 2.0f, p.y);
+                };
+                const glm::vec3 forward = glm::normalize(glm::vec3(1.0f, -0.3f, 1.0f));
+
+                const int frames = 200;
+                double first_ms = 0.0, total_ms = 0.0, max_ms = 0.0, select_ms = 0.0, build_ms = 0.0, total_draw_ms = 0.0;
+                size_t total_tris = 0, max_tris = 0, builds = 0;
+                for (int f = 0; f <= frames; ++f) {
+                    glm::vec3 eye = eyeAt(f);
+                    glm::mat4 view = glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+                    program.uniform<glm::mat4>("uV_m").set(view);
+                    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                    auto frame_start = Clock::now();
+                    terrain.update(eye, view);
+                    double ms = secondsSince(frame_start) * 1000.0;
+                    auto draw_start = Clock::now();
+                    terrain.draw(0);
+                    glFinish();
+                    double draw_ms = secondsSince(draw_start) * 1000.0;
+
+                    const ChunkedTerrainStats& s = terrain.stats();
+                    if (f == 0) { first_ms = ms; continue; }
+                    total_ms += ms;
+                    total_draw_ms += draw_ms;
+                    max_ms = std::max(max_ms, ms);
+                    select_ms += s.select_ms;
+                    build_ms += s.build_ms;
+                    total_tris += s.triangles;
+                    max_tris = std::max(max_tris, s.triangles);
+                    builds += s.built;
+                }
+                // meshing: bounds (and the height upload) plus the first frame's chunks
+                std::cout << "  " << size << "x" << size << " | " << (gpu ? "gpu" : "chunked") << " | "
+                    << total_tris / frames << " / " << max_tris << " | " << setup_ms + first_ms << " (" << bounds_ms << " + "
+                    << upload_ms << " + " << first_ms << ") | "
+                    << total_ms / frames << " / " << max_ms << " (" << select_ms / frames << " + " << build_ms / frames
+                    << ") | " << double(builds) / frames << " | " << total_draw_ms / frames << " | "
+                    << double(terrain.stats().gpu_bytes) / (1 << 20) << "\n";
+                terrain.clear();
+            }
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &color);
+        glDeleteRenderbuffers(1, &depth);
+        glDeleteTextures(1, &white);
+        variants.clear();
+    }
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// --bench pagedterrain [shader_dir=resources/shaders/] [world=16384] [tile_cells=128] [radius=4]
+// Streams a procedural world x world terrain from a .tiles file (written
+// row by row, never held in memory) while a camera flies diagonally across
+// it at 60 frames/s (paced, nothing drawn), slowly and fast. Reports the
+// render thread's update time, frames whose tile under the camera was not
+// resident yet, the peak resident heights / GPU meshes against the size of
+// the whole heightmap, and the tiles paged in and out.
+int benchPagedTerrain(const std::vector<std::string>& args) {
+    std::filesystem::path shader_dir = args.empty() ? "resources/shaders/" : args[0];
+    const int world = args.size() > 1 ? std::stoi(args[1]) : 16384;
+    const int tile_cells = args.size() > 2 ? std::stoi(args[2]) : 128;
+    const int radius = args.size() > 3 ? std::stoi(args[3]) : 4;
+    GLFWwindow* window = createBenchContext();
+    if (!window) {
+        std::cerr << "[Bench] No OpenGL 4.5+ context\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "[Bench] Paged terrain, " << glGetString(GL_RENDERER) << "\n";
+
+    const std::filesystem::path file = std::filesystem::temp_directory_path() / "bench_paged.tiles";
+    {
+        // generateHeights' waves, one row at a time
+        std::vector<float> wave_x(world);
+        for (int i = 0; i < world; ++i) wave_x[i] = std::sin(i * 0.013f) + 0.5f * std::sin(i * 0.071f + 1.0f);
+        auto row = [&](int z, unsigned char* out) {
+            const float wave_z = std::cos(z * 0.011f) + 0.5f * std::sin(z * 0.053f + 2.0f);
+            std::mt19937 rng{ unsigned(z) };
+            for (int x = 0; x < world; ++x) {
+                float h = 128.0f + 40.0f * (wave_x[x] + wave_z) + 20.0f * wave_x[x] * wave_z + float(rng() & 7);
+                out[x] = (unsigned char)std::clamp(h, 0.0f, 255.0f);
+            }
+        };
+        auto start = Clock::now();
+        if (!writeHeightTiles(file, world, world, tile_cells, row)) return EXIT_FAILURE;
+        std::cout << "  " << world << "x" << world << " world -> " << (std::filesystem::file_size(file) >> 20)
+            << " MB of " << tile_cells << "-cell tiles in " << secondsSince(start) << " s (heightmap in memory would be "
+            << ((size_t(world) * world) >> 20) << " MB)\n";
+    }
+
+    {
+        ShaderVariants variants(shader_dir / "tex.vert", shader_dir / "tex.frag");
+        ShaderProgram& program = variants.get(SHADER_SUN | SHADER_FOG | SHADER_TERRAIN_TEXTURE);
+        const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+
+        std::cout << "  speed units/frame | update ms avg/max | misses | pending max | resident tiles max | "
+            "heights MB max | GPU MB max | paged in / out\n";
+        for (float speed : { 0.5f, 4.0f }) {
+            PagedTerrainParams params;
+            params.radius = radius;
+            params.height_scale = -0.25f;
+            PagedTerrain terrain;
+            if (!terrain.open(file, params)) return EXIT_FAILURE;
+            terrain.init(program);
+            const glm::vec3 origin(-world * 0.25f, -10.0f, -world * 0.25f), scale(0.5f, 1.0f, 0.5f);
+            terrain.setTransform(origin, scale);
+            terrain.setProjection(projection);
+            const glm::vec3 forward = glm::normalize(glm::vec3(1.0f, -0.3f, 1.0f));
+
+            // start a quarter into the world with the first window resident,
+            // as the app would after a warm-up
+            glm::vec2 p = glm::vec2(origin.x, origin.z) + glm::vec2(world * 0.125f);
+            glm::vec3 eye(p.x, 0.0f, p.y);
+            terrain.update(eye, glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+            terrain.finish();
+
+            const int frames = 600;
+            const auto frame_time = std::chrono::microseconds(16667);
+            double total_ms = 0.0, max_ms = 0.0;
+            size_t misses = 0, max_pending = 0, max_resident = 0, max_cpu = 0, max_gpu = 0;
+            PagedTerrainStats s;
+            for (int f = 0; f < frames; ++f) {
+                auto frame_start = Clock::now();
+                p += glm::vec2(speed * 0.7071f);
+                float y = 0.0f;
+                if (!terrain.heightAt(p.x, p.y, y)) ++misses;
+                eye = glm::vec3(p.x, y + 2.0f, p.y);
+                terrain.update(eye, glm::lookAt(eye, eye + forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+                double ms = secondsSince(frame_start) * 1000.0;
+                total_ms += ms;
+                max_ms = std::max(max_ms, ms);
+
+                s = terrain.stats();
+                max_pending = std::max(max_pending, s.pending);
+                max_resident = std::max(max_resident, s.resident);
+                max_cpu = std::max(max_cpu, s.cpu_bytes);
+                max_gpu = std::max(max_gpu, s.gpu_bytes);
+                std::this_thread::sleep_until(frame_start + frame_time);
+            }
+            std::cout << "  " << speed << " | " << total_ms / frames << " / " << max_ms << " | " << misses << " | "
+                << max_pending << " | " << max_resident << " | " << double(max_cpu) / (1 << 20) << " | "
+                << double(max_gpu) / (1 << 20) << " | " << s.paged_in << " / " << s.paged_out << "\n";
+            terrain.clear();
+        }
+        variants.clear();
+    }
+    std::filesystem::remove(file);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
+
+// --bench noise [size=16384] [seed=1337]
+// Procedural heightmap generation: the full field per thread count, and the
+// scalar kernel against SSE2 on a strip (must match bit for bit)
+int benchNoise(const std::vector<std::string>& args) {
+    const int size = args.size() > 0 ? std::stoi(args[0]) : 16384;
+    NoiseTerrainParams params;
+    if (args.size() > 1) params.seed = uint32_t(std::stoul(args[1]));
+    std::cout << "[Bench] Procedural heightmap, " << size << "x" << size << ", " << params.octaves << " + "
+        << params.warp_octaves << " warp octaves\n";
+
+    std::vector<unsigned char> heights(size_t(size) * size);
+    std::cout << "  kernel | threads | ms | Msamples/s | per thread | clipped %\n";
+    for (unsigned threads : threadCounts()) {
+        NoiseTerrainStats stats = generateNoiseHeights(params, 0, 0, size, size, heights.data(), size_t(size), threads);
+        double msps = double(heights.size()) / (stats.ms * 1000.0);
+        std::cout << "  " << (stats.simd ? "sse2" : "scalar") << " | " << stats.threads << " | " << stats.ms << " | "
+            << msps << " | " << msps / stats.threads << " | " << 100.0 * stats.clipped / heights.size() << "\n";
+    }
+
+    // single-threaded strip through the middle, both kernels
+    const int strip = std::min(size, 256);
+    std::vector<unsigned char> simd(size_t(size) * strip), scalar(simd.size());
+    NoiseTerrainStats fast = generateNoiseHeights(params, 0, size / 2, size, strip, simd.data(), size_t(size), 1);
+    params.simd = false;
+    NoiseTerrainStats slow = generateNoiseHeights(params, 0, size / 2, size, strip, scalar.data(), size_t(size), 1);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < simd.size(); ++i) mismatches += simd[i] != scalar[i];
+    std::cout << "  strip " << size << "x" << strip << ", 1 thread: sse2 " << double(simd.size()) / (fast.ms * 1000.0)
+        << " Msamples/s, scalar " << double(simd.size()) / (slow.ms * 1000.0) << " Msamples/s ("
+        << slow.ms / fast.ms << "x), " << mismatches << " mismatches\n";
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// --bench raycast [size=4096] [rays=4096]
+// Terrain ray queries on a procedural heightmap placed as the app places
+// it: the min/max pyramid against DDA through every cell, for camera picks,
+// line-of-sight segments, grazing rays and views from
+// high up; then batches per thread count
+int benchRaycast(const std::vector<std::string>& args) {
+    const int size = args.size() > 0 ? std::stoi(args[0]) : 4096;
+    const size_t ray_count = args.size() > 1 ? std::stoul(args[1]) : 4096;
+    std::cout << "[Bench] Terrain raycast, " << size << "x" << size << ", " << ray_count << " rays per set\n";
+
+    std::vector<unsigned char> heights(size_t(size) * size);
+    NoiseTerrainParams noise;
+    noise.frequency = 1.0f / 512.0f;
+    generateNoiseHeights(noise, 0, 0, size, size, heights.data(), size_t(size));
+
+    TerrainRaycaster raycaster;
+    raycaster.build(heights.data(), size, size, size_t(size));
+    const glm::vec3 origin(-(size / 2.0f) * 0.5f, -10.0f, -(size / 2.0f) * 0.5f);
+    raycaster.setTransform(origin, glm::vec3(0.5f, 1.0f, 0.5f), -0.25f);
+
+    std::mt19937 rng{ 7u };
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float extent = (size - 1) * 0.5f;
+    auto ground = [&](float above) {
+        glm::vec3 p(origin.x + unit(rng) * extent, 0.0f, origin.z + unit(rng) * extent);
+        raycaster.heightAt(p.x, p.z, p.y);
+        p.y += above;
+        return p;
+    };
+    auto direction = [&](float pitch_lo, float pitch_hi) {
+        const float yaw = unit(rng) * 6.2831853f, pitch = glm::radians(pitch_lo + (pitch_hi - pitch_lo) * unit(rng));
+        return glm::vec3(std::cos(yaw) * std::cos(pitch), std::sin(pitch), std::sin(yaw) * std::cos(pitch));
+    };
+
+    struct Set { const char* name; std::vector<TerrainRay> rays; };
+    std::vector<Set> sets{ { "pick", {} }, { "sight", {} }, { "grazing", {} }, { "overview", {} } };
+    for (size_t i = 0; i < ray_count; ++i) {
+        // the camera a few units up, looking down into the terrain
+        sets[0].rays.push_back({ ground(2.0f + 18.0f * unit(rng)), direction(-60.0f, -5.0f), 1000.0f });
+        // line of sight between two points 1-3 units above the ground, up to 200 apart
+        glm::vec3 a = ground(1.0f + 2.0f * unit(rng)), b = a + direction(0.0f, 0.0f) * (200.0f * unit(rng));
+        float by;
+        raycaster.heightAt(b.x, b.z, by);
+        b.y = by + 1.0f + 2.0f * unit(rng);
+        sets[1].rays.push_back({ a, b - a, 1.0f });
+        // nearly level from a unit above the ground, across the map
+        sets[2].rays.push_back({ ground(1.0f), direction(-1.0f, 1.0f), 2.0f * extent });
+        // high above the terrain, looking towards the horizon
+        sets[3].rays.push_back({ ground(80.0f), direction(-20.0f, -2.0f), 2.0f * extent });
+    }
+
+    std::cout << "  set | hits | pyramid us/ray (nodes + cells) | DDA us/ray (cells) | speedup | mismatches\n";
+    std::vector<TerrainHit> hits(ray_count), reference(ray_count);
+    for (const Set& set : sets) {
+        TerrainRaycastStats fast_stats, dda_stats;
+        auto start = Clock::now();
+        for (size_t i = 0; i < ray_count; ++i)
+            raycaster.raycast(set.rays[i].origin, set.rays[i].direction, set.rays[i].max_t, hits[i], &fast_stats);
+        const double fast_us = secondsSince(start) * 1e6 / ray_count;
+        start = Clock::now();
+        for (size_t i = 0; i < ray_count; ++i)
+            raycaster.raycastDDA(set.rays[i].origin, set.rays[i].direction, set.rays[i].max_t, reference[i], &dda_stats);
+        const double dda_us = secondsSince(start) * 1e6 / ray_count;
+
+        size_t hit_count = 0, mismatches = 0;
+        for (size_t i = 0; i < ray_count; ++i) {
+            hit_count += hits[i].hit;
+            const float length = glm::length(set.rays[i].direction);
+            if (hits[i].hit != reference[i].hit || (hits[i].hit && std::abs(hits[i].t - reference[i].t) * length > 1e-3f))
+                ++mismatches;
+        }
+        std::cout << "  " << set.name << " | " << hit_count << " | " << fast_us << " (" << double(fast_stats.nodes) / ray_count
+            << " + " << double(fast_stats.cells) / ray_count << ") | " << dda_us << " (" << double(dda_stats.cells) / ray_count
+            << ") | " << dda_us / fast_us << "x | " << mismatches << "\n";
+    }
+
+    // all the sets as one batch
+    std::vector<TerrainRay> batch;
+    for (const Set& set : sets) batch.insert(batch.end(), set.rays.begin(), set.rays.end());
+    hits.resize(batch.size());
+    std::cout << "  batch of " << batch.size() << " | threads | ms | Mrays/s\n";
+    for (unsigned threads : threadCounts()) {
+        auto start = Clock::now();
+        raycaster.raycastBatch(batch.data(), batch.size(), hits.data(), threads);
+        const double ms = secondsSince(start) * 1000.0;
+        std::cout << "  | " << threads << " | " << ms << " | " << batch.size() / (ms * 1000.0) << "\n";
+    }
+    return EXIT_SUCCESS;
+}
+
+} // namespace
+
+int runBenchmark(int argc, char* argv[]) {
+    const std::map<std::string, std::function<int(const std::vector<std::string>&)>> benchmarks = {
+        { "obj", benchObjParse },
+        { "meshcache", benchMeshCache },
+        { "meshopt", benchMeshOptimizer },
+        { "lod", benchLodChain },
+        { "vertexformat", benchVertexFormat },
+        { "maze", benchMazeInstancing },
+        { "mazemesh", benchMazeMesher },
+        { "uniforms", benchUniforms },
+        { "clusters", benchClusteredLighting },
+        { "shadercache", benchShaderCache },
+        { "shaderbatch", benchShaderBatch },
+        { "variants", benchShaderVariants },
+        { "textures", benchTextures },
+        { "texcompress", benchTextureCompression },
+        { "residency", benchTextureResidency },
+        { "terrain", benchTerrain },
+        { "pagedterrain", benchPagedTerrain },
+        { "noise", benchNoise },
+        { "raycast", benchRaycast },
+    };
+
+    std::string name = argc > 2 ? argv[2] : "";
+    std::vector<std::string> args(argv + std::min(argc, 3), argv + argc);
+
+    auto it = benchmarks.find(name);
+    if (it == benchmarks.end()) {
+        std::cerr << "Usage: " << argv[0] << " --bench <name> [args...]\nAvailable benchmarks:\n";
+        for (const auto& [key, fn] : benchmarks) std::cerr << "  " << key << "\n";
+        return EXIT_FAILURE;
+    }
+    return it->second(args);
+}
@@ -0,0 +1,7 @@
+// bench.hpp
+// Command-line benchmarks: my_app.exe --bench <name> [args...]
+
+#pragma once
+
+// Returns process exit code; prints the list of benchmarks for an unknown name
+int runBenchmark(int argc, char* argv[]);
@@ -0,0 +1,605 @@
+#include "block_compression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+// ---------- shared endpoint fitting ----------
+
+// Mean and dominant direction (power iteration on the covariance) of count
+// N-dimensional points; axis is zero for a flat block
+template <int N>
+void principalAxis(const float (*points)[N], int count, float mean[N], float axis[N]) {
+    for (int c = 0; c < N; ++c) {
+        mean[c] = 0.0f;
+        for (int i = 0; i < count; ++i) mean[c] += points[i][c];
+        mean[c] /= count;
+    }
+    float cov[N][N] = {};
+    for (int i = 0; i < count; ++i)
+        for (int a = 0; a < N; ++a)
+            for (int b = 0; b < N; ++b)
+                cov[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+
+    for (int c = 0; c < N; ++c) axis[c] = 1.0f;
+    for (int iter = 0; iter < 8; ++iter) {
+        float next[N] = {};
+        for (int a = 0; a < N; ++a)
+            for (int b = 0; b < N; ++b) next[a] += cov[a][b] * axis[b];
+        float length = 0.0f;
+        for (int c = 0; c < N; ++c) length += next[c] * next[c];
+        length = std::sqrt(length);
+        if (length < 1e-6f) {
+            for (int c = 0; c < N; ++c) axis[c] = 0.0f;
+            return;
+        }
+        for (int c = 0; c < N; ++c) axis[c] = next[c] / length;
+    }
+}
+
+// Extremes of the points projected on the axis
+template <int N>
+void axisEndpoints(const float (*points)[N], int count, const float mean[N], const float axis[N], float lo[N], float hi[N]) {
+    float tmin = 0.0f, tmax = 0.0f;
+    for (int i = 0; i < count; ++i) {
+        float t = 0.0f;
+        for (int c = 0; c < N; ++c) t += (points[i][c] - mean[c]) * axis[c];
+        tmin = std::min(tmin, t);
+        tmax = std::max(tmax, t);
+    }
+    for (int c = 0; c < N; ++c) {
+        lo[c] = std::clamp(mean[c] + tmin * axis[c], 0.0f, 255.0f);
+        hi[c] = std::clamp(mean[c] + tmax * axis[c], 0.0f, 255.0f);
+    }
+}
+
+// Least-squares endpoints for fixed interpolation weights (0 = lo, 1 = hi);
+// false if the weights do not determine both endpoints
+template <int N>
+bool refineEndpoints(const float (*points)[N], int count, const float* weights, float lo[N], float hi[N]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[N] = {}, bx[N] = {};
+    for (int i = 0; i < count; ++i) {
+        float b = weights[i], a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < N; ++c) {
+            ax[c] += a * points[i][c];
+            bx[c] += b * points[i][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f) return false;
+    for (int c = 0; c < N; ++c) {
+        lo[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+        hi[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+// ---------- BC1 ----------
+
+uint16_t to565(const float c[3]) {
+    int r = std::clamp(int(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+    int g = std::clamp(int(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+    int b = std::clamp(int(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+    return uint16_t((r << 11) | (g << 5) | b);
+}
+
+void from565(uint16_t v, int out[3]) {
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// Four-color palette as decoders build it (c0 > c1 order)
+void bc1Palette(uint16_t c0, uint16_t c1, int palette[4][3]) {
+    from565(c0, palette[0]);
+    from565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+}
+
+// Nearest palette entries; returns the squared error
+int bc1Indices(uint16_t c0, uint16_t c1, const float (*points)[3], uint8_t indices[16]) {
+    int palette[4][3];
+    bc1Palette(c0, c1, palette);
+    int total = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0, best_error = INT32_MAX;
+        for (int p = 0; p < 4; ++p) {
+            int error = 0;
+            for (int c = 0; c < 3; ++c) {
+                int d = int(points[i][c]) - palette[p][c];
+                error += d * d;
+            }
+            if (error < best_error) { best_error = error; best = p; }
+        }
+        indices[i] = uint8_t(best);
+        total += best_error;
+    }
+    return total;
+}
+
+// 4-color block; c0 > c1 is forced (c0 == c1 only for a solid block)
+void bc1Color(const float (*points)[3], uint8_t out[8]) {
+    float mean[3], axis[3], lo[3], hi[3];
+    principalAxis<3>(points, 16, mean, axis);
+    axisEndpoints<3>(points, 16, mean, axis, lo, hi);
+
+    uint16_t c0 = to565(hi), c1 = to565(lo);
+    uint8_t indices[16];
+    int error = bc1Indices(c0, c1, points, indices);
+
+    // one least-squares pass on the weights the first fit picked
+    static const float WEIGHT[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f }; // share of c1
+    float weights[16];
+    for (int i = 0; i < 16; ++i) weights[i] = 1.0f - WEIGHT[indices[i]]; // share of hi (c0)
+    if (refineEndpoints<3>(points, 16, weights, lo, hi)) {
+        uint16_t r0 = to565(hi), r1 = to565(lo);
+        uint8_t refined[16];
+        int refined_error = bc1Indices(r0, r1, points, refined);
+        if (refined_error < error) {
+            c0 = r0; c1 = r1;
+            std::memcpy(indices, refined, 16);
+        }
+    }
+
+    static const uint8_t SWAPPED[4] = { 1, 0, 3, 2 };
+    if (c0 < c1) {
+        std::swap(c0, c1);
+        for (uint8_t& i : indices) i = SWAPPED[i];
+    }
+    else if (c0 == c1) {
+        std::fill(indices, indices + 16, uint8_t(0));
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i) bits |= uint32_t(indices[i]) << (2 * i);
+    out[0] = uint8_t(c0); out[1] = uint8_t(c0 >> 8);
+    out[2] = uint8_t(c1); out[3] = uint8_t(c1 >> 8);
+    for (int b = 0; b < 4; ++b) out[4 + b] = uint8_t(bits >> (8 * b));
+}
+
+void decodeBC1Color(const uint8_t in[8], uint8_t rgba[64], bool always_four_colors) {
+    uint16_t c0 = uint16_t(in[0] | (in[1] << 8)), c1 = uint16_t(in[2] | (in[3] << 8));
+    int palette[4][3];
+    int alpha[4] = { 255, 255, 255, 255 };
+    bc1Palette(c0, c1, palette);
+    if (c0 <= c1 && !always_four_colors) {
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+        alpha[3] = 0;
+    }
+    uint32_t bits = uint32_t(in[4]) | (uint32_t(in[5]) << 8) | (uint32_t(in[6]) << 16) | (uint32_t(in[7]) << 24);
+    for (int i = 0; i < 16; ++i) {
+        int p = (bits >> (2 * i)) & 3;
+        for (int c = 0; c < 3; ++c) rgba[4 * i + c] = uint8_t(palette[p][c]);
+        rgba[4 * i + 3] = uint8_t(alpha[p]);
+    }
+}
+
+// ---------- BC3 alpha ----------
+
+void bc3AlphaPalette(int a0, int a1, int palette[8]) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    }
+    else {
+        for (int i = 1; i < 5; ++i) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+void bc3Alpha(const uint8_t rgba[64], uint8_t out[8]) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        a0 = std::max(a0, int(rgba[4 * i + 3]));
+        a1 = std::min(a1, int(rgba[4 * i + 3]));
+    }
+    uint64_t bits = 0;
+    if (a0 != a1) {
+        int palette[8];
+        bc3AlphaPalette(a0, a1, palette);
+        for (int i = 0; i < 16; ++i) {
+            int a = rgba[4 * i + 3], best = 0;
+            for (int p = 1; p < 8; ++p)
+                if (std::abs(palette[p] - a) < std::abs(palette[best] - a)) best = p;
+            bits |= uint64_t(best) << (3 * i);
+        }
+    }
+    out[0] = uint8_t(a0);
+    out[1] = uint8_t(a1);
+    for (int b = 0; b < 6; ++b) out[2 + b] = uint8_t(bits >> (8 * b));
+}
+
+// ---------- BC7 mode 6 ----------
+
+const int BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct Bc7Endpoint {
+    int q[4]; // 7-bit
+    int p;    // shared low bit
+    int value(int c) const { return (q[c] << 1) | p; }
+};
+
+Bc7Endpoint quantizeBc7(const float v[4]) {
+    Bc7Endpoint best{};
+    float best_error = 1e30f;
+    for (int p = 0; p < 2; ++p) {
+        Bc7Endpoint e{};
+        e.p = p;
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            e.q[c] = std::clamp(int(std::floor((v[c] - p) / 2.0f + 0.5f)), 0, 127);
+            float d = float(e.value(c)) - v[c];
+            error += d * d;
+        }
+        if (error < best_error) { best_error = error; best = e; }
+    }
+    return best;
+}
+
+int bc7Interpolate(int e0, int e1, int index) {
+    return ((64 - BC7_WEIGHTS4[index]) * e0 + BC7_WEIGHTS4[index] * e1 + 32) >> 6;
+}
+
+int bc7Indices(const Bc7Endpoint& e0, const Bc7Endpoint& e1, const float (*points)[4], uint8_t indices[16]) {
+    int palette[16][4];
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 4; ++c) palette[i][c] = bc7Interpolate(e0.value(c), e1.value(c), i);
+    int total = 0;
+    for (int i = 0; i < 16; ++i) {
+        int best = 0, best_error = INT32_MAX;
+        for (int p = 0; p < 16; ++p) {
+            int error = 0;
+            for (int c = 0; c < 4; ++c) {
+                int d = int(points[i][c]) - palette[p][c];
+                error += d * d;
+            }
+            if (error < best_error) { best_error = error; best = p; }
+        }
+        indices[i] = uint8_t(best);
+        total += best_error;
+    }
+    return total;
+}
+
+struct BitWriter {
+    uint8_t* out;
+    int position = 0;
+    void put(uint32_t value, int bits) {
+        for (int b = 0; b < bits; ++b, ++position)
+            if (value & (1u << b)) out[position >> 3] |= uint8_t(1u << (position & 7));
+    }
+};
+
+struct BitReader {
+    const uint8_t* in;
+    int position = 0;
+    uint32_t get(int bits) {
+        uint32_t value = 0;
+        for (int b = 0; b < bits; ++b, ++position)
+            value |= uint32_t((in[position >> 3] >> (position & 7)) & 1) << b;
+        return value;
+    }
+};
+
+// ---------- DDS ----------
+
+#pragma pack(push, 1)
+struct DDSPixelFormat {
+    uint32_t size, flags, four_cc, rgb_bit_count, r_mask, g_mask, b_mask, a_mask;
+};
+struct DDSHeader {
+    uint32_t size, flags, height, width, pitch_or_linear_size, depth, mip_map_count;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixel_format;
+    uint32_t caps, caps2, caps3, caps4, reserved2;
+};
+struct DDSHeaderDX10 {
+    uint32_t dxgi_format, resource_dimension, misc_flag, array_size, misc_flags2;
+};
+#pragma pack(pop)
+static_assert(sizeof(DDSHeader) == 124, "DDS_HEADER is 124 bytes");
+static_assert(sizeof(DDSHeaderDX10) == 20, "DDS_HEADER_DXT10 is 20 bytes");
+
+constexpr uint32_t fourCC(char a, char b, char c, char d) {
+    return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+}
+
+constexpr uint32_t DDS_MAGIC = fourCC('D', 'D', 'S', ' ');
+constexpr uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PIXELFORMAT = 0x1000,
+    DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000;
+constexpr uint32_t DXGI_FORMAT_BC1_UNORM = 71, DXGI_FORMAT_BC3_UNORM = 77, DXGI_FORMAT_BC7_UNORM = 98;
+constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+uint32_t dxgiFormat(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: return DXGI_FORMAT_BC1_UNORM;
+    case BlockFormat::BC3: return DXGI_FORMAT_BC3_UNORM;
+    default: return DXGI_FORMAT_BC7_UNORM;
+    }
+}
+
+} // namespace
+
+const char* blockFormatName(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    default: return "BC7";
+    }
+}
+
+size_t blockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+size_t compressedLevelSize(BlockFormat format, int width, int height) {
+    return size_t((width + 3) / 4) * size_t((height + 3) / 4) * blockBytes(format);
+}
+
+size_t CompressedTexture::bytes() const {
+    size_t total = 0;
+    for (const auto& level : levels) total += level.size();
+    return total;
+}
+
+void encodeBC1Block(const uint8_t rgba[64], uint8_t out[8]) {
+    float points[16][3];
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c) points[i][c] = rgba[4 * i + c];
+    bc1Color(points, out);
+}
+
+void encodeBC3Block(const uint8_t rgba[64], uint8_t out[16]) {
+    bc3Alpha(rgba, out);
+    encodeBC1Block(rgba, out + 8);
+}
+
+void encodeBC7Block(const uint8_t rgba[64], uint8_t out[16]) {
+    float points[16][4];
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 4; ++c) points[i][c] = rgba[4 * i + c];
+
+    float mean[4], axis[4], lo[4], hi[4];
+    principalAxis<4>(points, 16, mean, axis);
+    axisEndpoints<4>(points, 16, mean, axis, lo, hi);
+    Bc7Endpoint e0 = quantizeBc7(lo), e1 = quantizeBc7(hi);
+    uint8_t indices[16];
+    int error = bc7Indices(e0, e1, points, indices);
+
+    float weights[16];
+    for (int i = 0; i < 16; ++i) weights[i] = BC7_WEIGHTS4[indices[i]] / 64.0f;
+    if (refineEndpoints<4>(points, 16, weights, lo, hi)) {
+        Bc7Endpoint r0 = quantizeBc7(lo), r1 = quantizeBc7(hi);
+        uint8_t refined[16];
+        int refined_error = bc7Indices(r0, r1, points, refined);
+        if (refined_error < error) {
+            e0 = r0; e1 = r1;
+            std::memcpy(indices, refined, 16);
+        }
+    }
+
+    // the anchor (first) index is stored without its top bit
+    if (indices[0] & 8) {
+        std::swap(e0, e1);
+        for (uint8_t& i : indices) i = uint8_t(15 - i);
+    }
+
+    std::memset(out, 0, 16);
+    BitWriter w{ out };
+    w.put(1u << 6, 7); // mode 6
+    for (int c = 0; c < 4; ++c) {
+        w.put(uint32_t(e0.q[c]), 7);
+        w.put(uint32_t(e1.q[c]), 7);
+    }
+    w.put(uint32_t(e0.p), 1);
+    w.put(uint32_t(e1.p), 1);
+    w.put(indices[0], 3);
+    for (int i = 1; i < 16; ++i) w.put(indices[i], 4);
+}
+
+void decodeBC1Block(const uint8_t in[8], uint8_t rgba[64]) {
+    decodeBC1Color(in, rgba, false);
+}
+
+void decodeBC3Block(const uint8_t in[16], uint8_t rgba[64]) {
+    decodeBC1Color(in + 8, rgba, true);
+    int palette[8];
+    bc3AlphaPalette(in[0], in[1], palette);
+    uint64_t bits = 0;
+    for (int b = 0; b < 6; ++b) bits |= uint64_t(in[2 + b]) << (8 * b);
+    for (int i = 0; i < 16; ++i) rgba[4 * i + 3] = uint8_t(palette[(bits >> (3 * i)) & 7]);
+}
+
+void decodeBC7Block(const uint8_t in[16], uint8_t rgba[64]) {
+    BitReader r{ in };
+    if (r.get(7) != (1u << 6)) {
+        std::memset(rgba, 0, 64); // not mode 6
+        return;
+    }
+    Bc7Endpoint e0{}, e1{};
+    for (int c = 0; c < 4; ++c) {
+        e0.q[c] = int(r.get(7));
+        e1.q[c] = int(r.get(7));
+    }
+    e0.p = int(r.get(1));
+    e1.p = int(r.get(1));
+    for (int i = 0; i < 16; ++i) {
+        int index = int(r.get(i == 0 ? 3 : 4));
+        for (int c = 0; c < 4; ++c) rgba[4 * i + c] = uint8_t(bc7Interpolate(e0.value(c), e1.value(c), index));
+    }
+}
+
+bool hasAlpha(const uint8_t* rgba, size_t pixel_count) {
+    for (size_t i = 0; i < pixel_count; ++i)
+        if (rgba[4 * i + 3] != 255) return true;
+    return false;
+}
+
+void compressImage(const uint8_t* rgba, int width, int height, BlockFormat format, CompressedTexture& out) {
+    out.format = format;
+    out.width = width;
+    out.height = height;
+    out.levels.clear();
+
+    void (*encode)(const uint8_t*, uint8_t*) = format == BlockFormat::BC1 ? encodeBC1Block
+        : format == BlockFormat::BC3 ? encodeBC3Block : encodeBC7Block;
+    const size_t block_bytes = blockBytes(format);
+
+    std::vector<uint8_t> level(rgba, rgba + size_t(width) * height * 4), next;
+    int w = width, h = height;
+    for (;;) {
+        std::vector<uint8_t> blocks(compressedLevelSize(format, w, h));
+        uint8_t* dst = blocks.data();
+        uint8_t block[64];
+        for (int by = 0; by < h; by += 4) {
+            for (int bx = 0; bx < w; bx += 4) {
+                // partial blocks repeat the edge texels
+                for (int y = 0; y < 4; ++y)
+                    for (int x = 0; x < 4; ++x)
+                        std::memcpy(block + 4 * (4 * y + x),
+                            &level[4 * (size_t(std::min(by + y, h - 1)) * w + std::min(bx + x, w - 1))], 4);
+                encode(block, dst);
+                dst += block_bytes;
+            }
+        }
+        out.levels.push_back(std::move(blocks));
+        if (w == 1 && h == 1) break;
+
+        int nw = std::max(1, w / 2), nh = std::max(1, h / 2);
+        next.assign(size_t(nw) * nh * 4, 0);
+        for (int y = 0; y < nh; ++y) {
+            for (int x = 0; x < nw; ++x) {
+                int x0 = std::min(2 * x, w - 1), x1 = std::min(2 * x + 1, w - 1);
+                int y0 = std::min(2 * y, h - 1), y1 = std::min(2 * y + 1, h - 1);
+                for (int c = 0; c < 4; ++c) {
+                    int sum = level[4 * (size_t(y0) * w + x0) + c] + level[4 * (size_t(y0) * w + x1) + c]
+                        + level[4 * (size_t(y1) * w + x0) + c] + level[4 * (size_t(y1) * w + x1) + c];
+                    next[4 * (size_t(y) * nw + x) + c] = uint8_t((sum + 2) / 4);
+                }
+            }
+        }
+        level.swap(next);
+        w = nw;
+        h = nh;
+    }
+}
+
+bool saveDDS(const std::filesystem::path& file, const CompressedTexture& texture) {
+    DDSHeader header{};
+    header.size = sizeof(DDSHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height = uint32_t(texture.height);
+    header.width = uint32_t(texture.width);
+    header.pitch_or_linear_size = uint32_t(texture.levels.empty() ? 0 : texture.levels[0].size());
+    header.mip_map_count = uint32_t(texture.levels.size());
+    header.pixel_format.size = sizeof(DDSPixelFormat);
+    header.pixel_format.flags = DDPF_FOURCC;
+    header.pixel_format.four_cc = fourCC('D', 'X', '1', '0');
+    header.caps = DDSCAPS_TEXTURE | (texture.levels.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+    DDSHeaderDX10 dx10{};
+    dx10.dxgi_format = dxgiFormat(texture.format);
+    dx10.resource_dimension = DDS_DIMENSION_TEXTURE2D;
+    dx10.array_size = 1;
+
+    // temporary file first so an interrupted conversion never leaves a truncated .dds
+    std::filesystem::path tmp = file;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "[DDS] Cannot write: " << tmp << "\n";
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+        for (const auto& level : texture.levels)
+            out.write(reinterpret_cast<const char*>(level.data()), level.size());
+        if (!out) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, file, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool loadDDS(const std::filesystem::path& file, CompressedTexture& texture, bool header_only) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) return false;
+
+    uint32_t magic = 0;
+    DDSHeader header{};
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || magic != DDS_MAGIC || header.size != sizeof(DDSHeader) || !(header.pixel_format.flags & DDPF_FOURCC)
+        || header.width == 0 || header.height == 0 || header.width > 16384 || header.height > 16384) {
+        std::cerr << "[DDS] Not a supported DDS file: " << file.string() << "\n";
+        return false;
+    }
+
+    switch (header.pixel_format.four_cc) {
+    case fourCC('D', 'X', 'T', '1'): texture.format = BlockFormat::BC1; break;
+    case fourCC('D', 'X', 'T', '5'): texture.format = BlockFormat::BC3; break;
+    case fourCC('D', 'X', '1', '0'): {
+        DDSHeaderDX10 dx10{};
+        in.read(reinterpret_cast<char*>(&dx10), sizeof(dx10));
+        if (!in || dx10.resource_dimension != DDS_DIMENSION_TEXTURE2D || dx10.array_size > 1) {
+            std::cerr << "[DDS] Only single 2D textures are supported: " << file.string() << "\n";
+            return false;
+        }
+        if (dx10.dxgi_format == DXGI_FORMAT_BC1_UNORM) texture.format = BlockFormat::BC1;
+        else if (dx10.dxgi_format == DXGI_FORMAT_BC3_UNORM) texture.format = BlockFormat::BC3;
+        else if (dx10.dxgi_format == DXGI_FORMAT_BC7_UNORM) texture.format = BlockFormat::BC7;
+        else {
+            std::cerr << "[DDS] Unsupported DXGI format " << dx10.dxgi_format << ": " << file.string() << "\n";
+            return false;
+        }
+        break;
+    }
+    default:
+        std::cerr << "[DDS] Unsupported pixel format: " << file.string() << "\n";
+        return false;
+    }
+
+    texture.width = int(header.width);
+    texture.height = int(header.height);
+    uint32_t level_count = (header.flags & DDSD_MIPMAPCOUNT) ? std::max(1u, header.mip_map_count) : 1u;
+    level_count = std::min(level_count, 15u);
+    texture.levels.assign(level_count, {});
+    if (header_only) return true;
+
+    int w = texture.width, h = texture.height;
+    for (auto& level : texture.levels) {
+        level.resize(compressedLevelSize(texture.format, w, h));
+        in.read(reinterpret_cast<char*>(level.data()), level.size());
+        if (!in) {
+            std::cerr << "[DDS] Truncated file: " << file.string() << "\n";
+            return false;
+        }
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    return true;
+}
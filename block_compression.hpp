@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// BC1/BC3/BC7 block compression and the .dds container, shared by the
+// offline converter (tools/texconv) and the texture loader. No GL here: the
+// converter builds without a context.
+//
+// Encoders work on 4x4 RGBA8 blocks (row-major, 64 bytes). Quality aims at
+// "good enough for an offline pass that runs once per asset": principal-axis
+// endpoints refined by one least-squares step; BC7 uses mode 6 only (one
+// subset, RGBA endpoints, 16 interpolation steps).
+
+enum class BlockFormat : uint32_t {
+    BC1, // RGB, 4 bpp (1-bit alpha unused: opaque textures)
+    BC3, // RGBA, 8 bpp (BC1 color + interpolated alpha)
+    BC7, // RGBA, 8 bpp, best quality
+};
+
+const char* blockFormatName(BlockFormat format);
+size_t blockBytes(BlockFormat format); // 8 or 16
+
+// Bytes of one mip level (whole 4x4 blocks, partial blocks padded)
+size_t compressedLevelSize(BlockFormat format, int width, int height);
+
+void encodeBC1Block(const uint8_t rgba[64], uint8_t out[8]);
+void encodeBC3Block(const uint8_t rgba[64], uint8_t out[16]);
+void encodeBC7Block(const uint8_t rgba[64], uint8_t out[16]);
+
+// Reference decoders (mode 6 only for BC7), used to measure encoder error
+void decodeBC1Block(const uint8_t in[8], uint8_t rgba[64]);
+void decodeBC3Block(const uint8_t in[16], uint8_t rgba[64]);
+void decodeBC7Block(const uint8_t in[16], uint8_t rgba[64]);
+
+struct CompressedTexture {
+    BlockFormat format{ BlockFormat::BC1 };
+    int width{ 0 }, height{ 0 };
+    std::vector<std::vector<uint8_t>> levels; // levels[0] is the full size, then each mip
+
+    size_t bytes() const;
+};
+
+// Full mip chain (2x2 box filter, down to 1x1) of an RGBA8 image, every
+// level block compressed. rgba is width*height*4 bytes, tightly packed.
+void compressImage(const uint8_t* rgba, int width, int height, BlockFormat format, CompressedTexture& out);
+
+// True if any texel has alpha below 255 (decides BC1 vs. an alpha format)
+bool hasAlpha(const uint8_t* rgba, size_t pixel_count);
+
+// .dds with a DX10 header (DXGI_FORMAT_BC1/BC3/BC7_UNORM). Loading also
+// accepts legacy DXT1/DXT5 FourCC files from other tools. header_only fills
+// format, size and one empty entry per level without reading the payload.
+bool saveDDS(const std::filesystem::path& file, const CompressedTexture& texture);
+bool loadDDS(const std::filesystem::path& file, CompressedTexture& texture, bool header_only = false);
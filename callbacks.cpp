@@ -48,9 +48,18 @@ void App::key_callback(GLFWwindow* window, int key, int scancode, int action, in
         case GLFW_KEY_SPACE:
             app->spawnParticles(app->camera.Position, 50); // Emit 50 particles from player
             break;
+        case GLFW_KEY_F:
+            app->pickTerrain();
+            break;
         case GLFW_KEY_F11:
             app->toggleFullscreen();
             break;
+        case GLFW_KEY_F4:
+            app->toggleClusterDebug();
+            break;
+        case GLFW_KEY_F5:
+            app->toggleClusteredLighting();
+            break;
 
 
 
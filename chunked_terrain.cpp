@@ -0,0 +1,418 @@
+#include "chunked_terrain.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "terrain_mesher.hpp"
+#include "vertex_packing.hpp"
+
+void ChunkedTerrain::setHeights(const unsigned char* heights, int width, int height, size_t row_stride,
+    const ChunkedTerrainParams& params, const HeightPyramid* pyramid)
+{
+    pyramid_ = nullptr;
+    own_pyramid_.clear();
+    chunks_.clear();
+    stats_ = ChunkedTerrainStats{};
+    heights_ = nullptr;
+    if (!heights || width < 2 || height < 2) return;
+
+    heights_ = heights;
+    width_ = width;
+    height_ = height;
+    row_stride_ = row_stride;
+    params_ = params;
+    params_.chunk_cells = std::clamp(params_.chunk_cells, 2, 128); // 16-bit indices
+    params_.texture_period = std::max(1, params_.texture_period);
+
+    // a chunk covers the nodes of one pyramid level: shared if it has that
+    // level, else built with chunk-sized leaves
+    auto start = std::chrono::steady_clock::now();
+    base_level_ = pyramid ? pyramid->levelFor(params_.chunk_cells) : -1;
+    if (base_level_ >= 0) pyramid_ = pyramid;
+    else {
+        own_pyramid_.build(heights, width, height, row_stride, params_.chunk_cells);
+        pyramid_ = &own_pyramid_;
+        base_level_ = 0;
+    }
+
+    // packed positions span the map; y leaves room for the deepest possible skirt
+    const HeightPyramid::Range& root = pyramid_->root();
+    float y0 = root.lo * params_.height_scale, y1 = root.hi * params_.height_scale;
+    float lo = std::min(y0, y1), hi = std::max(y0, y1);
+    float skirt = 256.0f * std::abs(params_.height_scale);
+    pack_min_ = glm::vec3(0.0f, lo - skirt, 0.0f);
+    pack_max_ = glm::vec3(float(width_ - 1), hi, float(height_ - 1));
+
+    lod_distance_ = std::max(params_.lod_distance, minLodDistance());
+    stats_.bounds_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[Terrain] " << width_ << "x" << height_ << " heightmap: " << levels() << " levels of "
+        << params_.chunk_cells << "x" << params_.chunk_cells << " chunks, " << nodes(0).ranges.size()
+        << " at full resolution | bounds " << (pyramid_ == pyramid ? "shared, " : "") << stats_.bounds_ms << " ms\n";
+}
+
+void ChunkedTerrain::setTransform(const glm::vec3& origin, const glm::vec3& scale) {
+    origin_ = origin;
+    scale_ = scale;
+    lod_distance_ = std::max(params_.lod_distance, minLodDistance());
+    if (heights_ && lod_distance_ > params_.lod_distance)
+        std::cout << "[Terrain] LOD distance raised to " << lod_distance_ << " (twice the chunk diagonal)\n";
+}
+
+// A drawn node and its neighbour's ancestor one level finer (which was split)
+// touch, so their distances differ by at most that ancestor's diagonal.
+// Ranges of at least twice the leaf diagonal then rule out neighbours two
+// levels apart.
+float ChunkedTerrain::minLodDistance() const {
+    return 2.0f * params_.chunk_cells * glm::length(glm::vec2(scale_.x, scale_.z));
+}
+
+void ChunkedTerrain::init(const ShaderProgram& shader) {
+    shader_ = shader;
+    u.model = shader_.uniform<glm::mat4>("uM_m");
+    u.pos_offset = shader_.uniform<glm::vec3>("uPosOffset");
+    u.pos_scale = shader_.uniform<glm::vec3>("uPosScale");
+    u.oct_normals = shader_.uniform<int>("uOctNormals");
+    u.instanced = shader_.uniform<int>("uInstanced");
+    u.texture_layer = shader_.uniform<int>("uTextureLayer");
+    u.texture_period = shader_.uniform<glm::vec2>("uTexturePeriod");
+    u.tile_size = shader_.uniform<glm::vec2>("uTileSize");
+
+    const int S = params_.chunk_cells, n = S + 1;
+    vertices_per_chunk_ = size_t(n) * n + 4 * size_t(n); // grid + one skirt row per edge
+
+    // shared by every chunk: the grid as in buildTerrainMesh, then the skirts
+    std::vector<GLushort> indices;
+    buildTerrainPatchIndices(S, indices);
+    indices_per_chunk_ = GLsizei(indices.size());
+
+    glCreateVertexArrays(1, &vao_);
+    glCreateBuffers(1, &ebo_);
+    glNamedBufferStorage(ebo_, indices.size() * sizeof(GLushort), indices.data(), 0);
+    glVertexArrayElementBuffer(vao_, ebo_);
+
+    if (params_.gpu_displacement) {
+        initDisplacement();
+        return;
+    }
+
+    // the packed layout of GpuGeometry
+    glEnableVertexArrayAttrib(vao_, 0);
+    glVertexArrayAttribFormat(vao_, 0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(packed_vertex, position));
+    glVertexArrayAttribBinding(vao_, 0, 0);
+    glEnableVertexArrayAttrib(vao_, 1);
+    glVertexArrayAttribFormat(vao_, 1, 2, GL_SHORT, GL_TRUE, offsetof(packed_vertex, normal));
+    glVertexArrayAttribBinding(vao_, 1, 0);
+    glEnableVertexArrayAttrib(vao_, 2);
+    glVertexArrayAttribFormat(vao_, 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(packed_vertex, texcoords));
+    glVertexArrayAttribBinding(vao_, 2, 0);
+
+    growPool(std::max<size_t>(params_.pool_chunks, 16));
+}
+
+void ChunkedTerrain::initDisplacement() {
+    u.patch_cells = shader_.uniform<int>("uPatchCells");
+    u.height_scale = shader_.uniform<float>("uHeightScale");
+
+    // one texel per pixel, sampled at texel centres
+    auto start = std::chrono::steady_clock::now();
+    glCreateTextures(GL_TEXTURE_2D, 1, &height_texture_);
+    glTextureStorage2D(height_texture_, 1, GL_R8, width_, height_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (row_stride_ != size_t(width_)) glPixelStorei(GL_UNPACK_ROW_LENGTH, GLint(row_stride_));
+    glTextureSubImage2D(height_texture_, 0, 0, 0, width_, height_, GL_RED, GL_UNSIGNED_BYTE, heights_);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    stats_.upload_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[Terrain] Height texture " << width_ << "x" << height_ << " (" << ((size_t(width_) * height_) >> 10)
+        << " KB) | upload " << stats_.upload_ms << " ms\n";
+    glTextureParameteri(height_texture_, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(height_texture_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(height_texture_, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(height_texture_, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // no vertex buffer: tex.vert builds the patch from gl_VertexID. Node
+    // corner and step -> location 4, step and skirt depth -> location 5
+    glEnableVertexArrayAttrib(vao_, 4);
+    glVertexArrayAttribFormat(vao_, 4, 4, GL_FLOAT, GL_FALSE, offsetof(mesh_instance, offset));
+    glVertexArrayAttribBinding(vao_, 4, INSTANCE_BINDING);
+    glEnableVertexArrayAttrib(vao_, 5);
+    glVertexArrayAttribFormat(vao_, 5, 3, GL_FLOAT, GL_FALSE, offsetof(mesh_instance, scale));
+    glVertexArrayAttribBinding(vao_, 5, INSTANCE_BINDING);
+    glVertexArrayBindingDivisor(vao_, INSTANCE_BINDING, 1);
+}
+
+void ChunkedTerrain::growPool(size_t slot_count) {
+    const size_t chunk_bytes = vertices_per_chunk_ * sizeof(packed_vertex);
+    GLuint buffer;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, slot_count * chunk_bytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+    if (vbo_) {
+        glCopyNamedBufferSubData(vbo_, buffer, 0, 0, slot_count_ * chunk_bytes);
+        glDeleteBuffers(1, &vbo_);
+        std::cout << "[Terrain] Chunk pool full, grown to " << slot_count << " chunks\n";
+    }
+    vbo_ = buffer;
+    glVertexArrayVertexBuffer(vao_, 0, vbo_, 0, sizeof(packed_vertex));
+
+    for (size_t slot = slot_count; slot-- > slot_count_;) free_slots_.push_back(slot);
+    slot_count_ = slot_count;
+}
+
+size_t ChunkedTerrain::acquireSlot() {
+    if (free_slots_.empty()) {
+        // reuse the least recently drawn chunk, unless the whole pool is in this frame
+        auto victim = chunks_.end();
+        for (auto it = chunks_.begin(); it != chunks_.end(); ++it)
+            if (it->second.last_used < frame_ && (victim == chunks_.end() || it->second.last_used < victim->second.last_used))
+                victim = it;
+        if (victim != chunks_.end()) {
+            size_t slot = victim->second.slot;
+            chunks_.erase(victim);
+            return slot;
+        }
+        growPool(slot_count_ * 2);
+    }
+    size_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    return slot;
+}
+
+void ChunkedTerrain::update(const glm::vec3& eye, const glm::mat4& view) {
+    if (!heights_ || !vao_) return;
+    auto start = std::chrono::steady_clock::now();
+    ++frame_;
+    stats_.culled = 0;
+    stats_.built = 0;
+
+    // frustum planes (unnormalized, inside >= 0) from the rows of projection * view
+    const glm::mat4 m = projection_ * view;
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i) rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    const glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+        rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+
+    selected_.clear();
+    const int top = levels() - 1;
+    for (int iz = 0; iz < nodes(top).nodes_z; ++iz)
+        for (int ix = 0; ix < nodes(top).nodes_x; ++ix)
+            select(top, ix, iz, planes, glm::vec2(eye.x, eye.z));
+    auto selected = std::chrono::steady_clock::now();
+    stats_.select_ms = std::chrono::duration<double, std::milli>(selected - start).count();
+
+    // keep what is already resident before any slot gets reused
+    std::vector<uint64_t> missing;
+    for (uint64_t k : selected_) {
+        auto it = chunks_.find(k);
+        if (it != chunks_.end()) it->second.last_used = frame_;
+        else missing.push_back(k);
+    }
+    for (uint64_t k : missing) {
+        const int level = int(k >> 56), iz = int((k >> 28) & 0xFFFFFFF), ix = int(k & 0xFFFFFFF);
+        if (params_.gpu_displacement) {
+            // nothing to mesh; the skirt depth is all the chunk needs from the CPU
+            const int size = params_.chunk_cells << level;
+            const int x0 = ix * size, z0 = iz * size;
+            chunks_[k] = Chunk{ 0, frame_, skirtDepth(level, x0, z0, pixelX(x0 + size), pixelZ(z0 + size)) };
+        }
+        else {
+            size_t slot = acquireSlot();
+            buildChunk(level, ix, iz, slot);
+            chunks_[k] = Chunk{ slot, frame_ };
+        }
+        ++stats_.built;
+    }
+    // no slots to reuse in GPU mode: past the pool size, forget the skirt
+    // depths of every chunk this frame does not draw
+    if (params_.gpu_displacement && chunks_.size() > params_.pool_chunks) {
+        for (auto it = chunks_.begin(); it != chunks_.end();)
+            it = it->second.last_used < frame_ ? chunks_.erase(it) : std::next(it);
+    }
+    stats_.build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - selected).count();
+
+    stats_.chunks = selected_.size();
+    stats_.triangles = selected_.size() * size_t(indices_per_chunk_) / 3;
+    stats_.resident = chunks_.size();
+
+    if (params_.gpu_displacement) {
+        instance_data_.resize(selected_.size());
+        for (size_t i = 0; i < selected_.size(); ++i) {
+            const uint64_t k = selected_[i];
+            const int level = int(k >> 56), iz = int((k >> 28) & 0xFFFFFFF), ix = int(k & 0xFFFFFFF);
+            const float size = float(params_.chunk_cells << level);
+            instance_data_[i] = mesh_instance{ glm::vec3(ix * size, 0.0f, iz * size), 0.0f,
+                glm::vec3(float(1 << level), chunks_[k].skirt, 0.0f), 0.0f };
+        }
+        instances_.upload(instance_data_);
+        glVertexArrayVertexBuffer(vao_, INSTANCE_BINDING, instances_.buffer, 0, sizeof(mesh_instance));
+        stats_.gpu_bytes = size_t(width_) * height_ + size_t(indices_per_chunk_) * sizeof(GLushort)
+            + instance_data_.size() * sizeof(mesh_instance);
+        return;
+    }
+
+    draw_counts_.assign(selected_.size(), indices_per_chunk_);
+    draw_offsets_.assign(selected_.size(), nullptr);
+    draw_base_vertices_.resize(selected_.size());
+    for (size_t i = 0; i < selected_.size(); ++i)
+        draw_base_vertices_[i] = GLint(chunks_[selected_[i]].slot * vertices_per_chunk_);
+    stats_.gpu_bytes = slot_count_ * vertices_per_chunk_ * sizeof(packed_vertex) + size_t(indices_per_chunk_) * sizeof(GLushort);
+}
+
+void ChunkedTerrain::select(int level, int ix, int iz, const glm::vec4 (&planes)[6], const glm::vec2& eye_xz) {
+    const HeightPyramid::Range& range = nodes(level).at(ix, iz);
+    const int size = params_.chunk_cells << level;
+    const int x0 = ix * size, z0 = iz * size;
+    const float y0 = range.lo * params_.height_scale, y1 = range.hi * params_.height_scale;
+
+    const glm::vec3 bmin = origin_ + scale_ * glm::vec3(float(x0), std::min(y0, y1), float(z0));
+    const glm::vec3 bmax = origin_ + scale_ * glm::vec3(float(std::min(x0 + size, width_ - 1)), std::max(y0, y1),
+        float(std::min(z0 + size, height_ - 1)));
+
+    for (const glm::vec4& p : planes) {
+        glm::vec3 corner(p.x > 0.0f ? bmax.x : bmin.x, p.y > 0.0f ? bmax.y : bmin.y, p.z > 0.0f ? bmax.z : bmin.z);
+        if (glm::dot(glm::vec3(p), corner) + p.w < 0.0f) {
+            ++stats_.culled;
+            return;
+        }
+    }
+
+    // horizontal distance only: the height range would widen the diagonal
+    // bound on level differences by the whole relief
+    if (level > 0) {
+        const glm::vec2 d = glm::max(glm::max(glm::vec2(bmin.x, bmin.z) - eye_xz, eye_xz - glm::vec2(bmax.x, bmax.z)), glm::vec2(0.0f));
+        if (glm::length(d) < lod_distance_ * float(1 << (level - 1))) {
+            const HeightPyramid::Level& children = nodes(level - 1);
+            for (int cz = iz * 2; cz < std::min(iz * 2 + 2, children.nodes_z); ++cz)
+                for (int cx = ix * 2; cx < std::min(ix * 2 + 2, children.nodes_x); ++cx)
+                    select(level - 1, cx, cz, planes, eye_xz);
+            return;
+        }
+    }
+    selected_.push_back(key(level, ix, iz));
+}
+
+float ChunkedTerrain::skirtDepth(int level, int x0, int z0, int x1, int z1) const {
+    const int step = 1 << level;
+    const int steps[3] = { std::max(step / 2, 1), step, step * 2 };
+
+    // Height at t along a line of pixels as drawn with samples every s pixels
+    // (at multiples of s, the last one clamped to the line end)
+    auto drawn = [](const unsigned char* line, size_t stride, int length, int t, int s) {
+        const int a = t / s * s, b = std::min(a + s, length - 1);
+        if (b <= a) return float(line[size_t(a) * stride]);
+        const float f = float(t - a) / float(b - a);
+        return float(line[size_t(a) * stride]) * (1.0f - f) + float(line[size_t(b) * stride]) * f;
+    };
+    float error = 0.0f;
+    auto edge = [&](const unsigned char* line, size_t stride, int length, int from, int to) {
+        for (int t = from; t <= to; ++t) {
+            float h[3];
+            for (int i = 0; i < 3; ++i) h[i] = drawn(line, stride, length, t, steps[i]);
+            error = std::max(error, std::max(std::abs(h[1] - h[0]), std::abs(h[1] - h[2])));
+        }
+    };
+    edge(heights_ + size_t(z0) * row_stride_, 1, width_, x0, x1);
+    edge(heights_ + size_t(z1) * row_stride_, 1, width_, x0, x1);
+    edge(heights_ + x0, row_stride_, height_, z0, z1);
+    edge(heights_ + x1, row_stride_, height_, z0, z1);
+
+    // one height unit extra hides pinholes along T-junctions on flat ground
+    return (error + 1.0f) * std::abs(params_.height_scale);
+}
+
+void ChunkedTerrain::buildChunk(int level, int ix, int iz, size_t slot) {
+    const int S = params_.chunk_cells, n = S + 1, a = S + 3; // a: grid plus a one-sample apron
+    const int step = 1 << level;
+    const int x0 = ix * S * step, z0 = iz * S * step;
+
+    // heights with the apron, so normals on shared edges match the neighbours
+    apron_.resize(size_t(a) * a);
+    for (int r = 0; r < a; ++r)
+        for (int c = 0; c < a; ++c)
+            apron_[size_t(r) * a + c] = pixel(x0 + (c - 1) * step, z0 + (r - 1) * step) * params_.height_scale;
+    computeTerrainNormals(apron_.data(), a, a, float(step), normals_);
+
+    // texcoords: the material of the cell a vertex is the (c, r) corner of
+    // (its provoking vertex), by the cell's highest sample
+    auto material = [&](int x, int z) {
+        if (!params_.material) return glm::vec2(0.0f);
+        const unsigned char top = std::max(std::max(pixel(x, z), pixel(x + step, z)),
+            std::max(pixel(x, z + step), pixel(x + step, z + step)));
+        return params_.material(top * params_.height_scale);
+    };
+
+    vertices_.resize(vertices_per_chunk_);
+    for (int r = 0; r < n; ++r) {
+        const int pz = pixelZ(z0 + r * step);
+        for (int c = 0; c < n; ++c) {
+            const int px = pixelX(x0 + c * step);
+            const size_t i = size_t(r + 1) * a + c + 1;
+            const float y = apron_[i];
+            vertices_[size_t(r) * n + c] = vertex(glm::vec3(float(px), y, float(pz)), normals_[i], material(px, pz));
+        }
+    }
+
+    // skirts: copies of the edge rows, lowered
+    const float depth = skirtDepth(level, pixelX(x0), pixelZ(z0), pixelX(x0 + S * step), pixelZ(z0 + S * step));
+    buildTerrainSkirts(vertices_, S, depth, pack_min_.y);
+
+    packVertices(vertices_.data(), vertices_.size(), pack_min_, pack_max_, packed_);
+    glNamedBufferSubData(vbo_, GLintptr(slot * vertices_per_chunk_ * sizeof(packed_vertex)),
+        GLsizeiptr(packed_.size() * sizeof(packed_vertex)), packed_.data());
+}
+
+void ChunkedTerrain::draw(int texture_layer) {
+    glm::mat4 model_matrix = glm::scale(glm::translate(glm::mat4(1.0f), origin_), scale_);
+    u.texture_period.set(float(params_.texture_period) * glm::vec2(scale_.x, scale_.z));
+    u.tile_size.set(params_.tile_size);
+
+    if (params_.gpu_displacement) {
+        if (instances_.count == 0) return;
+        shader_.activate();
+        u.model.set(model_matrix);
+        u.instanced.set(0);
+        u.texture_layer.set(texture_layer);
+        u.patch_cells.set(params_.chunk_cells);
+        u.height_scale.set(255.0f * params_.height_scale);
+        glBindTextureUnit(1, height_texture_); // layout(binding = 1) in tex.vert
+
+        glBindVertexArray(vao_);
+        glDrawElementsInstanced(GL_TRIANGLES, indices_per_chunk_, GL_UNSIGNED_SHORT, nullptr, instances_.count);
+        glBindVertexArray(0);
+        return;
+    }
+
+    if (draw_counts_.empty()) return;
+    shader_.activate();
+    u.model.set(model_matrix);
+    u.pos_offset.set(pack_min_);
+    u.pos_scale.set(packedPositionScale(pack_min_, pack_max_));
+    u.oct_normals.set(1);
+    u.instanced.set(0);
+    u.texture_layer.set(texture_layer);
+
+    glBindVertexArray(vao_);
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, draw_counts_.data(), GL_UNSIGNED_SHORT, draw_offsets_.data(),
+        GLsizei(draw_counts_.size()), draw_base_vertices_.data());
+    glBindVertexArray(0);
+}
+
+void ChunkedTerrain::clear() {
+    if (vbo_) glDeleteBuffers(1, &vbo_);
+    if (ebo_) glDeleteBuffers(1, &ebo_);
+    if (vao_) glDeleteVertexArrays(1, &vao_);
+    if (height_texture_) glDeleteTextures(1, &height_texture_);
+    vao_ = vbo_ = ebo_ = height_texture_ = 0;
+    instances_.clear();
+    instance_data_.clear();
+    slot_count_ = 0;
+    chunks_.clear();
+    free_slots_.clear();
+    selected_.clear();
+    draw_counts_.clear();
+    draw_offsets_.clear();
+    draw_base_vertices_.clear();
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "InstanceBuffer.hpp"
+#include "ShaderProgram.hpp"
+#include "assets.hpp"
+#include "height_pyramid.hpp"
+
+// Heightmap terrain as a quadtree of fixed-size chunks. Every chunk has the
+// same grid (chunk_cells x chunk_cells cells); a chunk on level l samples
+// every 2^l-th pixel, so level 0 is the full heightmap resolution and each
+// level up covers four times the area with the same triangle count.
+//
+// Per frame, update() walks the tree from the roots and splits a node while
+// the camera is closer than lod_distance * 2^(level - 1) to its bounds (from
+// a min/max height pyramid); nodes outside the view frustum are dropped.
+// The distance ranges keep neighbouring chunks within one level of each
+// other, and every chunk hangs a skirt below its edges, deep enough to
+// cover the gap to a neighbour one level finer or coarser.
+//
+// Chunk meshes are built on demand into fixed-size slots of one packed
+// vertex buffer (least recently drawn slots are reused) and the whole
+// selection is drawn with one glMultiDrawElementsBaseVertex over a shared
+// index buffer.
+//
+// With gpu_displacement the heights go to the GPU once as an R8 texture
+// and nothing is meshed: the selection becomes one instance per chunk of a
+// vertex-less patch, which tex.vert (SHADER_TERRAIN) displaces, shades and
+// textures from the height texture.
+
+struct ChunkedTerrainParams {
+    int chunk_cells{ 32 };          // grid cells per chunk side, power of two up to 128
+    float height_scale{ 1.0f };     // model y per height unit
+    float lod_distance{ 48.0f };    // world xz distance drawn at full resolution; doubles per level
+    size_t pool_chunks{ 512 };      // chunk meshes kept on the GPU, grows if one frame needs more (GPU displacement: skirt depths kept)
+    int texture_period{ 8 };        // pixels per texture tile, mirrored in between per fragment
+    glm::vec2 tile_size{ 1.0f };    // of the atlas tile material() points at
+    std::function<glm::vec2(float)> material; // atlas tile of a cell whose highest sample is at model y (CPU meshes)
+    bool gpu_displacement{ false }; // instanced patches displaced in tex.vert; the program needs SHADER_TERRAIN
+};
+
+struct ChunkedTerrainStats {
+    size_t chunks{ 0 };             // drawn this frame
+    size_t triangles{ 0 };
+    size_t culled{ 0 };             // nodes outside the frustum
+    size_t built{ 0 };              // chunk meshes (GPU displacement: skirt depths) built this frame
+    size_t resident{ 0 };           // chunk meshes in the pool (skirt depths cached)
+    size_t gpu_bytes{ 0 };          // vertex pool or height texture + instances, index buffer
+    double select_ms{ 0.0 }, build_ms{ 0.0 };
+    double bounds_ms{ 0.0 };        // setHeights
+    double upload_ms{ 0.0 };        // init: the height texture (GPU displacement)
+};
+
+class ChunkedTerrain {
+public:
+    ChunkedTerrain() = default;
+    ~ChunkedTerrain() { clear(); }
+
+    ChunkedTerrain(const ChunkedTerrain&) = delete;
+    ChunkedTerrain& operator=(const ChunkedTerrain&) = delete;
+
+    // Sets up the quadtree bounds; CPU only, no GL calls. heights is row-major
+    // 8-bit (row = z, column = x) and must stay valid while the terrain lives.
+    // pyramid, if given, is a min/max pyramid of the same heights (e.g. the
+    // TerrainRaycaster's) that must outlive the terrain: when chunk_cells is
+    // one of its node sizes the bounds are read from it, else built here.
+    void setHeights(const unsigned char* heights, int width, int height, size_t row_stride,
+        const ChunkedTerrainParams& params, const HeightPyramid* pyramid = nullptr);
+
+    // Creates the vertex pool and index buffer; shader is the program draw() uses
+    void init(const ShaderProgram& shader);
+
+    // World placement: world = origin + scale * model (scale > 0)
+    void setTransform(const glm::vec3& origin, const glm::vec3& scale);
+    void setProjection(const glm::mat4& projection) { projection_ = projection; }
+
+    // Selects the chunks for this view and builds the missing ones
+    void update(const glm::vec3& eye, const glm::mat4& view);
+
+    // Draws the selection; the caller binds the texture (array) on unit 0
+    void draw(int texture_layer);
+
+    const ChunkedTerrainStats& stats() const { return stats_; }
+    int levels() const { return pyramid_ ? pyramid_->levels() - base_level_ : 0; }
+    bool empty() const { return heights_ == nullptr; }
+
+    void clear();
+
+private:
+    struct Chunk {
+        size_t slot{ 0 };
+        uint64_t last_used{ 0 };
+        float skirt{ 0.0f };        // GPU displacement: skirt depth in model units
+    };
+
+    const unsigned char* heights_{ nullptr };
+    int width_{ 0 }, height_{ 0 };
+    size_t row_stride_{ 0 };
+    ChunkedTerrainParams params_;
+    // quadtree level l (step 2^l pixels) is pyramid level base_level_ + l
+    const HeightPyramid* pyramid_{ nullptr };
+    int base_level_{ 0 };
+    HeightPyramid own_pyramid_;     // when none is shared
+
+    glm::vec3 origin_{ 0.0f }, scale_{ 1.0f };
+    glm::mat4 projection_{ 1.0f };
+    float lod_distance_{ 0.0f };    // params.lod_distance, raised to keep neighbours within one level
+    glm::vec3 pack_min_{ 0.0f }, pack_max_{ 0.0f }; // packed position bounds (model space)
+
+    GLuint vao_{ 0 }, vbo_{ 0 }, ebo_{ 0 };
+    GLuint height_texture_{ 0 };    // GPU displacement
+    InstanceBuffer instances_;
+    std::vector<mesh_instance> instance_data_;
+    size_t slot_count_{ 0 };
+    size_t vertices_per_chunk_{ 0 };
+    GLsizei indices_per_chunk_{ 0 };
+
+    std::unordered_map<uint64_t, Chunk> chunks_;
+    std::vector<size_t> free_slots_;
+    uint64_t frame_{ 0 };
+
+    // this frame's selection and its draw arguments
+    std::vector<uint64_t> selected_;
+    std::vector<GLsizei> draw_counts_;
+    std::vector<const void*> draw_offsets_;
+    std::vector<GLint> draw_base_vertices_;
+
+    struct {
+        Uniform<glm::mat4> model;
+        Uniform<glm::vec3> pos_offset, pos_scale;
+        Uniform<int> oct_normals, instanced, texture_layer;
+        Uniform<int> patch_cells;
+        Uniform<float> height_scale;
+        Uniform<glm::vec2> texture_period, tile_size;
+    } u;
+    ShaderProgram shader_;
+
+    ChunkedTerrainStats stats_;
+
+    // chunk build scratch, reused between builds
+    std::vector<float> apron_;
+    std::vector<glm::vec3> normals_;
+    std::vector<vertex> vertices_;
+    std::vector<packed_vertex> packed_;
+
+    static constexpr GLuint INSTANCE_BINDING = 2; // as GpuGeometry: 0 = vertices
+
+    static uint64_t key(int level, int ix, int iz) {
+        return (uint64_t(level) << 56) | (uint64_t(iz) << 28) | uint64_t(ix);
+    }
+
+    float minLodDistance() const;
+    void select(int level, int ix, int iz, const glm::vec4 (&planes)[6], const glm::vec2& eye_xz);
+    size_t acquireSlot();
+    void growPool(size_t slot_count);
+    void initDisplacement();
+    void buildChunk(int level, int ix, int iz, size_t slot);
+    float skirtDepth(int level, int x0, int z0, int x1, int z1) const;
+
+    const HeightPyramid::Level& nodes(int level) const { return pyramid_->level(base_level_ + level); }
+    int pixelX(int x) const { return x < 0 ? 0 : (x >= width_ ? width_ - 1 : x); }
+    int pixelZ(int z) const { return z < 0 ? 0 : (z >= height_ ? height_ - 1 : z); }
+    unsigned char pixel(int x, int z) const { return heights_[size_t(pixelZ(z)) * row_stride_ + size_t(pixelX(x))]; }
+};
@@ -0,0 +1,128 @@
+#include "clustered_lighting.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "light_buffer.hpp"
+
+void ClusteredLighting::init(const std::filesystem::path& compute_shader) {
+    cull_program = ShaderProgram(compute_shader);
+    createGrid();
+}
+
+void ClusteredLighting::init(ShaderBatch& batch, const std::filesystem::path& compute_shader) {
+    batch.add(cull_program, compute_shader);
+    createGrid();
+}
+
+void ClusteredLighting::createGrid() {
+    const size_t clusters = size_t(GRID_X) * GRID_Y * GRID_Z;
+    glCreateBuffers(1, &counts_buffer);
+    glNamedBufferStorage(counts_buffer, clusters * sizeof(GLuint), nullptr, 0);
+    glCreateBuffers(1, &indices_buffer);
+    glNamedBufferStorage(indices_buffer, clusters * MAX_LIGHTS_PER_CLUSTER * sizeof(GLuint), nullptr, 0);
+
+    std::cout << "[Clusters] " << GRID_X << "x" << GRID_Y << "x" << GRID_Z << " froxels, up to "
+        << MAX_LIGHTS_PER_CLUSTER << " lights each ("
+        << clusters * (MAX_LIGHTS_PER_CLUSTER + 1) * sizeof(GLuint) / 1024 << " KB)\n";
+}
+
+void ClusteredLighting::attach(const ShaderProgram& shading_program) {
+    cull_u.grid = cull_program.uniform<glm::ivec3>("uClusterGrid");
+    cull_u.max_lights = cull_program.uniform<int>("uMaxLightsPerCluster");
+    cull_u.inverse_projection = cull_program.uniform<glm::mat4>("uInvP_m");
+    cull_u.view = cull_program.uniform<glm::mat4>("uV_m");
+    cull_u.near_plane = cull_program.uniform<float>("uNear");
+    cull_u.far_plane = cull_program.uniform<float>("uFar");
+    cull_u.grid.set(glm::ivec3(GRID_X, GRID_Y, GRID_Z));
+    cull_u.max_lights.set(MAX_LIGHTS_PER_CLUSTER);
+    cull_u.inverse_projection.set(inverse_projection);
+    cull_u.near_plane.set(near_plane);
+    cull_u.far_plane.set(far_plane);
+
+    ShadeUniforms u;
+    u.clustered = shading_program.uniform<int>("uClustered");
+    u.debug = shading_program.uniform<int>("uClusterDebug");
+    u.max_lights = shading_program.uniform<int>("uMaxLightsPerCluster");
+    u.grid = shading_program.uniform<glm::ivec3>("uClusterGrid");
+    u.tile_size = shading_program.uniform<glm::vec2>("uClusterTileSize");
+    u.depth_mapping = shading_program.uniform<glm::vec2>("uClusterDepth");
+    shade_u.push_back(u);
+    applyShadingUniforms();
+}
+
+void ClusteredLighting::setProjection(const glm::mat4& projection, float near_plane, float far_plane, int width, int height) {
+    this->near_plane = near_plane;
+    this->far_plane = far_plane;
+    inverse_projection = glm::inverse(projection);
+    tile_size = glm::vec2(std::max(width, 1) / float(GRID_X), std::max(height, 1) / float(GRID_Y));
+
+    cull_u.inverse_projection.set(inverse_projection);
+    cull_u.near_plane.set(near_plane);
+    cull_u.far_plane.set(far_plane);
+    applyShadingUniforms();
+}
+
+void ClusteredLighting::setEnabled(bool value) {
+    enabled_ = value;
+    applyShadingUniforms();
+}
+
+void ClusteredLighting::setDebugView(bool value) {
+    debug_ = value;
+    applyShadingUniforms();
+}
+
+void ClusteredLighting::applyShadingUniforms() const {
+    // slice = log(depth) * scale - bias, the inverse of the slicing in cluster_cull.comp
+    float log_ratio = std::log(far_plane / near_plane);
+    glm::vec2 depth_mapping(GRID_Z / log_ratio, GRID_Z * std::log(near_plane) / log_ratio);
+
+    for (const ShadeUniforms& u : shade_u) {
+        u.clustered.set(enabled_ ? 1 : 0);
+        u.debug.set(debug_ ? 1 : 0);
+        u.max_lights.set(MAX_LIGHTS_PER_CLUSTER);
+        u.grid.set(glm::ivec3(GRID_X, GRID_Y, GRID_Z));
+        u.tile_size.set(tile_size);
+        u.depth_mapping.set(depth_mapping);
+    }
+}
+
+void ClusteredLighting::cull(const glm::mat4& view, const LightBuffer& lights) {
+    lights.bind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTS_BINDING, counts_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDICES_BINDING, indices_buffer);
+    if (!enabled_ && !debug_) return;
+
+    cull_u.view.set(view);
+    cull_program.activate();
+    const GLuint clusters = GRID_X * GRID_Y * GRID_Z;
+    glDispatchCompute((clusters + 63) / 64, 1, 1);
+    // lists are read by the following draws
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void ClusteredLighting::occupancy(unsigned& max_count, double& average, unsigned& overflowing) const {
+    std::vector<GLuint> counts(size_t(GRID_X) * GRID_Y * GRID_Z);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glGetNamedBufferSubData(counts_buffer, 0, counts.size() * sizeof(GLuint), counts.data());
+
+    max_count = overflowing = 0;
+    double sum = 0.0;
+    for (GLuint c : counts) {
+        max_count = std::max<unsigned>(max_count, c);
+        sum += c;
+        if (c > MAX_LIGHTS_PER_CLUSTER) ++overflowing;
+    }
+    average = sum / counts.size();
+}
+
+void ClusteredLighting::clear() {
+    if (counts_buffer) glDeleteBuffers(1, &counts_buffer);
+    if (indices_buffer) glDeleteBuffers(1, &indices_buffer);
+    counts_buffer = indices_buffer = 0;
+    shade_u.clear();
+    if (cull_program.ID) cull_program.clear();
+}
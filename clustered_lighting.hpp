@@ -0,0 +1,81 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "ShaderProgram.hpp"
+
+class LightBuffer;
+
+// Clustered forward lighting: a compute pass (cluster_cull.comp) bins the
+// point lights of a LightBuffer into a froxel grid over the view frustum
+// (screen tiles x exponential depth slices). tex.frag then shades each
+// fragment with only the lights listed for its froxel.
+class ClusteredLighting {
+public:
+    static constexpr int GRID_X = 16, GRID_Y = 9, GRID_Z = 24;
+    static constexpr int MAX_LIGHTS_PER_CLUSTER = 256;
+    static constexpr GLuint COUNTS_BINDING = 1, INDICES_BINDING = 2; // after LightBuffer::BINDING
+
+    ClusteredLighting() = default;
+    ~ClusteredLighting() { clear(); }
+
+    ClusteredLighting(const ClusteredLighting&) = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    // Compiles the culling program (or queues it on batch) and allocates the grid
+    void init(const std::filesystem::path& compute_shader);
+    void init(ShaderBatch& batch, const std::filesystem::path& compute_shader);
+
+    // Resolves the uniforms of the culling program and the cluster uniforms
+    // of a shading program (tex.frag); after the programs are linked. Call once
+    // per program variant that shades point lights.
+    void attach(const ShaderProgram& shading_program);
+
+    // Call when the projection or the framebuffer size changes
+    void setProjection(const glm::mat4& projection, float near_plane, float far_plane, int width, int height);
+
+    // Assigns the lights to clusters for this view and binds the result
+    void cull(const glm::mat4& view, const LightBuffer& lights);
+
+    // enabled = false shades every light per fragment (the reference path);
+    // debug shows per-cluster light counts instead of the lit scene
+    void setEnabled(bool value);
+    void setDebugView(bool value);
+    bool enabled() const { return enabled_; }
+    bool debugView() const { return debug_; }
+
+    // Reads the counts back (stalls; for stats and the benchmark)
+    void occupancy(unsigned& max_count, double& average, unsigned& overflowing) const;
+
+    void clear();
+
+private:
+    ShaderProgram cull_program;
+    GLuint counts_buffer{ 0 }, indices_buffer{ 0 };
+    bool enabled_{ true }, debug_{ false };
+
+    glm::mat4 inverse_projection{ 1.0f };
+    float near_plane{ 0.1f }, far_plane{ 1000.0f };
+    glm::vec2 tile_size{ 1.0f };
+
+    struct {
+        Uniform<glm::ivec3> grid;
+        Uniform<int> max_lights;
+        Uniform<glm::mat4> inverse_projection, view;
+        Uniform<float> near_plane, far_plane;
+    } cull_u;
+
+    struct ShadeUniforms {
+        Uniform<int> clustered, debug, max_lights;
+        Uniform<glm::ivec3> grid;
+        Uniform<glm::vec2> tile_size, depth_mapping;
+    };
+    std::vector<ShadeUniforms> shade_u; // one per attached program
+
+    void createGrid();
+    void applyShadingUniforms() const;
+};
@@ -0,0 +1,191 @@
+#include "gpu_geometry.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+#include "InstanceBuffer.hpp"
+
+GpuGeometry::GpuGeometry(const std::string& name,
+    const vertex* vertex_data, size_t vertex_count,
+    const void* index_data, size_t index_count, GLenum index_type,
+    const std::vector<MeshLod>& lods,
+    const glm::vec3& bounds_min, const glm::vec3& bounds_max,
+    VertexFormat format, bool with_colors)
+    : name_(name),
+    index_type_(index_type),
+    lods_(lods),
+    vertex_count_(vertex_count),
+    bounds_min_(bounds_min),
+    bounds_max_(bounds_max)
+{
+    createIndexBuffer(index_data, index_count);
+
+    packed_ = (format == VertexFormat::Packed);
+    if (packed_) {
+        std::vector<packed_vertex> packed_vertices;
+        packVertices(vertex_data, vertex_count, bounds_min, bounds_max, packed_vertices);
+        uploadPacked(packed_vertices.data(), packed_vertices.size());
+
+        // Color -> location 3 from its own RGBA8 stream, only on request
+        if (with_colors) {
+            std::vector<uint32_t> colors;
+            packColors(vertex_data, vertex_count, colors);
+            vertex_bytes_ += colors.size() * sizeof(uint32_t);
+
+            glCreateBuffers(1, &color_vbo_);
+            glNamedBufferStorage(color_vbo_, std::max<size_t>(colors.size() * sizeof(uint32_t), 1), colors.data(), 0);
+            glVertexArrayVertexBuffer(vao_, 1, color_vbo_, 0, sizeof(uint32_t));
+            glEnableVertexArrayAttrib(vao_, 3);
+            glVertexArrayAttribFormat(vao_, 3, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0);
+            glVertexArrayAttribBinding(vao_, 3, 1);
+        }
+        return;
+    }
+
+    vertex_bytes_ = vertex_count * sizeof(vertex);
+    glNamedBufferStorage(vbo_, std::max<size_t>(vertex_bytes_, 1), vertex_data, 0);
+    glVertexArrayVertexBuffer(vao_, 0, vbo_, 0, sizeof(vertex));
+
+    // Position -> location 0
+    glEnableVertexArrayAttrib(vao_, 0);
+    glVertexArrayAttribFormat(vao_, 0, 3, GL_FLOAT, GL_FALSE, offsetof(vertex, position));
+    glVertexArrayAttribBinding(vao_, 0, 0);
+
+    // Normal -> location 1
+    glEnableVertexArrayAttrib(vao_, 1);
+    glVertexArrayAttribFormat(vao_, 1, 3, GL_FLOAT, GL_FALSE, offsetof(vertex, normal));
+    glVertexArrayAttribBinding(vao_, 1, 0);
+
+    // Texcoords -> location 2
+    glEnableVertexArrayAttrib(vao_, 2);
+    glVertexArrayAttribFormat(vao_, 2, 2, GL_FLOAT, GL_FALSE, offsetof(vertex, texcoords));
+    glVertexArrayAttribBinding(vao_, 2, 0);
+
+    // Color -> location 3, only on request
+    if (with_colors) {
+        glEnableVertexArrayAttrib(vao_, 3);
+        glVertexArrayAttribFormat(vao_, 3, 3, GL_FLOAT, GL_FALSE, offsetof(vertex, color));
+        glVertexArrayAttribBinding(vao_, 3, 0);
+    }
+}
+
+GpuGeometry::GpuGeometry(const std::string& name,
+    const packed_vertex* vertex_data, size_t vertex_count,
+    const void* index_data, size_t index_count, GLenum index_type,
+    const std::vector<MeshLod>& lods,
+    const glm::vec3& bounds_min, const glm::vec3& bounds_max)
+    : name_(name),
+    index_type_(index_type),
+    lods_(lods),
+    vertex_count_(vertex_count),
+    bounds_min_(bounds_min),
+    bounds_max_(bounds_max),
+    packed_(true)
+{
+    createIndexBuffer(index_data, index_count);
+    uploadPacked(vertex_data, vertex_count);
+}
+
+void GpuGeometry::createIndexBuffer(const void* index_data, size_t index_count) {
+    if (lods_.empty())
+        lods_.push_back({ 0, static_cast<GLsizei>(index_count), 0.0f });
+
+    glCreateVertexArrays(1, &vao_);
+    glCreateBuffers(1, &vbo_);
+    glCreateBuffers(1, &ebo_);
+
+    // immutable storage: the driver knows the buffers never change size or content
+    index_bytes_ = std::max<size_t>(index_count * indexSize(), 1);
+    glNamedBufferStorage(ebo_, index_bytes_, index_data, 0);
+    glVertexArrayElementBuffer(vao_, ebo_);
+}
+
+void GpuGeometry::uploadPacked(const packed_vertex* vertex_data, size_t vertex_count) {
+    position_offset_ = bounds_min_;
+    position_scale_ = packedPositionScale(bounds_min_, bounds_max_);
+    vertex_bytes_ = vertex_count * sizeof(packed_vertex);
+
+    glNamedBufferStorage(vbo_, std::max<size_t>(vertex_bytes_, 1), vertex_data, 0);
+    glVertexArrayVertexBuffer(vao_, 0, vbo_, 0, sizeof(packed_vertex));
+
+    // Position -> location 0, normalized to [0, 1] within the bounds
+    glEnableVertexArrayAttrib(vao_, 0);
+    glVertexArrayAttribFormat(vao_, 0, 3, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(packed_vertex, position));
+    glVertexArrayAttribBinding(vao_, 0, 0);
+
+    // Octahedral normal -> location 1 (.xy)
+    glEnableVertexArrayAttrib(vao_, 1);
+    glVertexArrayAttribFormat(vao_, 1, 2, GL_SHORT, GL_TRUE, offsetof(packed_vertex, normal));
+    glVertexArrayAttribBinding(vao_, 1, 0);
+
+    // Texcoords -> location 2
+    glEnableVertexArrayAttrib(vao_, 2);
+    glVertexArrayAttribFormat(vao_, 2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(packed_vertex, texcoords));
+    glVertexArrayAttribBinding(vao_, 2, 0);
+}
+
+GpuGeometry::~GpuGeometry() {
+    if (vbo_) glDeleteBuffers(1, &vbo_);
+    if (color_vbo_) glDeleteBuffers(1, &color_vbo_);
+    if (ebo_) glDeleteBuffers(1, &ebo_);
+    if (vao_) glDeleteVertexArrays(1, &vao_);
+}
+
+void GpuGeometry::bindInstances(GLuint buffer) {
+    if (!instance_attribs_) {
+        // Offset + layer -> location 4
+        glEnableVertexArrayAttrib(vao_, 4);
+        glVertexArrayAttribFormat(vao_, 4, 4, GL_FLOAT, GL_FALSE, offsetof(mesh_instance, offset));
+        glVertexArrayAttribBinding(vao_, 4, INSTANCE_BINDING);
+
+        // Scale -> location 5
+        glEnableVertexArrayAttrib(vao_, 5);
+        glVertexArrayAttribFormat(vao_, 5, 3, GL_FLOAT, GL_FALSE, offsetof(mesh_instance, scale));
+        glVertexArrayAttribBinding(vao_, 5, INSTANCE_BINDING);
+
+        glVertexArrayBindingDivisor(vao_, INSTANCE_BINDING, 1);
+        instance_attribs_ = true;
+    }
+    glVertexArrayVertexBuffer(vao_, INSTANCE_BINDING, buffer, 0, sizeof(mesh_instance));
+}
+
+std::map<std::string, std::weak_ptr<GpuGeometry>>& GeometryRegistry::entries() {
+    static std::map<std::string, std::weak_ptr<GpuGeometry>> registry;
+    return registry;
+}
+
+GeometryHandle GeometryRegistry::find(const std::string& key) {
+    auto it = entries().find(key);
+    if (it == entries().end()) return nullptr;
+    GeometryHandle geometry = it->second.lock();
+    if (!geometry) entries().erase(it);
+    return geometry;
+}
+
+GeometryHandle GeometryRegistry::add(const std::string& key, GeometryHandle geometry) {
+    entries()[key] = geometry;
+    return geometry;
+}
+
+void GeometryRegistry::report(std::ostream& out) {
+    size_t total = 0;
+    out << "[Geometry] Live GPU geometry:\n";
+    for (auto it = entries().begin(); it != entries().end();) {
+        GeometryHandle g = it->second.lock();
+        if (!g) {
+            it = entries().erase(it);
+            continue;
+        }
+        size_t bytes = g->vertexBytes() + g->indexBytes();
+        total += bytes;
+        // use_count includes the local handle
+        out << "  " << std::left << std::setw(28) << it->first << std::right
+            << std::setw(9) << g->vertexCount() << " vertices  "
+            << std::setw(8) << g->vertexBytes() / 1024 << " KB VBO  "
+            << std::setw(8) << g->indexBytes() / 1024 << " KB EBO  "
+            << g->lods().size() << " LOD  " << g.use_count() - 1 << " refs\n";
+        ++it;
+    }
+    out << "  total " << total / 1024 << " KB\n";
+}
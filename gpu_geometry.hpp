@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "assets.hpp"
+#include "vertex_packing.hpp"
+
+// One level of detail: a range of the shared index buffer
+struct MeshLod {
+    GLuint first_index{ 0 };
+    GLsizei index_count{ 0 };
+    float error{ 0.0f }; // simplification error relative to the mesh extent
+};
+
+// Immutable GPU copy of a mesh: VAO plus glNamedBufferStorage buffers.
+// Owned through GeometryHandle; the GL objects are deleted with the last
+// handle, so any number of Meshes/Models can share one upload.
+class GpuGeometry {
+public:
+    // Uploads vertices (in the given layout) and indices (GL_UNSIGNED_SHORT or
+    // GL_UNSIGNED_INT); nothing is kept on the CPU. Empty lods = one level.
+    GpuGeometry(const std::string& name,
+        const vertex* vertex_data, size_t vertex_count,
+        const void* index_data, size_t index_count, GLenum index_type,
+        const std::vector<MeshLod>& lods,
+        const glm::vec3& bounds_min, const glm::vec3& bounds_max,
+        VertexFormat format, bool with_colors);
+    // Uploads vertices that are already packed against bounds_min/bounds_max
+    // (packVertex); no color stream
+    GpuGeometry(const std::string& name,
+        const packed_vertex* vertex_data, size_t vertex_count,
+        const void* index_data, size_t index_count, GLenum index_type,
+        const std::vector<MeshLod>& lods,
+        const glm::vec3& bounds_min, const glm::vec3& bounds_max);
+    ~GpuGeometry();
+
+    GpuGeometry(const GpuGeometry&) = delete;
+    GpuGeometry& operator=(const GpuGeometry&) = delete;
+
+    const std::string& name() const { return name_; }
+    GLuint vao() const { return vao_; }
+    GLenum indexType() const { return index_type_; }
+    size_t indexSize() const { return index_type_ == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint); }
+    const std::vector<MeshLod>& lods() const { return lods_; }
+    const MeshLod& lod(size_t level) const { return lods_[std::min(level, lods_.size() - 1)]; }
+
+    size_t vertexCount() const { return vertex_count_; }
+    size_t vertexBytes() const { return vertex_bytes_; }
+    size_t indexBytes() const { return index_bytes_; }
+
+    const glm::vec3& boundsMin() const { return bounds_min_; }
+    const glm::vec3& boundsMax() const { return bounds_max_; }
+
+    // packed positions decode as positionOffset() + positionScale() * unorm16
+    bool packed() const { return packed_; }
+    const glm::vec3& positionOffset() const { return position_offset_; }
+    const glm::vec3& positionScale() const { return position_scale_; }
+
+    // Attaches a mesh_instance buffer to the VAO for instanced draws
+    void bindInstances(GLuint buffer);
+
+private:
+    static constexpr GLuint INSTANCE_BINDING = 2; // 0 = vertices, 1 = packed colors
+
+    std::string name_;
+    GLuint vao_{ 0 }, vbo_{ 0 }, color_vbo_{ 0 }, ebo_{ 0 };
+    GLenum index_type_{ GL_UNSIGNED_INT };
+    std::vector<MeshLod> lods_;
+    size_t vertex_count_{ 0 };
+    size_t vertex_bytes_{ 0 }, index_bytes_{ 0 };
+    glm::vec3 bounds_min_{ 0.0f }, bounds_max_{ 0.0f };
+    bool packed_{ false };
+    glm::vec3 position_offset_{ 0.0f }, position_scale_{ 1.0f };
+    bool instance_attribs_{ false };
+
+    void createIndexBuffer(const void* index_data, size_t index_count);
+    void uploadPacked(const packed_vertex* vertex_data, size_t vertex_count);
+};
+
+using GeometryHandle = std::shared_ptr<GpuGeometry>;
+
+// Name -> live geometry, so the same source is uploaded once and shared.
+// Only weak references are held: geometry dies with its last handle.
+class GeometryRegistry {
+public:
+    // Live geometry registered under key, or nullptr
+    static GeometryHandle find(const std::string& key);
+
+    // Registers (or replaces) key; returns geometry for chaining
+    static GeometryHandle add(const std::string& key, GeometryHandle geometry);
+
+    // Per-geometry GPU memory and reference counts of everything alive
+    static void report(std::ostream& out);
+
+private:
+    static std::map<std::string, std::weak_ptr<GpuGeometry>>& entries();
+};
@@ -0,0 +1,105 @@
+#include "height_pyramid.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HEIGHT_PYRAMID_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// lo[x] = min(lo[x], in_lo[x]), hi[x] = max(hi[x], in_hi[x]) for x < count,
+// in ascending x, so the inputs may also be lo and hi further ahead. Spelled
+// out in SSE2: byte pointers may alias, so the plain loop is not vectorized.
+void fold(const unsigned char* in_lo, const unsigned char* in_hi, unsigned char* lo, unsigned char* hi, int count) {
+    int x = 0;
+#ifdef HEIGHT_PYRAMID_SSE2
+    for (; x + 16 <= count; x += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in_lo + x));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in_hi + x));
+        __m128i* l = reinterpret_cast<__m128i*>(lo + x);
+        __m128i* h = reinterpret_cast<__m128i*>(hi + x);
+        _mm_storeu_si128(l, _mm_min_epu8(_mm_loadu_si128(l), a));
+        _mm_storeu_si128(h, _mm_max_epu8(_mm_loadu_si128(h), b));
+    }
+#endif
+    for (; x < count; ++x) {
+        lo[x] = std::min(lo[x], in_lo[x]);
+        hi[x] = std::max(hi[x], in_hi[x]);
+    }
+}
+
+} // namespace
+
+void HeightPyramid::build(const unsigned char* heights, int width, int height, size_t row_stride, int leaf_cells) {
+    levels_.clear();
+    leaf_cells_ = std::max(1, leaf_cells);
+    if (!heights || width < 2 || height < 2) return;
+
+    // leaves: min/max over every sample a leaf covers, edges included. Each
+    // band of rows is first folded column-wise. Then band[x] becomes the
+    // min/max of the span samples from x on (span the largest power of two
+    // <= S + 1, cut at the edge), so a leaf is two overlapping windows.
+    const int S = leaf_cells_;
+    int span = 1;
+    while (span * 2 <= S + 1) span *= 2;
+    Level leaves;
+    leaves.nodes_x = (width - 2) / S + 1;
+    leaves.nodes_z = (height - 2) / S + 1;
+    leaves.ranges.resize(size_t(leaves.nodes_x) * leaves.nodes_z);
+    std::vector<unsigned char> band_lo(width), band_hi(width);
+    for (int iz = 0; iz < leaves.nodes_z; ++iz) {
+        const int z0 = iz * S, z1 = std::min(z0 + S, height - 1);
+        std::copy_n(heights + size_t(z0) * row_stride, width, band_lo.begin());
+        std::copy_n(heights + size_t(z0) * row_stride, width, band_hi.begin());
+        unsigned char* lo = band_lo.data();
+        unsigned char* hi = band_hi.data();
+        for (int z = z0 + 1; z <= z1; ++z) {
+            const unsigned char* row = heights + size_t(z) * row_stride;
+            fold(row, row, lo, hi, width);
+        }
+        for (int w = 1; w < span && w < width; w *= 2) fold(lo + w, hi + w, lo, hi, width - w);
+
+        Range* out = leaves.ranges.data() + size_t(iz) * leaves.nodes_x;
+        for (int ix = 0; ix < leaves.nodes_x; ++ix) {
+            const int x0 = ix * S, x1 = std::min(x0 + S, width - 1);
+            const int x = std::max(x0, x1 + 1 - span);
+            out[ix] = Range{ std::min(lo[x0], lo[x]), std::max(hi[x0], hi[x]) };
+        }
+    }
+    levels_.push_back(std::move(leaves));
+
+    // each parent covers 2x2 children, up to a single root
+    while (levels_.back().nodes_x > 1 || levels_.back().nodes_z > 1) {
+        const Level& child = levels_.back();
+        Level parent;
+        parent.nodes_x = (child.nodes_x + 1) / 2;
+        parent.nodes_z = (child.nodes_z + 1) / 2;
+        parent.ranges.resize(size_t(parent.nodes_x) * parent.nodes_z);
+        for (int iz = 0; iz < parent.nodes_z; ++iz) {
+            // an odd last row or column of children counts twice
+            const Range* r0 = &child.at(0, iz * 2);
+            const Range* r1 = &child.at(0, std::min(iz * 2 + 1, child.nodes_z - 1));
+            Range* out = &parent.ranges[size_t(iz) * parent.nodes_x];
+            for (int ix = 0; ix < parent.nodes_x; ++ix) {
+                const int x0 = ix * 2, x1 = std::min(x0 + 1, child.nodes_x - 1);
+                out[ix].lo = std::min(std::min(r0[x0].lo, r0[x1].lo), std::min(r1[x0].lo, r1[x1].lo));
+                out[ix].hi = std::max(std::max(r0[x0].hi, r0[x1].hi), std::max(r1[x0].hi, r1[x1].hi));
+            }
+        }
+        levels_.push_back(std::move(parent));
+    }
+}
+
+int HeightPyramid::levelFor(int cells) const {
+    for (int l = 0; l < levels(); ++l)
+        if (leaf_cells_ << l == cells) return l;
+    return -1;
+}
+
+size_t HeightPyramid::bytes() const {
+    size_t total = 0;
+    for (const Level& level : levels_) total += level.ranges.size() * sizeof(Range);
+    return total;
+}
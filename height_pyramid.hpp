@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Min/max pyramid over a row-major 8-bit heightmap (row = z, column = x).
+// A level-0 node covers leaf_cells x leaf_cells cells and holds the lowest
+// and highest of their samples, edges included; each level above folds 2x2
+// nodes, up to a single root. A node of level l covers leaf_cells << l cells
+// per side, so a pyramid with 4-cell leaves also holds the bounds of 8-,
+// 16-, 32-cell... blocks from level 1, 2, 3... up.
+class HeightPyramid {
+public:
+    struct Range { unsigned char lo, hi; };
+
+    // Nodes of one level, row-major
+    struct Level {
+        int nodes_x{ 0 }, nodes_z{ 0 };
+        std::vector<Range> ranges;
+
+        const Range& at(int ix, int iz) const { return ranges[size_t(iz) * nodes_x + ix]; }
+    };
+
+    // CPU only; the heights are only read during the build
+    void build(const unsigned char* heights, int width, int height, size_t row_stride, int leaf_cells);
+
+    // Level whose nodes cover cells x cells (leafCells() << level), or -1
+    int levelFor(int cells) const;
+
+    int leafCells() const { return leaf_cells_; }
+    int levels() const { return int(levels_.size()); }
+    const Level& level(int l) const { return levels_[l]; }
+    const Range& root() const { return levels_.back().ranges.front(); }
+    size_t bytes() const;
+    bool empty() const { return levels_.empty(); }
+
+    void clear() { levels_.clear(); }
+
+private:
+    int leaf_cells_{ 0 };
+    std::vector<Level> levels_;     // [0] = leaves
+};
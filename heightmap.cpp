@@ -5,6 +5,13 @@
 #include <vector>
 #include <algorithm>
 #include <filesystem>
+#include <chrono>
+#include <cstring>
+
+#include "terrain_mesher.hpp"
+#include "paged_terrain.hpp"
+#include "terrain_noise.hpp"
+#include "terrain_raycast.hpp"
 
 // Choose subtexture based on height
 glm::vec2 get_subtex_by_height(float height) {
@@ -20,85 +27,177 @@ glm::vec2 get_subtex_by_height(float height) {
         return glm::vec2(0, 11) / 16.0f; // grass
 }
 
-void App::initHeightmap() {
-    std::filesystem::path hm_file("C:/Users/Jirka/source/repos/my_app/resources/textures/heights.png");
-    cv::Mat hmap = cv::imread(hm_file.string(), cv::IMREAD_GRAYSCALE);
-    if (hmap.empty()) {
-        throw std::runtime_error("ERR: Height map empty? File: " + hm_file.string());
-    }
-
-    heightmap_img = hmap.clone(); // Copy image for use in Y-smoothing
-
+void App::loadHeightmap(std::vector<vertex>& vertices, std::vector<GLuint>& indices) {
+    const std::filesystem::path& hm_file = heightmap_file;
+
+    if (terrain_paged) {
+        // the heights stay on disk: the image is cut into a .tiles file once
+        // (again when it changes) and tiles are paged in around the camera
+        // (procedural: keyed by the size and a hash of the noise parameters)
+        std::filesystem::path tiles_file = heightTilesPath(hm_file);
+        std::error_code ec;
+        uint64_t source_size = 0;
+        int64_t source_mtime = 0;
+        bool have_source = true;
+        if (terrain_procedural) {
+            source_size = uint64_t(terrain_noise_size);
+            source_mtime = static_cast<int64_t>(noiseParamsHash(terrain_noise));
+        }
+        else {
+            source_size = std::filesystem::file_size(hm_file, ec);
+            have_source = !ec;
+            if (have_source)
+                source_mtime = static_cast<int64_t>(std::filesystem::last_write_time(hm_file, ec).time_since_epoch().count());
+        }
 
+        HeightTiles existing;
+        bool fresh = existing.open(tiles_file) && int(existing.tileCells()) == terrain_tile_cells
+            && (!have_source || (existing.header().source_size == source_size && existing.header().source_mtime == source_mtime));
+        existing.close();
+        if (!fresh && terrain_procedural) {
+            // generated a band of rows at a time on all cores, straight into the tiles
+            const int size = terrain_noise_size, band_rows = 256;
+            cv::Mat band(band_rows, size, CV_8U);
+            int band_z = -band_rows;
+            double generate_ms = 0.0;
+            auto row = [&](int z, unsigned char* out) {
+                if (z < band_z || z >= band_z + band_rows) {
+                    band_z = std::max(0, z - 2); // the next tile row starts two rows back
+                    generate_ms += generateNoiseHeights(terrain_noise, 0, band_z, size, std::min(band_rows, size - band_z),
+                        band.ptr<uchar>(0), band.step).ms;
+                }
+                std::memcpy(out, band.ptr<uchar>(z - band_z), size_t(size));
+            };
+            auto start = std::chrono::steady_clock::now();
+            if (!writeHeightTiles(tiles_file, size, size, terrain_tile_cells, row, source_size, source_mtime)) {
+                throw std::runtime_error("ERR: Cannot write height tiles: " + tiles_file.string());
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "[Heightmap] Generated " << size << "x" << size << " (seed " << terrain_noise.seed << ") into "
+                << tiles_file << " | noise " << generate_ms << " ms, total " << ms << " ms\n";
+        }
+        else if (!fresh) {
+            auto start = std::chrono::steady_clock::now();
+            cv::Mat hmap = cv::imread(hm_file.string(), cv::IMREAD_GRAYSCALE);
+            if (hmap.empty()) {
+                throw std::runtime_error("ERR: Height map empty? File: " + hm_file.string());
+            }
+            auto row = [&hmap](int z, unsigned char* out) { std::memcpy(out, hmap.ptr<uchar>(z), size_t(hmap.cols)); };
+            if (!writeHeightTiles(tiles_file, hmap.cols, hmap.rows, terrain_tile_cells, row, source_size, source_mtime)) {
+                throw std::runtime_error("ERR: Cannot write height tiles: " + tiles_file.string());
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "[Heightmap] Tiled " << hm_file << " (" << hmap.cols << "x" << hmap.rows << ") into "
+                << tiles_file << " | " << ms << " ms\n";
+        }
 
-    if (hmap.empty()) {
-        throw std::runtime_error("ERR: Height map empty? File: " + hm_file.string());
+        paged_params.height_scale = -0.25f; // inverted to correct flipped orientation
+        paged_params.tile_size = glm::vec2(1.0f / 16.0f);
+        paged_params.material = [](float y) { return get_subtex_by_height(-y / (255.0f * 0.25f)); };
+        if (!paged_terrain.open(tiles_file, paged_params)) {
+            throw std::runtime_error("ERR: Cannot open height tiles: " + tiles_file.string());
+        }
+        return;
     }
 
-    std::cout << "[Heightmap] Loaded: " << hm_file << " (" << hmap.cols << "x" << hmap.rows << ")\n";
-
-    std::vector<vertex> vertices;
-    std::vector<GLuint> indices;
-
-    const unsigned int step = 10;
-    float height_scale = 0.25f;
-
-    for (unsigned int x = 0; x < hmap.cols - step; x += step) {
-        for (unsigned int z = 0; z < hmap.rows - step; z += step) {
-            // Invert height to correct flipped orientation
-            float h0 = - hmap.at<uchar>(z, x) * height_scale;
-            float h1 = - hmap.at<uchar>(z, x + step) * height_scale;
-            float h2 = - hmap.at<uchar>(z + step, x + step) * height_scale;
-            float h3 = - hmap.at<uchar>(z + step, x) * height_scale;
-
-            glm::vec3 p0(x, h0, z);
-            glm::vec3 p1(x + step, h1, z);
-            glm::vec3 p2(x + step, h2, z + step);
-            glm::vec3 p3(x, h3, z + step);
-
-            float max_h = std::max({ h0, h1, h2, h3 }) / (255.0f * height_scale);
-
-            glm::vec2 base_tc = get_subtex_by_height(max_h);
-            glm::vec2 offset(1.0f / 16.0f, 1.0f / 16.0f);
-
-            glm::vec2 t0 = base_tc;
-            glm::vec2 t1 = base_tc + glm::vec2(offset.x, 0);
-            glm::vec2 t2 = base_tc + offset;
-            glm::vec2 t3 = base_tc + glm::vec2(0, offset.y);
+    cv::Mat hmap;
+    if (terrain_procedural) {
+        hmap = cv::Mat(terrain_noise_size, terrain_noise_size, CV_8U);
+        NoiseTerrainStats stats = generateNoiseHeights(terrain_noise, 0, 0, hmap.cols, hmap.rows, hmap.ptr<uchar>(0), hmap.step);
+        heightmap_img = hmap;
+        std::cout << "[Heightmap] Generated " << hmap.cols << "x" << hmap.rows << " (seed " << terrain_noise.seed << ", "
+            << stats.threads << " threads" << (stats.simd ? ", SSE2" : "") << ") | " << stats.ms << " ms, "
+            << double(hmap.total()) / (stats.ms * 1000.0) << " Msamples/s\n";
+    }
+    else {
+        hmap = cv::imread(hm_file.string(), cv::IMREAD_GRAYSCALE);
+        if (hmap.empty()) {
+            throw std::runtime_error("ERR: Height map empty? File: " + hm_file.string());
+        }
 
-            glm::vec3 n1 = glm::normalize(glm::cross(p1 - p0, p2 - p0));
-            glm::vec3 n2 = glm::normalize(glm::cross(p2 - p0, p3 - p0));
-            glm::vec3 navg = glm::normalize(n1 + n2);
+        heightmap_img = hmap.clone(); // Copy image for use in Y-smoothing
 
-            GLuint base = vertices.size();
+        std::cout << "[Heightmap] Loaded: " << hm_file << " (" << hmap.cols << "x" << hmap.rows << ")\n";
+    }
 
-            vertices.emplace_back(vertex(p0, navg, t0));
-            vertices.emplace_back(vertex(p1, n1, t1));
-            vertices.emplace_back(vertex(p2, navg, t2));
-            vertices.emplace_back(vertex(p3, n2, t3));
+    // camera height, picking and line of sight at full resolution, whatever is drawn
+    terrain_rays.build(heightmap_img.ptr<uchar>(0), heightmap_img.cols, heightmap_img.rows, heightmap_img.step);
+
+    if (terrain_chunked) {
+        // chunks are meshed (or displaced on the GPU) around the camera while
+        // running; heightmap_img holds the heights
+        terrain_params.height_scale = -0.25f; // inverted to correct flipped orientation
+        terrain_params.tile_size = glm::vec2(1.0f / 16.0f);
+        terrain_params.material = [](float y) { return get_subtex_by_height(-y / (255.0f * 0.25f)); };
+        terrain.setHeights(heightmap_img.ptr<uchar>(0), heightmap_img.cols, heightmap_img.rows, heightmap_img.step, terrain_params,
+            &terrain_rays.pyramid());
+        return;
+    }
 
-            indices.push_back(base + 0);
-            indices.push_back(base + 1);
-            indices.push_back(base + 2);
-            indices.push_back(base + 0);
-            indices.push_back(base + 2);
-            indices.push_back(base + 3);
+    auto start = std::chrono::steady_clock::now();
+    TerrainMeshParams params;
+    params.step = terrain_step;
+    params.height_scale = -0.25f; // inverted to correct flipped orientation
+    TerrainMeshStats stats = buildTerrainMesh(hmap.ptr<uchar>(0), hmap.cols, hmap.rows, hmap.step, params, vertices, indices);
+
+    // the atlas tile of the cell each vertex is the (c, r) corner of (its
+    // provoking vertex), by the cell's highest pixel; the shader tiles it
+    // across the ground
+    for (int r = 0; r < stats.rows; ++r) {
+        const int z0 = r * params.step, z1 = std::min(z0 + params.step, (stats.rows - 1) * params.step);
+        for (int c = 0; c < stats.cols; ++c) {
+            const int x0 = c * params.step, x1 = std::min(x0 + params.step, (stats.cols - 1) * params.step);
+            const uchar top = std::max(std::max(hmap.at<uchar>(z0, x0), hmap.at<uchar>(z0, x1)),
+                std::max(hmap.at<uchar>(z1, x0), hmap.at<uchar>(z1, x1)));
+            vertices[size_t(r) * stats.cols + c].texcoords = get_subtex_by_height(top / 255.0f);
         }
     }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 
-    std::cout << "[Heightmap] Generated vertices: " << vertices.size() << ", indices: " << indices.size() << "\n";
+    const size_t vertex_bytes = Mesh::vertex_format == VertexFormat::Packed ? sizeof(packed_vertex) : sizeof(vertex);
+    const size_t index_bytes = Mesh::fitsShortIndices(vertices.size()) ? sizeof(GLushort) : sizeof(GLuint);
+    std::cout << "[Heightmap] " << stats.cols << "x" << stats.rows << " grid (step " << params.step << "): "
+        << vertices.size() << " vertices, " << stats.triangles << " triangles | "
+        << ((vertices.size() * vertex_bytes + indices.size() * index_bytes) >> 10) << " KB on the GPU | " << ms << " ms\n";
+}
 
-    heightmap_model = new Model("manual", shader_program);
-    heightmap_model->meshes.emplace_back(GL_TRIANGLES, shader_program, vertices, indices, glm::vec3(0), glm::vec3(0));
+void App::initHeightmap(const std::vector<vertex>& vertices, const std::vector<GLuint>& indices) {
+    const int cols = terrain_paged ? paged_terrain.width() : heightmap_img.cols;
+    const int rows = terrain_paged ? paged_terrain.height() : heightmap_img.rows;
 
     // Lower and reposition terrain to ground level below maze
-    heightmap_model->origin = glm::vec3(
-        -((hmap.cols / 2.0f) * 0.5f), // Adjusted by scale factor (0.5f)
-        -10.0f,                       // Keep your vertical offset
-        -((hmap.rows / 2.0f) * 0.5f)  // Adjusted by scale factor (0.5f)
+    const glm::vec3 origin(
+        -((cols / 2.0f) * 0.5f), // Adjusted by scale factor (0.5f)
+        -10.0f,                  // Keep your vertical offset
+        -((rows / 2.0f) * 0.5f)  // Adjusted by scale factor (0.5f)
     );
+    const glm::vec3 scale(0.5f, 1.0f, 0.5f);
+    terrain_rays.setTransform(origin, scale, -0.25f);
+
+    if (terrain_paged) {
+        paged_terrain.init(shader_variants.get(terrain_features));
+        paged_terrain.setTransform(origin, scale);
+        std::cout << "[Heightmap] Paged terrain ready to draw.\n";
+        return;
+    }
+
+    if (terrain_chunked) {
+        terrain.init(shader_variants.get(terrain_features));
+        terrain.setTransform(origin, scale);
+        std::cout << "[Heightmap] " << (terrain_params.gpu_displacement ? "GPU displaced" : "Chunked")
+            << " terrain ready to draw.\n";
+        return;
+    }
+
+    ShaderProgram& shader = shader_variants.get(terrain_features);
+    shader.uniform<glm::vec2>("uTexturePeriod").set(float(terrain_params.texture_period) * glm::vec2(scale.x, scale.z));
+    shader.uniform<glm::vec2>("uTileSize").set(glm::vec2(1.0f / 16.0f));
+    heightmap_model = new Model("manual", shader);
+    heightmap_model->meshes.emplace_back(GL_TRIANGLES, shader, vertices, indices, glm::vec3(0), glm::vec3(0));
 
-    heightmap_model->scale = glm::vec3(0.5f, 1.0f, 0.5f);
+    heightmap_model->origin = origin;
+    heightmap_model->scale = scale;
+    heightmap_model->texture_layer = TERRAIN_LAYER;
 
 
     std::cout << "[Heightmap] Model created and ready to draw.\n";
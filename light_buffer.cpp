@@ -0,0 +1,55 @@
+#include "light_buffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#include "app.hpp"
+
+float lightRadius(const glm::vec3& color, float constant, float linear, float quadratic) {
+    // solve quadratic * d^2 + linear * d + constant = 256 * max(color)
+    float peak = std::max({ color.x, color.y, color.z, 1e-6f });
+    float c = constant - 256.0f * peak;
+    if (quadratic <= 0.0f) return linear > 0.0f ? std::max(0.0f, -c / linear) : 1e9f;
+    float disc = linear * linear - 4.0f * quadratic * c;
+    return (-linear + std::sqrt(std::max(disc, 0.0f))) / (2.0f * quadratic);
+}
+
+void LightBuffer::update(const DirectionalLight& sun, const SpotLight& spot, const std::vector<PointLight>& points) {
+    point_count = points.size();
+    if (!buffer || point_count > capacity) {
+        clear();
+        capacity = std::max<size_t>(point_count, std::max<size_t>(capacity * 2, 16));
+        glCreateBuffers(1, &buffer);
+        glNamedBufferStorage(buffer, sizeof(GpuLightHeader) + capacity * sizeof(GpuPointLight), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        std::cout << "[Lights] Light buffer for " << capacity << " point lights ("
+            << (sizeof(GpuLightHeader) + capacity * sizeof(GpuPointLight)) / 1024 << " KB)\n";
+    }
+
+    const size_t bytes = sizeof(GpuLightHeader) + point_count * sizeof(GpuPointLight);
+    staging.resize(bytes);
+
+    GpuLightHeader header;
+    header.sun = { glm::vec4(sun.direction, 0.0f), glm::vec4(sun.ambient, 0.0f),
+        glm::vec4(sun.diffuse, 0.0f), glm::vec4(sun.specular, 0.0f) };
+    header.spot = { glm::vec4(spot.position, 1.0f), glm::vec4(spot.direction, 0.0f),
+        glm::vec4(spot.constant, spot.linear, spot.quadratic, 0.0f),
+        glm::vec4(spot.cutoff, spot.outerCutoff, 0.0f, 0.0f) };
+    header.counts = glm::uvec4(static_cast<GLuint>(point_count), 0u, 0u, 0u);
+    std::memcpy(staging.data(), &header, sizeof(header));
+
+    GpuPointLight* out = reinterpret_cast<GpuPointLight*>(staging.data() + sizeof(GpuLightHeader));
+    for (const PointLight& p : points) {
+        float radius = lightRadius(p.diffuse, p.constant, p.linear, p.quadratic);
+        *out++ = { glm::vec4(p.position, radius), glm::vec4(p.diffuse, 0.0f),
+            glm::vec4(p.constant, p.linear, p.quadratic, 0.0f) };
+    }
+
+    glNamedBufferSubData(buffer, 0, bytes, staging.data());
+}
+
+void LightBuffer::clear() {
+    if (buffer) glDeleteBuffers(1, &buffer);
+    buffer = 0;
+}
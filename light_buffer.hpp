@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+struct PointLight;
+struct SpotLight;
+struct DirectionalLight;
+
+// GPU mirrors of the app.hpp lights. Every member is a vec4, so the std140 and
+// std430 layouts coincide and match these structs without manual padding.
+// Must agree with the Lights block in tex.frag.
+struct GpuDirectionalLight {
+    glm::vec4 direction; // xyz
+    glm::vec4 ambient;   // rgb
+    glm::vec4 diffuse;   // rgb
+    glm::vec4 specular;  // rgb
+};
+
+struct GpuSpotLight {
+    glm::vec4 position;    // xyz
+    glm::vec4 direction;   // xyz
+    glm::vec4 attenuation; // constant, linear, quadratic, -
+    glm::vec4 cone;        // cos(cutoff), cos(outer cutoff), -, -
+};
+
+struct GpuPointLight {
+    glm::vec4 position;    // xyz, w = radius of influence
+    glm::vec4 diffuse;     // rgb
+    glm::vec4 attenuation; // constant, linear, quadratic, -
+};
+
+// Fixed part of the buffer; GpuPointLight[point_count] follows it
+struct GpuLightHeader {
+    GpuDirectionalLight sun;
+    GpuSpotLight spot;
+    glm::uvec4 counts; // x = point lights
+};
+
+static_assert(sizeof(GpuDirectionalLight) == 64, "std430 mirror");
+static_assert(sizeof(GpuSpotLight) == 64, "std430 mirror");
+static_assert(sizeof(GpuPointLight) == 48, "std430 mirror");
+static_assert(sizeof(GpuLightHeader) == 144, "std430 mirror");
+
+// Distance at which a light of the given attenuation and color drops below
+// 1/256 of full intensity; used to skip (and later cull) far lights
+float lightRadius(const glm::vec3& color, float constant, float linear, float quadratic);
+
+// All scene lights in one shader storage buffer, rewritten with a single
+// glNamedBufferSubData per frame. Any number of point lights; the buffer
+// grows (and is reallocated) only when the count exceeds its capacity.
+class LightBuffer {
+public:
+    static constexpr GLuint BINDING = 0; // layout(std430, binding = 0) in tex.frag
+
+    LightBuffer() = default;
+    ~LightBuffer() { clear(); }
+
+    LightBuffer(const LightBuffer&) = delete;
+    LightBuffer& operator=(const LightBuffer&) = delete;
+
+    void update(const DirectionalLight& sun, const SpotLight& spot, const std::vector<PointLight>& points);
+    void bind() const { glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BINDING, buffer); }
+    void clear();
+
+    GLuint id() const { return buffer; }
+    size_t pointCount() const { return point_count; }
+
+private:
+    GLuint buffer{ 0 };
+    size_t capacity{ 0 };     // point lights
+    size_t point_count{ 0 };
+    std::vector<unsigned char> staging; // reused every frame
+};
@@ -2,10 +2,15 @@
 // Author: JJ
 
 #include "app.hpp"
+#include "bench.hpp"
 #include <chrono>
 #include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--bench")
+        return runBenchmark(argc, argv);
 
-int main() {
     auto start = std::chrono::steady_clock::now(); // Start time measurement
 
     App app;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+
+// Read-only memory mapping of a whole file (zero-copy access for loaders)
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path& path) { open(path); }
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    bool is_open() const { return opened_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_{ nullptr };
+    size_t size_{ 0 };
+    bool opened_{ false };
+#ifdef _WIN32
+    void* file_handle_{ nullptr };
+    void* mapping_handle_{ nullptr };
+#endif
+};
+
+// Read-only file read at explicit offsets (pread / ReadFile at an offset),
+// for random access to small parts of a large file: unlike a mapping, the
+// pages read do not stay in the process. read() may run on several threads.
+class RandomAccessFile {
+public:
+    RandomAccessFile() = default;
+    ~RandomAccessFile() { close(); }
+
+    RandomAccessFile(const RandomAccessFile&) = delete;
+    RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    bool is_open() const { return opened_; }
+    uint64_t size() const { return size_; }
+
+    // Reads bytes [offset, offset + count) into out; false on error or past the end
+    bool read(uint64_t offset, void* out, size_t count) const;
+
+private:
+    uint64_t size_{ 0 };
+    bool opened_{ false };
+#ifdef _WIN32
+    void* file_handle_{ nullptr };
+#else
+    int fd_{ -1 };
+#endif
+};
@@ -61,7 +61,7 @@ cv::Point App::genLabyrinth(cv::Mat& map) {
     map.at<uchar>(rows - 2, cols - 2) = 'e'; // end
 
     std::cout << "[Maze]\n";
-    for (int j = 0; j < rows; ++j) {
+    for (int j = 0; j < rows && rows * cols <= 10000; ++j) { // large mazes would flood the console
         for (int i = 0; i < cols; ++i) {
             std::cout << static_cast<char>(map.at<uchar>(j, i));
         }
@@ -0,0 +1,390 @@
+#include "maze_mesher.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "vertex_packing.hpp"
+
+namespace {
+
+// Rows per band; bands are meshed independently (and in parallel), merging
+// never crosses a band boundary
+constexpr int BAND_ROWS = 128;
+
+// Every quad lies on the maze grid: corners at integer grid points (x, z,
+// counted from the outer corner of cell (0, 0)) on one of four heights, with
+// integer texture coordinates and an axis normal. The writers turn that into
+// vertices, the packed one by table lookups alone.
+enum Height : uint8_t { FLOOR_BOTTOM, FLOOR_TOP, WALL_BOTTOM, WALL_TOP };
+enum Normal : uint8_t { POS_X, NEG_X, POS_Y, NEG_Y, POS_Z, NEG_Z };
+
+struct GridCorner {
+    int x, z;
+    Height y;
+    int u, v;
+};
+
+const glm::vec3 AXIS_NORMALS[6] = { { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+    { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f } };
+
+// A quad as meshBand finds it, before it is turned into corners
+struct GridQuad {
+    enum Kind : uint8_t { HORIZONTAL, SIDE_X, SIDE_Z };
+    Kind kind;
+    Height y0, y1;                  // y1 unused by horizontal quads
+    bool positive;                  // normal along +axis (up for horizontal quads)
+    int x0, z0, x1, z1;
+};
+
+// First pass: records each band's quads, so the output can be allocated once
+// and the second pass only expands them
+struct QuadRecorder {
+    std::vector<GridQuad>& quads;
+
+    void horizontal(int x0, int z0, int x1, int z1, Height y, bool up) {
+        quads.push_back({ GridQuad::HORIZONTAL, y, y, up, x0, z0, x1, z1 });
+    }
+    void sideX(int x, int z0, int z1, Height y0, Height y1, bool positive) {
+        quads.push_back({ GridQuad::SIDE_X, y0, y1, positive, x, z0, x, z1 });
+    }
+    void sideZ(int z, int x0, int x1, Height y0, Height y1, bool positive) {
+        quads.push_back({ GridQuad::SIDE_Z, y0, y1, positive, x0, z, x1, z });
+    }
+};
+
+// Output vertex formats: the float vertex, or packed_vertex quantized to the
+// maze bounds exactly as packVertex would
+struct FloatVertices {
+    glm::vec2 origin;
+    float heights[4];
+
+    void operator()(const GridCorner& c, Normal n, vertex& out) const {
+        out = vertex(glm::vec3(origin.x + c.x, heights[c.y], origin.y + c.z), AXIS_NORMALS[n], glm::vec2(c.u, c.v));
+    }
+};
+
+struct PackedVertices {
+    std::vector<uint16_t> x, z;     // quantized position per grid line
+    uint16_t y[4];
+    std::vector<uint16_t> half;     // texture coordinate k as a half float
+    int16_t normals[6][2];
+
+    PackedVertices(int cols, int rows, const MazeMeshParams& params, const glm::vec3& bounds_min, const glm::vec3& bounds_max) {
+        const glm::vec3 inv_scale = packedPositionInvScale(bounds_min, bounds_max);
+        auto quantize = [&](const glm::vec3& p) {
+            packed_vertex v;
+            packPositionTexcoords(p, glm::vec2(0.0f), bounds_min, inv_scale, v);
+            return v;
+        };
+        x.resize(size_t(cols) + 1);
+        z.resize(size_t(rows) + 1);
+        for (int i = 0; i <= cols; ++i) x[i] = quantize(glm::vec3(params.origin.x + i, bounds_min.y, bounds_min.z)).position[0];
+        for (int j = 0; j <= rows; ++j) z[j] = quantize(glm::vec3(bounds_min.x, bounds_min.y, params.origin.y + j)).position[2];
+        const float heights[4] = { params.floor_bottom, params.floor_top, params.wall_bottom, params.wall_top };
+        for (int h = 0; h < 4; ++h) y[h] = quantize(glm::vec3(bounds_min.x, heights[h], bounds_min.z)).position[1];
+
+        half.resize(size_t(std::max(cols, rows)) + 1);
+        for (size_t k = 0; k < half.size(); ++k) {
+            packed_vertex v;
+            packPositionTexcoords(bounds_min, glm::vec2(float(k)), bounds_min, inv_scale, v);
+            half[k] = v.texcoords[0];
+        }
+        for (int n = 0; n < 6; ++n) packNormal(AXIS_NORMALS[n], normals[n]);
+    }
+
+    void operator()(const GridCorner& c, Normal n, packed_vertex& out) const {
+        out.position[0] = x[c.x];
+        out.position[1] = y[c.y];
+        out.position[2] = z[c.z];
+        out.position[3] = 0;
+        out.normal[0] = normals[n][0];
+        out.normal[1] = normals[n][1];
+        out.texcoords[0] = half[c.u];
+        out.texcoords[1] = half[c.v];
+    }
+};
+
+// Second pass: expands recorded quads into preallocated vertex/index ranges
+template <class Vertex, class Encode>
+struct QuadWriter {
+    Vertex* vertices;
+    GLuint* indices;
+    GLuint base; // index of the first vertex this writer owns
+    const Encode& encode;
+
+    // Corners in order around the quad; ccw when they already wind counter-clockwise seen along the normal
+    void add(const GridCorner (&c)[4], Normal n, bool ccw) {
+        for (int k = 0; k < 4; ++k) encode(c[k], n, *vertices++);
+
+        static const GLuint ccw_order[6] = { 0, 1, 2, 2, 3, 0 }, cw_order[6] = { 0, 2, 1, 0, 3, 2 };
+        const GLuint* order = ccw ? ccw_order : cw_order;
+        for (int k = 0; k < 6; ++k) *indices++ = base + order[k];
+        base += 4;
+    }
+};
+
+template <class Out>
+struct QuadBuilder {
+    Out& out;
+    bool rising_walls, rising_slab; // wall_top above wall_bottom, floor_top above floor_bottom
+
+    // Horizontal rectangle [x0, x1] x [z0, z1]; uv are the grid coordinates
+    void horizontal(int x0, int z0, int x1, int z1, Height y, bool up) {
+        out.add({ { x0, z0, y, x0, z0 }, { x1, z0, y, x1, z0 }, { x1, z1, y, x1, z1 }, { x0, z1, y, x0, z1 } },
+            up ? POS_Y : NEG_Y, !up);
+    }
+
+    // Vertical quad in the plane x = x (normal +-X) spanning [z0, z1] x [y0, y1]
+    void sideX(int x, int z0, int z1, Height y0, Height y1, bool positive) {
+        const bool rising = y0 == WALL_BOTTOM ? rising_walls : rising_slab;
+        out.add({ { x, z0, y0, 0, 0 }, { x, z1, y0, z1 - z0, 0 }, { x, z1, y1, z1 - z0, 1 }, { x, z0, y1, 0, 1 } },
+            positive ? POS_X : NEG_X, positive != rising);
+    }
+
+    // Vertical quad in the plane z = z (normal +-Z) spanning [x0, x1] x [y0, y1]
+    void sideZ(int z, int x0, int x1, Height y0, Height y1, bool positive) {
+        const bool rising = y0 == WALL_BOTTOM ? rising_walls : rising_slab;
+        out.add({ { x0, z, y0, 0, 0 }, { x1, z, y0, x1 - x0, 0 }, { x1, z, y1, x1 - x0, 1 }, { x0, z, y1, 0, 1 } },
+            positive ? POS_Z : NEG_Z, positive == rising);
+    }
+};
+
+template <class Out>
+void expandQuads(const std::vector<GridQuad>& quads, QuadBuilder<Out>& out) {
+    for (const GridQuad& q : quads) {
+        switch (q.kind) {
+        case GridQuad::HORIZONTAL: out.horizontal(q.x0, q.z0, q.x1, q.z1, q.y0, q.positive); break;
+        case GridQuad::SIDE_X: out.sideX(q.x0, q.z0, q.z1, q.y0, q.y1, q.positive); break;
+        case GridQuad::SIDE_Z: out.sideZ(q.z0, q.x0, q.x1, q.y0, q.y1, q.positive); break;
+        }
+    }
+}
+
+// Greedy rectangle cover of a row-major mask; emit(i, j, w, h) per rectangle.
+// The mask is consumed (cleared) as cells are covered.
+template <class Emit>
+size_t greedyRectangles(std::vector<unsigned char>& mask, int cols, int rows, Emit emit) {
+    size_t count = 0;
+    for (int j = 0; j < rows; ++j) {
+        unsigned char* row = &mask[size_t(j) * cols];
+        for (int i = 0; i < cols; ++i) {
+            if (!row[i]) continue;
+
+            int w = 1;
+            while (i + w < cols && row[i + w]) ++w;
+
+            int h = 1;
+            for (; j + h < rows; ++h) {
+                const unsigned char* next = &mask[size_t(j + h) * cols + i];
+                if (std::find(next, next + w, 0) != next + w) break;
+            }
+
+            for (int r = 0; r < h; ++r)
+                std::fill_n(&mask[size_t(j + r) * cols + i], w, 0);
+            emit(i, j, w, h);
+            ++count;
+            i += w - 1;
+        }
+    }
+    return count;
+}
+
+struct MazeGrid {
+    const unsigned char* cells;
+    int cols, rows;
+    size_t row_stride;
+
+    bool wall(int i, int j) const {
+        return i >= 0 && i < cols && j >= 0 && j < rows && cells[size_t(j) * row_stride + i] == '#';
+    }
+};
+
+// Meshes rows [j0, j1): wall tops and sides, exposed floor top
+template <class Out>
+MazeMeshStats meshBand(const MazeGrid& grid, int j0, int j1, Out& out) {
+    MazeMeshStats stats;
+    const int cols = grid.cols, rows = j1 - j0;
+
+    // walls of the band plus the rows either side, with an open border all
+    // round so neighbour tests need no bounds checks; rows -1 .. rows + 1
+    const size_t padded_cols = size_t(cols) + 2;
+    std::vector<unsigned char> padded(padded_cols * (rows + 3), 0);
+    auto paddedRow = [&](int j) { return &padded[size_t(j + 1) * padded_cols + 1]; };
+    for (int j = -1; j <= rows; ++j) {
+        unsigned char* row = paddedRow(j);
+        for (int i = 0; i < cols; ++i) row[i] = grid.wall(i, j0 + j);
+    }
+
+    // masks of wall cells and of floor cells not covered by a wall
+    std::vector<unsigned char> wall_mask(size_t(cols) * rows), floor_mask(size_t(cols) * rows);
+    for (int j = 0; j < rows; ++j) {
+        const unsigned char* row = paddedRow(j);
+        for (int i = 0; i < cols; ++i) {
+            wall_mask[size_t(j) * cols + i] = row[i];
+            floor_mask[size_t(j) * cols + i] = !row[i];
+        }
+    }
+
+    // === Wall tops ===
+    stats.wall_quads += greedyRectangles(wall_mask, cols, rows, [&](int i, int j, int w, int h) {
+        out.horizontal(i, j0 + j, i + w, j0 + j + h, WALL_TOP, true);
+    });
+
+    // === Wall sides ===
+    // +-Z faces lie in the plane between rows j and j +- 1 and merge along x;
+    // +-X faces lie between columns and merge along z. Both are found in one
+    // row-major pass: Z runs close within the row, X runs stay open per column.
+    std::vector<int> run_pos_x(cols, -1), run_neg_x(cols, -1);
+    auto closeX = [&](int i, int& start, int end, bool positive) {
+        out.sideX(positive ? i + 1 : i, j0 + start, j0 + end, WALL_BOTTOM, WALL_TOP, positive);
+        ++stats.wall_quads;
+        start = -1;
+    };
+
+    for (int j = 0; j <= rows; ++j) {
+        const int gj = j0 + j;
+        const unsigned char *above = paddedRow(j - 1), *row = paddedRow(j), *below = paddedRow(j + 1);
+        int run_pos_z = -1, run_neg_z = -1;
+        for (int i = 0; i <= cols; ++i) {
+            bool here = j < rows && row[i];
+
+            // X faces: exposed if the neighbouring column is open
+            if (i < cols) {
+                bool pos = here && !row[i + 1];
+                bool neg = here && !row[i - 1];
+                if (pos && run_pos_x[i] < 0) run_pos_x[i] = j;
+                if (!pos && run_pos_x[i] >= 0) closeX(i, run_pos_x[i], j, true);
+                if (neg && run_neg_x[i] < 0) run_neg_x[i] = j;
+                if (!neg && run_neg_x[i] >= 0) closeX(i, run_neg_x[i], j, false);
+            }
+
+            // Z faces of row j
+            bool pos = here && !below[i];
+            bool neg = here && !above[i];
+            if (pos && run_pos_z < 0) run_pos_z = i;
+            if (!pos && run_pos_z >= 0) {
+                out.sideZ(gj + 1, run_pos_z, i, WALL_BOTTOM, WALL_TOP, true);
+                ++stats.wall_quads;
+                run_pos_z = -1;
+            }
+            if (neg && run_neg_z < 0) run_neg_z = i;
+            if (!neg && run_neg_z >= 0) {
+                out.sideZ(gj, run_neg_z, i, WALL_BOTTOM, WALL_TOP, false);
+                ++stats.wall_quads;
+                run_neg_z = -1;
+            }
+        }
+    }
+
+    // === Exposed floor top ===
+    stats.floor_quads += greedyRectangles(floor_mask, cols, rows, [&](int i, int j, int w, int h) {
+        out.horizontal(i, j0 + j, i + w, j0 + j + h, FLOOR_TOP, true);
+    });
+    return stats;
+}
+
+// Floor bottom and the four slab edges
+template <class Out>
+void meshFloorSlab(int cols, int rows, Out& out) {
+    out.horizontal(0, 0, cols, rows, FLOOR_BOTTOM, false);
+    out.sideX(0, 0, rows, FLOOR_BOTTOM, FLOOR_TOP, false);
+    out.sideX(cols, 0, rows, FLOOR_BOTTOM, FLOOR_TOP, true);
+    out.sideZ(0, 0, cols, FLOOR_BOTTOM, FLOOR_TOP, false);
+    out.sideZ(rows, 0, cols, FLOOR_BOTTOM, FLOOR_TOP, true);
+}
+
+template <typename Fn>
+void runParallel(size_t count, unsigned thread_count, Fn fn) {
+    thread_count = static_cast<unsigned>(std::min<size_t>(thread_count, count));
+    if (thread_count <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+    // bands are interleaved across threads; wall density varies per region
+    std::vector<std::thread> workers;
+    workers.reserve(thread_count);
+    for (unsigned t = 0; t < thread_count; ++t)
+        workers.emplace_back([&, t] {
+            for (size_t i = t; i < count; i += thread_count) fn(i);
+        });
+    for (auto& w : workers)
+        w.join();
+}
+
+template <class Vertices, class Indices, class Encode>
+MazeMeshStats buildMesh(const unsigned char* cells, int cols, int rows, size_t row_stride,
+    const MazeMeshParams& params, const Encode& encode, Vertices& vertices, Indices& indices,
+    unsigned thread_count)
+{
+    MazeMeshStats stats;
+    vertices.clear();
+    indices.clear();
+    if (cols <= 0 || rows <= 0) return stats;
+
+    if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+    const MazeGrid grid{ cells, cols, rows, row_stride };
+    const size_t band_count = (rows + BAND_ROWS - 1) / BAND_ROWS;
+    auto bandRows = [&](size_t b, int& j0, int& j1) {
+        j0 = static_cast<int>(b) * BAND_ROWS;
+        j1 = std::min(rows, j0 + BAND_ROWS);
+    };
+
+    // 1. record quads per band, the floor slab last
+    std::vector<std::vector<GridQuad>> band_quads(band_count + 1);
+    std::vector<MazeMeshStats> band_stats(band_count);
+    runParallel(band_count, thread_count, [&](size_t b) {
+        int j0, j1;
+        bandRows(b, j0, j1);
+        band_quads[b].reserve(size_t(cols) * (j1 - j0)); // about one quad per cell in a carved maze
+        QuadRecorder recorder{ band_quads[b] };
+        band_stats[b] = meshBand(grid, j0, j1, recorder);
+    });
+    QuadRecorder slab{ band_quads[band_count] };
+    meshFloorSlab(cols, rows, slab);
+    stats.floor_quads = slab.quads.size();
+
+    // 2. allocate once, then every band expands its quads into its own range
+    std::vector<size_t> first_quad(band_count + 2, 0);
+    for (size_t b = 0; b <= band_count; ++b) first_quad[b + 1] = first_quad[b] + band_quads[b].size();
+    vertices.resize(first_quad.back() * 4);
+    indices.resize(first_quad.back() * 6);
+
+    runParallel(band_count + 1, thread_count, [&](size_t b) {
+        const size_t q = first_quad[b];
+        QuadWriter<typename Vertices::value_type, Encode> writer{ vertices.data() + q * 4, indices.data() + q * 6,
+            static_cast<GLuint>(q * 4), encode };
+        QuadBuilder<decltype(writer)> out{ writer, params.wall_top > params.wall_bottom,
+            params.floor_top > params.floor_bottom };
+        expandQuads(band_quads[b], out);
+        std::vector<GridQuad>().swap(band_quads[b]);
+    });
+
+    for (const MazeMeshStats& s : band_stats) {
+        stats.wall_quads += s.wall_quads;
+        stats.floor_quads += s.floor_quads;
+    }
+    return stats;
+}
+
+} // namespace
+
+void mazeMeshBounds(int cols, int rows, const MazeMeshParams& params, glm::vec3& bounds_min, glm::vec3& bounds_max) {
+    bounds_min = glm::vec3(params.origin.x, std::min(params.floor_bottom, params.wall_bottom), params.origin.y);
+    bounds_max = glm::vec3(params.origin.x + cols, std::max(params.floor_top, params.wall_top), params.origin.y + rows);
+}
+
+MazeMeshStats buildMazeMesh(const unsigned char* cells, int cols, int rows, size_t row_stride,
+    const MazeMeshParams& params, std::vector<vertex>& vertices, std::vector<GLuint>& indices, unsigned thread_count)
+{
+    const FloatVertices encode{ params.origin, { params.floor_bottom, params.floor_top, params.wall_bottom, params.wall_top } };
+    return buildMesh(cells, cols, rows, row_stride, params, encode, vertices, indices, thread_count);
+}
+
+MazeMeshStats buildMazeMesh(const unsigned char* cells, int cols, int rows, size_t row_stride,
+    const MazeMeshParams& params, MeshBuffer<packed_vertex>& vertices, MeshBuffer<GLuint>& indices, unsigned thread_count)
+{
+    glm::vec3 bounds_min, bounds_max;
+    mazeMeshBounds(cols, rows, params, bounds_min, bounds_max);
+    const PackedVertices encode(std::max(cols, 0), std::max(rows, 0), params, bounds_min, bounds_max);
+    return buildMesh(cells, cols, rows, row_stride, params, encode, vertices, indices, thread_count);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "assets.hpp"
+
+// Turns the maze grid into one static mesh of exposed faces only. Coplanar
+// neighbouring faces are greedily merged into larger quads, so the triangle
+// count follows the wall perimeter instead of the maze area.
+
+struct MazeMeshParams {
+    glm::vec2 origin{ 0.0f };       // world x/z of the outer corner of cell (0, 0)
+    float wall_bottom{ -68.0f };    // walls span [wall_bottom, wall_top] in y
+    float wall_top{ -66.0f };
+    float floor_bottom{ -68.025f }; // floor slab under the whole maze
+    float floor_top{ -67.975f };
+};
+
+// Vector storage that resize() leaves uninitialized, so a 4096^2 maze is not
+// zero-filled on one thread before the bands overwrite it in parallel
+template <class T>
+struct UninitializedAllocator : std::allocator<T> {
+    template <class U> struct rebind { using other = UninitializedAllocator<U>; };
+
+    UninitializedAllocator() = default;
+    template <class U> UninitializedAllocator(const UninitializedAllocator<U>&) {}
+
+    template <class U> void construct(U* p) { ::new (static_cast<void*>(p)) U; }
+    template <class U, class... Args> void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+template <class T>
+using MeshBuffer = std::vector<T, UninitializedAllocator<T>>;
+
+struct MazeMeshStats {
+    size_t wall_quads{ 0 };
+    size_t floor_quads{ 0 };
+};
+
+// cells is row-major (row = z, column = x), '#' marks a wall cell.
+// Top and side quads get per-cell texture coordinates, sides span v = 0..1
+// over their height, matching the unit cubes the maze used to be drawn with.
+// Bands of rows are meshed on thread_count threads (0 = all cores).
+MazeMeshStats buildMazeMesh(const unsigned char* cells, int cols, int rows, size_t row_stride,
+    const MazeMeshParams& params, std::vector<vertex>& vertices, std::vector<GLuint>& indices,
+    unsigned thread_count = 0);
+
+// The same mesh written straight in the 16-byte packed_vertex layout
+// (VertexFormat::Packed), positions quantized to mazeMeshBounds: a quarter
+// of the float stream, and nothing left to convert before the upload. Each
+// band writes its own range of the uninitialized buffers.
+MazeMeshStats buildMazeMesh(const unsigned char* cells, int cols, int rows, size_t row_stride,
+    const MazeMeshParams& params, MeshBuffer<packed_vertex>& vertices, MeshBuffer<GLuint>& indices,
+    unsigned thread_count = 0);
+
+// Box around everything buildMazeMesh emits
+void mazeMeshBounds(int cols, int rows, const MazeMeshParams& params, glm::vec3& bounds_min, glm::vec3& bounds_max);
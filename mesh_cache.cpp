@@ -0,0 +1,193 @@
+#include "mesh_cache.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+
+#include "Mesh.hpp"
+
+namespace {
+
+const char MAGIC[8] = { 'M', 'E', 'S', 'H', 'B', 'I', 'N', '\0' };
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t h = 0xcbf29ce484222325ull) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// 8 bytes per step; much faster than byte-wise FNV on multi-MB payloads
+uint64_t payloadHash(const char* data, size_t size) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ size;
+    size_t words = size / 8;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t w;
+        std::memcpy(&w, data + i * 8, 8);
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    return fnv1a(data + words * 8, size % 8, h);
+}
+
+struct SourceKey {
+    uint64_t path_hash;
+    uint64_t size;
+    int64_t mtime;
+};
+
+bool sourceKey(const std::filesystem::path& source, SourceKey& key) {
+    std::error_code ec;
+    std::filesystem::path abs = std::filesystem::absolute(source, ec);
+    if (ec) return false;
+    std::string path_str = abs.generic_string();
+    key.path_hash = fnv1a(path_str.data(), path_str.size());
+    key.size = std::filesystem::file_size(source, ec);
+    if (ec) return false;
+    key.mtime = static_cast<int64_t>(std::filesystem::last_write_time(source, ec).time_since_epoch().count());
+    return !ec;
+}
+
+bool sameRatios(const MeshBinHeader& h, const std::vector<float>& lod_ratios) {
+    if (lod_ratios.size() > MESHBIN_MAX_LODS || h.lod_ratio_count != lod_ratios.size()) return false;
+    for (size_t i = 0; i < lod_ratios.size(); ++i)
+        if (h.lod_ratios[i] != lod_ratios[i]) return false;
+    return true;
+}
+
+} // namespace
+
+std::filesystem::path meshCachePath(const std::filesystem::path& source) {
+    std::filesystem::path p = source;
+    p += ".meshbin";
+    return p;
+}
+
+bool loadMeshCache(const std::filesystem::path& source, uint32_t flags, const std::vector<float>& lod_ratios,
+    MeshBinView& out) {
+    SourceKey key;
+    if (!sourceKey(source, key)) return false;
+
+    std::filesystem::path cache = meshCachePath(source);
+    if (!std::filesystem::exists(cache)) return false;
+
+    if (!out.file.open(cache) || out.file.size() < sizeof(MeshBinHeader)) {
+        std::cerr << "[MeshCache] Unreadable cache: " << cache << "\n";
+        return false;
+    }
+
+    const char* base = out.file.data();
+    const MeshBinHeader* h = reinterpret_cast<const MeshBinHeader*>(base);
+
+    if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->version != MESHBIN_VERSION
+        || h->vertex_stride != sizeof(vertex)) {
+        std::cout << "[MeshCache] Outdated format: " << cache << "\n";
+        return false;
+    }
+    if (h->source_path_hash != key.path_hash || h->source_size != key.size || h->source_mtime != key.mtime
+        || h->flags != flags || !sameRatios(*h, lod_ratios)) {
+        std::cout << "[MeshCache] Stale cache: " << cache << "\n";
+        return false;
+    }
+
+    size_t index_size = (h->index_type == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+    uint64_t vertex_bytes = uint64_t(h->vertex_count) * sizeof(vertex);
+    uint64_t index_bytes = uint64_t(h->index_count) * index_size;
+    bool layout_ok = (h->index_type == GL_UNSIGNED_SHORT || h->index_type == GL_UNSIGNED_INT)
+        && h->vertex_offset == sizeof(MeshBinHeader)
+        && h->index_offset == h->vertex_offset + vertex_bytes
+        && h->index_offset + index_bytes == out.file.size()
+        && h->lod_count >= 1 && h->lod_count <= MESHBIN_MAX_LODS;
+    for (uint32_t i = 0; layout_ok && i < h->lod_count; ++i)
+        layout_ok = uint64_t(h->lods[i].first_index) + h->lods[i].index_count <= h->index_count;
+    if (!layout_ok || payloadHash(base + h->vertex_offset, vertex_bytes + index_bytes) != h->payload_hash) {
+        std::cerr << "[MeshCache] Corrupt cache: " << cache << "\n";
+        return false;
+    }
+
+    out.header = h;
+    out.vertices = reinterpret_cast<const vertex*>(base + h->vertex_offset);
+    out.indices = base + h->index_offset;
+    return true;
+}
+
+bool saveMeshCache(const std::filesystem::path& source, uint32_t flags, const std::vector<float>& lod_ratios,
+    const std::vector<vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<MeshLod>& lods,
+    const glm::vec3& bounds_min, const glm::vec3& bounds_max)
+{
+    if (lods.empty() || lods.size() > MESHBIN_MAX_LODS || lod_ratios.size() > MESHBIN_MAX_LODS) return false;
+
+    SourceKey key;
+    if (!sourceKey(source, key)) return false;
+
+    // same index width the Mesh uploads
+    std::vector<char> index_bytes;
+    GLenum index_type;
+    if (Mesh::fitsShortIndices(vertices.size())) {
+        index_type = GL_UNSIGNED_SHORT;
+        index_bytes.resize(indices.size() * sizeof(GLushort));
+        GLushort* dst = reinterpret_cast<GLushort*>(index_bytes.data());
+        for (GLuint i : indices) *dst++ = static_cast<GLushort>(i);
+    }
+    else {
+        index_type = GL_UNSIGNED_INT;
+        index_bytes.resize(indices.size() * sizeof(GLuint));
+        std::memcpy(index_bytes.data(), indices.data(), index_bytes.size());
+    }
+
+    MeshBinHeader h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = MESHBIN_VERSION;
+    h.vertex_stride = sizeof(vertex);
+    h.source_path_hash = key.path_hash;
+    h.source_size = key.size;
+    h.source_mtime = key.mtime;
+    h.vertex_count = static_cast<uint32_t>(vertices.size());
+    h.index_count = static_cast<uint32_t>(indices.size());
+    h.index_type = index_type;
+    h.flags = flags;
+    for (int i = 0; i < 3; ++i) {
+        h.bounds_min[i] = bounds_min[i];
+        h.bounds_max[i] = bounds_max[i];
+    }
+    h.lod_ratio_count = static_cast<uint32_t>(lod_ratios.size());
+    for (size_t i = 0; i < lod_ratios.size(); ++i) h.lod_ratios[i] = lod_ratios[i];
+    h.lod_count = static_cast<uint32_t>(lods.size());
+    for (size_t i = 0; i < lods.size(); ++i)
+        h.lods[i] = { lods[i].first_index, static_cast<uint32_t>(lods[i].index_count), lods[i].error };
+    h.vertex_offset = sizeof(MeshBinHeader);
+    h.index_offset = h.vertex_offset + vertices.size() * sizeof(vertex);
+
+    size_t vertex_bytes = vertices.size() * sizeof(vertex);
+    std::vector<char> payload(vertex_bytes + index_bytes.size());
+    std::memcpy(payload.data(), vertices.data(), vertex_bytes);
+    std::memcpy(payload.data() + vertex_bytes, index_bytes.data(), index_bytes.size());
+    h.payload_hash = payloadHash(payload.data(), payload.size());
+
+    // write to a temporary file first so a crash never leaves a half-written cache
+    std::filesystem::path cache = meshCachePath(source);
+    std::filesystem::path tmp = cache;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "[MeshCache] Cannot write: " << tmp << "\n";
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(payload.data(), payload.size());
+        if (!out) return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, cache, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
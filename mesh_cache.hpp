@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "assets.hpp"
+#include "mapped_file.hpp"
+
+struct MeshLod;
+
+// Binary mesh cache (.meshbin) written next to the source model.
+// Stores the final interleaved vertex stream, the GPU-ready index stream
+// (16 or 32 bit, all LOD ranges concatenated), the LOD table and the
+// bounds, so a warm start can upload straight from
+// the memory-mapped file.
+
+#define MESHBIN_VERSION 2
+
+#define MESHBIN_MAX_LODS 8
+
+#define MESHBIN_FLAG_OPTIMIZED 0x1  // vertex cache / overdraw / fetch reordering applied
+
+struct MeshBinLod {
+    uint32_t first_index;
+    uint32_t index_count;
+    float error;
+};
+
+struct MeshBinHeader {
+    char magic[8];              // "MESHBIN\0"
+    uint32_t version;
+    uint32_t vertex_stride;     // sizeof(vertex) at write time
+    uint64_t source_path_hash;  // key: source path, size and mtime
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t index_type;        // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t flags;             // MESHBIN_FLAG_* the streams were built with
+    float bounds_min[3];
+    float bounds_max[3];
+    uint32_t lod_ratio_count;   // LOD ratios the chain was requested with
+    float lod_ratios[MESHBIN_MAX_LODS];
+    uint32_t lod_count;         // levels actually built; lods[0] is the full mesh
+    MeshBinLod lods[MESHBIN_MAX_LODS];
+    uint64_t vertex_offset;     // byte offsets from the file start
+    uint64_t index_offset;
+    uint64_t payload_hash;      // detects truncated/corrupt payloads
+};
+
+// Read-only view of a validated cache file; pointers stay valid while it lives
+struct MeshBinView {
+    MappedFile file;
+    const MeshBinHeader* header{ nullptr };
+    const vertex* vertices{ nullptr };
+    const void* indices{ nullptr };
+};
+
+std::filesystem::path meshCachePath(const std::filesystem::path& source);
+
+// Maps and validates the cache for source; false if missing, stale, built
+// with different flags or LOD ratios, or corrupt
+bool loadMeshCache(const std::filesystem::path& source, uint32_t flags, const std::vector<float>& lod_ratios,
+    MeshBinView& out);
+
+// Writes the cache for source; indices are stored in the width Mesh uploads
+bool saveMeshCache(const std::filesystem::path& source, uint32_t flags, const std::vector<float>& lod_ratios,
+    const std::vector<vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<MeshLod>& lods,
+    const glm::vec3& bounds_min, const glm::vec3& bounds_max);
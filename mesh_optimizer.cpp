@@ -0,0 +1,224 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include <glm/glm.hpp>
+
+namespace {
+
+// Post-transform cache size Tipsify optimizes for (FIFO, common on current GPUs)
+constexpr unsigned TIPSIFY_CACHE_SIZE = 16;
+
+// Tipsify's next fanning vertex: prefer a vertex from the last fan that is
+// still in the cache after emitting all its remaining triangles, otherwise
+// backtrack through the dead-end stack, otherwise scan forward
+long nextFanningVertex(const std::vector<GLuint>& candidates, const std::vector<unsigned>& live,
+    const std::vector<size_t>& cache_time, size_t timestamp,
+    std::vector<GLuint>& dead_end, size_t& cursor)
+{
+    long best = -1;
+    long best_priority = -1;
+    for (GLuint v : candidates) {
+        if (live[v] == 0) continue;
+        long priority = 0;
+        // still in cache after its fan is emitted (2 new vertices per triangle)?
+        if (timestamp - cache_time[v] + 2 * live[v] <= TIPSIFY_CACHE_SIZE)
+            priority = static_cast<long>(timestamp - cache_time[v]);
+        if (priority > best_priority) {
+            best_priority = priority;
+            best = v;
+        }
+    }
+    if (best >= 0) return best;
+
+    while (!dead_end.empty()) {
+        GLuint v = dead_end.back();
+        dead_end.pop_back();
+        if (live[v] > 0) return v;
+    }
+    while (cursor < live.size()) {
+        if (live[cursor] > 0) return static_cast<long>(cursor);
+        ++cursor;
+    }
+    return -1;
+}
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const std::vector<GLuint>& indices, size_t vertex_count, unsigned cache_size)
+{
+    VertexCacheStats stats;
+    if (indices.size() < 3 || vertex_count == 0) return stats;
+
+    // FIFO: a vertex is in the cache if it was pushed less than cache_size misses ago
+    std::vector<size_t> pushed_at(vertex_count, 0);
+    size_t misses = 0;
+    for (GLuint i : indices) {
+        if (pushed_at[i] == 0 || misses - pushed_at[i] >= cache_size) {
+            ++misses;
+            pushed_at[i] = misses;
+        }
+    }
+
+    size_t used = 0;
+    std::vector<char> seen(vertex_count, 0);
+    for (GLuint i : indices)
+        if (!seen[i]) { seen[i] = 1; ++used; }
+
+    stats.acmr = float(misses) / float(indices.size() / 3);
+    stats.atvr = float(misses) / float(used);
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<GLuint>& indices, size_t vertex_count)
+{
+    const size_t tri_count = indices.size() / 3;
+    if (tri_count == 0 || vertex_count == 0) return;
+
+    // vertex -> triangle adjacency (CSR layout)
+    std::vector<unsigned> live(vertex_count, 0);
+    for (GLuint i : indices) ++live[i];
+
+    std::vector<unsigned> offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; ++v) offsets[v + 1] = offsets[v] + live[v];
+
+    std::vector<unsigned> adjacency(indices.size());
+    {
+        std::vector<unsigned> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < tri_count; ++t)
+            for (int k = 0; k < 3; ++k)
+                adjacency[fill[indices[t * 3 + k]]++] = static_cast<unsigned>(t);
+    }
+
+    // Tipsify (Sander et al. 2007): emit all remaining triangles around a
+    // fanning vertex, then pick the next fan from what is still cached
+    std::vector<size_t> cache_time(vertex_count, 0);
+    std::vector<char> emitted(tri_count, 0);
+    std::vector<GLuint> dead_end, candidates;
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+
+    size_t timestamp = TIPSIFY_CACHE_SIZE + 1;
+    size_t cursor = 0;
+    long fan = 0;
+    while (live[fan] == 0) ++fan; // first referenced vertex
+
+    while (fan >= 0) {
+        candidates.clear();
+        for (unsigned a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+            unsigned t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+
+            for (int k = 0; k < 3; ++k) {
+                GLuint v = indices[t * 3 + k];
+                result.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (timestamp - cache_time[v] > TIPSIFY_CACHE_SIZE)
+                    cache_time[v] = timestamp++;
+            }
+        }
+        fan = nextFanningVertex(candidates, live, cache_time, timestamp, dead_end, cursor);
+    }
+
+    indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<vertex>& vertices, float threshold)
+{
+    const size_t tri_count = indices.size() / 3;
+    if (tri_count < 2) return;
+
+    // 1. split into clusters where the FIFO cache was effectively flushed
+    //    (a triangle with 3 misses) and the running ACMR is within threshold
+    const unsigned cache_size = 16;
+    std::vector<size_t> pushed_at(vertices.size(), 0);
+    std::vector<size_t> cluster_start{ 0 };
+    size_t misses = 0, cluster_misses = 0;
+    const float target_acmr = analyzeVertexCache(indices, vertices.size(), cache_size).acmr * threshold;
+
+    for (size_t t = 0; t < tri_count; ++t) {
+        int tri_misses = 0;
+        for (int k = 0; k < 3; ++k) {
+            GLuint v = indices[t * 3 + k];
+            if (pushed_at[v] == 0 || misses - pushed_at[v] >= cache_size) {
+                ++misses;
+                ++tri_misses;
+                pushed_at[v] = misses;
+            }
+        }
+        size_t cluster_tris = t - cluster_start.back();
+        if (tri_misses == 3 && cluster_tris > 0 && float(cluster_misses) / cluster_tris <= target_acmr) {
+            cluster_start.push_back(t);
+            cluster_misses = 0;
+        }
+        cluster_misses += tri_misses;
+    }
+    cluster_start.push_back(tri_count);
+
+    const size_t cluster_count = cluster_start.size() - 1;
+    if (cluster_count < 2) return;
+
+    // 2. sort clusters by how much they face away from the mesh centroid
+    glm::vec3 mesh_center(0.0f);
+    for (const vertex& v : vertices) mesh_center += v.position;
+    mesh_center /= float(vertices.size());
+
+    std::vector<float> sort_key(cluster_count);
+    for (size_t c = 0; c < cluster_count; ++c) {
+        glm::vec3 center(0.0f), normal(0.0f);
+        for (size_t t = cluster_start[c]; t < cluster_start[c + 1]; ++t) {
+            const glm::vec3& p0 = vertices[indices[t * 3]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            center += p0 + p1 + p2;
+            normal += glm::cross(p1 - p0, p2 - p0); // area weighted
+        }
+        center /= float((cluster_start[c + 1] - cluster_start[c]) * 3);
+        float nl = glm::length(normal);
+        sort_key[c] = (nl > 0.0f) ? glm::dot(center - mesh_center, normal) / nl : 0.0f;
+    }
+
+    std::vector<size_t> order(cluster_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sort_key[a] > sort_key[b]; });
+
+    std::vector<GLuint> result;
+    result.reserve(indices.size());
+    for (size_t c : order)
+        result.insert(result.end(), indices.begin() + cluster_start[c] * 3, indices.begin() + cluster_start[c + 1] * 3);
+    indices.swap(result);
+}
+
+void optimizeVertexFetch(std::vector<vertex>& vertices, std::vector<GLuint>& indices)
+{
+    const GLuint UNUSED = 0xFFFFFFFFu;
+    std::vector<GLuint> remap(vertices.size(), UNUSED);
+    std::vector<vertex> result;
+    result.reserve(vertices.size());
+
+    for (GLuint& i : indices) {
+        if (remap[i] == UNUSED) {
+            remap[i] = static_cast<GLuint>(result.size());
+            result.push_back(vertices[i]);
+        }
+        i = remap[i];
+    }
+    vertices.swap(result);
+}
+
+void optimizeMesh(std::vector<vertex>& vertices, std::vector<GLuint>& indices,
+    VertexCacheStats* before, VertexCacheStats* after)
+{
+    if (before) *before = analyzeVertexCache(indices, vertices.size());
+
+    optimizeVertexCache(indices, vertices.size());
+    optimizeOverdraw(indices, vertices);
+    optimizeVertexFetch(vertices, indices);
+
+    if (after) *after = analyzeVertexCache(indices, vertices.size());
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "assets.hpp"
+
+// Triangle/vertex reordering for the post-transform vertex cache, overdraw
+// and vertex fetch locality. All passes work on GL_TRIANGLES index lists.
+
+struct VertexCacheStats {
+    float acmr{ 0.0f }; // average cache miss ratio: transformed vertices per triangle
+    float atvr{ 0.0f }; // average transform to vertex ratio: 1.0 is optimal
+};
+
+// Simulates a FIFO post-transform cache of the given size
+VertexCacheStats analyzeVertexCache(const std::vector<GLuint>& indices, size_t vertex_count, unsigned cache_size = 16);
+
+// Tipsify vertex cache optimisation: linear time, no per-triangle scoring
+void optimizeVertexCache(std::vector<GLuint>& indices, size_t vertex_count);
+
+// Tipsify-style overdraw pass: splits the cache-optimized order into
+// clusters at cache-flush points and sorts clusters outside-in, so nearer
+// geometry tends to be drawn first. threshold bounds the allowed ACMR loss.
+void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<vertex>& vertices, float threshold = 1.05f);
+
+// Renumbers vertices in first-use order; unreferenced vertices are dropped
+void optimizeVertexFetch(std::vector<vertex>& vertices, std::vector<GLuint>& indices);
+
+// Runs all three passes and returns the cache stats before and after
+void optimizeMesh(std::vector<vertex>& vertices, std::vector<GLuint>& indices,
+    VertexCacheStats* before = nullptr, VertexCacheStats* after = nullptr);
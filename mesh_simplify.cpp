@@ -0,0 +1,265 @@
+#include "mesh_simplify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+namespace {
+
+// Symmetric 4x4 error quadric stored as its 10 unique coefficients
+struct Quadric {
+    double a2{ 0 }, ab{ 0 }, ac{ 0 }, ad{ 0 };
+    double b2{ 0 }, bc{ 0 }, bd{ 0 };
+    double c2{ 0 }, cd{ 0 };
+    double d2{ 0 };
+
+    static Quadric fromPlane(const glm::vec3& n, double d, double w) {
+        Quadric q;
+        q.a2 = w * n.x * n.x; q.ab = w * n.x * n.y; q.ac = w * n.x * n.z; q.ad = w * n.x * d;
+        q.b2 = w * n.y * n.y; q.bc = w * n.y * n.z; q.bd = w * n.y * d;
+        q.c2 = w * n.z * n.z; q.cd = w * n.z * d;
+        q.d2 = w * d * d;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+        a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+        b2 += o.b2; bc += o.bc; bd += o.bd;
+        c2 += o.c2; cd += o.cd;
+        d2 += o.d2;
+        return *this;
+    }
+
+    double evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+            + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+            + c2 * z * z + 2 * cd * z
+            + d2;
+    }
+};
+
+struct Collapse {
+    float cost;
+    GLuint from, to;          // wedge (vertex) indices
+    uint32_t from_stamp, to_stamp;
+    bool operator>(const Collapse& o) const { return cost > o.cost; }
+};
+
+struct PositionKey {
+    uint32_t x, y, z;
+    bool operator==(const PositionKey& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct PositionKeyHash {
+    size_t operator()(const PositionKey& k) const {
+        uint64_t h = k.x * 0x9E3779B97F4A7C15ull;
+        h ^= k.y * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+        h ^= k.z * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h);
+    }
+};
+
+PositionKey positionKey(const glm::vec3& p) {
+    PositionKey k;
+    std::memcpy(&k.x, &p.x, 4);
+    std::memcpy(&k.y, &p.y, 4);
+    std::memcpy(&k.z, &p.z, 4);
+    return k;
+}
+
+} // namespace
+
+std::vector<GLuint> simplifyMesh(const std::vector<vertex>& vertices, const std::vector<GLuint>& indices,
+    size_t target_index_count, float* out_error)
+{
+    if (out_error) *out_error = 0.0f;
+    if (indices.size() <= target_index_count || vertices.empty()) return indices;
+
+    const size_t vertex_count = vertices.size();
+    const size_t tri_count = indices.size() / 3;
+
+    // 1. weld wedges (vertices split by UV/normal) into positions
+    std::vector<GLuint> pos_of(vertex_count);
+    std::vector<unsigned> wedge_count;
+    {
+        std::unordered_map<PositionKey, GLuint, PositionKeyHash> lookup;
+        lookup.reserve(vertex_count);
+        for (size_t v = 0; v < vertex_count; ++v) {
+            auto [it, inserted] = lookup.emplace(positionKey(vertices[v].position), static_cast<GLuint>(wedge_count.size()));
+            if (inserted) wedge_count.push_back(0);
+            pos_of[v] = it->second;
+            ++wedge_count[it->second];
+        }
+    }
+    const size_t pos_count = wedge_count.size();
+
+    // 2. lock seams (several wedges) and open borders (edges with one triangle)
+    std::vector<char> locked(pos_count, 0);
+    for (size_t p = 0; p < pos_count; ++p)
+        if (wedge_count[p] > 1) locked[p] = 1;
+    {
+        std::unordered_map<uint64_t, int> edge_use;
+        edge_use.reserve(indices.size());
+        for (size_t t = 0; t < tri_count; ++t)
+            for (int k = 0; k < 3; ++k) {
+                uint64_t a = pos_of[indices[t * 3 + k]], b = pos_of[indices[t * 3 + (k + 1) % 3]];
+                if (a > b) std::swap(a, b);
+                ++edge_use[(a << 32) | b];
+            }
+        for (const auto& [edge, count] : edge_use)
+            if (count == 1) {
+                locked[edge >> 32] = 1;
+                locked[edge & 0xFFFFFFFFu] = 1;
+            }
+    }
+
+    // 3. plane quadrics, area weighted; extent normalizes the reported error
+    glm::vec3 lo = vertices[0].position, hi = lo;
+    for (const vertex& v : vertices) {
+        lo = glm::min(lo, v.position);
+        hi = glm::max(hi, v.position);
+    }
+    const double extent = std::max(1e-12, double(glm::length(hi - lo)));
+
+    std::vector<Quadric> quadric(pos_count);
+    for (size_t t = 0; t < tri_count; ++t) {
+        const glm::vec3& p0 = vertices[indices[t * 3]].position;
+        const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+        const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        float len = glm::length(n);
+        if (len <= 0.0f) continue;
+        n /= len;
+        Quadric q = Quadric::fromPlane(n, -double(glm::dot(n, p0)), len * 0.5);
+        for (int k = 0; k < 3; ++k) quadric[pos_of[indices[t * 3 + k]]] += q;
+    }
+
+    // 4. working triangle list + wedge -> triangle adjacency
+    std::vector<GLuint> tris(indices);
+    std::vector<char> tri_alive(tri_count, 1);
+    std::vector<std::vector<unsigned>> adjacency(vertex_count);
+    for (size_t t = 0; t < tri_count; ++t)
+        for (int k = 0; k < 3; ++k) adjacency[tris[t * 3 + k]].push_back(static_cast<unsigned>(t));
+
+    std::vector<char> wedge_alive(vertex_count, 1);
+    std::vector<uint32_t> stamp(pos_count, 0);
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+    auto pushCollapse = [&](GLuint from, GLuint to) {
+        GLuint pf = pos_of[from], pt = pos_of[to];
+        if (locked[pf] || pf == pt) return;
+        Quadric q = quadric[pf];
+        q += quadric[pt];
+        heap.push({ static_cast<float>(std::max(0.0, q.evaluate(vertices[to].position))), from, to, stamp[pf], stamp[pt] });
+    };
+
+    for (size_t t = 0; t < tri_count; ++t)
+        for (int k = 0; k < 3; ++k) {
+            GLuint a = tris[t * 3 + k], b = tris[t * 3 + (k + 1) % 3];
+            pushCollapse(a, b);
+            pushCollapse(b, a);
+        }
+
+    // 5. greedy collapses, cheapest first
+    size_t alive_tris = tri_count;
+    const size_t target_tris = target_index_count / 3;
+    double max_cost = 0.0;
+    std::vector<GLuint> ring_from, ring_to;
+
+    auto collectRing = [&](GLuint w, std::vector<GLuint>& ring) {
+        ring.clear();
+        for (unsigned t : adjacency[w]) {
+            if (!tri_alive[t]) continue;
+            for (int k = 0; k < 3; ++k) ring.push_back(pos_of[tris[t * 3 + k]]);
+        }
+        std::sort(ring.begin(), ring.end());
+        ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+    };
+
+    while (alive_tris > target_tris && !heap.empty()) {
+        Collapse c = heap.top();
+        heap.pop();
+
+        GLuint u = c.from, v = c.to;
+        GLuint pu = pos_of[u], pv = pos_of[v];
+        if (!wedge_alive[u] || !wedge_alive[v]) continue;
+        if (stamp[pu] != c.from_stamp || stamp[pv] != c.to_stamp) continue;
+
+        // link condition: u and v may share only the two vertices opposite their edge
+        collectRing(u, ring_from);
+        collectRing(v, ring_to);
+        size_t shared = 0;
+        for (size_t i = 0, j = 0; i < ring_from.size() && j < ring_to.size();) {
+            if (ring_from[i] < ring_to[j]) ++i;
+            else if (ring_from[i] > ring_to[j]) ++j;
+            else { ++shared; ++i; ++j; }
+        }
+        if (shared > 4) continue; // u and v themselves + two opposite vertices
+
+        // reject collapses that flip or degenerate a surviving triangle
+        const glm::vec3& target = vertices[v].position;
+        bool flips = false;
+        for (unsigned t : adjacency[u]) {
+            if (!tri_alive[t]) continue;
+            const GLuint* tri = &tris[t * 3];
+            if (tri[0] == v || tri[1] == v || tri[2] == v) continue;
+            glm::vec3 p[3], q[3];
+            for (int k = 0; k < 3; ++k) {
+                p[k] = vertices[tri[k]].position;
+                q[k] = (tri[k] == u) ? target : p[k];
+            }
+            glm::vec3 n0 = glm::cross(p[1] - p[0], p[2] - p[0]);
+            glm::vec3 n1 = glm::cross(q[1] - q[0], q[2] - q[0]);
+            if (glm::dot(n0, n1) <= 0.0f) {
+                flips = true;
+                break;
+            }
+        }
+        if (flips) continue;
+
+        // collapse u onto v
+        for (unsigned t : adjacency[u]) {
+            if (!tri_alive[t]) continue;
+            GLuint* tri = &tris[t * 3];
+            if (tri[0] == v || tri[1] == v || tri[2] == v) {
+                tri_alive[t] = 0;
+                --alive_tris;
+                continue;
+            }
+            for (int k = 0; k < 3; ++k)
+                if (tri[k] == u) tri[k] = v;
+            adjacency[v].push_back(t);
+        }
+        adjacency[u].clear();
+        wedge_alive[u] = 0;
+        quadric[pv] += quadric[pu];
+        ++stamp[pu];
+        ++stamp[pv];
+        max_cost = std::max(max_cost, double(c.cost));
+
+        // drop dead triangles from v's list and requeue its edges
+        auto& adj = adjacency[v];
+        adj.erase(std::remove_if(adj.begin(), adj.end(), [&](unsigned t) { return !tri_alive[t]; }), adj.end());
+        for (unsigned t : adj)
+            for (int k = 0; k < 3; ++k) {
+                GLuint w = tris[t * 3 + k];
+                if (w == v) continue;
+                pushCollapse(w, v);
+                pushCollapse(v, w);
+            }
+    }
+
+    std::vector<GLuint> result;
+    result.reserve(alive_tris * 3);
+    for (size_t t = 0; t < tri_count; ++t)
+        if (tri_alive[t]) result.insert(result.end(), &tris[t * 3], &tris[t * 3] + 3);
+
+    if (out_error) *out_error = static_cast<float>(std::sqrt(max_cost) / (extent * extent));
+    return result;
+}
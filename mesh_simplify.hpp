@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include "assets.hpp"
+
+// Quadric error metric (Garland-Heckbert) simplification by half-edge
+// collapse. Vertices are never moved or created, so every LOD index list
+// indexes the original vertex buffer and all levels can share one VBO.
+// Mesh borders and UV/normal seams are kept in place.
+
+// Returns the simplified GL_TRIANGLES index list with at most
+// target_index_count indices (or as close as the locked features allow).
+// out_error receives the largest quadric error of an accepted collapse,
+// relative to the mesh extent.
+std::vector<GLuint> simplifyMesh(const std::vector<vertex>& vertices, const std::vector<GLuint>& indices,
+    size_t target_index_count, float* out_error = nullptr);
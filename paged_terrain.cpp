@@ -0,0 +1,443 @@
+#include "paged_terrain.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "terrain_mesher.hpp"
+
+static constexpr char MAGIC[8] = { 'H', 'T', 'I', 'L', 'E', 'S', 0, 0 };
+
+// 16-bit patch indices limit a tile to 128 cells
+static bool validTileCells(uint32_t cells) { return cells >= 8 && cells <= 128 && (cells & (cells - 1)) == 0; }
+
+static uint32_t tileCount(int pixels, int cells) { return uint32_t(std::max(1, (pixels - 2) / cells + 1)); }
+
+bool HeightTiles::open(const std::filesystem::path& file) {
+    close();
+    if (!file_.open(file) || !file_.read(0, &header_, sizeof(HeightTilesHeader))) {
+        file_.close();
+        return false;
+    }
+    const HeightTilesHeader* h = &header_;
+    const bool valid = std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) == 0 && h->version == HEIGHT_TILES_VERSION
+        && validTileCells(h->tile_cells) && h->width >= 2 && h->height >= 2
+        && h->tiles_x == tileCount(int(h->width), int(h->tile_cells))
+        && h->tiles_z == tileCount(int(h->height), int(h->tile_cells))
+        && h->tile_offset >= sizeof(HeightTilesHeader);
+    const size_t tile_bytes = size_t(h->tile_cells + 3) * (h->tile_cells + 3);
+    if (!valid || file_.size() < h->tile_offset + size_t(h->tiles_x) * h->tiles_z * tile_bytes) {
+        std::cerr << "[Terrain] Invalid tile file: " << file << "\n";
+        file_.close();
+        return false;
+    }
+    return true;
+}
+
+std::filesystem::path heightTilesPath(const std::filesystem::path& source) {
+    std::filesystem::path tiles = source;
+    tiles.replace_extension(".tiles");
+    return tiles;
+}
+
+bool writeHeightTiles(const std::filesystem::path& file, int width, int height, int tile_cells,
+    const std::function<void(int z, unsigned char* row)>& row, uint64_t source_size, int64_t source_mtime)
+{
+    if (!validTileCells(uint32_t(tile_cells)) || width < 2 || height < 2) {
+        std::cerr << "[Terrain] Cannot tile a " << width << "x" << height << " world into " << tile_cells
+            << "-cell tiles (power of two, 8 to 128)\n";
+        return false;
+    }
+    const int T = tile_cells, a = T + 3;
+
+    HeightTilesHeader h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = HEIGHT_TILES_VERSION;
+    h.tile_cells = uint32_t(T);
+    h.tiles_x = tileCount(width, T);
+    h.tiles_z = tileCount(height, T);
+    h.width = uint32_t(width);
+    h.height = uint32_t(height);
+    h.source_size = source_size;
+    h.source_mtime = source_mtime;
+    h.tile_offset = sizeof(HeightTilesHeader);
+
+    // written to a temporary file first, as the mesh cache
+    std::filesystem::path tmp = file;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "[Terrain] Cannot write: " << tmp << "\n";
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+        // one band of rows (a tile row with its apron) at a time
+        std::vector<unsigned char> band(size_t(a) * width);
+        std::vector<unsigned char> tiles(size_t(h.tiles_x) * a * a);
+        for (uint32_t tz = 0; tz < h.tiles_z; ++tz) {
+            for (int r = 0; r < a; ++r)
+                row(std::clamp(int(tz) * T - 1 + r, 0, height - 1), band.data() + size_t(r) * width);
+            for (uint32_t tx = 0; tx < h.tiles_x; ++tx) {
+                unsigned char* tile = tiles.data() + size_t(tx) * a * a;
+                for (int r = 0; r < a; ++r)
+                    for (int c = 0; c < a; ++c)
+                        tile[size_t(r) * a + c] = band[size_t(r) * width + std::clamp(int(tx) * T - 1 + c, 0, width - 1)];
+            }
+            out.write(reinterpret_cast<const char*>(tiles.data()), std::streamsize(tiles.size()));
+        }
+        if (!out) return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, file, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool PagedTerrain::open(const std::filesystem::path& tiles_file, const PagedTerrainParams& params) {
+    clear();
+    if (!tiles_.open(tiles_file)) return false;
+
+    params_ = params;
+    params_.radius = std::max(1, params_.radius);
+    params_.full_detail_radius = std::max(0, params_.full_detail_radius);
+    params_.uploads_per_frame = std::max<size_t>(1, params_.uploads_per_frame);
+    params_.texture_period = std::max(1, params_.texture_period);
+
+    stopping_ = false;
+    worker_ = std::thread(&PagedTerrain::workerLoop, this);
+
+    const HeightTilesHeader& h = tiles_.header();
+    const size_t max_resident = size_t(2 * params_.radius + 3) * (2 * params_.radius + 3);
+    std::cout << "[Terrain] Paged " << h.width << "x" << h.height << " world: " << h.tiles_x << "x" << h.tiles_z
+        << " tiles of " << h.tile_cells << " cells, radius " << params_.radius << " -> at most " << max_resident
+        << " resident (" << ((max_resident * tiles_.tileBytes()) >> 10) << " KB of heights)\n";
+    return true;
+}
+
+void PagedTerrain::init(const ShaderProgram& shader) {
+    shader_ = shader;
+    texture_period_ = shader_.uniform<glm::vec2>("uTexturePeriod");
+    tile_size_ = shader_.uniform<glm::vec2>("uTileSize");
+}
+
+int PagedTerrain::stepForRing(int ring) const {
+    return std::min(1 << std::clamp(ring - params_.full_detail_radius, 0, 16), tiles_.tileCells());
+}
+
+void PagedTerrain::update(const glm::vec3& eye, const glm::mat4& view) {
+    if (empty()) return;
+    auto start = std::chrono::steady_clock::now();
+
+    const int T = tiles_.tileCells();
+    const glm::vec3 model_eye = (eye - origin_) / scale_;
+    const glm::ivec2 center(int(std::floor(model_eye.x / float(T))), int(std::floor(model_eye.z / float(T))));
+    if (center != center_) {
+        center_ = center;
+        request(center);
+        pageOut(center);
+    }
+
+    uploadFinished(params_.uploads_per_frame);
+
+    // frustum planes (unnormalized, inside >= 0) from the rows of projection * view
+    const glm::mat4 m = projection_ * view;
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i) rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    const glm::vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1],
+        rows[3] - rows[1], rows[3] + rows[2], rows[3] - rows[2] };
+
+    drawn_.clear();
+    stats_.triangles = 0;
+    for (const auto& [k, tile] : resident_) {
+        const glm::vec3 corner(float(int32_t(k & 0xFFFFFFFF) * T), 0.0f, float(int32_t(k >> 32) * T));
+        const glm::vec3 lo = origin_ + scale_ * (corner + tile.bounds_min);
+        const glm::vec3 hi = origin_ + scale_ * (corner + tile.bounds_max);
+        bool inside = true;
+        for (const glm::vec4& p : planes) {
+            const glm::vec3 v(p.x >= 0.0f ? hi.x : lo.x, p.y >= 0.0f ? hi.y : lo.y, p.z >= 0.0f ? hi.z : lo.z);
+            if (glm::dot(glm::vec3(p), v) + p.w < 0.0f) { inside = false; break; }
+        }
+        if (!inside) continue;
+        drawn_.push_back(k);
+        stats_.triangles += tile.triangles;
+    }
+    stats_.tiles = drawn_.size();
+    stats_.resident = resident_.size();
+    stats_.update_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PagedTerrain::request(const glm::ivec2& center) {
+    const HeightTilesHeader& h = tiles_.header();
+    const int R = params_.radius;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::unordered_map<uint64_t, int> wanted;
+    for (int tz = std::max(center.y - R, 0); tz <= std::min(center.y + R, int(h.tiles_z) - 1); ++tz) {
+        for (int tx = std::max(center.x - R, 0); tx <= std::min(center.x + R, int(h.tiles_x) - 1); ++tx) {
+            const uint64_t k = key(tx, tz);
+            const int step = stepForRing(std::max(std::abs(tx - center.x), std::abs(tz - center.y)));
+            wanted[k] = step;
+
+            // queued already, or resident at this step (back from the page-out margin)
+            auto old = wanted_.find(k);
+            if (old != wanted_.end() && old->second == step) continue;
+            auto tile = resident_.find(k);
+            if (tile != resident_.end() && tile->second.step == step) continue;
+            jobs_.push_back(Job{ tx, tz, step });
+        }
+    }
+    // drop the jobs of tiles that left the window or now want another step
+    wanted_ = std::move(wanted);
+    jobs_.erase(std::remove_if(jobs_.begin(), jobs_.end(), [this](const Job& j) {
+        auto w = wanted_.find(key(j.tx, j.tz));
+        return w == wanted_.end() || w->second != j.step;
+    }), jobs_.end());
+
+    // nearest first, from wherever the camera is now
+    auto ring = [&center](const Job& j) { return std::max(std::abs(j.tx - center.x), std::abs(j.tz - center.y)); };
+    std::stable_sort(jobs_.begin(), jobs_.end(), [&](const Job& a, const Job& b) { return ring(a) < ring(b); });
+    work_ready_.notify_one();
+}
+
+void PagedTerrain::pageOut(const glm::ivec2& center) {
+    // one ring of margin, so moving back and forth over a tile border does not thrash
+    const int keep = params_.radius + 1;
+    for (auto it = resident_.begin(); it != resident_.end();) {
+        const int tx = int32_t(it->first & 0xFFFFFFFF), tz = int32_t(it->first >> 32);
+        if (std::max(std::abs(tx - center.x), std::abs(tz - center.y)) > keep) {
+            stats_.cpu_bytes -= it->second.heights.size();
+            stats_.gpu_bytes -= it->second.gpu_bytes;
+            ++stats_.paged_out;
+            it = resident_.erase(it); // frees the mesh's buffers
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void PagedTerrain::uploadFinished(size_t max_tiles) {
+    // anything no longer wanted (left the window or re-requested at another step) is dropped
+    for (size_t uploaded = 0; uploaded < max_tiles;) {
+        Built built;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (built_.empty()) return;
+            built = std::move(built_.front());
+            built_.pop_front();
+            auto wanted = wanted_.find(key(built.tx, built.tz));
+            if (wanted == wanted_.end() || wanted->second != built.step) continue;
+        }
+        upload(built);
+        ++uploaded;
+    }
+}
+
+void PagedTerrain::upload(Built& built) {
+    auto [it, added] = resident_.try_emplace(key(built.tx, built.tz));
+    Tile& tile = it->second;
+    if (added) ++stats_.paged_in;
+    stats_.cpu_bytes -= tile.heights.size();
+    stats_.gpu_bytes -= tile.gpu_bytes;
+
+    // replaces the mesh drawn so far
+    tile.mesh = std::make_unique<Mesh>(GL_TRIANGLES, shader_, built.vertices.data(), built.vertices.size(),
+        built.indices.data(), built.indices.size(), GL_UNSIGNED_SHORT, built.bounds_min, built.bounds_max,
+        glm::vec3(0.0f), glm::vec3(0.0f));
+    tile.step = built.step;
+    tile.heights = std::move(built.heights);
+    tile.bounds_min = built.bounds_min;
+    tile.bounds_max = built.bounds_max;
+    tile.triangles = built.indices.size() / 3;
+    tile.gpu_bytes = tile.mesh->getGeometry()->vertexBytes() + tile.mesh->getGeometry()->indexBytes();
+
+    stats_.cpu_bytes += tile.heights.size();
+    stats_.gpu_bytes += tile.gpu_bytes;
+}
+
+void PagedTerrain::workerLoop() {
+    for (;;) {
+        Built built;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_ready_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (stopping_) return;
+            static_cast<Job&>(built) = jobs_.front();
+            jobs_.pop_front();
+            ++meshing_;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        buildTile(built);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        --meshing_;
+        stats_.mesh_ms += ms;
+        built_.push_back(std::move(built));
+    }
+}
+
+void PagedTerrain::buildTile(Built& out) const {
+    const HeightTilesHeader& h = tiles_.header();
+    const int T = tiles_.tileCells(), a = tiles_.apronSize(), s = out.step, S = T / s, n = S + 1;
+
+    // the only read of the file, on the worker; a tile that cannot be read is flat
+    out.heights.resize(tiles_.tileBytes());
+    if (!tiles_.readTile(out.tx, out.tz, out.heights.data())) {
+        std::cerr << "[Terrain] Cannot read tile (" << out.tx << ", " << out.tz << ")\n";
+        std::fill(out.heights.begin(), out.heights.end(), 0);
+    }
+
+    // full-resolution normals over the apron, so a vertex on a shared edge
+    // gets the same normal in both tiles whatever their steps
+    std::vector<float> samples(out.heights.size());
+    for (size_t i = 0; i < samples.size(); ++i) samples[i] = float(out.heights[i]) * params_.height_scale;
+    std::vector<glm::vec3> normals;
+    computeTerrainNormals(samples.data(), a, a, 1.0f, normals);
+
+    // positions relative to the tile corner; the last tiles stop at the world edge
+    const int x0 = out.tx * T, z0 = out.tz * T;
+    const int last_x = std::min(T, int(h.width) - 1 - x0), last_z = std::min(T, int(h.height) - 1 - z0);
+
+    // texcoords: the material of the cell a vertex is the (c, r) corner of
+    // (its provoking vertex), by the cell's highest sample
+    auto material = [&](int x, int z) {
+        if (!params_.material) return glm::vec2(0.0f);
+        const int x1 = std::min(x + s, last_x), z1 = std::min(z + s, last_z);
+        auto at = [&](int px, int pz) { return out.heights[size_t(pz + 1) * a + px + 1]; };
+        const unsigned char top = std::max(std::max(at(x, z), at(x1, z)), std::max(at(x, z1), at(x1, z1)));
+        return params_.material(top * params_.height_scale);
+    };
+
+    out.vertices.resize(size_t(n) * n);
+    for (int r = 0; r < n; ++r) {
+        const int z = std::min(r * s, last_z);
+        for (int c = 0; c < n; ++c) {
+            const int x = std::min(c * s, last_x);
+            const size_t i = size_t(z + 1) * a + x + 1;
+            const float y = samples[i];
+            out.vertices[size_t(r) * n + c] = vertex(glm::vec3(float(x), y, float(z)), normals[i], material(x, z));
+        }
+    }
+
+    // skirts deep enough against a neighbour at any step: tiles waiting for
+    // a new mesh keep their old one, so neighbours may differ by more than one
+    auto drawn = [](const unsigned char* line, size_t stride, int length, int t, int step) {
+        const int lo = t / step * step, hi = std::min(lo + step, length - 1);
+        if (hi <= lo) return float(line[size_t(lo) * stride]);
+        const float f = float(t - lo) / float(hi - lo);
+        return float(line[size_t(lo) * stride]) * (1.0f - f) + float(line[size_t(hi) * stride]) * f;
+    };
+    float error = 0.0f;
+    auto edge = [&](const unsigned char* line, size_t stride) {
+        for (int t = 0; t <= T; ++t) {
+            const float mine = drawn(line, stride, T + 1, t, s);
+            for (int other = 1; other <= T; other *= 2)
+                error = std::max(error, std::abs(mine - drawn(line, stride, T + 1, t, other)));
+        }
+    };
+    const unsigned char* grid = out.heights.data() + a + 1;
+    edge(grid, 1);
+    edge(grid + size_t(T) * a, 1);
+    edge(grid, size_t(a));
+    edge(grid + T, size_t(a));
+    const float depth = (error + 1.0f) * std::abs(params_.height_scale);
+    buildTerrainSkirts(out.vertices, S, depth, -FLT_MAX);
+    buildTerrainPatchIndices(S, out.indices);
+
+    out.bounds_min = glm::vec3(FLT_MAX);
+    out.bounds_max = glm::vec3(-FLT_MAX);
+    for (const vertex& v : out.vertices) {
+        out.bounds_min = glm::min(out.bounds_min, v.position);
+        out.bounds_max = glm::max(out.bounds_max, v.position);
+    }
+}
+
+void PagedTerrain::draw(int texture_layer) {
+    if (drawn_.empty()) return;
+    const int T = tiles_.tileCells();
+    const glm::mat4 model_matrix = glm::scale(glm::translate(glm::mat4(1.0f), origin_), scale_);
+    texture_period_.set(float(params_.texture_period) * glm::vec2(scale_.x, scale_.z));
+    tile_size_.set(params_.tile_size);
+    for (uint64_t k : drawn_) {
+        const Tile& tile = resident_.at(k);
+        const glm::vec3 corner(float(int32_t(k & 0xFFFFFFFF) * T), 0.0f, float(int32_t(k >> 32) * T));
+        tile.mesh->setModelMatrix(glm::translate(model_matrix, corner));
+        tile.mesh->setTextureLayer(texture_layer);
+        tile.mesh->draw();
+    }
+}
+
+bool PagedTerrain::heightAt(float x, float z, float& y) const {
+    if (empty()) return false;
+    const HeightTilesHeader& h = tiles_.header();
+    const int T = tiles_.tileCells(), a = tiles_.apronSize();
+
+    // the cell under (x, z) and the tile holding it; both its corners are in
+    // the tile (the far ones on its edge or apron)
+    const float u = std::clamp((x - origin_.x) / scale_.x, 0.0f, float(h.width - 1));
+    const float v = std::clamp((z - origin_.z) / scale_.z, 0.0f, float(h.height - 1));
+    const int c = std::min(int(u), int(h.width) - 2), r = std::min(int(v), int(h.height) - 2);
+    const int tx = c / T, tz = r / T;
+    auto it = resident_.find(key(tx, tz));
+    if (it == resident_.end()) return false;
+
+    // the triangle of the cell the mesh has there, split along (c, r) - (c + 1, r + 1)
+    const unsigned char* s = it->second.heights.data() + size_t(r - tz * T + 1) * a + (c - tx * T + 1);
+    const float h00 = s[0], h10 = s[1], h01 = s[a], h11 = s[a + 1];
+    const float fu = u - float(c), fv = v - float(r);
+    const float height = fu >= fv ? h00 + fu * (h10 - h00) + fv * (h11 - h10) : h00 + fu * (h11 - h01) + fv * (h01 - h00);
+    y = origin_.y + scale_.y * height * params_.height_scale;
+    return true;
+}
+
+void PagedTerrain::finish() {
+    for (;;) {
+        uploadFinished(SIZE_MAX);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (jobs_.empty() && meshing_ == 0 && built_.empty()) break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stats_.resident = resident_.size();
+}
+
+PagedTerrainStats PagedTerrain::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PagedTerrainStats stats = stats_;
+    stats.pending = jobs_.size() + meshing_ + built_.size();
+    return stats;
+}
+
+void PagedTerrain::clear() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        jobs_.clear();
+    }
+    work_ready_.notify_all();
+    if (worker_.joinable()) worker_.join();
+    built_.clear();
+    wanted_.clear();
+    meshing_ = 0;
+
+    resident_.clear();
+    drawn_.clear();
+    center_ = glm::ivec2(INT32_MIN);
+    tiles_.close();
+    stats_ = PagedTerrainStats();
+}
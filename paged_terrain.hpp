@@ -0,0 +1,202 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+#include "ShaderProgram.hpp"
+#include "mapped_file.hpp"
+
+// Height tile file (.tiles): the world cut into square tiles of tile_cells
+// cells, stored row by row after the header. A tile holds its
+// (tile_cells + 1)^2 grid samples plus a one-pixel apron, so
+// (tile_cells + 3)^2 bytes row-major, and can be meshed (normals included)
+// without its neighbours. Samples past the world edge are clamped.
+
+#define HEIGHT_TILES_VERSION 1
+
+struct HeightTilesHeader {
+    char magic[8];              // "HTILES\0\0"
+    uint32_t version;
+    uint32_t tile_cells;        // cells per tile side, power of two
+    uint32_t tiles_x, tiles_z;
+    uint32_t width, height;     // world size in pixels
+    uint64_t source_size;       // key of the image the tiles were cut from (0 = generated)
+    int64_t source_mtime;
+    uint64_t tile_offset;       // byte offset of tile (0, 0)
+};
+
+// Read-only access to a validated tile file. Tiles are read at their offset
+// rather than mapped, so the process only holds the tiles it keeps.
+class HeightTiles {
+public:
+    bool open(const std::filesystem::path& file);
+    void close() { file_.close(); }
+    bool isOpen() const { return file_.is_open(); }
+
+    const HeightTilesHeader& header() const { return header_; }
+    int tileCells() const { return int(header_.tile_cells); }
+    int apronSize() const { return tileCells() + 3; }
+    size_t tileBytes() const { return size_t(apronSize()) * apronSize(); }
+
+    // Reads tile (tx, tz) into out (tileBytes()); sample (x, z) of the tile is at
+    // [(z + 1) * apronSize() + x + 1], -1 <= x, z <= tile_cells + 1. Any thread.
+    bool readTile(int tx, int tz, unsigned char* out) const {
+        return file_.read(header_.tile_offset + (uint64_t(tz) * header_.tiles_x + uint64_t(tx)) * tileBytes(), out,
+            tileBytes());
+    }
+
+private:
+    RandomAccessFile file_;
+    HeightTilesHeader header_{};
+};
+
+// image.png -> image.tiles
+std::filesystem::path heightTilesPath(const std::filesystem::path& source);
+
+// Writes a tile file for a width x height world. row(z, out) fills the width
+// samples of row z; rows are requested in order, the ones shared by two tile
+// rows again, so only tile_cells + 3 rows are held at a time. The source key
+// is the size/mtime of the image the rows come from (0 if generated).
+bool writeHeightTiles(const std::filesystem::path& file, int width, int height, int tile_cells,
+    const std::function<void(int z, unsigned char* row)>& row,
+    uint64_t source_size = 0, int64_t source_mtime = 0);
+
+// Terrain streamed from a tile file around the camera. update() (render
+// thread) works out the tiles within radius rings of the camera's tile and
+// queues the missing ones nearest first; a worker thread reads them from
+// the file (the I/O lands there, not on the render thread), meshes them and
+// hands the streams back, and update() uploads a few finished
+// tiles per frame. Tiles further than radius + 1 rings are paged out, so at
+// most (2 * radius + 3)^2 tiles are resident whatever the world size.
+//
+// The sample step doubles with every ring past full_detail_radius. A tile
+// whose step changed keeps drawing its old mesh until the new one arrives;
+// skirts deep enough against any step hide the cracks in between.
+
+struct PagedTerrainParams {
+    int radius{ 4 };                // rings of tiles requested around the camera tile
+    int full_detail_radius{ 1 };    // rings meshed at full resolution
+    size_t uploads_per_frame{ 2 };  // finished tiles uploaded per update()
+    float height_scale{ 1.0f };     // model y per height unit
+    int texture_period{ 8 };        // pixels per texture tile, mirrored in between per fragment
+    glm::vec2 tile_size{ 1.0f };    // of the atlas tile material() points at
+    std::function<glm::vec2(float)> material; // atlas tile of a cell whose highest sample is at model y; called on the worker
+};
+
+struct PagedTerrainStats {
+    size_t tiles{ 0 };              // drawn this frame
+    size_t triangles{ 0 };
+    size_t resident{ 0 };           // tiles with heights and a mesh
+    size_t pending{ 0 };            // queued, being meshed or waiting for upload
+    size_t paged_in{ 0 }, paged_out{ 0 }; // totals
+    size_t cpu_bytes{ 0 };          // resident heights
+    size_t gpu_bytes{ 0 };          // resident meshes
+    double update_ms{ 0.0 };        // last update() on the render thread
+    double mesh_ms{ 0.0 };          // summed over the worker
+};
+
+class PagedTerrain {
+public:
+    PagedTerrain() = default;
+    ~PagedTerrain() { clear(); }
+
+    PagedTerrain(const PagedTerrain&) = delete;
+    PagedTerrain& operator=(const PagedTerrain&) = delete;
+
+    // Maps the tile file and starts the worker; no GL calls
+    bool open(const std::filesystem::path& tiles_file, const PagedTerrainParams& params);
+
+    // shader is the program the tile meshes draw with (SHADER_TERRAIN_TEXTURE)
+    void init(const ShaderProgram& shader);
+
+    // World placement: world = origin + scale * model (scale > 0); model
+    // x and z are world pixels
+    void setTransform(const glm::vec3& origin, const glm::vec3& scale) { origin_ = origin; scale_ = scale; }
+    void setProjection(const glm::mat4& projection) { projection_ = projection; }
+
+    // Requests tiles around the eye, uploads finished ones, pages out far ones
+    void update(const glm::vec3& eye, const glm::mat4& view);
+
+    // Draws the resident tiles in the view; the caller binds the texture (array) on unit 0
+    void draw(int texture_layer);
+
+    // World y of the surface under world (x, z), on the triangle the mesh has
+    // there (as TerrainRaycaster::heightAt); false while that tile is not resident
+    bool heightAt(float x, float z, float& y) const;
+
+    // Blocks until every tile requested by the last update() is resident
+    // (warm-up, benchmarks); the next update() draws them
+    void finish();
+
+    PagedTerrainStats stats() const;
+    int width() const { return tiles_.isOpen() ? int(tiles_.header().width) : 0; }
+    int height() const { return tiles_.isOpen() ? int(tiles_.header().height) : 0; }
+    bool empty() const { return !tiles_.isOpen(); }
+
+    void clear();
+
+private:
+    struct Job {
+        int tx{ 0 }, tz{ 0 }, step{ 1 };
+    };
+    // worker output: the tile's heights and GPU-ready streams
+    struct Built : Job {
+        std::vector<unsigned char> heights;
+        std::vector<vertex> vertices;
+        std::vector<GLushort> indices;
+        glm::vec3 bounds_min{ 0.0f }, bounds_max{ 0.0f };
+    };
+    struct Tile {
+        int step{ 0 };              // of the mesh drawn; wanted_ may already ask for another
+        std::vector<unsigned char> heights;
+        std::unique_ptr<Mesh> mesh;
+        glm::vec3 bounds_min{ 0.0f }, bounds_max{ 0.0f };
+        size_t triangles{ 0 };
+        size_t gpu_bytes{ 0 };
+    };
+
+    HeightTiles tiles_;
+    PagedTerrainParams params_;
+    ShaderProgram shader_;
+    Uniform<glm::vec2> texture_period_, tile_size_;
+    glm::vec3 origin_{ 0.0f }, scale_{ 1.0f };
+    glm::mat4 projection_{ 1.0f };
+
+    std::unordered_map<uint64_t, Tile> resident_; // render thread only
+    std::vector<uint64_t> drawn_;
+    glm::ivec2 center_{ INT32_MIN };              // camera tile of the last request pass
+
+    std::thread worker_;
+    mutable std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::deque<Job> jobs_;
+    std::deque<Built> built_;
+    std::unordered_map<uint64_t, int> wanted_;    // tile -> step of the current window
+    size_t meshing_{ 0 };
+    bool stopping_{ false };
+
+    PagedTerrainStats stats_;
+
+    static uint64_t key(int tx, int tz) { return (uint64_t(uint32_t(tz)) << 32) | uint32_t(tx); }
+
+    int stepForRing(int ring) const;
+    void request(const glm::ivec2& center);
+    void pageOut(const glm::ivec2& center);
+    void uploadFinished(size_t max_tiles);
+    void upload(Built& built);
+    void workerLoop();
+    void buildTile(Built& out) const;
+};
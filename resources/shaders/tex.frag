@@ -1,85 +1,185 @@
-﻿#version 460 core
+﻿#version 450 core
+
+// Feature switches, see shader_variants.hpp. Variants define VARIANT and
+// their features; a plain build gets every feature.
+#ifndef VARIANT
+#define SUN_LIGHT
+#define POINT_LIGHTS
+#define SPOT_LIGHT
+#endif
+
+// Mirrors of the GpuLight structs in light_buffer.hpp (all vec4: std430 = std140)
+struct DirectionalLight {
+    vec4 direction, ambient, diffuse, specular;
+};
+
+struct SpotLight {
+    vec4 position, direction;
+    vec4 attenuation; // constant, linear, quadratic
+    vec4 cone;        // cos(cutoff), cos(outer cutoff)
+};
 
 struct PointLight {
-    vec3 ambient, diffuse, specular;
-    float constant, linear, quadratic;
+    vec4 position;    // w = radius of influence
+    vec4 diffuse;
+    vec4 attenuation; // constant, linear, quadratic
 };
 
-uniform PointLight pointLights[3];
+layout(std430, binding = 0) readonly buffer Lights {
+    DirectionalLight sun;
+    SpotLight spot;
+    uvec4 lightCounts; // x = point lights
+    PointLight pointLights[];
+};
 
-uniform vec3 directionalLight_direction;
-uniform vec3 directionalLight_ambient;
-uniform vec3 directionalLight_diffuse;
-uniform vec3 directionalLight_specular;
+#ifdef POINT_LIGHTS
+// Clustered forward: per-froxel light lists written by cluster_cull.comp
+layout(std430, binding = 1) readonly buffer ClusterCounts {
+    uint clusterCounts[];
+};
+
+layout(std430, binding = 2) readonly buffer ClusterLights {
+    uint clusterLightIndices[];
+};
 
-uniform vec3 spotLight_position;
-uniform vec3 spotLight_direction;
-uniform float spotLight_constant;
-uniform float spotLight_linear;
-uniform float spotLight_quadratic;
-uniform float spotLight_cutoff;
-uniform float spotLight_outerCutoff;
+uniform int uClustered = 0;      // 0 = every light for every fragment
+uniform int uClusterDebug = 0;   // show lights per cluster instead of shading
+uniform ivec3 uClusterGrid;
+uniform int uMaxLightsPerCluster;
+uniform vec2 uClusterTileSize;   // pixels
+uniform vec2 uClusterDepth;      // slice = log(depth) * x - y
+#endif
 
+#ifdef SUN_LIGHT
 uniform float shininess;
-uniform sampler2D uTexture;
+#endif
+#ifdef FOG
+uniform float uFogDensity = 0.004;
+uniform vec3 uFogColor = vec3(0.1); // the clear color
+#endif
+uniform sampler2DArray uTexture; // material layers, see TextureStreamer::requestArray
+
+#if defined(TERRAIN) && !defined(TERRAIN_TEXTURE)
+#define TERRAIN_TEXTURE
+#endif
+#ifdef TERRAIN_TEXTURE
+uniform vec2 uTileSize = vec2(1.0); // atlas tile the texcoords point at
+#endif
 
 in VS_OUT {
     vec3 N;
     vec3 V;
+#ifdef TERRAIN_TEXTURE
+    flat vec2 texCoord;
+#else
     vec2 texCoord;
+#endif
     vec3 FragPos_world;
-    vec3 L_point[3];
+    float viewDepth;
+    flat float layer;
+#ifdef TERRAIN_TEXTURE
+    vec2 tileCoord;
+#endif
 } fs_in;
 
 out vec4 FragColor;
 
 void main() {
-    vec4 texColor = texture(uTexture, fs_in.texCoord);
-    //if (texColor.a < 0.1) discard;
+#ifdef TERRAIN_TEXTURE
+    // tile mirrored every other period, so no seams; the gradients of the
+    // unfolded coordinate keep the mip level steady across the folds
+    vec2 tile = 1.0 - abs(mod(fs_in.tileCoord, 2.0) - 1.0);
+    vec4 texColor = textureGrad(uTexture, vec3(fs_in.texCoord + tile * uTileSize, fs_in.layer),
+        dFdx(fs_in.tileCoord) * uTileSize, dFdy(fs_in.tileCoord) * uTileSize);
+#else
+    vec4 texColor = texture(uTexture, vec3(fs_in.texCoord, fs_in.layer));
+#endif
+#ifdef ALPHA_TEST
+    if (texColor.a < 0.1) discard;
+#endif
 
     vec3 N = normalize(fs_in.N);
     vec3 V = normalize(fs_in.V);
     vec3 result = vec3(0.0);
 
+#ifdef SUN_LIGHT
     // === Directional light (Phong) ===
-    vec3 L_dir = normalize(-directionalLight_direction);
+    vec3 L_dir = normalize(-sun.direction.xyz);
     vec3 R_dir = reflect(-L_dir, N);
     float diff_dir = max(dot(N, L_dir), 0.0);
     float spec_dir = pow(max(dot(R_dir, V), 0.0), shininess);
     result += (
-        directionalLight_ambient *2.0 +
-        directionalLight_diffuse * diff_dir * 4.0+
-        directionalLight_specular * spec_dir
+        sun.ambient.rgb *2.0 +
+        sun.diffuse.rgb * diff_dir * 4.0+
+        sun.specular.rgb * spec_dir
     ) * texColor.rgb;
+#endif
 
+#ifdef POINT_LIGHTS
     // === Point Lights (soft diffuse, no specular) ===
-    for (int i = 0; i < 3; ++i) {
-        vec3 L = normalize(fs_in.L_point[i]);
-        float dist = length(fs_in.L_point[i]);
-        float attenuation = 1.0 / (pointLights[i].constant +
-                                   pointLights[i].linear * dist +
-                                   pointLights[i].quadratic * dist * dist);
+    uint light_count = lightCounts.x;
+    uint list_base = 0;
+    uint cluster_lights = 0;
+    if (uClustered != 0 || uClusterDebug != 0) {
+        ivec2 tile = ivec2(gl_FragCoord.xy / uClusterTileSize);
+        int slice = int(floor(log(max(fs_in.viewDepth, 1e-4)) * uClusterDepth.x - uClusterDepth.y));
+        ivec3 c = clamp(ivec3(tile, slice), ivec3(0), uClusterGrid - 1);
+        uint cluster = uint(c.x + uClusterGrid.x * (c.y + uClusterGrid.y * c.z));
+        cluster_lights = clusterCounts[cluster];
+        list_base = cluster * uint(uMaxLightsPerCluster);
+        if (uClustered != 0) light_count = min(cluster_lights, uint(uMaxLightsPerCluster));
+    }
+
+    if (uClusterDebug != 0) {
+        // black = no lights, blue -> green -> red towards the list capacity, white = overflow
+        float t = float(cluster_lights) / float(uMaxLightsPerCluster);
+        vec3 heat = cluster_lights == 0u ? vec3(0.0)
+            : t > 1.0 ? vec3(1.0)
+            : clamp(vec3(2.0 * t - 0.5, 1.5 - abs(4.0 * t - 1.5), 1.0 - 3.0 * t), 0.0, 1.0);
+        FragColor = vec4(mix(heat, texColor.rgb, 0.15), 1.0);
+        return;
+    }
+
+    for (uint n = 0; n < light_count; ++n) {
+        uint i = (uClustered != 0) ? clusterLightIndices[list_base + n] : n;
+        PointLight light = pointLights[i];
+        vec3 L_point = light.position.xyz - fs_in.FragPos_world;
+        float dist = length(L_point);
+        if (dist > light.position.w) continue; // below 1/256 of full intensity
+
+        vec3 L = L_point / max(dist, 1e-4);
+        float attenuation = 1.0 / (light.attenuation.x +
+                                   light.attenuation.y * dist +
+                                   light.attenuation.z * dist * dist);
 
         float diff = max(dot(N, L), 0.2); // min 0.2 to avoid full black
-        vec3 diffuse = pointLights[i].diffuse * diff * texColor.rgb;
+        vec3 diffuse = light.diffuse.rgb * diff * texColor.rgb;
 
         result += attenuation * diffuse;
     }
+#endif
 
+#ifdef SPOT_LIGHT
     // === Spotlight (pure cone) ===
-    vec3 L_spot = spotLight_position - fs_in.FragPos_world;
+    vec3 L_spot = spot.position.xyz - fs_in.FragPos_world;
     float dist_spot = length(L_spot);
     vec3 L_dir_spot = normalize(L_spot);
-    float theta = dot(L_dir_spot, normalize(-spotLight_direction));
-    float epsilon = spotLight_cutoff - spotLight_outerCutoff;
-    float intensity = clamp((theta - spotLight_outerCutoff) / epsilon, 0.0, 1.0);
-    float attenuation_spot = 1.0 / (spotLight_constant +
-                                    spotLight_linear * dist_spot +
-                                    spotLight_quadratic * dist_spot * dist_spot);
+    float theta = dot(L_dir_spot, normalize(-spot.direction.xyz));
+    float epsilon = spot.cone.x - spot.cone.y;
+    float intensity = clamp((theta - spot.cone.y) / epsilon, 0.0, 1.0);
+    float attenuation_spot = 1.0 / (spot.attenuation.x +
+                                    spot.attenuation.y * dist_spot +
+                                    spot.attenuation.z * dist_spot * dist_spot);
 
     // Intensity-only spotlight — no normal used
     vec3 spotlight = vec3(0.4) * intensity * attenuation_spot; // multiplier for brightness
     result += spotlight;
-
-    FragColor = vec4(min(result, vec3(1.0)), texColor.a); // clamp to avoid overbright
+#endif
+
+    result = min(result, vec3(1.0)); // clamp to avoid overbright
+#ifdef FOG
+    float fog = fs_in.viewDepth * uFogDensity;
+    result = mix(uFogColor, result, exp(-fog * fog));
+#endif
+    FragColor = vec4(result, texColor.a);
 }
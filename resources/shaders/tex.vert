@@ -1,35 +1,132 @@
-﻿#version 460 core
+﻿#version 450 core
 
-layout(location = 0) in vec3 aPosition;
-layout(location = 1) in vec3 aNormal;
-layout(location = 2) in vec2 aTexCoord;
+layout(location = 0) in vec3 aPosition;  // packed: unorm16 within the mesh bounds
+layout(location = 1) in vec3 aNormal;    // packed: octahedral snorm16 in .xy
+layout(location = 2) in vec2 aTexCoord;  // packed: half float
+layout(location = 4) in vec4 aInstanceOffset; // instanced: xyz offset, w texture layer
+layout(location = 5) in vec3 aInstanceScale;
+
+// Packed vertex decode (identity for the float layout)
+uniform vec3 uPosOffset = vec3(0.0);
+uniform vec3 uPosScale = vec3(1.0);
+uniform int uOctNormals = 0;
+uniform int uInstanced = 0;
+uniform int uTextureLayer = 0; // non-instanced draws: layer of the bound texture array
 
 uniform mat4 uM_m;
 uniform mat4 uV_m;
 uniform mat4 uP_m;
 
-uniform vec3 pointLightPositions[3];
+#if defined(TERRAIN) && !defined(TERRAIN_TEXTURE)
+#define TERRAIN_TEXTURE
+#endif
 
 out VS_OUT {
     vec3 N;
     vec3 V;
+#ifdef TERRAIN_TEXTURE
+    flat vec2 texCoord; // the cell's, from its (c, r) corner (the provoking vertex)
+#else
     vec2 texCoord;
+#endif
     vec3 FragPos_world;
-    vec3 L_point[3];
+    float viewDepth;
+    flat float layer;
+#ifdef TERRAIN_TEXTURE
+    vec2 tileCoord;
+#endif
 } vs_out;
 
+#ifdef TERRAIN_TEXTURE
+// Terrain texturing: texCoord is the corner of the atlas tile of the cell,
+// and tex.frag mirrors the tile across the ground every uTexturePeriod
+// world units
+uniform vec2 uTexturePeriod = vec2(8.0);
+#endif
+
+#ifdef TERRAIN
+// GPU terrain (ChunkedTerrain with gpu_displacement): one flat patch of
+// uPatchCells^2 cells plus a skirt ring, instanced per quadtree node, with
+// no vertex buffer; gl_VertexID picks the grid point. Per instance,
+// aInstanceOffset.xz is the node corner and aInstanceScale.x the sample
+// step (heightmap pixels), aInstanceScale.y the skirt depth.
+layout(binding = 1) uniform sampler2D uHeightmap; // normalized heights, one texel per pixel
+uniform int uPatchCells = 32;
+uniform float uHeightScale = 1.0;   // model y at a normalized height of 1
+
+// normalized height (the texel, 0..1) at pixel p
+float terrainSample(vec2 p) {
+    return textureLod(uHeightmap, (p + 0.5) / vec2(textureSize(uHeightmap, 0)), 0.0).r;
+}
+
+float terrainHeight(vec2 p) {
+    return terrainSample(p) * uHeightScale;
+}
+
+// Atlas tile by normalized height, as get_subtex_by_height in heightmap.cpp
+vec2 terrainMaterial(float h) {
+    if (h > 0.9) return vec2(2.0, 11.0) / 16.0; // snow
+    if (h > 0.8) return vec2(3.0, 11.0) / 16.0; // ice
+    if (h > 0.5) return vec2(0.0, 14.0) / 16.0; // rock
+    if (h > 0.3) return vec2(2.0, 15.0) / 16.0; // soil
+    return vec2(0.0, 11.0) / 16.0;              // grass
+}
+#endif
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
 void main() {
-    vec4 worldPos = uM_m * vec4(aPosition, 1.0);
+#ifdef TERRAIN
+    // grid points first, then one skirt row per edge: top, bottom, left, right
+    const int n = uPatchCells + 1;
+    ivec2 cell = ivec2(gl_VertexID % n, gl_VertexID / n);
+    const bool skirt = gl_VertexID >= n * n;
+    if (skirt) {
+        int edge = (gl_VertexID - n * n) / n, k = (gl_VertexID - n * n) % n;
+        cell = edge == 0 ? ivec2(k, 0) : edge == 1 ? ivec2(k, uPatchCells) : edge == 2 ? ivec2(0, k) : ivec2(uPatchCells, k);
+    }
+    const float step = aInstanceScale.x;
+    const vec2 p = min(aInstanceOffset.xz + vec2(cell) * step, vec2(textureSize(uHeightmap, 0) - 1));
+    vec3 position = vec3(p.x, terrainHeight(p), p.y);
+
+    // central differences over the sample step (the texture clamps at the border)
+    float hl = terrainHeight(p - vec2(step, 0.0)), hr = terrainHeight(p + vec2(step, 0.0));
+    float hd = terrainHeight(p - vec2(0.0, step)), hu = terrainHeight(p + vec2(0.0, step));
+    vec3 normal = normalize(vec3(hl - hr, 2.0 * step, hd - hu));
+
+    // the material of the cell this vertex is the (c, r) corner of, by its
+    // highest sample (the texture clamps past the last row and column)
+    float cell_top = max(max(terrainSample(p), terrainSample(p + vec2(step, 0.0))),
+        max(terrainSample(p + vec2(0.0, step)), terrainSample(p + vec2(step))));
+    vec2 texCoord = terrainMaterial(cell_top);
+    if (skirt) position.y -= aInstanceScale.y;
+#else
+    vec3 position = uPosOffset + uPosScale * aPosition;
+    vec3 normal = (uOctNormals != 0) ? octDecode(aNormal.xy) : aNormal;
+    vec2 texCoord = aTexCoord;
+    if (uInstanced != 0) {
+        position = aInstanceOffset.xyz + aInstanceScale * position;
+        normal /= aInstanceScale; // inverse-transpose of a per-axis scale
+    }
+#endif
+
+    vec4 worldPos = uM_m * vec4(position, 1.0);
     vec4 viewPos = uV_m * worldPos;
 
     vs_out.FragPos_world = worldPos.xyz;
-    vs_out.N = normalize(mat3(uM_m) * aNormal);
+    vs_out.viewDepth = -viewPos.z;
+    vs_out.N = normalize(mat3(uM_m) * normal);
     vs_out.V = normalize(vec3(uV_m * worldPos));
-    vs_out.texCoord = aTexCoord;
-
-    for (int i = 0; i < 3; ++i) {
-        vs_out.L_point[i] = pointLightPositions[i] - worldPos.xyz;
-    }
+    vs_out.texCoord = texCoord;
+    vs_out.layer = (uInstanced != 0) ? aInstanceOffset.w : float(uTextureLayer);
+#ifdef TERRAIN_TEXTURE
+    vs_out.tileCoord = worldPos.xz / uTexturePeriod;
+#endif
 
     gl_Position = uP_m * viewPos;
 }
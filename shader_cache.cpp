@@ -0,0 +1,143 @@
+#include "shader_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+namespace {
+
+const char MAGIC[8] = { 'P', 'R', 'O', 'G', 'B', 'I', 'N', '\0' };
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t h = 0xcbf29ce484222325ull) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+uint64_t hashString(const char* s, uint64_t h) {
+    // the terminator separates neighbouring fields ("ab"+"c" != "a"+"bc")
+    return s ? fnv1a(s, std::strlen(s) + 1, h) : fnv1a("", 1, h);
+}
+
+} // namespace
+
+bool programBinariesSupported() {
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+uint64_t programCacheKey(const std::vector<ShaderStageSource>& stages, const std::string& defines) {
+    uint64_t h = fnv1a(MAGIC, sizeof(MAGIC));
+    h = hashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), h);
+    h = hashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), h);
+    h = hashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), h);
+    h = hashString(defines.c_str(), h);
+    for (const ShaderStageSource& stage : stages) {
+        h = fnv1a(&stage.type, sizeof(stage.type), h);
+        h = hashString(stage.text.c_str(), h);
+    }
+    return h;
+}
+
+std::filesystem::path programCachePath(const std::filesystem::path& dir, const std::string& name, uint64_t key) {
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+    return dir / (name + "-" + hex + ".progbin");
+}
+
+GLuint loadProgramBinary(const std::filesystem::path& dir, const std::string& name, uint64_t key) {
+    std::filesystem::path cache = programCachePath(dir, name, key);
+    std::ifstream in(cache, std::ios::binary);
+    if (!in) return 0;
+
+    ProgramBinHeader h{};
+    in.read(reinterpret_cast<char*>(&h), sizeof(h));
+    std::error_code ec;
+    uint64_t file_size = std::filesystem::file_size(cache, ec);
+    if (!in || ec || std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != PROGBIN_VERSION
+        || h.key != key || h.binary_size + sizeof(h) != file_size) {
+        std::cerr << "[ShaderCache] Corrupt cache: " << cache << "\n";
+        return 0;
+    }
+
+    std::vector<char> binary(h.binary_size);
+    in.read(binary.data(), binary.size());
+    if (!in || fnv1a(binary.data(), binary.size()) != h.binary_hash) {
+        std::cerr << "[ShaderCache] Corrupt cache: " << cache << "\n";
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, h.binary_format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        // e.g. a driver update that kept the version string; rebuild from source
+        std::cout << "[ShaderCache] Binary rejected by the driver: " << cache << "\n";
+        glDeleteProgram(program);
+        in.close();
+        std::filesystem::remove(cache, ec);
+        return 0;
+    }
+    return program;
+}
+
+bool saveProgramBinary(const std::filesystem::path& dir, const std::string& name, uint64_t key, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return false;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) return false;
+    binary.resize(written);
+
+    ProgramBinHeader h{};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = PROGBIN_VERSION;
+    h.binary_format = format;
+    h.key = key;
+    h.binary_size = binary.size();
+    h.binary_hash = fnv1a(binary.data(), binary.size());
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    // binaries of older sources/drivers would never be read again
+    std::filesystem::path cache = programCachePath(dir, name, key);
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        std::string file = entry.path().filename().string();
+        if (entry.path() != cache && entry.path().extension() == ".progbin"
+            && file.size() == name.size() + 1 + 16 + 8 && file.compare(0, name.size() + 1, name + "-") == 0)
+            std::filesystem::remove(entry.path(), ec);
+    }
+
+    // write to a temporary file first so a crash never leaves a half-written cache
+    std::filesystem::path tmp = cache;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "[ShaderCache] Cannot write: " << tmp << "\n";
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(binary.data(), binary.size());
+        if (!out) return false;
+    }
+
+    std::filesystem::rename(tmp, cache, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Program binary cache (.progbin): linked programs saved with
+// glGetProgramBinary and restored with glProgramBinary on the next start.
+// Binaries are only valid for the driver that produced them, so the key
+// covers the driver as well as the sources.
+
+#define PROGBIN_VERSION 1
+
+struct ProgramBinHeader {
+    char magic[8];          // "PROGBIN\0"
+    uint32_t version;
+    uint32_t binary_format; // driver-specific, as returned by glGetProgramBinary
+    uint64_t key;           // programCacheKey()
+    uint64_t binary_size;
+    uint64_t binary_hash;   // detects truncated/corrupt payloads
+};
+
+struct ShaderStageSource {
+    GLenum type;            // GL_VERTEX_SHADER, ...
+    std::string text;
+};
+
+// False when the driver offers no binary formats (the cache is then skipped)
+bool programBinariesSupported();
+
+// Hash of the stage types and sources, the defines and
+// GL_VENDOR/GL_RENDERER/GL_VERSION; needs a current context
+uint64_t programCacheKey(const std::vector<ShaderStageSource>& stages, const std::string& defines);
+
+// <dir>/<name>-<key>.progbin
+std::filesystem::path programCachePath(const std::filesystem::path& dir, const std::string& name, uint64_t key);
+
+// Linked program restored from the cache, or 0 if missing, corrupt or
+// rejected by the driver (a rejected file is deleted)
+GLuint loadProgramBinary(const std::filesystem::path& dir, const std::string& name, uint64_t key);
+
+// Saves a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT and removes
+// older binaries of the same name
+bool saveProgramBinary(const std::filesystem::path& dir, const std::string& name, uint64_t key, GLuint program);
@@ -0,0 +1,59 @@
+#include "shader_variants.hpp"
+
+#include <iostream>
+
+namespace {
+
+struct FeatureName {
+    ShaderFeature feature;
+    const char* define; // tex.frag / tex.vert
+    const char* label;
+};
+
+const FeatureName FEATURES[] = {
+    { SHADER_SUN, "SUN_LIGHT", "sun" },
+    { SHADER_POINT_LIGHTS, "POINT_LIGHTS", "point" },
+    { SHADER_SPOT_LIGHT, "SPOT_LIGHT", "spot" },
+    { SHADER_ALPHA_TEST, "ALPHA_TEST", "alphatest" },
+    { SHADER_FOG, "FOG", "fog" },
+    { SHADER_TERRAIN, "TERRAIN", "terrain" },
+    { SHADER_TERRAIN_TEXTURE, "TERRAIN_TEXTURE", "terraintex" },
+};
+
+} // namespace
+
+std::string ShaderVariants::defines(unsigned features) {
+    std::string text = "#define VARIANT\n";
+    for (const FeatureName& f : FEATURES)
+        if (features & f.feature) text += std::string("#define ") + f.define + "\n";
+    return text;
+}
+
+std::string ShaderVariants::describe(unsigned features) {
+    std::string text;
+    for (const FeatureName& f : FEATURES)
+        if (features & f.feature) text += (text.empty() ? "" : "+") + std::string(f.label);
+    return text.empty() ? "unlit" : text;
+}
+
+void ShaderVariants::request(ShaderBatch& batch, unsigned features) {
+    auto [it, inserted] = variants.try_emplace(features);
+    if (!inserted) return;
+    batch.add(it->second, vs_file, fs_file, defines(features));
+    std::cout << "[ShaderVariants] " << vs_file.stem().string() << " [" << describe(features) << "] queued\n";
+}
+
+ShaderProgram& ShaderVariants::get(unsigned features) {
+    auto it = variants.find(features);
+    if (it != variants.end()) return it->second;
+
+    // not requested up front: compile synchronously
+    std::cout << "[ShaderVariants] " << vs_file.stem().string() << " [" << describe(features) << "] built on demand\n";
+    return variants.emplace(features, ShaderProgram(vs_file, fs_file, defines(features))).first->second;
+}
+
+void ShaderVariants::clear() {
+    for (auto& [features, program] : variants)
+        if (program.ID) program.clear();
+    variants.clear();
+}
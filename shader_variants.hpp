@@ -0,0 +1,57 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <string>
+
+#include "ShaderProgram.hpp"
+
+// Compile-time features of tex.vert/tex.frag. Every set bit becomes a
+// #define, so a variant contains only the lighting it needs; a build
+// without any (e.g. the benchmarks) gets all of them.
+enum ShaderFeature : unsigned {
+    SHADER_SUN          = 1u << 0, // directional light
+    SHADER_POINT_LIGHTS = 1u << 1, // light buffer point lights (clustered or brute force)
+    SHADER_SPOT_LIGHT   = 1u << 2, // camera flashlight
+    SHADER_ALPHA_TEST   = 1u << 3, // discard texels with alpha < 0.1
+    SHADER_FOG          = 1u << 4, // exponential distance fog
+    SHADER_TERRAIN      = 1u << 5, // vertices displaced from a height texture (ChunkedTerrain)
+    SHADER_TERRAIN_TEXTURE = 1u << 6, // texcoords pick an atlas tile, mirrored across it per fragment from world xz
+};
+
+// what most of the scene uses
+constexpr unsigned SHADER_LIT = SHADER_SUN | SHADER_POINT_LIGHTS | SHADER_SPOT_LIGHT;
+
+// One vertex/fragment source pair compiled once per feature set. Variants
+// are built on first use (or queued up front on a ShaderBatch) and then
+// shared; callers keep copies of the returned program like any other.
+class ShaderVariants {
+public:
+    ShaderVariants() = default;
+    ShaderVariants(const std::filesystem::path& VS_file, const std::filesystem::path& FS_file)
+        : vs_file(VS_file), fs_file(FS_file) {}
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+    ShaderVariants(ShaderVariants&&) = default;
+    ShaderVariants& operator=(ShaderVariants&&) = default;
+
+    // "#define VARIANT\n#define SUN_LIGHT\n..." for a feature mask
+    static std::string defines(unsigned features);
+    static std::string describe(unsigned features); // "sun+point+spot"
+
+    // Queues the variant on a startup batch unless it exists already
+    void request(ShaderBatch& batch, unsigned features);
+
+    // The variant for features; compiled now if nobody requested it before
+    ShaderProgram& get(unsigned features);
+
+    // Built variants by feature mask (per-frame uniforms go to each)
+    const std::map<unsigned, ShaderProgram>& programs() const { return variants; }
+
+    void clear();
+
+private:
+    std::filesystem::path vs_file, fs_file;
+    std::map<unsigned, ShaderProgram> variants; // node-based: batch targets stay put
+};
@@ -0,0 +1,137 @@
+#include "terrain_mesher.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void computeTerrainNormals(const float* heights, int cols, int rows, float spacing, std::vector<glm::vec3>& normals) {
+    normals.resize(size_t(cols) * rows);
+    if (cols <= 0 || rows <= 0) return;
+
+    // separable Sobel: [1 2 1] down the columns and [-1 0 1] along the row
+    // for d/dx, the other way round for d/dz; both sum 8 * spacing * slope
+    std::vector<float> smooth(cols), diff(cols), nx(cols), nz(cols), inv_length(cols);
+    const float k = -1.0f / (8.0f * spacing);
+    const int last = cols - 1;
+
+    for (int r = 0; r < rows; ++r) {
+        const float* up = heights + size_t(std::max(r - 1, 0)) * cols;
+        const float* mid = heights + size_t(r) * cols;
+        const float* down = heights + size_t(std::min(r + 1, rows - 1)) * cols;
+        // a one-sided difference on the first and last row spans half the distance
+        const float edge_z = (r == 0 || r == rows - 1) && rows > 1 ? 2.0f : 1.0f;
+
+        for (int c = 0; c < cols; ++c) {
+            smooth[c] = up[c] + 2.0f * mid[c] + down[c];
+            diff[c] = edge_z * (down[c] - up[c]);
+        }
+
+        // interior columns without clamping so the loop stays branch-free;
+        // the edge columns replicate their sample (one-sided in x)
+        for (int c = 1; c < last; ++c) {
+            nx[c] = k * (smooth[c + 1] - smooth[c - 1]);
+            nz[c] = k * (diff[c - 1] + 2.0f * diff[c] + diff[c + 1]);
+        }
+        nx[0] = 2.0f * k * (smooth[std::min(1, last)] - smooth[0]);
+        nz[0] = k * (3.0f * diff[0] + diff[std::min(1, last)]);
+        if (last > 0) {
+            nx[last] = 2.0f * k * (smooth[last] - smooth[last - 1]);
+            nz[last] = k * (diff[last - 1] + 3.0f * diff[last]);
+        }
+
+        for (int c = 0; c < cols; ++c)
+            inv_length[c] = 1.0f / std::sqrt(nx[c] * nx[c] + nz[c] * nz[c] + 1.0f);
+
+        glm::vec3* out = normals.data() + size_t(r) * cols;
+        for (int c = 0; c < cols; ++c)
+            out[c] = glm::vec3(nx[c] * inv_length[c], inv_length[c], nz[c] * inv_length[c]);
+    }
+}
+
+TerrainMeshStats buildTerrainMesh(const unsigned char* heights, int width, int height, size_t row_stride,
+    const TerrainMeshParams& params, std::vector<vertex>& vertices, std::vector<GLuint>& indices)
+{
+    TerrainMeshStats stats;
+    vertices.clear();
+    indices.clear();
+    if (width <= 0 || height <= 0) return stats;
+
+    const int step = std::max(1, params.step);
+    const int cols = (width - 1) / step + 1, rows = (height - 1) / step + 1;
+    stats.cols = cols;
+    stats.rows = rows;
+
+    std::vector<float> samples(size_t(cols) * rows);
+    for (int r = 0; r < rows; ++r) {
+        const unsigned char* row = heights + size_t(r) * step * row_stride;
+        float* out = samples.data() + size_t(r) * cols;
+        for (int c = 0; c < cols; ++c) out[c] = float(row[size_t(c) * step]) * params.height_scale;
+    }
+
+    std::vector<glm::vec3> normals;
+    computeTerrainNormals(samples.data(), cols, rows, float(step), normals);
+
+    vertices.resize(samples.size());
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            const size_t i = size_t(r) * cols + c;
+            vertices[i] = vertex(glm::vec3(float(c * step), samples[i], float(r * step)), normals[i],
+                glm::vec2(float(c & 1), float(r & 1)));
+        }
+    }
+
+    // two triangles per cell, counter-clockwise from above: (c, r+1) -> (c+1, r+1) -> (c, r),
+    // each ending on (c, r) (the provoking vertex)
+    indices.resize(size_t(cols - 1) * (rows - 1) * 6);
+    GLuint* out = indices.data();
+    for (int r = 0; r + 1 < rows; ++r) {
+        for (int c = 0; c + 1 < cols; ++c) {
+            const GLuint i00 = GLuint(r * cols + c), i10 = i00 + 1, i01 = i00 + GLuint(cols), i11 = i01 + 1;
+            *out++ = i01; *out++ = i11; *out++ = i00;
+            *out++ = i11; *out++ = i10; *out++ = i00;
+        }
+    }
+    stats.triangles = indices.size() / 3;
+    return stats;
+}
+
+void buildTerrainPatchIndices(int cells, std::vector<GLushort>& indices) {
+    const int S = cells, n = S + 1;
+    indices.clear();
+    indices.reserve(size_t(S) * S * 6 + 4 * size_t(S) * 6);
+    for (int r = 0; r < S; ++r) {
+        for (int c = 0; c < S; ++c) {
+            const GLushort i00 = GLushort(r * n + c), i10 = GLushort(i00 + 1), i01 = GLushort(i00 + n), i11 = GLushort(i01 + 1);
+            indices.insert(indices.end(), { i01, i11, i00, i11, i10, i00 });
+        }
+    }
+    auto grid = [&](int edge, int k) {
+        switch (edge) {
+        case 0: return k;
+        case 1: return S * n + k;
+        case 2: return k * n;
+        default: return k * n + S;
+        }
+    };
+    for (int edge = 0; edge < 4; ++edge) {
+        const bool flip = (edge == 0 || edge == 3);
+        for (int k = 0; k < S; ++k) {
+            const GLushort g0 = GLushort(grid(edge, k)), g1 = GLushort(grid(edge, k + 1));
+            const GLushort s0 = GLushort(n * n + edge * n + k), s1 = GLushort(s0 + 1);
+            if (flip) indices.insert(indices.end(), { g0, s1, s0, g0, g1, s1 });
+            else indices.insert(indices.end(), { g0, s0, s1, g0, s1, g1 });
+        }
+    }
+}
+
+void buildTerrainSkirts(std::vector<vertex>& vertices, int cells, float depth, float floor_y) {
+    const int S = cells, n = S + 1;
+    vertices.resize(size_t(n) * n + 4 * size_t(n));
+    for (int edge = 0; edge < 4; ++edge) {
+        for (int k = 0; k < n; ++k) {
+            const int g = edge == 0 ? k : edge == 1 ? S * n + k : edge == 2 ? k * n : k * n + S;
+            vertex v = vertices[g];
+            v.position.y = std::max(v.position.y - depth, floor_y);
+            vertices[size_t(n) * n + size_t(edge) * n + k] = v;
+        }
+    }
+}
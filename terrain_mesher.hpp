@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "assets.hpp"
+
+// Turns a heightmap into a shared-vertex grid: one vertex per sample and a
+// single indexed triangle list over it, instead of four unique vertices per
+// quad. Normals are smooth, from a Sobel pass over the sampled heights.
+
+struct TerrainMeshParams {
+    int step{ 1 };              // heightmap pixels between neighbouring samples
+    float height_scale{ 1.0f }; // model y per height unit
+};
+
+struct TerrainMeshStats {
+    int cols{ 0 }, rows{ 0 };   // samples per grid row / column
+    size_t triangles{ 0 };
+};
+
+// heights is row-major 8-bit (row = z, column = x). Vertex (c, r) sits at
+// x = c * step, z = r * step, y = height * height_scale. Texture
+// coordinates alternate 0/1 between neighbouring samples, so every cell
+// maps one whole texture tile (mirrored in every other cell, no seams).
+// Triangles wind counter-clockwise seen from +y, and both of a cell's end
+// on its (c, r) vertex: that vertex is the provoking one, so a flat
+// attribute on it is the cell's.
+TerrainMeshStats buildTerrainMesh(const unsigned char* heights, int width, int height, size_t row_stride,
+    const TerrainMeshParams& params, std::vector<vertex>& vertices, std::vector<GLuint>& indices);
+
+// Unit normals of the surface y = heights (row-major cols x rows floats,
+// already in model units) sampled every spacing units in x and z; Sobel
+// gradients, edges clamped. Rows are processed as flat float arrays the
+// compiler vectorizes.
+void computeTerrainNormals(const float* heights, int cols, int rows, float spacing, std::vector<glm::vec3>& normals);
+
+// Patch layout shared by the streamed terrains: a (cells + 1)^2 vertex grid
+// followed by one skirt row of cells + 1 vertices per edge, in the order
+// top (r = 0), bottom (r = cells), left (c = 0), right (c = cells).
+// Fills the indices of the grid (as buildTerrainMesh) and of the skirt
+// quads, which face outwards; cells <= 128 so they fit 16 bits.
+void buildTerrainPatchIndices(int cells, std::vector<GLushort>& indices);
+
+// Writes the skirt rows after the grid of vertices (resized to the patch
+// size): copies of the edge vertices lowered by depth, but not below floor_y
+void buildTerrainSkirts(std::vector<vertex>& vertices, int cells, float depth, float floor_y);
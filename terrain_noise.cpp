@@ -0,0 +1,365 @@
+#include "terrain_noise.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TERRAIN_NOISE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr float F2 = 0.366025403784f;   // (sqrt(3) - 1) / 2: skews x, y onto the simplex grid
+constexpr float G2 = 0.211324865405f;   // (3 - sqrt(3)) / 6: unskews back
+constexpr float SQRT2 = 1.41421356237f;
+constexpr uint32_t OCTAVE_SEED = 0x9E3779B9u;
+constexpr uint32_t WARP_SEED_X = 0x68E31DA4u, WARP_SEED_Z = 0xB5297A4Du;
+constexpr int BAND_ROWS = 16;
+
+// The noise evaluated for one parameter set; amplitudes pre-normalized so
+// every fBm sums to [-1, 1]
+struct Field {
+    uint32_t seed;
+    float frequency, lacunarity;
+    float amplitudes[32];
+    int octaves;
+    float warp, warp_frequency;
+    float warp_amplitudes[32];
+    int warp_octaves;
+    float contrast;
+
+    explicit Field(const NoiseTerrainParams& p)
+        : seed(p.seed), frequency(p.frequency), lacunarity(p.lacunarity),
+        octaves(std::clamp(p.octaves, 1, 32)), warp(p.warp), warp_frequency(p.warp_frequency),
+        warp_octaves(std::clamp(p.warp_octaves, 0, 32)), contrast(p.contrast)
+    {
+        normalize(amplitudes, octaves, p.gain);
+        normalize(warp_amplitudes, warp_octaves, p.gain);
+        if (warp == 0.0f) warp_octaves = 0;
+    }
+
+    static void normalize(float* amplitude, int count, float gain) {
+        float sum = 0.0f, a = 1.0f;
+        for (int o = 0; o < count; ++o, a *= gain) sum += (amplitude[o] = a);
+        for (int o = 0; o < count; ++o) amplitude[o] /= sum;
+    }
+};
+
+// --- scalar kernel ---------------------------------------------------------
+
+// Corner hash from the premultiplied lattice coordinates (i * HASH_X, j *
+// HASH_Y), so the other two corners of a simplex only add HASH_X / HASH_Y
+constexpr uint32_t HASH_X = 0x27D4EB2Du, HASH_Y = 0x165667B1u, HASH_MIX = 0x2C1B3C6Du;
+
+// gradient index in the top three bits of the product, which all input bits reach
+inline uint32_t hash(uint32_t ix, uint32_t jy, uint32_t seed) {
+    uint32_t h = ix ^ jy ^ seed;
+    h ^= h >> 16;
+    return (h * HASH_MIX) >> 29;
+}
+
+// 8 gradients of length sqrt(2): the diagonals (bit 2 clear) and the axes
+inline float grad(uint32_t h, float x, float y) {
+    if (h & 4) {
+        const float v = (h & 2) ? y : x;
+        return (h & 1) ? -SQRT2 * v : SQRT2 * v;
+    }
+    return ((h & 1) ? -x : x) + ((h & 2) ? -y : y);
+}
+
+inline float corner(uint32_t h, float x, float y) {
+    float t = std::max(0.5f - x * x - y * y, 0.0f);
+    t *= t;
+    return t * t * grad(h, x, y);
+}
+
+float simplex(float x, float y, uint32_t seed) {
+    const float s = (x + y) * F2;
+    const float fi = std::floor(x + s), fj = std::floor(y + s);
+    const float t = (fi + fj) * G2;
+    const float x0 = x - (fi - t), y0 = y - (fj - t);
+    const int i1 = x0 > y0 ? 1 : 0, j1 = 1 - i1;
+    const float x1 = x0 - float(i1) + G2, y1 = y0 - float(j1) + G2;
+    const float x2 = x0 + (-1.0f + 2.0f * G2), y2 = y0 + (-1.0f + 2.0f * G2); // rounded as the SSE2 kernel
+    const uint32_t ix = uint32_t(int32_t(fi)) * HASH_X, jy = uint32_t(int32_t(fj)) * HASH_Y;
+    return 70.0f * (corner(hash(ix, jy, seed), x0, y0) + corner(hash(ix + (i1 ? HASH_X : 0u), jy + (i1 ? 0u : HASH_Y), seed), x1, y1)
+        + corner(hash(ix + HASH_X, jy + HASH_Y, seed), x2, y2));
+}
+
+float fbm(float x, float y, float frequency, float lacunarity, const float* amplitudes, int octaves, uint32_t seed) {
+    float sum = 0.0f;
+    for (int o = 0; o < octaves; ++o, frequency *= lacunarity)
+        sum += amplitudes[o] * simplex(x * frequency, y * frequency, seed + uint32_t(o) * OCTAVE_SEED);
+    return sum;
+}
+
+void fbmScalar(const float* x, const float* y, int count, float frequency, float lacunarity,
+    const float* amplitudes, int octaves, uint32_t seed, float* out)
+{
+    for (int k = 0; k < count; ++k) out[k] = fbm(x[k], y[k], frequency, lacunarity, amplitudes, octaves, seed);
+}
+
+// --- SSE2 kernel: the same function, four samples per call ----------------
+
+#ifdef TERRAIN_NOISE_SSE2
+
+// 32-bit low multiply (SSE4.1 has it as one instruction, SSE2 does not)
+inline __m128i mullo(__m128i a, __m128i b) {
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+inline __m128i hash4(__m128i ix, __m128i jy, __m128i seed) {
+    __m128i h = _mm_xor_si128(_mm_xor_si128(ix, jy), seed);
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+    return _mm_srli_epi32(mullo(h, _mm_set1_epi32(int(HASH_MIX))), 29);
+}
+
+inline __m128 select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_andnot_ps(mask, a), _mm_and_ps(mask, b)); }
+
+inline __m128 bitMask(__m128i h, int bit) {
+    const __m128i b = _mm_set1_epi32(bit);
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, b), b));
+}
+
+inline __m128 grad4(__m128i h, __m128 x, __m128 y) {
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 m1 = bitMask(h, 1), m2 = bitMask(h, 2), m4 = bitMask(h, 4);
+    const __m128 diagonal = _mm_add_ps(_mm_xor_ps(x, _mm_and_ps(m1, sign)), _mm_xor_ps(y, _mm_and_ps(m2, sign)));
+    const __m128 axis = _mm_mul_ps(_mm_xor_ps(select(m2, x, y), _mm_and_ps(m1, sign)), _mm_set1_ps(SQRT2));
+    return select(m4, diagonal, axis);
+}
+
+inline __m128 corner4(__m128i h, __m128 x, __m128 y) {
+    __m128 t = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y));
+    t = _mm_max_ps(t, _mm_setzero_ps());
+    t = _mm_mul_ps(t, t);
+    return _mm_mul_ps(_mm_mul_ps(t, t), grad4(h, x, y));
+}
+
+// floor without SSE4.1: truncate, then step down where that rounded up
+inline __m128 floor4(__m128 x) {
+    const __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+
+__m128 simplex4(__m128 x, __m128 y, __m128i seed) {
+    const __m128 s = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(F2));
+    const __m128 fi = floor4(_mm_add_ps(x, s)), fj = floor4(_mm_add_ps(y, s));
+    const __m128 t = _mm_mul_ps(_mm_add_ps(fi, fj), _mm_set1_ps(G2));
+    const __m128 x0 = _mm_sub_ps(x, _mm_sub_ps(fi, t)), y0 = _mm_sub_ps(y, _mm_sub_ps(fj, t));
+
+    const __m128 lower = _mm_cmpgt_ps(x0, y0); // x step first
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 i1 = _mm_and_ps(lower, one), j1 = _mm_andnot_ps(lower, one);
+    const __m128 g2 = _mm_set1_ps(G2);
+    const __m128 x1 = _mm_add_ps(_mm_sub_ps(x0, i1), g2), y1 = _mm_add_ps(_mm_sub_ps(y0, j1), g2);
+    const __m128 corner2 = _mm_set1_ps(-1.0f + 2.0f * G2);
+    const __m128 x2 = _mm_add_ps(x0, corner2), y2 = _mm_add_ps(y0, corner2);
+
+    const __m128i hash_x = _mm_set1_epi32(int(HASH_X)), hash_y = _mm_set1_epi32(int(HASH_Y));
+    const __m128i ix = mullo(_mm_cvttps_epi32(fi), hash_x), jy = mullo(_mm_cvttps_epi32(fj), hash_y);
+    const __m128i step_x = _mm_and_si128(_mm_castps_si128(lower), hash_x), step_y = _mm_andnot_si128(_mm_castps_si128(lower), hash_y);
+    const __m128 n = _mm_add_ps(_mm_add_ps(corner4(hash4(ix, jy, seed), x0, y0),
+        corner4(hash4(_mm_add_epi32(ix, step_x), _mm_add_epi32(jy, step_y), seed), x1, y1)),
+        corner4(hash4(_mm_add_epi32(ix, hash_x), _mm_add_epi32(jy, hash_y), seed), x2, y2));
+    return _mm_mul_ps(n, _mm_set1_ps(70.0f));
+}
+
+__m128 fbm4(__m128 x, __m128 y, float frequency, float lacunarity, const float* amplitudes, int octaves, uint32_t seed) {
+    __m128 sum = _mm_setzero_ps();
+    for (int o = 0; o < octaves; ++o, frequency *= lacunarity) {
+        const __m128 f = _mm_set1_ps(frequency);
+        const __m128 n = simplex4(_mm_mul_ps(x, f), _mm_mul_ps(y, f), _mm_set1_epi32(int(seed + uint32_t(o) * OCTAVE_SEED)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(amplitudes[o]), n));
+    }
+    return sum;
+}
+
+// count is a multiple of 4
+void fbmSSE2(const float* x, const float* y, int count, float frequency, float lacunarity,
+    const float* amplitudes, int octaves, uint32_t seed, float* out)
+{
+    for (int k = 0; k < count; k += 4)
+        _mm_storeu_ps(out + k, fbm4(_mm_loadu_ps(x + k), _mm_loadu_ps(y + k), frequency, lacunarity, amplitudes, octaves, seed));
+}
+
+#endif
+
+// fBm at count points (x[k], y[k]); the arrays are padded to a multiple of 4
+void fbmPoints(bool simd, const float* x, const float* y, int count, float frequency, float lacunarity,
+    const float* amplitudes, int octaves, uint32_t seed, float* out)
+{
+#ifdef TERRAIN_NOISE_SSE2
+    if (simd) {
+        fbmSSE2(x, y, (count + 3) & ~3, frequency, lacunarity, amplitudes, octaves, seed, out);
+        return;
+    }
+#endif
+    fbmScalar(x, y, count, frequency, lacunarity, amplitudes, octaves, seed, out);
+}
+
+inline int floorDiv(int a, int b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+// Rows of one band. The warp is smooth, so it is evaluated on a lattice of
+// WARP_CELL pixels (in absolute coordinates, so regions still line up) and
+// interpolated bilinearly; the main fBm runs at every sample.
+class RowGenerator {
+public:
+    RowGenerator(const Field& field, bool simd, int x0, int width)
+        : f(field), simd(simd), x0(x0), width(width), padded((width + 3) & ~3),
+        gx0(floorDiv(x0, WARP_CELL)), lattice_count(floorDiv(x0 + width - 1, WARP_CELL) - gx0 + 2),
+        lattice_padded((lattice_count + 3) & ~3)
+    {
+        x.resize(padded);
+        y.resize(padded);
+        for (int k = 0; k < padded; ++k) x[k] = float(x0 + k);
+        lattice_x.resize(lattice_padded);
+        lattice_y.resize(lattice_padded);
+        for (int k = 0; k < lattice_padded; ++k) lattice_x[k] = float((gx0 + k) * WARP_CELL);
+        for (auto* rows : { &warp_x, &warp_z })
+            for (auto& r : *rows) r.resize(lattice_padded);
+    }
+
+    void row(int z, float* out) {
+        std::fill(y.begin(), y.end(), float(z));
+        if (f.warp_octaves > 0) {
+            const int gz = floorDiv(z, WARP_CELL);
+            latticeRows(gz);
+            const float tz = float(z - gz * WARP_CELL) / WARP_CELL;
+            wx.resize(padded);
+            wz.resize(padded);
+            for (int k = 0; k < padded; ++k) {
+                const int px = x0 + std::min(k, width - 1);
+                const int g = floorDiv(px, WARP_CELL), i = g - gx0;
+                const float tx = float(px - g * WARP_CELL) / WARP_CELL;
+                auto bilinear = [&](const std::vector<float>(&r)[2]) {
+                    const float top = r[0][i] + (r[0][i + 1] - r[0][i]) * tx;
+                    const float bottom = r[1][i] + (r[1][i + 1] - r[1][i]) * tx;
+                    return top + (bottom - top) * tz;
+                };
+                wx[k] = x[k] + f.warp * bilinear(warp_x);
+                wz[k] = y[k] + f.warp * bilinear(warp_z);
+            }
+            fbmPoints(simd, wx.data(), wz.data(), width, f.frequency, f.lacunarity, f.amplitudes, f.octaves, f.seed, out);
+        }
+        else {
+            fbmPoints(simd, x.data(), y.data(), width, f.frequency, f.lacunarity, f.amplitudes, f.octaves, f.seed, out);
+        }
+    }
+
+private:
+    static constexpr int WARP_CELL = 8;
+
+    const Field& f;
+    const bool simd;
+    const int x0, width, padded;
+    const int gx0, lattice_count, lattice_padded;
+    std::vector<float> x, y, wx, wz, lattice_x, lattice_y;
+    std::vector<float> warp_x[2], warp_z[2]; // lattice rows gz and gz + 1
+    int cached_gz{ INT32_MIN };
+
+    void latticeRows(int gz) {
+        if (gz == cached_gz) return;
+        if (gz == cached_gz + 1) {
+            std::swap(warp_x[0], warp_x[1]);
+            std::swap(warp_z[0], warp_z[1]);
+            latticeRow(gz + 1, 1);
+        }
+        else {
+            latticeRow(gz, 0);
+            latticeRow(gz + 1, 1);
+        }
+        cached_gz = gz;
+    }
+
+    void latticeRow(int gz, int slot) {
+        std::fill(lattice_y.begin(), lattice_y.end(), float(gz * WARP_CELL));
+        fbmPoints(simd, lattice_x.data(), lattice_y.data(), lattice_count, f.warp_frequency, f.lacunarity,
+            f.warp_amplitudes, f.warp_octaves, f.seed ^ WARP_SEED_X, warp_x[slot].data());
+        fbmPoints(simd, lattice_x.data(), lattice_y.data(), lattice_count, f.warp_frequency, f.lacunarity,
+            f.warp_amplitudes, f.warp_octaves, f.seed ^ WARP_SEED_Z, warp_z[slot].data());
+    }
+};
+
+} // namespace
+
+NoiseTerrainStats generateNoiseHeights(const NoiseTerrainParams& params, int x0, int z0, int width, int height,
+    unsigned char* out, size_t row_stride, unsigned thread_count)
+{
+    NoiseTerrainStats stats;
+    if (width <= 0 || height <= 0) return stats;
+    auto start = std::chrono::steady_clock::now();
+
+    const Field field(params);
+#ifdef TERRAIN_NOISE_SSE2
+    stats.simd = params.simd;
+#endif
+    if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+    const size_t band_count = (size_t(height) + BAND_ROWS - 1) / BAND_ROWS;
+    thread_count = unsigned(std::min<size_t>(thread_count, band_count));
+    stats.threads = thread_count;
+
+    const float scale = 127.5f * field.contrast;
+    std::atomic<size_t> clipped{ 0 };
+    auto band = [&](size_t b) {
+        std::vector<float> row((size_t(width) + 3) & ~size_t(3));
+        RowGenerator rows(field, stats.simd, x0, width);
+        size_t band_clipped = 0;
+        const int r1 = std::min(height, int(b + 1) * BAND_ROWS);
+        for (int r = int(b) * BAND_ROWS; r < r1; ++r) {
+            rows.row(z0 + r, row.data());
+
+            unsigned char* dst = out + size_t(r) * row_stride;
+            for (int c = 0; c < width; ++c) {
+                const float v = 127.5f + scale * row[c];
+                band_clipped += (v < 0.0f) | (v > 255.0f);
+                dst[c] = (unsigned char)(std::clamp(v, 0.0f, 255.0f) + 0.5f);
+            }
+        }
+        clipped += band_clipped;
+    };
+
+    // bands are interleaved across threads, as the maze mesher
+    if (thread_count <= 1) {
+        for (size_t b = 0; b < band_count; ++b) band(b);
+    }
+    else {
+        std::vector<std::thread> workers;
+        workers.reserve(thread_count);
+        for (unsigned t = 0; t < thread_count; ++t)
+            workers.emplace_back([&, t] {
+                for (size_t b = t; b < band_count; b += thread_count) band(b);
+            });
+        for (auto& w : workers) w.join();
+    }
+
+    stats.clipped = clipped;
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+uint64_t noiseParamsHash(const NoiseTerrainParams& params) {
+    // FNV-1a over the fields that shape the output (simd does not)
+    uint64_t h = 0xCBF29CE484222325ull;
+    auto mix = [&h](const void* data, size_t size) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) h = (h ^ p[i]) * 0x100000001B3ull;
+    };
+    mix(&params.seed, sizeof(params.seed));
+    mix(&params.frequency, sizeof(params.frequency));
+    mix(&params.octaves, sizeof(params.octaves));
+    mix(&params.lacunarity, sizeof(params.lacunarity));
+    mix(&params.gain, sizeof(params.gain));
+    mix(&params.warp, sizeof(params.warp));
+    mix(&params.warp_frequency, sizeof(params.warp_frequency));
+    mix(&params.warp_octaves, sizeof(params.warp_octaves));
+    mix(&params.contrast, sizeof(params.contrast));
+    return h;
+}
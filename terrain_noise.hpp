@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Procedural heightmaps: fractal (fBm) 2D simplex noise over a domain warped
+// by a second, low-frequency fBm. The field is infinite and deterministic per
+// seed, so any region can be generated on its own (bands, tiles) and the
+// pieces line up exactly.
+//
+// Four samples along a row are evaluated at once with SSE2 where available
+// (hashed gradients, no permutation table, so no gathers); the scalar path
+// computes the same function. Rows are split into bands across threads.
+
+struct NoiseTerrainParams {
+    uint32_t seed{ 1337 };
+    float frequency{ 1.0f / 1024.0f };  // of the first octave, per pixel
+    int octaves{ 8 };
+    float lacunarity{ 2.0f };           // frequency factor per octave
+    float gain{ 0.5f };                 // amplitude factor per octave
+    float warp{ 96.0f };                // pixels the domain warp shifts a sample by, at most
+    float warp_frequency{ 1.0f / 2048.0f };
+    int warp_octaves{ 3 };
+    float contrast{ 1.6f };             // fBm in [-1, 1] times this maps to [0, 255]
+    bool simd{ true };                  // false: scalar kernel (comparisons)
+};
+
+struct NoiseTerrainStats {
+    double ms{ 0.0 };
+    unsigned threads{ 0 };
+    bool simd{ false };                 // the SSE2 kernel ran
+    size_t clipped{ 0 };                // samples clamped to 0 or 255
+};
+
+// Fills the width x height region at (x0, z0) of the field with 8-bit heights
+// (row-major, row = z, column = x) on thread_count threads (0 = all cores)
+NoiseTerrainStats generateNoiseHeights(const NoiseTerrainParams& params, int x0, int z0, int width, int height,
+    unsigned char* out, size_t row_stride, unsigned thread_count = 0);
+
+// Key of everything that changes the field (caches of generated terrain)
+uint64_t noiseParamsHash(const NoiseTerrainParams& params);
@@ -0,0 +1,248 @@
+#include "terrain_raycast.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+constexpr size_t BATCH_BLOCK = 64;           // rays per work item of a batch
+constexpr size_t MIN_RAYS_PER_THREAD = 512;  // below this a thread costs more than it saves
+
+} // namespace
+
+void TerrainRaycaster::build(const unsigned char* heights, int width, int height, size_t row_stride) {
+    clear();
+    if (!heights || width < 2 || height < 2) return;
+
+    heights_ = heights;
+    width_ = width;
+    height_ = height;
+    row_stride_ = row_stride;
+    auto start = std::chrono::steady_clock::now();
+
+    pyramid_.build(heights, width, height, row_stride, LEAF_CELLS);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "[Raycast] " << width_ << "x" << height_ << " heightmap: " << levels() << " levels of min/max, "
+        << (bytes() >> 10) << " KB | " << ms << " ms\n";
+}
+
+void TerrainRaycaster::setTransform(const glm::vec3& origin, const glm::vec3& scale, float height_scale) {
+    origin_ = origin;
+    scale_ = scale;
+    y_per_height_ = scale.y * height_scale;
+}
+
+void TerrainRaycaster::clear() {
+    heights_ = nullptr;
+    width_ = height_ = 0;
+    pyramid_.clear();
+}
+
+void TerrainRaycaster::rangeY(const HeightPyramid::Range& range, float& lo, float& hi) const {
+    const float a = origin_.y + y_per_height_ * float(range.lo), b = origin_.y + y_per_height_ * float(range.hi);
+    lo = std::min(a, b);
+    hi = std::max(a, b);
+}
+
+TerrainRaycaster::GridRay TerrainRaycaster::gridRay(const glm::vec3& origin, const glm::vec3& direction) const {
+    GridRay ray;
+    ray.x = (origin.x - origin_.x) / scale_.x;
+    ray.z = (origin.z - origin_.z) / scale_.z;
+    ray.y = origin.y;
+    ray.dx = direction.x / scale_.x;
+    ray.dz = direction.z / scale_.z;
+    ray.dy = direction.y;
+    ray.inv_dx = ray.dx != 0.0f ? 1.0f / ray.dx : 0.0f;
+    ray.inv_dz = ray.dz != 0.0f ? 1.0f / ray.dz : 0.0f;
+    ray.origin = origin;
+    ray.direction = direction;
+    return ray;
+}
+
+bool TerrainRaycaster::clipBox(const GridRay& ray, float x0, float x1, float z0, float z1, float& ta, float& tb) const {
+    // a ray parallel to a slab is either inside it for every t or never
+    if (ray.dx != 0.0f) {
+        float t0 = (x0 - ray.x) * ray.inv_dx, t1 = (x1 - ray.x) * ray.inv_dx;
+        if (t0 > t1) std::swap(t0, t1);
+        ta = std::max(ta, t0);
+        tb = std::min(tb, t1);
+    }
+    else if (ray.x < x0 || ray.x > x1) return false;
+    if (ray.dz != 0.0f) {
+        float t0 = (z0 - ray.z) * ray.inv_dz, t1 = (z1 - ray.z) * ray.inv_dz;
+        if (t0 > t1) std::swap(t0, t1);
+        ta = std::max(ta, t0);
+        tb = std::min(tb, t1);
+    }
+    else if (ray.z < z0 || ray.z > z1) return false;
+    return ta <= tb;
+}
+
+bool TerrainRaycaster::raycast(const glm::vec3& origin, const glm::vec3& direction, float max_t, TerrainHit& hit,
+    TerrainRaycastStats* stats) const
+{
+    hit = TerrainHit{};
+    if (empty()) return false;
+    const GridRay ray = gridRay(origin, direction);
+    float ta = 0.0f, tb = max_t;
+    if (!clipBox(ray, 0.0f, float(width_ - 1), 0.0f, float(height_ - 1), ta, tb)) return false;
+
+    // children of a node in the order the ray meets them: the near/near one
+    // first and the far/far one last; a line crosses at most one of the other
+    // two, so their order does not matter. Pushed in reverse.
+    const int near_x = ray.dx >= 0.0f ? 0 : 1, near_z = ray.dz >= 0.0f ? 0 : 1;
+    const int order[4][2] = { { near_x, near_z }, { 1 - near_x, near_z }, { near_x, 1 - near_z }, { 1 - near_x, 1 - near_z } };
+
+    struct Node { int level, ix, iz; float ta, tb; };
+    Node stack[3 * 32 + 1];
+    int top = 0;
+    stack[top++] = { levels() - 1, 0, 0, ta, tb };
+    while (top > 0) {
+        const Node node = stack[--top];
+        const HeightPyramid::Level& level = pyramid_.level(node.level);
+        if (stats) ++stats->nodes;
+
+        // skip the node if the ray stays above all of it (y is linear in t)
+        float lo, hi;
+        rangeY(level.at(node.ix, node.iz), lo, hi);
+        const float y0 = ray.y + node.ta * ray.dy, y1 = ray.y + node.tb * ray.dy;
+        if (std::min(y0, y1) > hi) continue;
+
+        if (node.level == 0) {
+            const int cx0 = node.ix * LEAF_CELLS, cz0 = node.iz * LEAF_CELLS;
+            const int cx1 = std::min(cx0 + LEAF_CELLS, width_ - 1), cz1 = std::min(cz0 + LEAF_CELLS, height_ - 1);
+            if (walkCells(ray, cx0, cx1, cz0, cz1, node.ta, node.tb, hit, stats)) return true;
+            continue;
+        }
+
+        const HeightPyramid::Level& children = pyramid_.level(node.level - 1);
+        const int size = LEAF_CELLS << (node.level - 1);
+        for (int k = 3; k >= 0; --k) {
+            const int cx = node.ix * 2 + order[k][0], cz = node.iz * 2 + order[k][1];
+            if (cx >= children.nodes_x || cz >= children.nodes_z) continue;
+            const float x0 = float(cx * size), z0 = float(cz * size);
+            const float x1 = float(std::min(cx * size + size, width_ - 1)), z1 = float(std::min(cz * size + size, height_ - 1));
+            float cta = node.ta, ctb = node.tb;
+            if (clipBox(ray, x0, x1, z0, z1, cta, ctb)) stack[top++] = { node.level - 1, cx, cz, cta, ctb };
+        }
+    }
+    return false;
+}
+
+bool TerrainRaycaster::raycastDDA(const glm::vec3& origin, const glm::vec3& direction, float max_t, TerrainHit& hit,
+    TerrainRaycastStats* stats) const
+{
+    hit = TerrainHit{};
+    if (empty()) return false;
+    const GridRay ray = gridRay(origin, direction);
+    float ta = 0.0f, tb = max_t;
+    if (!clipBox(ray, 0.0f, float(width_ - 1), 0.0f, float(height_ - 1), ta, tb)) return false;
+    return walkCells(ray, 0, width_ - 1, 0, height_ - 1, ta, tb, hit, stats);
+}
+
+size_t TerrainRaycaster::raycastBatch(const TerrainRay* rays, size_t count, TerrainHit* hits, unsigned thread_count) const {
+    if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+    thread_count = unsigned(std::min<size_t>(thread_count, std::max<size_t>(1, count / MIN_RAYS_PER_THREAD)));
+
+    auto block = [&](size_t b) {
+        const size_t end = std::min(count, (b + 1) * BATCH_BLOCK);
+        for (size_t i = b * BATCH_BLOCK; i < end; ++i)
+            raycast(rays[i].origin, rays[i].direction, rays[i].max_t, hits[i]);
+    };
+    const size_t blocks = (count + BATCH_BLOCK - 1) / BATCH_BLOCK;
+    if (thread_count <= 1) {
+        for (size_t b = 0; b < blocks; ++b) block(b);
+    }
+    else {
+        // blocks are interleaved across threads; rays over flat ground are cheaper
+        std::vector<std::thread> workers;
+        workers.reserve(thread_count);
+        for (unsigned t = 0; t < thread_count; ++t)
+            workers.emplace_back([&, t] {
+                for (size_t b = t; b < blocks; b += thread_count) block(b);
+            });
+        for (std::thread& w : workers) w.join();
+    }
+    return size_t(std::count_if(hits, hits + count, [](const TerrainHit& h) { return h.hit; }));
+}
+
+bool TerrainRaycaster::walkCells(const GridRay& ray, int cx0, int cx1, int cz0, int cz1, float ta, float tb,
+    TerrainHit& hit, TerrainRaycastStats* stats) const
+{
+    // cells [cx0, cx1) x [cz0, cz1); the cell the ray enters at ta, then one
+    // cell boundary at a time (Amanatides & Woo)
+    int c = std::clamp(int(std::floor(ray.x + ta * ray.dx)), cx0, cx1 - 1);
+    int r = std::clamp(int(std::floor(ray.z + ta * ray.dz)), cz0, cz1 - 1);
+    const int step_x = ray.dx > 0.0f ? 1 : -1, step_z = ray.dz > 0.0f ? 1 : -1;
+    float t = ta;
+    for (;;) {
+        const float tx = ray.dx != 0.0f ? (float(ray.dx > 0.0f ? c + 1 : c) - ray.x) * ray.inv_dx : FLT_MAX;
+        const float tz = ray.dz != 0.0f ? (float(ray.dz > 0.0f ? r + 1 : r) - ray.z) * ray.inv_dz : FLT_MAX;
+        const float t_exit = std::min(std::min(tx, tz), tb);
+        if (stats) ++stats->cells;
+        if (hitCell(ray, c, r, t, std::max(t, t_exit), hit)) return true;
+        if (t_exit >= tb) return false;
+        if (tx <= tz) {
+            c += step_x;
+            if (c < cx0 || c >= cx1) return false;
+        }
+        else {
+            r += step_z;
+            if (r < cz0 || r >= cz1) return false;
+        }
+        t = std::max(t, t_exit);
+    }
+}
+
+bool TerrainRaycaster::hitCell(const GridRay& ray, int c, int r, float ta, float tb, TerrainHit& hit) const {
+    const float h00 = sampleY(c, r), h10 = sampleY(c + 1, r), h01 = sampleY(c, r + 1), h11 = sampleY(c + 1, r + 1);
+    const float ya = ray.y + ta * ray.dy, yb = ray.y + tb * ray.dy;
+    if (std::min(ya, yb) > std::max(std::max(h00, h10), std::max(h01, h11))) return false;
+
+    // u - v changes sign where the ray crosses the diagonal; each side is one
+    // triangle, a plane, so ray y minus surface y is linear within it
+    const float u0 = ray.x - float(c), v0 = ray.z - float(r);
+    const float g0 = u0 - v0, dg = ray.dx - ray.dz;
+    float split[3] = { ta, tb, tb };
+    int pieces = 1;
+    if (dg != 0.0f) {
+        const float tm = -g0 / dg;
+        if (tm > ta && tm < tb) {
+            split[1] = tm;
+            pieces = 2;
+        }
+    }
+    for (int p = 0; p < pieces; ++p) {
+        const float s0 = split[p], s1 = split[p + 1];
+        // lower triangle (c, r) - (c + 1, r + 1) - (c + 1, r) where u >= v, upper one otherwise
+        const bool lower = g0 + 0.5f * (s0 + s1) * dg >= 0.0f;
+        const float du = lower ? h10 - h00 : h11 - h01;
+        const float dv = lower ? h11 - h10 : h01 - h00;
+        auto f = [&](float s) { return ray.y + s * ray.dy - (h00 + (u0 + s * ray.dx) * du + (v0 + s * ray.dz) * dv); };
+        const float f0 = f(s0), f1 = f(s1);
+        if (f0 > 0.0f && f1 > 0.0f) continue;
+
+        hit.hit = true;
+        hit.t = f0 <= 0.0f ? s0 : s0 + (s1 - s0) * f0 / (f0 - f1);
+        hit.position = ray.origin + hit.t * ray.direction;
+        hit.normal = glm::normalize(glm::vec3(-du / scale_.x, 1.0f, -dv / scale_.z));
+        return true;
+    }
+    return false;
+}
+
+bool TerrainRaycaster::heightAt(float x, float z, float& y) const {
+    if (empty()) return false;
+    const float u = std::clamp((x - origin_.x) / scale_.x, 0.0f, float(width_ - 1));
+    const float v = std::clamp((z - origin_.z) / scale_.z, 0.0f, float(height_ - 1));
+    const int c = std::min(int(u), width_ - 2), r = std::min(int(v), height_ - 2);
+    const float fu = u - float(c), fv = v - float(r);
+
+    const float h00 = sampleY(c, r), h10 = sampleY(c + 1, r), h01 = sampleY(c, r + 1), h11 = sampleY(c + 1, r + 1);
+    y = fu >= fv ? h00 + fu * (h10 - h00) + fv * (h11 - h10) : h00 + fu * (h11 - h01) + fv * (h01 - h00);
+    return true;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "height_pyramid.hpp"
+
+// Ray queries against a heightmap surface: the triangles buildTerrainMesh
+// makes at step 1 (cell (c, r) split along its (c, r) - (c + 1, r + 1)
+// diagonal), intersected exactly.
+//
+// A min/max pyramid over blocks of LEAF_CELLS x LEAF_CELLS cells lets a ray
+// skip every node it passes over: the quadtree is walked front to back from
+// the root, a node is dropped when the ray's lowest point inside it is above
+// its highest sample, and only leaves the ray dips into are walked cell by
+// cell (DDA). The first hit found is therefore the nearest one.
+
+struct TerrainRay {
+    glm::vec3 origin{ 0.0f };
+    glm::vec3 direction{ 0.0f, -1.0f, 0.0f }; // need not be unit length; t is in its units
+    float max_t{ FLT_MAX };
+};
+
+struct TerrainHit {
+    bool hit{ false };
+    float t{ 0.0f };                // origin + t * direction
+    glm::vec3 position{ 0.0f };
+    glm::vec3 normal{ 0.0f, 1.0f, 0.0f }; // of the triangle hit, world space
+};
+
+struct TerrainRaycastStats {
+    size_t nodes{ 0 };              // pyramid nodes visited
+    size_t cells{ 0 };              // cells whose triangles were tested
+};
+
+class TerrainRaycaster {
+public:
+    static constexpr int LEAF_CELLS = 4;
+
+    // Builds the pyramid; CPU only. heights is row-major 8-bit (row = z,
+    // column = x) and must stay valid while the raycaster lives.
+    void build(const unsigned char* heights, int width, int height, size_t row_stride);
+
+    // World placement: world = origin + scale * model with model y =
+    // height * height_scale (scale.x, scale.z > 0; height_scale may be negative)
+    void setTransform(const glm::vec3& origin, const glm::vec3& scale, float height_scale);
+
+    // First hit along origin + t * direction, 0 <= t <= max_t. A ray that
+    // starts below the surface hits at t = 0.
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float max_t, TerrainHit& hit,
+        TerrainRaycastStats* stats = nullptr) const;
+
+    // First hit between a and b (t in [0, 1]); line of sight is !segment(a, b, hit)
+    bool segment(const glm::vec3& a, const glm::vec3& b, TerrainHit& hit) const { return raycast(a, b - a, 1.0f, hit); }
+
+    // hits[i] for rays[i], rays split in blocks across thread_count threads
+    // (0 = all cores; small batches stay on the calling thread). Returns the
+    // number of rays that hit.
+    size_t raycastBatch(const TerrainRay* rays, size_t count, TerrainHit* hits, unsigned thread_count = 0) const;
+
+    // Reference for benchmarks and checks: the same query walking every cell
+    // along the ray, no pyramid
+    bool raycastDDA(const glm::vec3& origin, const glm::vec3& direction, float max_t, TerrainHit& hit,
+        TerrainRaycastStats* stats = nullptr) const;
+
+    // World y of the surface under world (x, z), clamped to the heightmap's edges
+    bool heightAt(float x, float z, float& y) const;
+
+    // The min/max pyramid (4-cell leaves); ChunkedTerrain reads its chunk
+    // bounds from it
+    const HeightPyramid& pyramid() const { return pyramid_; }
+    int levels() const { return pyramid_.levels(); }
+    size_t bytes() const { return pyramid_.bytes(); }
+    bool empty() const { return heights_ == nullptr; }
+
+    void clear();
+
+private:
+    // The ray in grid space: x, z in pixels, y in world units, all linear in t
+    struct GridRay {
+        float x, z, y;
+        float dx, dz, dy;
+        float inv_dx, inv_dz;
+        glm::vec3 origin, direction; // world, for the hit
+    };
+
+    const unsigned char* heights_{ nullptr };
+    int width_{ 0 }, height_{ 0 };
+    size_t row_stride_{ 0 };
+    HeightPyramid pyramid_;
+
+    glm::vec3 origin_{ 0.0f }, scale_{ 1.0f };
+    float y_per_height_{ 1.0f };    // scale.y * height_scale
+
+    float sampleY(int x, int z) const { return origin_.y + y_per_height_ * float(heights_[size_t(z) * row_stride_ + x]); }
+    // world y range of a node's samples
+    void rangeY(const HeightPyramid::Range& range, float& lo, float& hi) const;
+
+    GridRay gridRay(const glm::vec3& origin, const glm::vec3& direction) const;
+    // clips [ta, tb] to the grid-space box; false if nothing is left
+    bool clipBox(const GridRay& ray, float x0, float x1, float z0, float z1, float& ta, float& tb) const;
+    bool walkCells(const GridRay& ray, int cx0, int cx1, int cz0, int cz1, float ta, float tb, TerrainHit& hit,
+        TerrainRaycastStats* stats) const;
+    bool hitCell(const GridRay& ray, int c, int r, float ta, float tb, TerrainHit& hit) const;
+};
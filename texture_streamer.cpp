@@ -0,0 +1,736 @@
+#include "texture_streamer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+constexpr size_t RING_ALIGNMENT = 64;
+
+// smallest edge a texture in use is trimmed to under budget pressure
+constexpr int MIN_TRIMMED_SIZE = 64;
+
+size_t alignUp(size_t value) { return (value + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1); }
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+GLenum compressedFormat(BlockFormat format) {
+    return format == BlockFormat::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+        : format == BlockFormat::BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_BPTC_UNORM;
+}
+
+std::filesystem::path ddsPath(const std::filesystem::path& file) {
+    return std::filesystem::path(file).replace_extension(".dds");
+}
+
+// Image size without decoding: the PNG IHDR chunk, else a full decode
+bool imageSize(const std::filesystem::path& file, int& width, int& height) {
+    std::ifstream in(file, std::ios::binary);
+    unsigned char header[24];
+    static const unsigned char PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (in.read(reinterpret_cast<char*>(header), sizeof(header)) && std::memcmp(header, PNG_SIGNATURE, 8) == 0) {
+        width = int((header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19]);
+        height = int((header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23]);
+        return width > 0 && height > 0;
+    }
+    cv::Mat image = cv::imread(file.string(), cv::IMREAD_UNCHANGED);
+    width = image.cols;
+    height = image.rows;
+    return !image.empty();
+}
+
+// Re-specifies a level as empty (zero size), which releases it; the levels
+// outside [BASE_LEVEL, MAX_LEVEL] do not take part in completeness
+void releaseLevel(GLenum target, GLint level) {
+    if (target == GL_TEXTURE_2D_ARRAY)
+        glTexImage3D(target, level, GL_RGBA8, 0, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    else
+        glTexImage2D(target, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+}
+
+// The streamer specifies textures through the active unit; the app's
+// binding there is put back afterwards
+class ScopedTextureBinding {
+public:
+    ScopedTextureBinding(GLenum target, GLuint texture) : target(target) {
+        glGetIntegerv(target == GL_TEXTURE_2D_ARRAY ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D, &previous);
+        glBindTexture(target, texture);
+    }
+    ~ScopedTextureBinding() { glBindTexture(target, GLuint(previous)); }
+private:
+    GLenum target;
+    GLint previous{ 0 };
+};
+
+std::string describe(const std::vector<std::filesystem::path>& files) {
+    std::string name = files.empty() ? std::string("(no file)") : files[0].filename().string();
+    if (files.size() > 1) name += " +" + std::to_string(files.size() - 1) + " layers";
+    return name;
+}
+
+} // namespace
+
+void TextureStreamer::init(unsigned thread_count, size_t ring_bytes) {
+    if (!workers.empty()) return;
+
+    // workers read these; set before they start
+    bc1_bc3_supported = GLEW_EXT_texture_compression_s3tc;
+    bc7_supported = GLEW_ARB_texture_compression_bptc;
+
+    if (thread_count == 0) {
+        // all cores but the render thread's; hardware_concurrency() may be 0
+        const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+        thread_count = std::max(1u, hw - 1);
+    }
+    stopping = false;
+    for (unsigned i = 0; i < thread_count; ++i)
+        workers.emplace_back(&TextureStreamer::workerLoop, this);
+
+    ring_size = alignUp(ring_bytes);
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &ring);
+    glNamedBufferStorage(ring, ring_size, nullptr, flags);
+    ring_ptr = static_cast<unsigned char*>(glMapNamedBufferRange(ring, 0, ring_size, flags));
+    if (!ring_ptr) {
+        std::cerr << "[Texture ERROR] Cannot map the upload ring; uploading from client memory\n";
+        glDeleteBuffers(1, &ring);
+        ring = 0;
+        ring_size = 0;
+    }
+    ring_head = 0;
+
+    std::cout << "[Texture] Streaming with " << thread_count << " decode threads, "
+        << (ring_size >> 20) << " MB upload ring\n";
+}
+
+GLuint TextureStreamer::request(const std::filesystem::path& file, const glm::u8vec4& placeholder) {
+    if (workers.empty()) init();
+
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // mutable storage: the real image is specified into the same name later
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &placeholder);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    Resident& resident = residents[texture];
+    resident.files = { file };
+    resident.placeholder = placeholder;
+    resident.last_used = frame;
+    queue(texture, resident);
+    return texture;
+}
+
+GLuint TextureStreamer::requestArray(const std::vector<std::filesystem::path>& files, const glm::u8vec4& placeholder) {
+    if (workers.empty()) init();
+
+    Resident layout;
+    layout.files = files;
+    layout.array = true;
+    layout.placeholder = placeholder;
+    layout.last_used = frame;
+
+    // block compressed only if every layer has a .dds of one format and size
+    bool block_compressed = prefer_compressed && !files.empty();
+    GLint levels = 0;
+    for (const auto& file : files) {
+        CompressedTexture header;
+        std::error_code ec;
+        std::filesystem::path dds = ddsPath(file);
+        if (!block_compressed || !std::filesystem::exists(dds, ec) || !loadDDS(dds, header, true)
+            || !(header.format == BlockFormat::BC7 ? bc7_supported : bc1_bc3_supported)
+            || (levels && (header.format != layout.format || header.width != layout.width || header.height != layout.height))) {
+            block_compressed = false;
+            break;
+        }
+        layout.format = header.format;
+        layout.width = header.width;
+        layout.height = header.height;
+        levels = levels ? std::min(levels, GLint(header.levels.size())) : GLint(header.levels.size());
+    }
+    if (!block_compressed) {
+        // the first readable image decides the layer size
+        layout.width = layout.height = 0;
+        for (const auto& file : files)
+            if (imageSize(file, layout.width, layout.height)) break;
+        if (layout.width == 0) {
+            std::cerr << "[Texture ERROR] No readable image for a texture array (" << files.size() << " layers)\n";
+            layout.width = layout.height = 1;
+        }
+        levels = 1 + GLint(std::floor(std::log2(std::max(layout.width, layout.height))));
+    }
+    layout.block_compressed = block_compressed;
+    layout.levels = levels;
+
+    GLuint texture;
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAX_LEVEL, levels - 1); // a .dds chain may stop above 1x1
+    specifyArrayLevels(texture, layout, 0, levels, true);
+
+    std::cout << "[Texture] Array of " << files.size() << " layers, " << layout.width << "x" << layout.height << " "
+        << (block_compressed ? blockFormatName(layout.format) : "RGBA8") << ", " << levels << " levels\n";
+
+    Resident& resident = residents[texture] = std::move(layout);
+    queue(texture, resident);
+    return texture;
+}
+
+void TextureStreamer::queue(GLuint texture, Resident& resident) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < resident.files.size(); ++i) {
+            Job job;
+            job.texture = texture;
+            job.file = resident.files[i];
+            if (resident.array) {
+                job.layer = int(i);
+                job.width = resident.width;
+                job.height = resident.height;
+                job.block_compressed = resident.block_compressed;
+                job.format = resident.format;
+            }
+            jobs.push_back(std::move(job));
+            ++stats_.requested;
+        }
+    }
+    resident.pending = int(resident.files.size());
+    work_ready.notify_all();
+}
+
+// Mutable storage for levels [first, last) of every layer, filled with the
+// placeholder or left undefined
+void TextureStreamer::specifyArrayLevels(GLuint texture, const Resident& resident, GLint first, GLint last, bool placeholder) {
+    ScopedTextureBinding binding(GL_TEXTURE_2D_ARRAY, texture);
+    const GLsizei layers = resident.layers();
+    const GLenum internal_format = resident.block_compressed ? compressedFormat(resident.format) : GL_RGBA8;
+
+    // compressed formats cannot be cleared: one solid block, repeated
+    uint8_t block[16] = {};
+    if (resident.block_compressed && placeholder) {
+        uint8_t texels[64];
+        for (int i = 0; i < 16; ++i) std::memcpy(texels + 4 * i, &resident.placeholder, 4);
+        if (resident.format == BlockFormat::BC1) encodeBC1Block(texels, block);
+        else if (resident.format == BlockFormat::BC3) encodeBC3Block(texels, block);
+        else encodeBC7Block(texels, block);
+    }
+
+    std::vector<uint8_t> data;
+    for (GLint level = first; level < last; ++level) {
+        const int w = std::max(1, resident.width >> level), h = std::max(1, resident.height >> level);
+        if (!resident.block_compressed) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internal_format, w, h, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            if (placeholder) glClearTexImage(texture, level, GL_RGBA, GL_UNSIGNED_BYTE, &resident.placeholder);
+            continue;
+        }
+        const size_t block_bytes = blockBytes(resident.format);
+        const size_t size = compressedLevelSize(resident.format, w, h) * layers;
+        if (placeholder) {
+            data.resize(size);
+            for (size_t offset = 0; offset < size; offset += block_bytes) std::memcpy(&data[offset], block, block_bytes);
+        }
+        glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, internal_format, w, h, layers, 0, GLsizei(size),
+            placeholder ? data.data() : nullptr);
+    }
+}
+
+void TextureStreamer::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            ++decoding;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Decoded item;
+        static_cast<Job&>(item) = std::move(job);
+        if (item.layer >= 0) {
+            decodeLayer(item);
+        }
+        else if (!loadCompressed(item.file, item.compressed)) {
+            item.compressed.levels.clear();
+            item.image = cv::imread(item.file.string(), cv::IMREAD_UNCHANGED);
+            if (item.image.empty())
+                std::cerr << "[Texture ERROR] Failed to load image: " << item.file.string() << "\n";
+        }
+        double ms = msSince(start);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        --decoding;
+        stats_.decode_ms += ms;
+        decoded.push_back(std::move(item));
+    }
+}
+
+void TextureStreamer::decodeLayer(Decoded& item) const {
+    if (item.block_compressed) {
+        // the array's format is fixed; a mismatching .dds keeps the placeholder
+        std::filesystem::path dds = ddsPath(item.file);
+        if (!loadDDS(dds, item.compressed)) return;
+        if (item.compressed.format != item.format || item.compressed.width != item.width || item.compressed.height != item.height) {
+            std::cerr << "[Texture ERROR] " << dds.string() << " is " << blockFormatName(item.compressed.format) << " "
+                << item.compressed.width << "x" << item.compressed.height << ", its array " << blockFormatName(item.format)
+                << " " << item.width << "x" << item.height << "\n";
+            item.compressed.levels.clear();
+        }
+        return;
+    }
+
+    item.image = cv::imread(item.file.string(), cv::IMREAD_UNCHANGED);
+    if (item.image.empty()) {
+        std::cerr << "[Texture ERROR] Failed to load image: " << item.file.string() << "\n";
+        return;
+    }
+    if (item.image.channels() == 1) cv::cvtColor(item.image, item.image, cv::COLOR_GRAY2BGR); // array is RGBA8
+    if (item.image.cols != item.width || item.image.rows != item.height) {
+        std::cout << "[Texture] " << item.file.filename().string() << " is " << item.image.cols << "x" << item.image.rows
+            << ", resized to its array's " << item.width << "x" << item.height << "\n";
+        cv::resize(item.image, item.image, cv::Size(item.width, item.height), 0, 0, cv::INTER_AREA);
+    }
+}
+
+bool TextureStreamer::loadCompressed(const std::filesystem::path& file, CompressedTexture& texture) const {
+    if (!prefer_compressed) return false;
+    std::filesystem::path dds = file;
+    dds.replace_extension(".dds");
+    std::error_code ec;
+    if (dds == file || !std::filesystem::exists(dds, ec)) return false;
+    if (!loadDDS(dds, texture)) return false;
+
+    bool supported = texture.format == BlockFormat::BC7 ? bc7_supported : bc1_bc3_supported;
+    if (!supported)
+        std::cerr << "[Texture] " << blockFormatName(texture.format) << " not supported by the driver, using "
+            << file.filename().string() << "\n";
+    return supported;
+}
+
+size_t TextureStreamer::Decoded::bytes() const {
+    return compressed.levels.empty() ? image.total() * image.elemSize() : compressed.bytes();
+}
+
+size_t TextureStreamer::update(size_t upload_budget) {
+    auto start = std::chrono::steady_clock::now();
+    retireUploads(false);
+
+    size_t completed = 0, bytes = 0;
+    while (completed == 0 || bytes < upload_budget) {
+        Decoded item;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (decoded.empty()) break;
+            item = std::move(decoded.front());
+            decoded.pop_front();
+        }
+
+        size_t size = item.bytes();
+        if (size == 0) {
+            loadDone(item, false, false);
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats_.failed;
+        }
+        else {
+            size_t offset = 0;
+            if (size <= ring_size && !allocate(size, offset)) {
+                // ring full of uploads the GPU has not read yet: retry next frame
+                std::lock_guard<std::mutex> lock(mutex);
+                decoded.push_front(std::move(item));
+                break;
+            }
+            if (item.compressed.levels.empty()) upload(item, size <= ring_size, offset);
+            else uploadCompressed(item, size <= ring_size, offset);
+            bytes += size;
+        }
+        ++completed;
+    }
+
+    enforceBudget();
+    ++frame;
+
+    const size_t resident_bytes = residentBytes();
+    std::lock_guard<std::mutex> lock(mutex);
+    stats_.upload_ms += msSince(start);
+    stats_.resident_bytes = resident_bytes;
+    return completed;
+}
+
+void TextureStreamer::loadDone(const Decoded& item, bool loaded, bool generate_mipmaps) {
+    auto it = residents.find(item.texture);
+    if (it == residents.end()) return;
+    Resident& resident = it->second;
+    --resident.pending;
+    if (resident.base_level == 0) {
+        if (loaded && generate_mipmaps) glGenerateTextureMipmap(item.texture);
+        return;
+    }
+    // restoring dropped mips: the top levels are complete with the last layer
+    // (an array's failed layer keeps the placeholder they were filled with)
+    if (resident.pending == 0 && (loaded || resident.array)) {
+        resident.base_level = 0;
+        glTextureParameteri(item.texture, GL_TEXTURE_BASE_LEVEL, 0);
+        if (generate_mipmaps) glGenerateTextureMipmap(item.texture);
+    }
+}
+
+size_t TextureStreamer::Resident::levelBytes(GLint level) const {
+    const int w = std::max(1, width >> level), h = std::max(1, height >> level);
+    const size_t layer_bytes = block_compressed ? compressedLevelSize(format, w, h) : size_t(w) * h * texel_bytes;
+    return layer_bytes * size_t(layers());
+}
+
+size_t TextureStreamer::Resident::bytes() const {
+    if (evicted) return size_t(4) * layers(); // 1x1 placeholder
+    size_t total = 0;
+    for (GLint level = base_level; level < levels; ++level) total += levelBytes(level);
+    return total;
+}
+
+size_t TextureStreamer::residentBytes() const {
+    size_t total = 0;
+    for (const auto& [texture, resident] : residents) total += resident.bytes();
+    return total;
+}
+
+void TextureStreamer::touch(GLuint texture) {
+    auto it = residents.find(texture);
+    if (it == residents.end()) return;
+    Resident& resident = it->second;
+    resident.last_used = frame;
+    if (resident.pending > 0) return;
+
+    if (resident.evicted) {
+        reload(texture, resident); // needed now; enforceBudget() makes room
+    }
+    else if (resident.base_level > 0) {
+        // restore only what fits, or the next update() trims it again
+        size_t full = 0;
+        for (GLint level = 0; level < resident.levels; ++level) full += resident.levelBytes(level);
+        if (budget == 0 || residentBytes() - resident.bytes() + full <= budget) reload(texture, resident);
+    }
+}
+
+// Least recently used first. A texture drawn in the last frame only loses
+// its top mip, down to MIN_TRIMMED_SIZE; anything older is evicted.
+void TextureStreamer::enforceBudget() {
+    if (budget == 0) return;
+    size_t total = residentBytes();
+    while (total > budget) {
+        GLuint victim = 0;
+        Resident* candidate = nullptr;
+        for (auto& [texture, resident] : residents) {
+            if (resident.evicted || resident.pending > 0 || resident.bytes() <= size_t(4) * resident.layers()) continue;
+            const bool in_use = resident.last_used + 1 >= frame;
+            const bool trimmable = resident.base_level + 1 < resident.levels
+                && (std::min(resident.width, resident.height) >> (resident.base_level + 1)) >= MIN_TRIMMED_SIZE;
+            if (in_use && !trimmable) continue;
+            if (!candidate || resident.last_used < candidate->last_used
+                || (resident.last_used == candidate->last_used && resident.bytes() > candidate->bytes())) {
+                candidate = &resident;
+                victim = texture;
+            }
+        }
+        if (!candidate) {
+            if (!over_budget_reported)
+                std::cout << "[Texture] " << (total >> 10) << " KB in use, over the " << (budget >> 10)
+                    << " KB budget; nothing left to trim or evict\n";
+            over_budget_reported = true;
+            return;
+        }
+
+        const size_t before = candidate->bytes();
+        if (candidate->last_used + 1 >= frame) dropTopLevel(victim, *candidate);
+        else evict(victim, *candidate);
+        total -= before - candidate->bytes();
+    }
+    over_budget_reported = false;
+}
+
+void TextureStreamer::dropTopLevel(GLuint texture, Resident& resident) {
+    const GLenum target = resident.array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    const GLint level = resident.base_level;
+    const size_t released = resident.levelBytes(level);
+    glTextureParameteri(texture, GL_TEXTURE_BASE_LEVEL, level + 1);
+    {
+        ScopedTextureBinding binding(target, texture);
+        releaseLevel(target, level);
+    }
+    resident.base_level = level + 1;
+
+    std::cout << "[Texture] Dropped mip " << level << " of " << describe(resident.files) << " | now "
+        << std::max(1, resident.width >> resident.base_level) << "x" << std::max(1, resident.height >> resident.base_level)
+        << " | " << (released >> 10) << " KB released\n";
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats_.trimmed_levels;
+}
+
+void TextureStreamer::evict(GLuint texture, Resident& resident) {
+    const GLenum target = resident.array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    const size_t released = resident.bytes();
+    glTextureParameteri(texture, GL_TEXTURE_BASE_LEVEL, 0);
+    {
+        // every level emptied, then level 0 becomes the 1x1 placeholder
+        ScopedTextureBinding binding(target, texture);
+        for (GLint level = 1; level < resident.levels; ++level) releaseLevel(target, level);
+        if (resident.array) {
+            std::vector<glm::u8vec4> texels(resident.layers(), resident.placeholder);
+            glTexImage3D(target, 0, GL_RGBA8, 1, 1, resident.layers(), 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+        }
+        else {
+            glTexImage2D(target, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &resident.placeholder);
+        }
+    }
+    resident.base_level = 0;
+    resident.evicted = true;
+
+    std::cout << "[Texture] Evicted " << describe(resident.files) << " | " << (released >> 10) << " KB released, unused for "
+        << (frame - resident.last_used) << " frames\n";
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats_.evictions;
+}
+
+void TextureStreamer::reload(GLuint texture, Resident& resident) {
+    // arrays are filled layer by layer: their levels need storage first
+    if (resident.evicted && resident.array) specifyArrayLevels(texture, resident, 0, resident.levels, true);
+    else if (resident.array) specifyArrayLevels(texture, resident, 0, resident.base_level, true);
+
+    std::cout << "[Texture] Reloading " << describe(resident.files) << " ("
+        << (resident.evicted ? std::string("evicted") : std::to_string(resident.base_level) + " mips dropped") << ")\n";
+    resident.evicted = false;
+    queue(texture, resident);
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats_.reloads;
+}
+
+void TextureStreamer::upload(Decoded& item, bool through_ring, size_t offset) {
+    const cv::Mat& image = item.image;
+    const int channels = image.channels();
+    const size_t row_bytes = size_t(image.cols) * channels;
+
+    // OpenCV decodes to BGR(A); the upload format swizzles, no conversion pass
+    GLenum internal_format = GL_RGB8, format = GL_BGR;
+    if (channels == 4) { internal_format = GL_RGBA8; format = GL_BGRA; }
+    else if (channels == 1) { internal_format = GL_R8; format = GL_RED; }
+    else if (channels != 3) {
+        std::cerr << "[Texture ERROR] Unsupported number of channels: " << channels << " in " << item.file.string() << "\n";
+        loadDone(item, false, false);
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats_.failed;
+        return;
+    }
+
+    const void* pixels = image.data;
+    cv::Mat continuous;
+    if (through_ring) {
+        unsigned char* dst = ring_ptr + offset;
+        if (image.isContinuous())
+            std::memcpy(dst, image.data, row_bytes * image.rows);
+        else
+            for (int y = 0; y < image.rows; ++y) std::memcpy(dst + y * row_bytes, image.ptr(y), row_bytes);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+        pixels = reinterpret_cast<const void*>(offset);
+    }
+    else {
+        if (!image.isContinuous()) {
+            continuous = image.clone();
+            pixels = continuous.data;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats_.ring_fallbacks;
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // BGR rows are not 4-byte aligned in general
+    if (item.layer >= 0) {
+        glTextureSubImage3D(item.texture, 0, 0, 0, item.layer, image.cols, image.rows, 1, format, GL_UNSIGNED_BYTE, pixels);
+    }
+    else {
+        glBindTexture(GL_TEXTURE_2D, item.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format, image.cols, image.rows, 0, format, GL_UNSIGNED_BYTE, pixels);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        Resident& resident = residents[item.texture];
+        resident.block_compressed = false;
+        resident.texel_bytes = channels == 1 ? 1 : 4; // drivers pad RGB8 to RGBA8
+        resident.width = image.cols;
+        resident.height = image.rows;
+        resident.levels = 1 + GLint(std::floor(std::log2(std::max(image.cols, image.rows))));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (channels == 1) {
+        const GLint gray[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+        glTextureParameteriv(item.texture, GL_TEXTURE_SWIZZLE_RGBA, gray);
+    }
+    loadDone(item, true, true);
+
+    if (through_ring)
+        in_flight.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), offset, alignUp(row_bytes * image.rows) });
+
+    std::cout << "[Texture] Loaded " << item.file.string() << " | " << image.cols << "x" << image.rows
+        << " | channels=" << channels;
+    if (item.layer >= 0) std::cout << " | layer " << item.layer;
+    std::cout << "\n";
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats_.loaded;
+    stats_.bytes += row_bytes * image.rows;
+}
+
+void TextureStreamer::uploadCompressed(Decoded& item, bool through_ring, size_t offset) {
+    const CompressedTexture& tex = item.compressed;
+    const GLenum internal_format = compressedFormat(tex.format);
+
+    if (through_ring) {
+        size_t position = offset;
+        for (const auto& level : tex.levels) {
+            std::memcpy(ring_ptr + position, level.data(), level.size());
+            position += level.size();
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+    }
+    else {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats_.ring_fallbacks;
+    }
+
+    // 2D: re-specified like the uncompressed path; arrays already have their
+    // levels in this format. The file brings its own mips either way.
+    Resident& resident = residents[item.texture];
+    const GLint array_levels = resident.levels;
+    if (item.layer < 0) glBindTexture(GL_TEXTURE_2D, item.texture);
+    int w = tex.width, h = tex.height;
+    size_t position = offset;
+    for (size_t level = 0; level < tex.levels.size(); ++level) {
+        const size_t size = tex.levels[level].size();
+        const void* data = through_ring ? reinterpret_cast<const void*>(position) : tex.levels[level].data();
+        if (item.layer < 0)
+            glCompressedTexImage2D(GL_TEXTURE_2D, GLint(level), internal_format, w, h, 0, GLsizei(size), data);
+        else if (GLint(level) < array_levels)
+            glCompressedTextureSubImage3D(item.texture, GLint(level), 0, 0, item.layer, w, h, 1, internal_format, GLsizei(size), data);
+        position += size;
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    if (item.layer < 0) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glTextureParameteri(item.texture, GL_TEXTURE_MAX_LEVEL, GLint(tex.levels.size()) - 1);
+        resident.block_compressed = true;
+        resident.format = tex.format;
+        resident.width = tex.width;
+        resident.height = tex.height;
+        resident.levels = GLint(tex.levels.size());
+    }
+    loadDone(item, true, false);
+
+    if (through_ring)
+        in_flight.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), offset, alignUp(tex.bytes()) });
+
+    // drivers keep RGB8 as RGBA8, so that is the uncompressed footprint
+    const size_t uncompressed = size_t(tex.width) * tex.height * 4 * 4 / 3;
+    std::cout << "[Texture] Loaded " << std::filesystem::path(item.file).replace_extension(".dds").string() << " | " << tex.width << "x" << tex.height
+        << " | " << blockFormatName(tex.format) << " | " << tex.levels.size() << " levels | " << (tex.bytes() >> 10)
+        << " KB (RGBA8 + mips " << (uncompressed >> 10) << " KB)";
+    if (item.layer >= 0) std::cout << " | layer " << item.layer;
+    std::cout << "\n";
+    std::lock_guard<std::mutex> lock(mutex);
+    ++stats_.loaded;
+    ++stats_.compressed;
+    stats_.bytes += tex.bytes();
+    stats_.saved_bytes += uncompressed > tex.bytes() ? uncompressed - tex.bytes() : 0;
+}
+
+void TextureStreamer::retireUploads(bool wait) {
+    while (!in_flight.empty()) {
+        GLenum status = glClientWaitSync(in_flight.front().fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+            wait ? GLuint64(1000000000) : 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(in_flight.front().fence);
+        in_flight.pop_front();
+    }
+    if (in_flight.empty()) ring_head = 0;
+}
+
+bool TextureStreamer::allocate(size_t size, size_t& offset) {
+    size = alignUp(size);
+    if (size > ring_size) return false;
+    if (in_flight.empty()) ring_head = 0;
+
+    // live region is [tail, head), possibly wrapped past the end
+    const size_t tail = in_flight.empty() ? 0 : in_flight.front().offset;
+    if (in_flight.empty() || ring_head > tail) {
+        if (ring_head + size <= ring_size) {
+            offset = ring_head;
+        }
+        else if (size < tail) {
+            offset = 0; // wrap
+        }
+        else return false;
+    }
+    else if (ring_head + size < tail) {
+        offset = ring_head;
+    }
+    else return false;
+
+    ring_head = offset + size;
+    return true;
+}
+
+bool TextureStreamer::idle() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.empty() && decoding == 0 && decoded.empty();
+}
+
+void TextureStreamer::finish() {
+    while (!idle()) {
+        if (update(SIZE_MAX) == 0) {
+            retireUploads(true); // may be waiting for ring space
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+TextureStreamer::Stats TextureStreamer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats_;
+}
+
+void TextureStreamer::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    work_ready.notify_all();
+    for (std::thread& t : workers) t.join();
+    workers.clear();
+    decoded.clear();
+
+    if (ring) {
+        retireUploads(true);
+        for (const InFlight& f : in_flight) glDeleteSync(f.fence);
+        in_flight.clear();
+        glUnmapNamedBuffer(ring);
+        glDeleteBuffers(1, &ring);
+        ring = 0;
+        ring_ptr = nullptr;
+    }
+}
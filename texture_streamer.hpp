@@ -0,0 +1,186 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "block_compression.hpp"
+
+// Asynchronous texture loading. request() hands out a texture name at once,
+// holding a 1x1 placeholder; worker threads decode the file, and update()
+// (render thread, once per frame) copies finished images into a persistently
+// mapped pixel-unpack ring and re-specifies the same texture from it, then
+// builds the mipmaps. The name never changes, so models and draw code keep it.
+//
+// Uploads use OpenCV's channel order directly (GL_BGR / GL_BGRA), so there is
+// no cvtColor pass; the copy into the ring is the only one on the CPU.
+//
+// A .dds next to the requested file (texture.png -> texture.dds, written by
+// tools/texconv) is preferred: its BC1/BC3/BC7 levels are uploaded as they
+// are, mips included. The PNG stays the fallback for missing or unsupported
+// files.
+//
+// requestArray() packs same-sized material textures into the layers of one
+// GL_TEXTURE_2D_ARRAY, so a single binding serves every draw using them. The
+// layer size and format come from the file headers at request time (BC if
+// every layer has a matching .dds, RGBA8 otherwise); a layer of another size
+// is resized on the worker.
+//
+// Residency: every texture handed out is tracked with its estimated GPU
+// bytes. With a budget set, update() brings the total back under it, least
+// recently touch()ed first: a texture drawn in the last frame loses its top
+// mip (BASE_LEVEL moves down and the level is re-specified empty), anything
+// older is evicted to its placeholder. touch() reloads an evicted texture
+// and restores the dropped mips once they fit again. Storage is mutable
+// (arrays too) so all of this keeps the texture name.
+class TextureStreamer {
+public:
+    struct Stats {
+        size_t requested{ 0 };
+        size_t loaded{ 0 };
+        size_t failed{ 0 };
+        size_t bytes{ 0 };           // pixel data uploaded
+        size_t ring_fallbacks{ 0 };  // images larger than the ring, uploaded from client memory
+        size_t compressed{ 0 };      // loaded from .dds
+        size_t saved_bytes{ 0 };     // VRAM saved by those vs. RGBA8 with mips
+        double decode_ms{ 0.0 };     // summed over the workers
+        double upload_ms{ 0.0 };     // spent in update() on the render thread
+        size_t resident_bytes{ 0 };  // estimated GPU bytes of all textures, as of the last update()
+        size_t evictions{ 0 };       // textures dropped to their placeholder
+        size_t trimmed_levels{ 0 };  // top mips dropped
+        size_t reloads{ 0 };         // evicted or trimmed textures loaded again
+    };
+
+    TextureStreamer() = default;
+    ~TextureStreamer() { shutdown(); }
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // thread_count = 0 uses all cores but one (the render thread)
+    void init(unsigned thread_count = 0, size_t ring_bytes = size_t(64) << 20);
+
+    // Look for block-compressed .dds files first (default on)
+    void setPreferCompressed(bool prefer) { prefer_compressed = prefer; }
+
+    // Estimated GPU bytes the textures may use; 0 = no limit (default)
+    void setBudget(size_t bytes) { budget = bytes; }
+
+    // Marks the texture as drawn this frame (render thread)
+    void touch(GLuint texture);
+
+    // Texture name with a placeholder (rgba8) until the file is loaded; a
+    // failed load keeps the placeholder
+    GLuint request(const std::filesystem::path& file, const glm::u8vec4& placeholder = glm::u8vec4(128, 128, 128, 255));
+
+    // One GL_TEXTURE_2D_ARRAY with files[i] in layer i; every layer holds the
+    // placeholder until its file is loaded
+    GLuint requestArray(const std::vector<std::filesystem::path>& files,
+        const glm::u8vec4& placeholder = glm::u8vec4(128, 128, 128, 255));
+
+    // Uploads finished decodes, about upload_budget bytes per call (at least
+    // one image), then enforces the memory budget; call once per frame.
+    // Returns the number of textures completed.
+    size_t update(size_t upload_budget = size_t(32) << 20);
+
+    // Nothing queued, decoding or waiting for upload
+    bool idle() const;
+
+    // Blocks (uploading as decodes finish) until idle
+    void finish();
+
+    // Stops the workers and releases the ring; loaded textures stay
+    void shutdown();
+
+    Stats stats() const;
+
+private:
+    struct Job {
+        GLuint texture{ 0 };
+        std::filesystem::path file;
+        int layer{ -1 };               // >= 0: layer of an array texture, whose
+        int width{ 0 }, height{ 0 };   // layers have this size and are
+        bool block_compressed{ false }; // block compressed in format if set
+        BlockFormat format{ BlockFormat::BC1 };
+    };
+    struct Decoded : Job {
+        cv::Mat image;                 // BGR(A) from OpenCV, or
+        CompressedTexture compressed;  // levels from a .dds
+        size_t bytes() const;
+    };
+    // Render-thread bookkeeping of one texture for the budget
+    struct Resident {
+        std::vector<std::filesystem::path> files; // one per array layer; a 2D texture has one
+        bool array{ false };
+        glm::u8vec4 placeholder;
+        bool block_compressed{ false };
+        BlockFormat format{ BlockFormat::BC1 };
+        size_t texel_bytes{ 4 };       // uncompressed formats
+        int width{ 1 }, height{ 1 };   // level 0 of the loaded texture
+        GLint levels{ 1 };
+        GLint base_level{ 0 };         // > 0: top mips dropped
+        bool evicted{ false };
+        int pending{ 0 };              // layers still loading
+        uint64_t last_used{ 0 };       // frame of the last touch()
+
+        GLsizei layers() const { return array ? GLsizei(std::max<size_t>(files.size(), 1)) : 1; }
+        size_t levelBytes(GLint level) const;
+        size_t bytes() const;          // what is allocated now
+    };
+    struct InFlight {
+        GLsync fence;
+        size_t offset, size;
+    };
+
+    std::vector<std::thread> workers;
+    mutable std::mutex mutex;
+    std::condition_variable work_ready;
+    std::deque<Job> jobs;
+    std::deque<Decoded> decoded;
+    size_t decoding{ 0 };
+    bool stopping{ false };
+    bool prefer_compressed{ true };
+    bool bc1_bc3_supported{ false }, bc7_supported{ false }; // queried in init()
+
+    // persistently mapped GL_PIXEL_UNPACK_BUFFER used as a ring; a region
+    // is reused once the fence of the upload that read it has signaled
+    GLuint ring{ 0 };
+    unsigned char* ring_ptr{ nullptr };
+    size_t ring_size{ 0 };
+    size_t ring_head{ 0 };
+    std::deque<InFlight> in_flight;
+
+    Stats stats_;
+
+    std::unordered_map<GLuint, Resident> residents;
+    size_t budget{ 0 };
+    uint64_t frame{ 0 };            // update() calls
+    bool over_budget_reported{ false };
+
+    void workerLoop();
+    void retireUploads(bool wait);
+    bool allocate(size_t size, size_t& offset);
+    bool loadCompressed(const std::filesystem::path& file, CompressedTexture& texture) const;
+    void upload(Decoded& item, bool through_ring, size_t offset);
+    void uploadCompressed(Decoded& item, bool through_ring, size_t offset);
+    void decodeLayer(Decoded& item) const;
+    void loadDone(const Decoded& item, bool loaded, bool generate_mipmaps);
+
+    void queue(GLuint texture, Resident& resident);
+    void specifyArrayLevels(GLuint texture, const Resident& resident, GLint first, GLint last, bool placeholder);
+    size_t residentBytes() const;
+    void enforceBudget();
+    void dropTopLevel(GLuint texture, Resident& resident);
+    void evict(GLuint texture, Resident& resident);
+    void reload(GLuint texture, Resident& resident);
+};
@@ -0,0 +1,145 @@
+// texconv.cpp
+// Offline texture converter: PNG/JPG -> .dds (BC1/BC3/BC7, full mip chain)
+// written next to the source, where TextureStreamer picks it up.
+//
+//   texconv [--format auto|bc1|bc3|bc7] [--force] <image or directory>...
+//
+// auto: BC1 for opaque images, BC3 if any texel has alpha < 255. Files whose
+// .dds is newer than the source are skipped unless --force is given.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "../../block_compression.hpp"
+
+namespace {
+
+enum class FormatChoice { Auto, BC1, BC3, BC7 };
+
+bool isImage(const std::filesystem::path& file) {
+    std::string ext = file.extension().string();
+    for (char& c : ext) c = char(std::tolower(static_cast<unsigned char>(c)));
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp" || ext == ".tga";
+}
+
+// PSNR of level 0 against the source, via the reference decoders
+double levelPSNR(const CompressedTexture& tex, const std::vector<uint8_t>& rgba) {
+    void (*decode)(const uint8_t*, uint8_t*) = tex.format == BlockFormat::BC1 ? decodeBC1Block
+        : tex.format == BlockFormat::BC3 ? decodeBC3Block : decodeBC7Block;
+    const int channels = tex.format == BlockFormat::BC1 ? 3 : 4;
+    const uint8_t* block = tex.levels[0].data();
+    double error = 0.0;
+    uint8_t texels[64];
+    for (int by = 0; by < tex.height; by += 4) {
+        for (int bx = 0; bx < tex.width; bx += 4, block += blockBytes(tex.format)) {
+            decode(block, texels);
+            for (int y = by; y < std::min(by + 4, tex.height); ++y)
+                for (int x = bx; x < std::min(bx + 4, tex.width); ++x)
+                    for (int c = 0; c < channels; ++c) {
+                        double d = double(texels[4 * (4 * (y - by) + (x - bx)) + c]) - rgba[4 * (size_t(y) * tex.width + x) + c];
+                        error += d * d;
+                    }
+        }
+    }
+    double mse = error / (double(tex.width) * tex.height * channels);
+    return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0;
+}
+
+bool convert(const std::filesystem::path& file, FormatChoice choice, bool force) {
+    std::filesystem::path dds = file;
+    dds.replace_extension(".dds");
+    std::error_code ec;
+    if (!force && std::filesystem::exists(dds, ec)
+        && std::filesystem::last_write_time(dds, ec) >= std::filesystem::last_write_time(file, ec)) {
+        std::cout << "[texconv] Up to date: " << dds.string() << "\n";
+        return true;
+    }
+
+    cv::Mat image = cv::imread(file.string(), cv::IMREAD_UNCHANGED);
+    if (image.empty()) {
+        std::cerr << "[texconv] Failed to load image: " << file.string() << "\n";
+        return false;
+    }
+    cv::Mat rgba_image;
+    if (image.channels() == 4) cv::cvtColor(image, rgba_image, cv::COLOR_BGRA2RGBA);
+    else if (image.channels() == 3) cv::cvtColor(image, rgba_image, cv::COLOR_BGR2RGBA);
+    else if (image.channels() == 1) cv::cvtColor(image, rgba_image, cv::COLOR_GRAY2RGBA);
+    else {
+        std::cerr << "[texconv] Unsupported number of channels: " << image.channels() << " in " << file.string() << "\n";
+        return false;
+    }
+    const int width = rgba_image.cols, height = rgba_image.rows;
+    std::vector<uint8_t> rgba(size_t(width) * height * 4);
+    for (int y = 0; y < height; ++y)
+        std::memcpy(&rgba[size_t(y) * width * 4], rgba_image.ptr(y), size_t(width) * 4);
+
+    BlockFormat format = BlockFormat::BC1;
+    if (choice == FormatChoice::BC3) format = BlockFormat::BC3;
+    else if (choice == FormatChoice::BC7) format = BlockFormat::BC7;
+    else if (choice == FormatChoice::Auto && hasAlpha(rgba.data(), size_t(width) * height)) format = BlockFormat::BC3;
+
+    auto start = std::chrono::steady_clock::now();
+    CompressedTexture tex;
+    compressImage(rgba.data(), width, height, format, tex);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (!saveDDS(dds, tex)) {
+        std::cerr << "[texconv] Cannot write: " << dds.string() << "\n";
+        return false;
+    }
+
+    // the app used to keep every texture as RGBA8 (RGB8 is padded by drivers) plus mips
+    const size_t uncompressed = size_t(width) * height * 4 * 4 / 3;
+    std::cout << "[texconv] " << file.filename().string() << " -> " << dds.filename().string() << " | " << width << "x" << height
+        << " | " << blockFormatName(format) << " | " << tex.levels.size() << " levels | " << (tex.bytes() >> 10) << " KB vs "
+        << (uncompressed >> 10) << " KB RGBA8 (" << double(uncompressed) / double(tex.bytes()) << "x) | PSNR "
+        << levelPSNR(tex, rgba) << " dB | " << ms << " ms\n";
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    FormatChoice choice = FormatChoice::Auto;
+    bool force = false;
+    std::vector<std::filesystem::path> inputs;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--force") force = true;
+        else if (arg == "--format" && i + 1 < argc) {
+            std::string f = argv[++i];
+            if (f == "auto") choice = FormatChoice::Auto;
+            else if (f == "bc1") choice = FormatChoice::BC1;
+            else if (f == "bc3") choice = FormatChoice::BC3;
+            else if (f == "bc7") choice = FormatChoice::BC7;
+            else {
+                std::cerr << "[texconv] Unknown format: " << f << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+        else inputs.emplace_back(arg);
+    }
+    if (inputs.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--format auto|bc1|bc3|bc7] [--force] <image or directory>...\n";
+        return EXIT_FAILURE;
+    }
+
+    int failed = 0;
+    for (const auto& input : inputs) {
+        if (std::filesystem::is_directory(input)) {
+            for (const auto& entry : std::filesystem::directory_iterator(input))
+                if (entry.is_regular_file() && isImage(entry.path()) && !convert(entry.path(), choice, force)) ++failed;
+        }
+        else if (!convert(input, choice, force)) ++failed;
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
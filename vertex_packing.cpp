@@ -0,0 +1,106 @@
+#include "vertex_packing.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/packing.hpp>
+
+namespace {
+
+// round half away from zero by truncation (std::lround is a library call)
+uint16_t quantizeUnorm16(float v) {
+    return static_cast<uint16_t>(std::clamp(v, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+int16_t quantizeSnorm16(float v) {
+    const float s = std::clamp(v, -1.0f, 1.0f) * 32767.0f;
+    return static_cast<int16_t>(s + (s >= 0.0f ? 0.5f : -0.5f));
+}
+
+float signNotZero(float v) { return v >= 0.0f ? 1.0f : -1.0f; }
+
+} // namespace
+
+glm::vec2 octEncode(const glm::vec3& n) {
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if (l1 <= 0.0f) return glm::vec2(0.0f);
+    glm::vec2 e(n.x / l1, n.y / l1);
+    if (n.z < 0.0f)
+        e = glm::vec2((1.0f - std::abs(e.y)) * signNotZero(e.x), (1.0f - std::abs(e.x)) * signNotZero(e.y));
+    return e;
+}
+
+glm::vec3 octDecode(const glm::vec2& e) {
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+glm::vec3 packedPositionScale(const glm::vec3& bounds_min, const glm::vec3& bounds_max) {
+    return glm::max(bounds_max - bounds_min, glm::vec3(0.0f));
+}
+
+glm::vec3 packedPositionInvScale(const glm::vec3& bounds_min, const glm::vec3& bounds_max) {
+    glm::vec3 scale = packedPositionScale(bounds_min, bounds_max);
+    glm::vec3 inv_scale(0.0f);
+    for (int k = 0; k < 3; ++k)
+        if (scale[k] > 0.0f) inv_scale[k] = 1.0f / scale[k]; // flat axis: every vertex decodes to bounds_min
+    return inv_scale;
+}
+
+void packNormal(const glm::vec3& normal, int16_t (&out)[2]) {
+    glm::vec2 e = octEncode(normal);
+    out[0] = quantizeSnorm16(e.x);
+    out[1] = quantizeSnorm16(e.y);
+}
+
+void packPositionTexcoords(const glm::vec3& position, const glm::vec2& texcoords, const glm::vec3& bounds_min,
+    const glm::vec3& inv_scale, packed_vertex& p)
+{
+    glm::vec3 q = (position - bounds_min) * inv_scale;
+    for (int k = 0; k < 3; ++k) p.position[k] = quantizeUnorm16(q[k]);
+    p.position[3] = 0;
+
+    p.texcoords[0] = glm::packHalf1x16(texcoords.x);
+    p.texcoords[1] = glm::packHalf1x16(texcoords.y);
+}
+
+packed_vertex packVertex(const vertex& v, const glm::vec3& bounds_min, const glm::vec3& inv_scale) {
+    packed_vertex p;
+    packPositionTexcoords(v.position, v.texcoords, bounds_min, inv_scale, p);
+    packNormal(v.normal, p.normal);
+    return p;
+}
+
+void packVertices(const vertex* vertices, size_t count, const glm::vec3& bounds_min, const glm::vec3& bounds_max,
+    std::vector<packed_vertex>& out)
+{
+    const glm::vec3 inv_scale = packedPositionInvScale(bounds_min, bounds_max);
+    out.resize(count);
+    for (size_t i = 0; i < count; ++i) out[i] = packVertex(vertices[i], bounds_min, inv_scale);
+}
+
+void packColors(const vertex* vertices, size_t count, std::vector<uint32_t>& out) {
+    out.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const glm::vec3& c = vertices[i].color;
+        uint32_t r = std::lround(std::clamp(c.x, 0.0f, 1.0f) * 255.0f);
+        uint32_t g = std::lround(std::clamp(c.y, 0.0f, 1.0f) * 255.0f);
+        uint32_t b = std::lround(std::clamp(c.z, 0.0f, 1.0f) * 255.0f);
+        out[i] = r | (g << 8) | (b << 16) | (0xFFu << 24);
+    }
+}
+
+vertex unpackVertex(const packed_vertex& p, const glm::vec3& bounds_min, const glm::vec3& position_scale) {
+    vertex v;
+    glm::vec3 q(p.position[0], p.position[1], p.position[2]);
+    v.position = bounds_min + position_scale * (q / 65535.0f);
+    // GL snorm conversion: max(c / 32767, -1)
+    glm::vec2 e(std::max(p.normal[0] / 32767.0f, -1.0f), std::max(p.normal[1] / 32767.0f, -1.0f));
+    v.normal = octDecode(e);
+    v.texcoords = glm::vec2(glm::unpackHalf1x16(p.texcoords[0]), glm::unpackHalf1x16(p.texcoords[1]));
+    v.color = glm::vec3(1.0f);
+    return v;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "assets.hpp"
+
+// Conversion between the float vertex and packed_vertex. tex.vert decodes
+// packed attributes with the same math as unpackVertex, which serves as the
+// CPU reference for comparing both paths.
+
+enum class VertexFormat {
+    Float,  // interleaved 44-byte vertex
+    Packed  // 16-byte packed_vertex (+ optional RGBA8 color stream)
+};
+
+static_assert(sizeof(packed_vertex) == 16, "packed_vertex must stay 16 bytes");
+
+// Octahedral normal encoding; e is in [-1, 1]^2
+glm::vec2 octEncode(const glm::vec3& n);
+glm::vec3 octDecode(const glm::vec2& e);
+
+// Dequantization the shader applies: position = offset + scale * unorm16
+glm::vec3 packedPositionScale(const glm::vec3& bounds_min, const glm::vec3& bounds_max);
+
+// 1 / packedPositionScale per axis, 0 on a flat axis
+glm::vec3 packedPositionInvScale(const glm::vec3& bounds_min, const glm::vec3& bounds_max);
+
+packed_vertex packVertex(const vertex& v, const glm::vec3& bounds_min, const glm::vec3& inv_scale);
+
+// The two halves of packVertex, for generators that tabulate them (the maze
+// mesher packs each grid line and axis normal once)
+void packNormal(const glm::vec3& normal, int16_t (&out)[2]);
+void packPositionTexcoords(const glm::vec3& position, const glm::vec2& texcoords, const glm::vec3& bounds_min,
+    const glm::vec3& inv_scale, packed_vertex& out);
+
+void packVertices(const vertex* vertices, size_t count, const glm::vec3& bounds_min, const glm::vec3& bounds_max,
+    std::vector<packed_vertex>& out);
+
+// RGBA8 colors for the optional second stream
+void packColors(const vertex* vertices, size_t count, std::vector<uint32_t>& out);
+
+vertex unpackVertex(const packed_vertex& v, const glm::vec3& bounds_min, const glm::vec3& position_scale);